@@ -3,6 +3,7 @@
 
 #include <unordered_map>
 #include <cstdint>
+#include <mutex>
 
 //#include "Component.h"
 #include "ComponentHandle.h"
@@ -12,7 +13,7 @@ namespace Atlas
 
 	/**
 	* Used to assign a unique ID and Bit to a System when
-	* added to the SystemManager.
+	* added to the SystemManager. Handles are shared by every world in the process.
 	*/
 	class SComponentHandleManager
 	{
@@ -38,5 +39,6 @@ namespace Atlas
 		SComponentHandleManager() = delete;	// Not meant for instantiation
 
 		static std::unordered_map<EComponent::Type, FComponentHandle> ComponentMap;	// Map of Components-to-ComponentHandles
+		static std::mutex ComponentMapMutex;
 	};
 }
\ No newline at end of file
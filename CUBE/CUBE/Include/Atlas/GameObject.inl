@@ -13,6 +13,7 @@ namespace Atlas
 	inline void FGameObjectManager::RegisterComponentType()
 	{
 		using ComponentType = ComponentTraits::Object<Type>::Type;
+		FMemoryTagScope MemoryTag(EMemoryTag::GameObjects);
 		mSystemComponents[Type].Init<ComponentType>(DEFAULT_CONTAINER_SIZE);
 	}
 
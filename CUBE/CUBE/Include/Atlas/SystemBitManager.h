@@ -3,11 +3,13 @@
 
 #include <unordered_map>
 #include <typeindex>
+#include <mutex>
 
 namespace Atlas
 {
 	/**
 	* Used to distribute a unique bit identifier to each System created.
+	* Bits are shared by every world in the process.
 	*/
 	class SSystemBitManager
 	{
@@ -36,5 +38,6 @@ namespace Atlas
 
 		static std::bitset<BITSIZE>                                         mNextBit;
 		static std::unordered_map<std::type_index, std::bitset<BITSIZE>>    mSystemBitMap;
+		static std::mutex                                                   mMutex;
 	};
 }
\ No newline at end of file
@@ -1,26 +1,103 @@
 #pragma once
+#include <vector>
 #include "Atlas\System.h"
 #include "FMOD\fmod.hpp"
+#include "Audio\SoundCache.h"
+#include "Math\Vector3.h"
 
 class FAudioListenerSystem;
+struct FSoundEmitter;
+
+namespace EAudioOutput
+{
+	enum Type : uint8_t
+	{
+		Device,  // Mixes to the default sound device
+		Null     // Mixes nothing and plays no sound, for running and benchmarking without a sound device
+	};
+}
 
 /**
 * System that manages the audio engine.
+* Only the MaxVoices most audible playing emitters get a real channel. The other emitters
+* are virtual, they keep their playback time and get a channel again once they are among
+* the most audible.
 */
 class FAudioSystem : public Atlas::ISystem
 {
 public:
-	FAudioSystem(Atlas::FWorld& World);
+	// Default number of emitters that play on a real channel at once
+	static const uint32_t DEFAULT_MAX_VOICES = 32;
+
+	// Emitters that moved less than this since their channel was last updated keep their 3D attributes
+	static const float MOVE_THRESHOLD;
+
+	/**
+	* Audio statistics.
+	*/
+	struct FStats
+	{
+		uint32_t            Emitters;          // Emitters in the world
+		uint32_t            RealVoices;        // Playing emitters with a channel
+		uint32_t            VirtualVoices;     // Playing emitters without a channel
+		uint64_t            AttributeUpdates;  // 3D attribute updates sent to channels
+		uint64_t            Virtualizations;   // Channels taken from emitters that became inaudible
+		FSoundCache::FStats Cache;
+	};
+
+public:
+	FAudioSystem(Atlas::FWorld& World, const EAudioOutput::Type Output = EAudioOutput::Device);
 	~FAudioSystem();
 
 	void Update() override;
 
+	/**
+	* Sets the number of emitters that play on a real channel at once.
+	*/
+	void SetMaxVoices(const uint32_t MaxVoices) { mMaxVoices = MaxVoices; }
+
+	/**
+	* Retrieves the statistics of the audio system.
+	*/
+	FStats GetStats() const;
+
+private:
+	struct FAudibleEmitter
+	{
+		FSoundEmitter* Emitter;
+		Vector3f       Position;
+		float          Audibility;
+	};
+
 private:
 	void OnGameObjectRemove(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent) override;
 	void OnGameObjectAdd(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent) override;
+
+	/**
+	* Starts playing an emitter on a channel from its playback time.
+	*/
+	void Realize(FSoundEmitter& Emitter, const Vector3f& Position);
+
+	/**
+	* Takes the channel of an emitter, keeping its playback time.
+	*/
+	void Virtualize(FSoundEmitter& Emitter);
+
+	/**
+	* Stops an emitter and drops its channel.
+	*/
+	static void StopChannel(FSoundEmitter& Emitter);
+
 private:
 	FMOD::System* mSystem;
 	FAudioListenerSystem* mListenerSubSystem;
+	FSoundCache* mSoundCache;
+
+	std::vector<FAudibleEmitter> mAudible;   // Playing emitters of the current update, the real ones first
+	uint32_t mMaxVoices;
+	uint32_t mRealVoices;
+	uint64_t mAttributeUpdates;
+	uint64_t mVirtualizations;
 };
 
 
@@ -35,9 +112,15 @@ public:
 
 	void Update() override;
 
+	/**
+	* Retrieves the position of the listener as of the last update.
+	*/
+	Vector3f GetListenerPosition() const { return mListenerPosition; }
+
 private:
 	void OnGameObjectAdd(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent) override;
 
 private:
 	FMOD::System* mSystem;
+	Vector3f mListenerPosition;
 };
\ No newline at end of file
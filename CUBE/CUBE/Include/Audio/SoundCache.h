@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "FMOD\fmod.hpp"
+
+namespace ESoundLoad
+{
+	enum Type : uint8_t
+	{
+		Auto,    // Streams files with more sound data than FSoundCache::STREAM_THRESHOLD, decodes the rest
+		Decode,  // Decodes the whole file into memory, shared by every emitter playing it
+		Stream   // Streams the file from disk, every emitter opens its own stream
+	};
+}
+
+/**
+* Reference counted cache of the sounds played by sound emitters. Decoded sounds are
+* loaded once and shared by every emitter playing the same file. Streams can only be
+* played once at a time, so every request for a stream opens a new one.
+* Sounds are opened in the background by FMOD's loader thread, requests return
+* immediately and the sound becomes playable once it finished loading. The Auto policy
+* opens a file as a stream first to find its size, small files are then reopened decoded.
+* Must only be used from the thread that updates the audio system.
+*/
+class FSoundCache
+{
+public:
+	typedef uint32_t SoundID;
+	static const SoundID INVALID_ID = ~0u;
+
+	// Files with more bytes of sound data than this are streamed by the Auto policy
+	static const uint32_t STREAM_THRESHOLD = 1024 * 1024;
+
+	/**
+	* Cache statistics.
+	*/
+	struct FStats
+	{
+		uint64_t Requests;   // Sounds requested
+		uint64_t Hits;       // Requests that shared an already requested sound
+		uint64_t Loads;      // Sounds opened
+		uint64_t Failures;   // Sounds that failed to open
+		uint32_t Resident;   // Sounds in memory or being opened
+		uint32_t Loading;    // Sounds being opened
+		uint32_t Streams;    // Resident sounds that are streams
+	};
+
+public:
+	/**
+	* Constructs a cache for the sounds of an FMOD system.
+	*/
+	explicit FSoundCache(FMOD::System* System);
+
+	/**
+	* Releases all sounds, must be called before the FMOD system is closed.
+	*/
+	~FSoundCache();
+
+	FSoundCache(const FSoundCache& Other) = delete;
+	FSoundCache& operator=(const FSoundCache& Other) = delete;
+
+	/**
+	* Requests a sound, opening it in the background if no emitter holds it yet.
+	* @param Filename - Filepath of the audio file.
+	* @param Looping - Whether streams are opened for looping, decoded sounds loop per channel.
+	* @param Policy - How the file is loaded.
+	* @return The sound, must be released with Release().
+	*/
+	SoundID Acquire(const std::string& Filename, const bool Looping, const ESoundLoad::Type Policy = ESoundLoad::Auto);
+
+	/**
+	* Drops a reference to a sound. The last reference releases the sound.
+	*/
+	void Release(const SoundID ID);
+
+	/**
+	* Retrieves a sound that finished loading.
+	* @return The sound, null while it is loading or if it failed to load.
+	*/
+	FMOD::Sound* GetSound(const SoundID ID) const;
+
+	/**
+	* Checks if a sound failed to load and will never become playable.
+	*/
+	bool HasFailed(const SoundID ID) const;
+
+	/**
+	* Retrieves the length of a sound that finished loading, in seconds.
+	*/
+	float GetLength(const SoundID ID) const;
+
+	/**
+	* Polls the sounds being opened and releases unreferenced sounds that finished opening.
+	*/
+	void Update();
+
+	/**
+	* Retrieves the statistics of the cache.
+	*/
+	FStats GetStats() const;
+
+private:
+	struct ESoundState
+	{
+		enum : uint8_t { Loading, Ready, Failed };
+	};
+
+	struct FEntry
+	{
+		std::string  Filename;
+		FMOD::Sound* Sound;
+		float        Length;
+		uint32_t     RefCount;
+		uint8_t      State;
+		bool         IsStream;
+		bool         IsProbing;  // Opened as a stream to find the size of the file for the Auto policy
+	};
+
+	/**
+	* Picks the load policy of a probed sound and reopens it decoded if it is small.
+	* @return False if the sound is still loading.
+	*/
+	bool FinishProbe(const SoundID ID);
+
+	/**
+	* Releases the sound of an entry and makes the entry reusable.
+	*/
+	void FreeEntry(const SoundID ID);
+
+private:
+	FMOD::System*                            mSystem;
+	std::vector<FEntry>                      mEntries;
+	std::vector<SoundID>                     mFreeEntries;
+	std::unordered_map<std::string, SoundID> mDecodedSounds;  // Shared decoded sounds by filename
+	std::vector<SoundID>                     mLoading;        // Sounds still being opened
+	std::unordered_map<std::string, ESoundLoad::Type> mAutoPolicies;  // Policies the Auto policy picked for probed files
+	FStats                                   mStats;
+};
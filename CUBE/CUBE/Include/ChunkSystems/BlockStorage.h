@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+
+#include "Memory\ConcurrentPoolAllocator.h"
+#include "Common.h"
+#include "Block.h"
+#include "BlockTypes.h"
+
+/**
+* Read-only view of the block layout of a chunk. The layout is split into pages
+* of one y layer each, pages are reference counted so they can be shared between
+* layouts and between the layers of a layout.
+*/
+class FBlockLayout
+{
+public:
+	// Dimensions of the layout, must match FChunk::CHUNK_SIZE
+	static const int32_t SIZE = 32;
+	static const int32_t PAGE_COUNT = SIZE;
+	static const int32_t BLOCKS_PER_PAGE = SIZE * SIZE;
+
+	/**
+	* The blocks of one y layer, indexed like a layer of FChunk::BlockIndex().
+	*/
+	WIN_ALIGN(16)
+	struct FPage
+	{
+		FPage()
+			: Blocks()
+			, RefCount()
+		{
+			RefCount = 1;
+		}
+
+		FBlock                Blocks[BLOCKS_PER_PAGE];
+		std::atomic<uint32_t> RefCount;
+	};
+
+	// Pool of pages, each world has one for the layouts of its chunks. Can be used from any thread.
+	static const uint32_t POOL_CAPACITY = 4096 * PAGE_COUNT;
+	using FPageAllocator = FConcurrentPoolAllocatorType<FPage, 64>;
+
+public:
+	/**
+	* Retrieves a block from its index in the layout.
+	*/
+	FBlock GetBlock(const int32_t Index) const
+	{
+		return mPages[Index / BLOCKS_PER_PAGE]->Blocks[Index % BLOCKS_PER_PAGE];
+	}
+
+	/**
+	* Retrieves the blocks of a y layer.
+	*/
+	const FBlock* GetLayer(const int32_t Y) const { return mPages[Y]->Blocks; }
+
+	/**
+	* Retrieves the version of the layout. The version changes every time a block is
+	* written or the layout is replaced, and never goes back to an earlier value.
+	*/
+	uint32_t GetVersion() const { return mVersion; }
+
+	/**
+	* Copies the layout into contiguous memory, in the order of FChunk::BlockIndex().
+	* @param BlocksOut - Memory for SIZE^3 blocks.
+	*/
+	void CopyTo(FBlock* BlocksOut) const;
+
+	/**
+	* Computes a hash of the layout, used to check if data built from
+	* an earlier layout is stale.
+	*/
+	uint64_t Hash() const;
+
+	/**
+	* Checks if every block has the same type.
+	* @param IDOut - The type of every block, if uniform.
+	*/
+	bool IsUniform(FBlockTypes::BlockID& IDOut) const;
+
+	/**
+	* Retrieves the number of layers from the bottom up to the highest
+	* non-air block, 0 if the layout only holds air.
+	*/
+	uint32_t GetHeight() const;
+
+protected:
+	explicit FBlockLayout(FPageAllocator* PageAllocator);
+	~FBlockLayout() = default;
+
+	/**
+	* Drops the references to all pages.
+	*/
+	void ReleasePages();
+
+	static void AddPageReference(FPage* Page);
+	void RemovePageReference(FPage* Page);
+
+protected:
+	FPage*          mPages[PAGE_COUNT];  // Null while the layout holds no blocks
+	uint32_t        mVersion;
+	FPageAllocator* mPageAllocator;      // Pool the pages are from, null for an empty snapshot
+};
+
+/**
+* Immutable copy of a chunk's block layout made by FBlockStorage::Snapshot(). The
+* snapshot shares the pages of the layout, so taking it only copies PAGE_COUNT
+* pointers. Snapshots can be read from any thread while the chunk is edited.
+*/
+class FBlockSnapshot : public FBlockLayout
+{
+public:
+	FBlockSnapshot();
+	FBlockSnapshot(FBlockSnapshot&& Other);
+	FBlockSnapshot& operator=(FBlockSnapshot&& Other);
+
+	FBlockSnapshot(const FBlockSnapshot& Other) = delete;
+	FBlockSnapshot& operator=(const FBlockSnapshot& Other) = delete;
+
+	/**
+	* Releases the pages of the snapshot, pages no longer shared return to the pool.
+	*/
+	~FBlockSnapshot();
+
+	/**
+	* Checks if the snapshot holds any blocks.
+	*/
+	bool IsValid() const { return mPages[0] != nullptr; }
+
+private:
+	friend class FBlockStorage;
+};
+
+/**
+* Copy-on-write block layout of a chunk. Pages shared with snapshots or other layers
+* are copied the first time one of their blocks is written, so a write only copies
+* the layer it touches and never changes the blocks a snapshot sees.
+* Single blocks are read and written with the pages locked, so blocks can be edited
+* while another thread replaces or releases the layout. Whole layouts are read through snapshots.
+*/
+class FBlockStorage : protected FBlockLayout
+{
+public:
+	using FBlockLayout::GetVersion;
+
+	/**
+	* Constructs an empty layout.
+	* @param PageAllocator - Pool to allocate pages from, must outlive the layout and its snapshots.
+	*/
+	explicit FBlockStorage(FPageAllocator& PageAllocator);
+
+	FBlockStorage(const FBlockStorage& Other) = delete;
+	FBlockStorage& operator=(const FBlockStorage& Other) = delete;
+
+	/**
+	* Releases the pages of the layout.
+	*/
+	~FBlockStorage();
+
+	/**
+	* Replaces the layout with a copy of contiguous blocks. Layers identical
+	* to the layer below them share its page.
+	* @param Blocks - SIZE^3 blocks in the order of FChunk::BlockIndex().
+	*/
+	void Assign(const FBlock* Blocks);
+
+	/**
+	* Replaces the layout with blocks of a single type, every layer shares one page.
+	*/
+	void Fill(const FBlockTypes::BlockID ID);
+
+	/**
+	* Drops all blocks of the layout, returning pages no snapshot holds to the pool.
+	*/
+	void Release();
+
+	/**
+	* Writes a block, copying its page first if the page is shared. Can be called from any thread.
+	* @param Index - The index of the block in the layout.
+	* @param Block - The new block.
+	* @param ReplacedOut - Optional, receives the block that was written over.
+	* @return False if the layout holds no blocks, nothing is written then.
+	*/
+	bool SetBlock(const int32_t Index, const FBlock Block, FBlock* ReplacedOut = nullptr);
+
+	/**
+	* Reads a block of the current layout. Can be called from any thread.
+	* @param Index - The index of the block in the layout.
+	* @param BlockOut - Receives the block, left unchanged if the layout holds no blocks.
+	* @return False if the layout holds no blocks.
+	*/
+	bool ReadBlock(const int32_t Index, FBlock& BlockOut) const;
+
+	/**
+	* Takes an immutable snapshot of the current layout. Can be called from any thread.
+	*/
+	FBlockSnapshot Snapshot() const;
+
+	/**
+	* Retrieves the version of the layout, can be called from any thread.
+	*/
+	uint32_t GetCurrentVersion() const;
+
+private:
+	// Guards the page pointers and version against snapshots taken by other threads
+	mutable std::mutex mPageMutex;
+};
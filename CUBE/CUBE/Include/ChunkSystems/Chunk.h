@@ -4,15 +4,19 @@
 #include <cstdint>
 #include <atomic>
 
-#include "Memory\PoolAllocator.h"
+#include "Memory\ConcurrentPoolAllocator.h"
+#include "Memory\ScratchArena.h"
 #include "Common.h"
 #include "Block.h"
+#include "ChunkCodec.h"
 #include "BulletPhysics\btBulletCollisionCommon.h"
 #include "Rendering\GLBindings.h"
 #include "ChunkMesh.h"
 #include "BlockTypes.h"
+#include "BlockStorage.h"
 
 class FChunkManager;
+class FChunkGenerator;
 class FPhysicsSystem;
 
 /**
@@ -49,11 +53,80 @@ public:
 	static const int32_t CHUNK_SIZE = 32;
 	static const int32_t BLOCKS_PER_CHUNK = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
 
-	// Memory pools
-	static const uint32_t POOL_SIZE = 30000;
-	static FPoolAllocator<sizeof(FBlock) * BLOCKS_PER_CHUNK, POOL_SIZE> ChunkAllocator;
-	static FPoolAllocatorType<FChunkMesh, POOL_SIZE> MeshAllocator;
-	static FPoolAllocatorType<CollisionData, POOL_SIZE> CollisionAllocator;
+	// Max size, in bytes, of the encoded block layout of a chunk for any codec.
+	// RLE is the largest, with a block type and length for each block.
+	static const uint32_t MAX_ENCODED_SIZE = 2 * BLOCKS_PER_CHUNK;
+
+	/**
+	* A quad produced by GreedyMesh(), in chunk space. The geometry is packed so
+	* meshes can be stored compactly. From the low bits: the layer along the quad's
+	* normal axis (6 bits), its position on the other two axes (5 bits each), its width
+	* and height minus 1 (5 bits each) and the side it faces (3 bits).
+	* Occlusion holds the ambient occlusion of the quad's corners, 2 bits each, in the
+	* order (-u, -v), (+u, -v), (+u, +v), (-u, +v) from the low bits.
+	*/
+	struct MeshQuad
+	{
+		uint32_t             Geometry;
+		FBlockTypes::BlockID BlockType;
+		uint8_t              Occlusion;
+	};
+
+	/**
+	* Layers of faces to re-mesh after blocks of a chunk changed, one bit for each of
+	* the CHUNK_SIZE + 1 layers along each axis. A block touches 2 layers on each axis.
+	*/
+	struct MeshPatch
+	{
+		uint64_t Layers[3];
+
+		/**
+		* Adds the layers touched by a block.
+		* @param LocalPosition - The position of the block within the chunk.
+		*/
+		void AddBlock(const Vector3i& LocalPosition);
+
+		/**
+		* Retrieves the number of layers to re-mesh.
+		*/
+		uint32_t LayerCount() const;
+	};
+
+	// Address space is reserved for POOL_CAPACITY chunks in each world's pools
+	static const uint32_t POOL_CAPACITY = 4096;
+
+	/**
+	* Memory pools of the chunks of one world. Pools commit memory in blocks as
+	* chunks are created and grow when needed, and can be used from any thread.
+	* The pools must outlive the chunks allocated from them and every snapshot of
+	* their blocks.
+	*/
+	struct FAllocators
+	{
+		FAllocators();
+
+		/**
+		* Returns memory cached by the calling thread to the pools so other threads
+		* can reuse it. Should be called by threads that created or destroyed chunks
+		* before they exit.
+		*/
+		void FlushThreadCaches();
+
+		/**
+		* Returns unused memory to the OS. Only call this when no other
+		* thread is creating or destroying chunks.
+		*/
+		void Trim();
+
+		/**
+		* Retrieves the number of bytes backed by physical memory.
+		*/
+		size_t CommittedBytes();
+
+		FBlockLayout::FPageAllocator                    PageAllocator;
+		FConcurrentPoolAllocatorType<FChunkMesh, 256>    MeshAllocator;
+		FConcurrentPoolAllocatorType<CollisionData, 64>  CollisionAllocator;
+	};
 
 public:
 	/**
@@ -65,8 +138,9 @@ public:
 public:
 	/**
 	* Constructs chunk of voxels.
+	* @param Allocators - Pools of the world the chunk is in.
 	*/
-	FChunk();
+	explicit FChunk(FAllocators& Allocators);
 
 	FChunk(const FChunk& Other) = delete;
 	FChunk& operator=(const FChunk& Other) = delete;
@@ -79,16 +153,38 @@ public:
 	/**
 	* Allocates and builds chunk data. Chunk meshes will still need to 
 	* be built before rendering.
-	* @param BlockData - RLE block layout for this chunk.
-	* @return True if the chunk is not empty, false otherwise.
+	* @param BlockData - Encoded block layout for this chunk. If null, the chunk is filled with air.
+	* @param DataSize - Size of the block layout in bytes.
+	* @param Codec - ID of the codec the block layout was encoded with.
+	* @return True if the chunk is empty, false otherwise.
 	*/
-	bool Load(const std::vector<uint8_t>& BlockData);
+	bool Load(const uint8_t* BlockData, const uint32_t DataSize, const uint8_t Codec);
 
 	/**
 	* Frees block and mesh data.
-	* @param BlockDataOut - Memory to place RLE block layout for this chunk.
+	* @param BlockDataOut - Memory to place the encoded block layout for this chunk. Must hold at least MAX_ENCODED_SIZE bytes.
+	* @param Codec - The codec to encode the block layout with.
+	* @return The size of the block layout in bytes.
+	*/
+	uint32_t Unload(uint8_t* BlockDataOut, const EChunkCodec::Type Codec);
+
+	/**
+	* Fills the chunk's blocks with the layout the generator builds for its position,
+	* used for chunks that are not in the world's region files. The chunk is not
+	* flagged as modified, so it is only saved if its blocks are changed.
+	* @param Generator - The generator to build the layout with.
+	* @param ChunkPosition - The chunk space position of this chunk.
+	* @return True if the chunk is empty, false otherwise.
+	*/
+	bool Generate(FChunkGenerator& Generator, const Vector3i& ChunkPosition);
+
+	/**
+	* Allocates chunk data and fills every block with the same type, used for
+	* chunks known to be uniform without reading their block layout.
+	* @param ID - The type of every block.
+	* @return True if the chunk is empty, false otherwise.
 	*/
-	void Unload(std::vector<uint8_t>& BlockDataOut);
+	bool Fill(const FBlockTypes::BlockID ID);
 
 	/**
 	* Removes data held by this chunk from external services.
@@ -97,13 +193,61 @@ public:
 
 	/**
 	* Builds/Rebuilds this chunks' mesh.
+	* @param WorldPosition - The world space position of this chunk.
+	* @param Blocks - Snapshot of the block layout to mesh.
+	*/
+	void RebuildMesh(const Vector3f& WorldPosition, const FBlockSnapshot& Blocks);
+
+	/**
+	* Builds/Rebuilds this chunks' mesh from quads made by GreedyMesh(), skipping the meshing.
+	* @param WorldPosition - The world space position of this chunk.
+	* @param Quads - The quads of the block layout.
+	* @param QuadCount - The number of quads.
+	* @param BlockVersion - Version of the block layout the quads were made from.
+	*/
+	void RebuildMesh(const Vector3f& WorldPosition, const MeshQuad* Quads, const uint32_t QuadCount, const uint32_t BlockVersion);
+
+	/**
+	* Re-meshes only the given layers of faces and replaces their slices of the current mesh.
+	* Only the changed slices are uploaded by the next buffer swap.
+	* @param WorldPosition - The world space position of this chunk.
+	* @param Blocks - Snapshot of the block layout, taken after the layers were added to the patch.
+	* @param Patch - The layers of faces that changed since the mesh was built.
+	* @param HasPendingSwap - Whether a mesh built since the last buffer swap is waiting to be swapped in.
+	*/
+	void PatchMesh(const Vector3f& WorldPosition, const FBlockSnapshot& Blocks, const MeshPatch& Patch, const bool HasPendingSwap);
+
+	/**
+	* Voxel mesh algorithm to minimize triangle count on chunk meshes.
+	* Algorithm by Mikola Lysenko from http://0fps.net/2012/06/30/meshing-in-a-minecraft-game/
+	* @param Blocks - The block layout to mesh.
+	* @param QuadsOut - Array to add the chunk space quads of the mesh to.
+	*/
+	static void GreedyMesh(const FBlockLayout& Blocks, TScratchArray<MeshQuad>& QuadsOut);
+
+	/**
+	* Takes an immutable snapshot of the block layout. Meshing and other work off the
+	* main thread reads blocks through snapshots, so edits made meanwhile are not seen.
 	*/
-	void RebuildMesh(const Vector3f& WorldPosition);
+	FBlockSnapshot Snapshot() const { return mBlocks.Snapshot(); }
 
 	/**
-	* Swaps the currently used mesh for rendering.
+	* Checks if the mesh waiting to be swapped in was built from an older block
+	* layout than the current one.
 	*/
-	void SwapMeshBuffer(FPhysicsSystem& PhysicsSystem);
+	bool IsMeshStale() const { return mMeshVersion != mBlocks.GetCurrentVersion(); }
+
+	/**
+	* Swaps the currently used mesh for rendering and collision.
+	* @param PhysicsSystem - The physics system the collider of the chunk is in.
+	* @param UploadMesh - Whether to upload the mesh for rendering, only the collider is updated otherwise.
+	*/
+	void SwapMeshBuffer(FPhysicsSystem& PhysicsSystem, const bool UploadMesh = true);
+
+	/**
+	* Discards a mesh built since the last buffer swap, used when the swap is cancelled.
+	*/
+	void DiscardMesh();
 
 	/**
 	* Checks if the chunk has been loaded.
@@ -116,7 +260,7 @@ public:
 	void Render(const GLenum RenderMode = GL_TRIANGLES);
 
 	/**
-	* Set a block in the chunk at a specific position.
+	* Set a block in the chunk at a specific position. Does nothing if the chunk is not loaded.
 	*/
 	void SetBlock(const Vector3i& Position, FBlockTypes::BlockID ID);
 
@@ -127,7 +271,7 @@ public:
 
 	/**
 	* Destroys a block in the chunk at a specific position.
-	* @return ID of the block that was destroyed.
+	* @return ID of the block that was destroyed, air if the chunk is not loaded.
 	*/
 	FBlockTypes::BlockID DestroyBlock(const Vector3i& Position);
 
@@ -136,6 +280,29 @@ public:
 	*/
 	bool IsEmpty() const { return mIsEmpty; }
 
+	/**
+	* Checks if blocks in this chunk changed since it was loaded.
+	* Chunks that aren't modified don't need to be written back to file.
+	*/
+	bool IsModified() const { return mIsModified; }
+
+	/**
+	* Flags this chunk as changed, used when the loaded layout
+	* was never written to file.
+	*/
+	void MarkModified() { mIsModified = true; }
+
+	/**
+	* Leaves the chunk without a mesh, used for chunks that can't be seen because
+	* they are enclosed by solid chunks. Cleared when the mesh is next built.
+	*/
+	void SkipMesh() { mIsMeshSkipped = true; }
+
+	/**
+	* Checks if the mesh of the chunk was skipped with SkipMesh().
+	*/
+	bool IsMeshSkipped() const { return mIsMeshSkipped; }
+
 private:
 	// Constants used for constructing quads with correct normals in GreedyMesh()
 	struct NormalID
@@ -153,10 +320,38 @@ private:
 
 private:
 	/**
-	* Voxel mesh algorithm to minimize triangle count on chunk meshes.
-	* Algorithm by Mikola Lysenko from http://0fps.net/2012/06/30/meshing-in-a-minecraft-game/
+	* Retrieves the mesh slice that holds quads of a side and layer.
+	*/
+	static uint32_t SliceIndex(const uint32_t Side, const uint32_t Layer);
+
+	/**
+	* Greedy meshes the faces of one side in one layer of the chunk.
+	* @param Blocks - The block layout to mesh.
+	* @param d - The axis of the layer.
+	* @param Layer - The layer, faces between blocks Layer - 1 and Layer along the axis.
+	* @param BackFace - Whether to mesh the faces pointing towards the negative axis.
+	* @param QuadsOut - Array to add the chunk space quads to.
+	*/
+	static void MeshSlice(const FBlockLayout& Blocks, const int32_t d, const int32_t Layer, const bool BackFace, TScratchArray<MeshQuad>& QuadsOut);
+
+	/**
+	* Computes the ambient occlusion of the corners of a face from the blocks next to it.
+	* @param Blocks - The block layout being meshed.
+	* @param AirSide - Position of the block the face points into.
+	* @param u, v - The axes of the face's plane.
+	* @return Occlusion of the corners, packed as in MeshQuad.
+	*/
+	static uint8_t FaceOcclusion(const FBlockLayout& Blocks, const int32_t AirSide[3], const int32_t u, const int32_t v);
+
+	/**
+	* Adds the vertices and indices of a quad made by GreedyMesh().
+	*/
+	void ExpandQuad(const MeshQuad& Quad, const Vector3f& WorldPosition, FChunkMesh::VertexData& VerticesOut, FChunkMesh::IndexData& IndicesOut);
+
+	/**
+	* Builds the inactive collision mesh from the mesh back buffer.
 	*/
-	void GreedyMesh(const Vector3f WorldPosition);
+	void BuildCollisionMesh();
 
 	/**
 	* Adds a quad from 4 vertices based on if the quad is backfaced, the direction of the surface,
@@ -169,6 +364,7 @@ private:
 	* @param IsBackFace - Used to specify vertex ordering.
 	* @param Side - Direction the surface is facing
 	* @param Type - The type of block the quad is used for.
+	* @param Occlusion - Ambient occlusion of the corners, packed as in MeshQuad.
 	* @param VerticesOut - Location to place vertex data.
 	* @param IndicesOut - Location to place index data.
 	*/
@@ -179,14 +375,19 @@ private:
 					const bool IsBackface, 
 					const uint32_t Side, 
 					const FBlock BlockType,
+					const uint8_t Occlusion,
 					FChunkMesh::VertexData& VerticesOut,
 					FChunkMesh::IndexData& IndicesOut);
 
 private:
-	FBlock* mBlocks;
+	FAllocators& mAllocators;
+	FBlockStorage mBlocks;
+	uint32_t mMeshVersion;  // Version of the block layout the mesh waiting to be swapped in was built from
 	FChunkMesh* mMesh;
 	CollisionData* mCollisionData;
 
 	std::atomic_bool mIsLoaded;
 	std::atomic_bool mIsEmpty;
+	std::atomic_bool mIsModified;
+	std::atomic_bool mIsMeshSkipped;
 };
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include "Block.h"
+
+/**
+* Codecs used to store chunk block layouts. The ID of each codec is
+* stored with the chunk's data in region files, so IDs must never change.
+*/
+namespace EChunkCodec
+{
+	enum Type : uint8_t
+	{
+		RLE,     // Byte pairs of block type and run length. Used by all worlds before codecs were added.
+		LZ,      // Byte oriented LZ77 compression of the raw block layout.
+		Palette, // Palette of block types used, followed by bitpacked palette indices.
+		Count
+	};
+}
+
+/**
+* Interface for encoding and decoding the block layout of a chunk.
+*/
+class IChunkCodec
+{
+public:
+	virtual ~IChunkCodec() {}
+
+	/**
+	* Encodes the blocks of a chunk.
+	* @param Blocks - The BLOCKS_PER_CHUNK blocks of a chunk.
+	* @param DataOut - Memory to place encoded data. Must hold at least FChunk::MAX_ENCODED_SIZE bytes.
+	* @return The size of the encoded data in bytes.
+	*/
+	virtual uint32_t Encode(const FBlock* Blocks, uint8_t* DataOut) const = 0;
+
+	/**
+	* Decodes the blocks of a chunk.
+	* @param Data - Encoded data.
+	* @param DataSize - Size of the encoded data in bytes.
+	* @param BlocksOut - Memory for the BLOCKS_PER_CHUNK blocks of a chunk.
+	* @return False if the data is malformed.
+	*/
+	virtual bool Decode(const uint8_t* Data, const uint32_t DataSize, FBlock* BlocksOut) const = 0;
+
+	/**
+	* Name of the codec for display.
+	*/
+	virtual const wchar_t* GetName() const = 0;
+};
+
+/**
+* Registry of all chunk codecs.
+*/
+class SChunkCodecs
+{
+public:
+	/**
+	* Statistics gathered while re-encoding a world.
+	*/
+	struct FReencodeReport
+	{
+		uint32_t ChunkCount;
+		uint64_t RawBytes;        // Size of all decoded chunks
+		uint64_t EncodedBytes;    // Size of all chunks with the new codec
+		float    DecodeSeconds;   // Time spent decoding the new encoding
+		float    LoadSeconds;     // Time spent reading and decoding the new encoding from file
+	};
+
+public:
+	/**
+	* Retrieves a codec by ID.
+	* @return The codec, or nullptr if the ID is unknown.
+	*/
+	static const IChunkCodec* Get(const uint8_t CodecID);
+
+	/**
+	* Retrieves a codec ID by name.
+	* @return The codec ID, or EChunkCodec::Count if the name is unknown.
+	*/
+	static EChunkCodec::Type Find(const wchar_t* Name);
+
+	/**
+	* Gets the codec chunks are written with.
+	*/
+	static EChunkCodec::Type GetDefault();
+
+	/**
+	* Sets the codec chunks are written with. Chunks stored with
+	* other codecs can still be read.
+	*/
+	static void SetDefault(const EChunkCodec::Type Codec);
+
+	/**
+	* Offline tool that rewrites every chunk of a world on file with a specific codec.
+	* Used for converting existing worlds and comparing codecs.
+	* @param WorldName - Name of the world in the Worlds directory.
+	* @param Codec - The codec to store chunks with.
+	* @param ReportOut - Optional statistics for the new encoding.
+	* @return False if the world could not be found.
+	*/
+	static bool ReencodeWorld(const wchar_t* WorldName, const EChunkCodec::Type Codec, FReencodeReport* ReportOut = nullptr);
+
+private:
+	static std::atomic<uint8_t> mDefaultCodec;
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Math\Vector3.h"
+#include "BlockTypes.h"
+#include "Block.h"
+
+/**
+* Generates chunk layouts on demand from a seed. Terrain heights come from integer
+* value noise, so a chunk is generated the same, bit for bit, on every platform and
+* in any order. Terrain heights of recently generated chunk columns are cached,
+* so chunks stacked on top of each other only sample the noise once.
+* Generation is not synchronized, each thread needs its own generator.
+*/
+class FChunkGenerator
+{
+public:
+	// Number of chunk columns with cached terrain heights
+	static const uint32_t HEIGHT_CACHE_SIZE = 64;
+
+	// Maximum number of noise octaves
+	static const uint32_t MAX_OCTAVE_COUNT = 16;
+
+public:
+	/**
+	* Constructs a generator with a seed.
+	*/
+	FChunkGenerator(const uint32_t Seed = 0);
+
+	FChunkGenerator(const FChunkGenerator& Other) = delete;
+	FChunkGenerator& operator=(const FChunkGenerator& Other) = delete;
+
+	/**
+	* Sets the seed used for the terrain noise.
+	*/
+	void SetSeed(const uint32_t Seed);
+
+	/**
+	* Retrieves the seed used for the terrain noise.
+	*/
+	uint32_t GetSeed() const { return mSeed; }
+
+	/**
+	* Sets the minimum height, in world coordinates, that the terrain will reach.
+	*/
+	void SetMinHeight(const int32_t MinHeight);
+
+	/**
+	* Sets the maximum height, in world coordinates, that the terrain will reach.
+	*/
+	void SetMaxHeight(const int32_t MaxHeight);
+
+	/**
+	* Sets the width, in blocks, of the largest terrain features. Must be a power of 2.
+	*/
+	void SetFeatureSize(const int32_t FeatureSize);
+
+	/**
+	* Sets the number of noise octaves. Each octave adds features half the size
+	* and half the height of the previous one.
+	*/
+	void SetOctaveCount(const uint32_t OctaveCount);
+
+	/**
+	* Adds a terrain type at a specific staring height within the generated world.
+	* This block type will be used for the bounds between it's starting height and the
+	* next terrain level, if added.
+	*/
+	void AddTerrainLevel(const int32_t StartingHeight, const FBlockTypes::BlockID ID);
+
+	/**
+	* Retrieves the terrain height at a world xz position.
+	*/
+	int32_t GetHeight(const int32_t WorldX, const int32_t WorldZ) const;
+
+	/**
+	* Generates the block layout of a chunk.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param BlocksOut - Array of FChunk::BLOCKS_PER_CHUNK blocks to fill.
+	* @return True if the chunk is empty.
+	*/
+	bool Generate(const Vector3i& ChunkPosition, FBlock* BlocksOut);
+
+private:
+	/**
+	* Terrain heights of a chunk column.
+	*/
+	struct FColumn
+	{
+		int32_t ChunkX;
+		int32_t ChunkZ;
+		int32_t MinHeight;
+		int32_t MaxHeight;
+		bool    IsValid;
+		int16_t Heights[32 * 32];   // Indexed like blocks within a chunk slab, x major
+	};
+
+	struct TerrainLevelRecord
+	{
+		int32_t StartingHeight;
+		FBlockTypes::BlockID ID;
+	};
+
+	/**
+	* Retrieves the terrain heights of a chunk column, sampling the noise if they aren't cached.
+	*/
+	const FColumn& GetColumn(const int32_t ChunkX, const int32_t ChunkZ);
+
+	/**
+	* Removes all cached heights, used when the terrain parameters change.
+	*/
+	void InvalidateCache();
+
+private:
+	std::vector<TerrainLevelRecord> mTerrainLevels;   // Sorted by descending starting height
+	std::unique_ptr<FColumn[]>      mHeightCache;
+	uint32_t                        mSeed;
+	int32_t                         mMinHeight;
+	int32_t                         mMaxHeight;
+	int32_t                         mFeatureSize;
+	uint32_t                        mOctaveCount;
+};
@@ -12,18 +12,54 @@
 #include "LibNoise\noiseutils.h"
 #include "Utils/Singleton.h"
 #include "FileIO\WorldFileSystem.h"
+#include "FileIO\ChunkPayloadCache.h"
+#include "FileIO\ChunkWriteQueue.h"
+#include "FileIO\ChunkMeshCache.h"
+#include "FileIO\ChunkSummaryCache.h"
 #include "BlockTypes.h"
 #include "Utils\Event.h"
 #include "Math\Frustum.h"
 
 class FPhysicsSystem;
 class FRenderSystem;
+class FChunkGenerator;
 
 /**
 * Class for managing a world.
 */
 class FChunkManager
 {
+public:
+	// The viewpoint that follows the main camera, with the view distance as its radius
+	static const uint32_t MAIN_VIEWPOINT = 0;
+
+	/**
+	* Statistics of the chunks kept resident around the viewpoints.
+	*/
+	struct FResidencyStats
+	{
+		uint32_t Viewpoints;  // Active viewpoints
+		uint32_t Requested;   // Chunks in the areas of the viewpoints, overlapping chunks counted for each
+		uint32_t Desired;     // Chunks in the union of the areas
+		uint32_t Resident;    // Chunks assigned to slots
+		uint32_t Slots;       // Chunks that can be resident at once
+		uint64_t Loads;       // Chunks loaded since the world was initialized
+		uint64_t Evictions;   // Chunks unloaded to make room for others
+	};
+
+	/**
+	* Statistics of chunk meshes updated after blocks were set or destroyed.
+	*/
+	struct FMeshUpdateStats
+	{
+		uint64_t Patches;         // Meshes updated by re-meshing only the layers of faces around changed blocks
+		uint64_t Rebuilds;        // Meshes rebuilt whole
+		uint64_t Edits;           // Edits that became visible
+		uint64_t StaleSwaps;      // Swaps held back because the blocks changed after the mesh was built
+		float    AverageLatency;  // Average time, in seconds, from changing a block to the updated mesh being swapped in
+		float    MaxLatency;
+	};
+
 public:
 	FChunkManager();
 	~FChunkManager();
@@ -56,6 +92,15 @@ public:
 	*/
 	void DestroyBlock(const Vector3i& Position);
 
+	/**
+	* Retrieves the height above the highest block of a column of the world, in blocks.
+	* Heights come from the summaries of chunks, chunks that were never loaded are not included.
+	* @param X - The world space x position of the column.
+	* @param Z - The world space z position of the column.
+	* @return The height, 0 if no summarized chunk of the column has a block.
+	*/
+	uint32_t GetSurfaceHeight(const int32_t X, const int32_t Z);
+
 	/**
 	* Retrieves the size of the world in chunks.
 	*/
@@ -69,6 +114,16 @@ public:
 	*/
 	void LoadWorld(const wchar_t* WorldName);
 
+	/**
+	* Creates an empty world and loads it. Chunks of the world are generated
+	* as they are loaded, without a chunk generator the world stays empty.
+	* @param WorldName - The name of the world to create.
+	* @param WorldSize - The cubic size of the world in chunks.
+	* @param Seed - The seed to generate chunks with.
+	* @return False if the world already exists.
+	*/
+	bool CreateWorld(const wchar_t* WorldName, const uint32_t WorldSize, const uint32_t Seed);
+
 	/**
 	* Save the current world to file. If the world is large, this operation may
 	* take some time due to a large amount of data needing to be copied on file.
@@ -81,11 +136,139 @@ public:
 	*/
 	void SetViewDistance(const uint32_t Distance);
 
+	/**
+	* Adds a point to stream the world around, in addition to the main camera. Chunks in the area of any
+	* viewpoint are kept resident, requests of overlapping areas are merged. Chunks load nearest first,
+	* by their distance to each viewpoint divided by the viewpoint's weight.
+	* @param Position - The world space position of the viewpoint.
+	* @param Radius - The horizontal distance in chunks to keep resident, half of it vertically.
+	* @param Weight - The priority of the viewpoint's chunks relative to other viewpoints.
+	* @return The ID of the viewpoint.
+	*/
+	uint32_t AddViewpoint(const Vector3f& Position, const uint32_t Radius, const float Weight = 1.0f);
+
+	/**
+	* Moves a viewpoint. Residency is only updated when it crosses a chunk boundary.
+	*/
+	void SetViewpointPosition(const uint32_t ID, const Vector3f& Position);
+
+	/**
+	* Removes a viewpoint, its chunks are unloaded once their slots are needed.
+	*/
+	void RemoveViewpoint(const uint32_t ID);
+
+	/**
+	* Sets the number of chunks that can be resident at once. When the union of the viewpoint areas
+	* is larger, the chunks nearest to the viewpoints are kept. With 0, the default, the limit fits
+	* the view distance of the main camera.
+	*/
+	void SetResidentChunkLimit(const uint32_t Limit);
+
+	/**
+	* Sets the generator used for chunks that are not in the world's region files.
+	* The generator's seed is set to the seed of each world that is loaded. If null,
+	* missing chunks are loaded as air.
+	*/
+	void SetChunkGenerator(FChunkGenerator* Generator);
+
+	/**
+	* Sets if generated chunks are saved even when they are not modified. By default,
+	* only generated chunks that were changed are written to file.
+	*/
+	void SetPersistGeneratedChunks(const bool Persist) { mPersistGeneratedChunks = Persist; }
+
+	/**
+	* Sets if chunk meshes are cached in files next to the world's region files.
+	* Chunks loaded with an up to date cached mesh are not meshed again. Disabled by default.
+	*/
+	void SetMeshCacheEnabled(const bool Enabled) { mUseMeshCache = Enabled; }
+
+	/**
+	* Sets if chunks are read from region files in asynchronous batches. When disabled, chunks
+	* are read one at a time on the loader thread. Resets the chunk read statistics. Enabled by default.
+	*/
+	void SetAsyncChunkReads(const bool Enabled);
+
+	/**
+	* Sets if visible chunks are drawn in front to back order from the camera, so the depth
+	* test rejects hidden fragments before they are shaded. Enabled by default.
+	*/
+	void SetFrontToBackRendering(const bool Enabled) { mSortRenderList = Enabled; }
+
+	/**
+	* Sets if meshes of chunks with changed blocks only re-mesh and upload the layers of faces
+	* around the changed blocks. When disabled, the whole chunk is rebuilt. Enabled by default.
+	*/
+	void SetMeshPatching(const bool Enabled) { mUseMeshPatching = Enabled; }
+
+	/**
+	* Sets if chunk meshes are uploaded to the GPU to be rendered. When disabled, meshes
+	* are only built for the colliders of chunks, no GL context is needed and Render()
+	* draws nothing. Must be set before chunks are loaded. Enabled by default.
+	*/
+	void SetRenderingEnabled(const bool Enabled) { mIsRenderingEnabled = Enabled; }
+
 	/**
 	* Sets the physics system used by the chunk manager.
 	*/
 	void SetPhysicsSystem(FPhysicsSystem& Physics);
 
+	/**
+	* Retrieves statistics of the cache for chunks that left the view distance.
+	*/
+	FChunkPayloadCache::FStats GetPayloadCacheStats() const { return mPayloadCache.GetStats(); }
+
+	/**
+	* Retrieves statistics of the open region files of the world.
+	*/
+	FRegionFileCache::FStats GetRegionFileStats() const { return mFileSystem.GetRegionFileStats(); }
+
+	/**
+	* Retrieves statistics of the queue of chunks waiting to be written to file.
+	*/
+	FChunkWriteQueue::FStats GetWriteQueueStats() const { return mWriteQueue.GetStats(); }
+
+	/**
+	* Retrieves statistics of the chunk mesh cache.
+	*/
+	FChunkMeshCache::FStats GetMeshCacheStats() const { return mMeshCache.GetStats(); }
+
+	/**
+	* Retrieves statistics of chunk reads from region files.
+	*/
+	FWorldFileSystem::FReadStats GetChunkReadStats() const { return mFileSystem.GetReadStats(); }
+
+	/**
+	* Retrieves statistics of the chunk summaries.
+	*/
+	FChunkSummaryCache::FStats GetSummaryCacheStats() const { return mSummaryCache.GetStats(); }
+
+	/**
+	* Retrieves the memory pools of the chunks of this world.
+	*/
+	FChunk::FAllocators& GetChunkAllocators() { return mChunkAllocators; }
+
+	/**
+	* Retrieves the number of loaded chunks left without a mesh because they are enclosed by solid chunks.
+	*/
+	uint64_t GetSkippedMeshCount() const { return mSkippedMeshes; }
+
+	/**
+	* Retrieves statistics of the chunks kept resident around the viewpoints.
+	*/
+	FResidencyStats GetResidencyStats() const;
+
+	/**
+	* Retrieves statistics of chunk meshes updated after blocks changed. Must be called from the main thread.
+	*/
+	FMeshUpdateStats GetMeshUpdateStats() const;
+
+	/**
+	* Retrieves the time, in seconds, it took for all chunks in the view distance to be
+	* loaded and meshed after the world was last loaded or reinitialized. 0 until they are.
+	*/
+	float GetWorldVisibleTime() const { return mWorldVisibleSeconds; }
+
 private:
 	void InitializeWorld();
 
@@ -113,6 +296,41 @@ private:
 	*/
 	void UpdateLoadList();
 
+	/**
+	* Loads a chunk into its slot from its layout, or generates it if it has no layout.
+	* Builds the mesh of the chunk and queues its buffer swap.
+	* @param IsCached - True if the layout was found in memory rather than read from file.
+	* @param IsCacheDirty - True if the cached layout was never queued to be written.
+	*/
+	void LoadChunk(const Vector3i& ChunkPosition, const uint8_t* ChunkData, const uint32_t DataSize, const uint8_t Codec, const bool IsCached, const bool IsCacheDirty);
+
+	/**
+	* Loads a chunk into its slot from a summary of a uniform chunk, without reading its layout.
+	* Builds the mesh of the chunk and queues its buffer swap.
+	*/
+	void LoadUniformChunk(const Vector3i& ChunkPosition, const FChunkSummary& Summary);
+
+	/**
+	* Builds the mesh of a chunk that was just loaded, unless it can't be seen, and queues its buffer swap.
+	*/
+	void FinishChunkLoad(const Vector3i& ChunkPosition, const FChunkSummary& Summary);
+
+	/**
+	* Checks if all 6 neighbors of a chunk are summarized as solid, so none of its faces can be seen.
+	*/
+	bool IsEnclosed(const Vector3i& ChunkPosition);
+
+	/**
+	* Queues rebuilds of neighbors without a mesh that a changed block on the border of a chunk exposes.
+	* Called with the rebuild list locked.
+	*/
+	void QueueExposedNeighborRebuilds(const Vector3i& ChunkPosition, const Vector3i& LocalPosition);
+
+	/**
+	* Builds the mesh of a newly loaded chunk, using the mesh cache if it is enabled.
+	*/
+	void BuildLoadedChunkMesh(const uint32_t Index, const Vector3i& ChunkPosition);
+
 	/**
 	* Rebuilds the chunks that have
 	* changed during the last update.
@@ -135,7 +353,20 @@ private:
 	*/
 	void ResizeWorld();
 
-	void ReallocateChunkData(const int32_t NewViewDistance);
+	/**
+	* Reallocates the chunk slots for the current view distance and resident chunk limit.
+	*/
+	void ReallocateChunkData();
+
+	/**
+	* Constructs ChunkCount() chunks with the pools of this world.
+	*/
+	void AllocateChunks();
+
+	/**
+	* Destroys the chunks of AllocateChunks(), ChunkCount() must not have changed since.
+	*/
+	void FreeChunks();
 
 	/**
 	* Unloads all chunks that are currently loaded.
@@ -148,22 +379,60 @@ private:
 	void PostWorldSetup();
 
 	/**
-	* Converts a 3D chunk position into an index into the chunks array.
+	* Finds the index into the chunks array of the slot assigned to a chunk position. The loader
+	* thread assigns slots, other threads must hold the buffer swap lock.
+	* @return The index, -1 if the chunk is not assigned to a slot.
+	*/
+	int32_t FindSlot(const Vector3i& Position) const;
+
+	/**
+	* Finds the slot of a chunk whose mesh was swapped in, without locking. Main thread only.
+	* @return The index, -1 if the chunk is not visible or its slot was given to another chunk.
 	*/
-	int32_t ChunkIndex(Vector3i Position) const;
+	int32_t FindVisibleSlot(const Vector3i& Position) const;
 
 	/**
-	* Converts a 3D chunk position into an index into the chunks array.
+	* Checks if a slot holds the loaded blocks of a chunk. Edits must check this with the
+	* rebuild list locked, the loader changes slot keys with that lock held.
 	*/
-	int32_t ChunkIndex(int32_t X, int32_t Y, int32_t Z) const;
+	bool IsSlotEditable(const uint32_t Index, const Vector3i& Position) const;
+
+	/**
+	* Queues the mesh of a chunk to be updated after one of its blocks changed. Must be
+	* called with the rebuild list locked.
+	* @param Index - The index of the chunk.
+	* @param LocalPosition - The position of the block within the chunk.
+	*/
+	void QueueMeshUpdate(const uint32_t Index, const Vector3i& LocalPosition);
+
+private:
+	/**
+	* A point the world is streamed around.
+	*/
+	struct FViewpoint
+	{
+		Vector3f Position;
+		Vector3i ChunkPosition;  // Chunk the position was in when the residency was last updated
+		int32_t  Radius;
+		float    Weight;
+		bool     IsActive;
+	};
 
 private:
+	FChunk::FAllocators   mChunkAllocators;  // Pools of the chunks of this world, outlive the chunks
 	FWorldFileSystem      mFileSystem;
+	FChunkSummaryCache    mSummaryCache;  // Uniform chunks and column heights, stored next to the region files. Outlives the write queue.
+	FChunkWriteQueue      mWriteQueue;    // Layouts of evicted chunks waiting to be written
+	FChunkPayloadCache    mPayloadCache;  // Layouts of chunks that recently left the view distance
+	FChunkMeshCache       mMeshCache;     // Meshes of chunks, stored next to the region files
 	FChunk*               mChunks;        // All world chunks
 	Vector4i*             mChunkPositions;
 	std::vector<uint32_t> mRenderList;    // Index list of chunks to render
+	std::vector<uint64_t> mRenderEntries; // Quantized camera distances and indices of chunks to render, for sorting
+	std::vector<uint64_t> mRenderSortScratch;
 	std::queue<Vector3i>  mLoadList;      // Index list of chunks to be loaded
 	std::deque<uint32_t>  mRebuildList;   // Index list of chunks to be rebuilt
+	std::unordered_map<uint32_t, FChunk::MeshPatch> mPatchList;  // Layers to re-mesh of chunks with changed blocks, by index
 	std::deque<Vector3i>  mBufferSwapQueue;
 	std::thread           mLoaderThread;
 	std::mutex            mRebuildListMutex;
@@ -171,8 +440,49 @@ private:
 	std::atomic_bool      mNeedsToRefreshVisibleList;
 	std::atomic_bool      mMustShutdown;
 
+	// Generation data
+	FChunkGenerator*      mChunkGenerator;
+	std::atomic_bool      mPersistGeneratedChunks;
+
+	// Loading data
+	std::atomic_bool      mUseAsyncReads;
+	std::atomic<uint64_t> mSkippedMeshes;
+
+	// Mesh cache data
+	std::atomic_bool      mUseMeshCache;
+	uint64_t              mVisibleStartTime;   // Time the world was initialized, 0 once all chunks in view are loaded
+	std::atomic<float>    mWorldVisibleSeconds;
+
+	// Residency data
+	std::vector<FViewpoint> mViewpoints;
+	mutable std::mutex      mViewpointMutex;
+	std::unordered_map<Vector3i, uint32_t, Vector3iHash> mSlotMap;  // Slots of chunks that are loaded or loading, changed by the loader thread with the buffer swap lock held
+	std::unordered_map<Vector3i, uint32_t, Vector3iHash> mVisibleSlots;  // Slots of chunks whose meshes were swapped in. Main thread only.
+	std::atomic<uint64_t>*  mSlotKeys;         // Packed position of the loaded chunk of each slot, changed with the rebuild list locked
+	std::vector<Vector3i>   mSlotContents;     // Chunk whose data is in each slot, y is -1 if unused. Loader thread only.
+	std::vector<uint32_t>   mEvictableSlots;   // Slots of chunks outside of all viewpoints, unused slots last
+	std::unordered_map<Vector3i, float, Vector3iHash> mDesiredChunks;  // Union of the viewpoint areas and chunk priorities
+	std::vector<std::pair<float, Vector3i>> mDesiredOrder;
+	uint32_t                mSlotCount;
+	uint32_t                mResidentChunkLimit;
+	std::atomic<uint32_t>   mRequestedCount;
+	std::atomic<uint32_t>   mDesiredCount;
+	std::atomic<uint64_t>   mLoadCount;
+	std::atomic<uint64_t>   mEvictionCount;
+
+	// Mesh update data
+	std::atomic_bool        mUseMeshPatching;
+	std::atomic<uint64_t>   mPatchCount;
+	std::atomic<uint64_t>   mRebuildCount;
+	std::vector<uint64_t>   mEditTimes;            // Time of the oldest edit of each chunk not yet visible, 0 if none. Main thread only.
+	uint64_t                mVisibleEditCount;
+	uint64_t                mEditLatencyCycles;    // Sum of the latency of all visible edits
+	uint64_t                mMaxEditLatencyCycles;
+	uint64_t                mStaleSwapCount;       // Main thread only
+
 	// Rendering data
-	Vector3i mLastCameraChunk;
+	bool     mIsRenderingEnabled;
+	bool     mSortRenderList;
 	int32_t mWorldSize;
 	int32_t mViewDistance;
 
@@ -189,29 +499,7 @@ public:
 };
 
 
-inline int32_t FChunkManager::ChunkIndex(Vector3i Position) const 
-{
-	ASSERT(Position.x >= 0 && Position.x < mWorldSize &&
-		Position.y >= 0 && Position.y < mWorldSize &&
-		Position.z >= 0 && Position.z < mWorldSize)
-
-	// Normalize the position
-	const int32_t HorizontalBounds = 2 * mViewDistance + 1;
-	const int32_t VerticalBounds = mViewDistance + 1;
-	const Vector3i PositionToIndex{ HorizontalBounds, HorizontalBounds * HorizontalBounds, 1 };
-
-	// Bit shift for mod operation
-	Position = Vector3i{ Position.x % HorizontalBounds, Position.y % VerticalBounds, Position.z % HorizontalBounds };
-
-	return Vector3i::Dot(Position, PositionToIndex);
-}
-
-inline int32_t FChunkManager::ChunkIndex(int32_t X, int32_t Y, int32_t Z) const 
-{
-	return ChunkIndex(Vector3i{ X, Y, Z });
-}
-
 inline uint32_t FChunkManager::ChunkCount() const
 {
-	return (2 * mViewDistance + 1) * (mViewDistance + 1) * (2 * mViewDistance + 1);
+	return mSlotCount;
 }
\ No newline at end of file
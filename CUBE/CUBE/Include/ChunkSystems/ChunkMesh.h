@@ -11,7 +11,10 @@
 
 /**
 * A double buffered mesh used to construct and render
-* chunks.
+* chunks. Quads are grouped into slices, one for each side and layer of
+* the chunk, so a slice can be replaced without rebuilding the whole mesh.
+* GL objects are created by the first swap that uploads the mesh, so meshes
+* that are only used for collision never need a GL context.
 */
 class FChunkMesh
 {
@@ -28,8 +31,23 @@ public:
 		Vector3f Position;
 		uint8_t  BlockType;
 		uint8_t  NormalID;
+		uint8_t  Occlusion;  // Number of neighbor blocks not occluding the vertex, 0 to 3
 	};
 
+	/**
+	* Quads of a slice in the vertex and index buffers. Slices have room for
+	* Capacity quads, unused quads are degenerate.
+	*/
+	struct SliceRange
+	{
+		uint32_t FirstQuad;
+		uint16_t QuadCount;
+		uint16_t Capacity;
+	};
+
+	// One slice for each of the 6 sides and 33 layers of faces of a 32^3 chunk
+	static const uint32_t MAX_SLICES = 6 * 33;
+
 public:
 	static GLuint BufferUsageMode;
 
@@ -61,15 +79,57 @@ public:
 
 	/**
 	* Swap the active buffer with the back buffer.
+	* @param Upload - Whether to upload the new active buffer to the GPU for rendering.
 	*/
-	void SwapBuffer();
+	void SwapBuffer(const bool Upload = true);
 
 	/**
 	* Clear data held by the inactive vertex and index
-	* buffers.
+	* buffers. The buffers keep their memory to be reused by the next build.
 	*/
 	void ClearBackBuffer();
 
+	/**
+	* Clears the inactive buffers for a full build. Quads must then be added slice
+	* by slice, with the range of each slice set by SetSlice().
+	* @param QuadCount - The number of quads of the mesh.
+	*/
+	void BeginBuild(const uint32_t QuadCount);
+
+	/**
+	* Sets the range of a slice built by a full build.
+	*/
+	void SetSlice(const uint32_t Slice, const uint32_t FirstQuad, const uint32_t QuadCount);
+
+	/**
+	* Prepares the inactive buffers to have slices replaced. A mesh built since the last
+	* swap is patched directly, otherwise the active mesh is copied so only the replaced
+	* slices have to be uploaded by the next swap.
+	* @param IsActiveMeshStale - Whether the active mesh is about to be replaced by a swap that
+	*                            was cancelled, the inactive buffers then hold the current mesh.
+	*/
+	void BeginPatch(const bool IsActiveMeshStale);
+
+	/**
+	* Replaces the quads of a slice in the inactive buffers. Slices that outgrow their
+	* range are moved to the end of the mesh.
+	* @param Slice - The index of the slice.
+	* @param Vertices - 4 vertices for each quad.
+	* @param Indices - 6 indices for each quad, relative to the first vertex of the slice.
+	* @param QuadCount - The number of quads.
+	*/
+	void ReplaceSlice(const uint32_t Slice, const Vertex* Vertices, const uint32_t* Indices, const uint32_t QuadCount);
+
+	/**
+	* Get the vertex list of the inactive mesh buffer to write new vertices into.
+	*/
+	VertexData& GetVertexBuffer(BackBuffer);
+
+	/**
+	* Get the index list of the inactive mesh buffer to write new indices into.
+	*/
+	IndexData& GetIndexBuffer(BackBuffer);
+
 	/**
 	* Get vertex position data for the inactive mesh buffer.
 	*/
@@ -120,17 +180,59 @@ private:
 		};
 	};
 
+	// What the inactive buffers hold since the last swap
+	struct BackBufferState
+	{
+		enum : uint8_t
+		{
+			Cleared,
+			Built,    // A full build, uploaded whole
+			Patched   // The active mesh with replaced slices, only the patch ranges are uploaded
+		};
+	};
+
+private:
+	/**
+	* Creates the vertex array and buffers of the mesh.
+	*/
+	void CreateGLObjects();
+
+	/**
+	* Turns quads of the inactive index buffer into degenerate triangles.
+	*/
+	void DegenerateQuads(const uint32_t FirstQuad, const uint32_t QuadCount);
+
+	/**
+	* Adds a range of quads that must be uploaded by the next swap of a patched mesh.
+	*/
+	void AddPatchRange(const uint32_t FirstQuad, const uint32_t QuadCount);
+
 private:
 	VertexDataPtr   mVertices[2];
 	IndexDataPtr    mIndices[2];
+	std::vector<SliceRange> mSlices[2];   // Empty until the buffer is built
+
+	std::vector<std::pair<uint32_t, uint32_t>> mPatchRanges;  // First quad and quad count of ranges changed by patches
+	uint8_t mBackState;
 
-	// GL buffers held by this object
+	// GL buffers held by this object, 0 until the mesh is first uploaded
 	GLuint mVertexArray;
 	GLuint mBuffers[2];
+	size_t mBufferBytes[2]; // Size of the data uploaded to each GL buffer
 
 	std::atomic_bool mActiveBuffer;
 };
 
+inline FChunkMesh::VertexData& FChunkMesh::GetVertexBuffer(FChunkMesh::BackBuffer)
+{
+	return *mVertices[!mActiveBuffer];
+}
+
+inline FChunkMesh::IndexData& FChunkMesh::GetIndexBuffer(FChunkMesh::BackBuffer)
+{
+	return *mIndices[!mActiveBuffer];
+}
+
 inline const FChunkMesh::Vertex* FChunkMesh::GetVertexData(FChunkMesh::BackBuffer) const
 {
 	return mVertices[!mActiveBuffer]->data();
@@ -10,9 +10,23 @@
 
 /**
 * Used for generating world layouts from noise functions.
+* The world is generated in tiles of one region column each. Every tile samples
+* its own heightmap, so memory use is bounded by the tile size and tiles can be
+* built in parallel.
 */
 class FWorldGenerator
 {
+public:
+	/**
+	* Timing of the last build.
+	*/
+	struct FBuildStats
+	{
+		uint32_t RegionCount;  // Regions that contain chunks
+		uint32_t ThreadCount;
+		float    Seconds;
+	};
+
 public:
 	/** Ctor */
 	FWorldGenerator();
@@ -50,37 +64,73 @@ public:
 	*/
 	void SetBounds(const Vector2f LowerBounds, const Vector2f UpperBounds);
 
+	/**
+	* Sets the number of threads used to build tiles. Defaults to the
+	* number of hardware threads.
+	*/
+	void SetThreadCount(const uint32_t ThreadCount);
+
 	/**
 	* Builds the world region files.
-	* @param NoiseModule - The noise module used to build to world.
+	* @param NoiseModule - The noise module used to build to world. It is evaluated from
+	*                      several threads at once, so it must not contain module::Cache.
 	* @param WorldName - The name of the world to build.
 	*/
 	void Build(noise::module::Module& NoiseModule, const wchar_t* WorldName);
 
+	/**
+	* Retrieves the timing of the last build.
+	*/
+	FBuildStats GetLastBuildStats() const { return mLastBuildStats; }
+
 private:
 	/**
-	* Builds a heightmap with the currently stored world info.
+	* A heightmap covering one tile of the world plus a border.
+	*/
+	struct FHeightTile
+	{
+		utils::NoiseMap Map;
+		int32_t OriginX;    // World x position of the first row
+		int32_t OriginZ;    // World z position of the first column
+	};
+
+	/**
+	* Builds the heightmap for a tile of the world.
 	* @param NoiseModule - The module to built the map with.
-	* @param HeightMapOut - The map to use to build.
+	* @param WorldOrigin - The world xz position of the first block in the tile.
+	* @param Size - The xz size of the tile in blocks, not including the border.
+	* @param TileOut - The tile to build.
+	*/
+	void BuildHeightTile(const noise::module::Module& NoiseModule, const Vector2i& WorldOrigin, const Vector2i& Size, FHeightTile& TileOut) const;
+
+	/**
+	* Builds all regions of a region column.
+	* @param TileIndex - The index of the column, x major.
 	*/
-	void BuildHeightMap(const noise::module::Module& NoiseModule, utils::NoiseMap& HeightMapOut);
+	void BuildTile(const noise::module::Module& NoiseModule, const wchar_t* WorldName, const int32_t TileIndex, FHeightTile& Tile, std::vector<uint8_t>& ChunkDataBuffer) const;
 
 	/**
 	* Builds a region file for a world from a given heightmap.
 	* @param WorldName - The name of the world for this region.
 	* @param RegionPosition - The position of the region within this world.
-	* @param HeightMap - The heightmap to use to build this region.
+	* @param HeightTile - The heightmap tile containing this region.
+	* @param ChunkDataBuffer - Buffer to build chunk data in.
 	*/
-	void BuildRegion(const wchar_t* WorldName, const Vector3i& RegionPosition, const utils::NoiseMap& HeightMap);
+	void BuildRegion(const wchar_t* WorldName, const Vector3i& RegionPosition, const FHeightTile& HeightTile, std::vector<uint8_t>& ChunkDataBuffer) const;
 
 	/**
 	* Builds RLE chunk data based of a heightmap.
 	* @param WorldPosition - The world position of this chunk.
-	* @param HeightMap - The heightmap to use to build this chunk.
+	* @param HeightTile - The heightmap tile containing this chunk.
 	* @param DataOut - RLE data for this chunk will be placed here.
 	* @return The size of the data added to DataOut.
 	*/
-	uint32_t BuildChunk(const Vector3i& WorldPosition, const utils::NoiseMap& HeightMap, std::vector<uint8_t>& DataOut);
+	uint32_t BuildChunk(const Vector3i& WorldPosition, const FHeightTile& HeightTile, std::vector<uint8_t>& DataOut) const;
+
+	/**
+	* Retrieves the chunk space bounds of a region, clamped to the world size.
+	*/
+	Vector3i GetRegionBounds(const Vector3i& RegionPosition) const;
 
 	void BuildWorldInfoFile(const wchar_t* WorldName) const;
 
@@ -92,6 +142,9 @@ private:
 		FBlockTypes::BlockID ID;
 	};
 
+	// Number of heightmap samples added to each side of a tile
+	static const int32_t TILE_BORDER = 1;
+
 private:
 	std::vector<TerrainLevelRecord> mTerrainLevels;
 	Vector2f mLowerBounds;
@@ -99,5 +152,7 @@ private:
 	int32_t mWorldSizeInChunks;
 	int32_t mMaxHeight;
 	int32_t mMinHeight;
+	uint32_t mThreadCount;
+	FBuildStats mLastBuildStats;
 };
 
@@ -1,4 +1,19 @@
 #pragma once
 
 #define WIN_ALIGN(Size) __declspec(align(Size))
-#define FOR(i, Num) for(int32_t i = 0; i < Num; i++)
\ No newline at end of file
+#define FOR(i, Num) for(int32_t i = 0; i < Num; i++)
+
+// Storage duration specifier for per-thread variables. Visual Studio 2013 lacks thread_local,
+// so only POD types with constant initialization can be used.
+#ifdef _MSC_VER
+	#define THREAD_LOCAL __declspec(thread)
+#else
+	#define THREAD_LOCAL thread_local
+#endif
+
+// Visual Studio 2013 lacks constexpr, functions marked with it are only inline there
+#if defined(_MSC_VER) && _MSC_VER < 1900
+	#define CONSTEXPR inline
+#else
+	#define CONSTEXPR constexpr
+#endif
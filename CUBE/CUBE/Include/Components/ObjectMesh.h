@@ -27,6 +27,16 @@ const uint32_t VertexTraits::GL_Attribute<MeshVertex>::Offset[] = { 0, 16, 28 };
 
 class FMeshRenderer;
 
+/**
+* Axis aligned bounds of a mesh in model space.
+*/
+struct FMeshBounds
+{
+	Vector3f Min;
+	Vector3f Max;
+	float    Radius;   // Radius of the sphere around the center of the bounds
+};
+
 /**
 * A mesh that can be rendered with a gameobject.
 * MeshRenderer components are linked with a single
@@ -37,6 +47,7 @@ struct FObjectMesh
 {
 	TMesh<MeshVertex> Mesh;
 	std::vector<FMeshRenderer*> Renderers;
+	FMeshBounds Bounds;
 };
 
 using SMeshHolder = TResourceHolder<FObjectMesh>;
\ No newline at end of file
@@ -5,18 +5,27 @@
 #include "FMOD\fmod.hpp"
 #include "Atlas\Component.h"
 #include "Atlas\ComponentTypes.h"
+#include "Audio\SoundCache.h"
+#include "Math\Vector3.h"
 
 struct FSoundEmitter : public Atlas::IComponent
 {
-	std::string    Filename;       // Filepath for the audio file
-	FMOD::Sound*   Sound{ nullptr };
-	FMOD::Channel* Channel{ nullptr };
-	bool           ActivateSound;  // If set to true, the sound with be activated in the next update
-	bool           Looping{false};
+	std::string          Filename;                                 // Filepath for the audio file, loaded in the background on the next update
+	ESoundLoad::Type     LoadPolicy{ ESoundLoad::Auto };           // How the audio file is loaded
+	float                Volume{ 1.0f };
+	bool                 ActivateSound{ false };                   // If set to true, the sound will be activated in the next update
+	bool                 Looping{ false };
+
+	// Playback state managed by the audio system
+	FSoundCache::SoundID SoundID{ FSoundCache::INVALID_ID };
+	FMOD::Channel*       Channel{ nullptr };                       // Null while the emitter is virtual or silent
+	Vector3f             LastPosition;                             // Position last sent to the channel
+	float                PlaybackTime{ 0.0f };                     // Seconds played since activated
+	bool                 IsPlaying{ false };
 };
 
 template <>
 struct Atlas::ComponentTraits::Object<Atlas::EComponent::SoundEmitter>
 {
 	using Type = FSoundEmitter;
-};
\ No newline at end of file
+};
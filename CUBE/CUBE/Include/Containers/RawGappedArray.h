@@ -6,6 +6,7 @@
 #include <functional>
 
 #include "Misc\Assertions.h"
+#include "Memory\MemoryTracker.h"
 
 /**
 * Allocation Strategy
@@ -42,6 +43,7 @@ public:
 	* of that element type.
 	* If this is called on an already initialized object, all current data is cleared and reinitialized
 	* according to the new data specs.
+	* Pages are reported to the calling thread's current memory tag.
 	* @param PageSize - The requested starting capacity for each memory page.
 	* @param ElementSize - The size of elements allocated by this allocator.
 	* @param Alignment - The memory alignment for the element type.
@@ -161,6 +163,7 @@ private:
 	struct Page
 	{
 		uint8_t* Data;
+		uint32_t Bytes;
 		std::vector<uint32_t> ActiveList; // Ordered list of active elements
 		std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> DeadList; // Min-heap of dead elements
 	};
@@ -171,6 +174,7 @@ private:
 	uint32_t          mActiveCount;
 	uint32_t          mNextFreePage;
 	std::vector<Page> mPages;
+	EMemoryTag        mTag;
 
 public:
 	template <typename T>
@@ -3,13 +3,18 @@
 #include "Atlas\World.h"
 #include "SFML\Window\Window.hpp"
 #include "Math\Vector2.h"
+#include "Utils\Event.h"
+#include "STime.h"
 #include <cstdint>
+#include <atomic>
+#include <memory>
 
 class Atlas::FGameObjectManager;
 class FRenderSystem;
 class FPhysicsSystem;
 class FChunkManager;
 class FAudioSystem;
+class FMeshLoader;
 
 /**
 * Root/Central class for the game engine
@@ -17,27 +22,86 @@ class FAudioSystem;
 class FCubeRoot
 {
 public:
+	// Seconds of ticks summarized by each report of a headless root
+	static const float TICK_REPORT_INTERVAL;
+
+	/**
+	* Timings of the ticks of a headless root, in seconds.
+	*/
+	struct FTickStats
+	{
+		uint64_t Ticks;
+		uint64_t Overruns;         // Ticks that took longer than the tick interval
+		float    AverageTick;
+		float    MaxTick;
+		float    AverageObjects;   // Gameobject and behavior updates
+		float    AverageChunks;    // Chunk streaming and collider swaps
+		float    AveragePhysics;
+	};
+
+public:
+	/**
+	* Constructs a root that renders the world to a window. Only one root
+	* in the process can have a window.
+	*/
 	FCubeRoot(const wchar_t* AppName, const Vector2ui Resolution, const uint32_t WindowStyle = sf::Style::Default);
 
+	/**
+	* Constructs a headless root, for running the world on a server. No window, GL context,
+	* renderer or audio is created. Chunks are streamed around the chunk manager's viewpoints
+	* with colliders but without meshes for rendering, and the world is stepped at a fixed tick.
+	* A process can run several headless roots, each started on its own thread. Every root has
+	* its own world, chunk manager, chunk memory pools and physics, while resources, block types
+	* and the file system are shared. Physics steps of different roots take turns, because
+	* Bullet's profiler is shared by the process.
+	* @param TickRate - Ticks per second.
+	*/
+	explicit FCubeRoot(const uint32_t TickRate);
+
 	~FCubeRoot();
 
 	// Disable copying of this object.
 	FCubeRoot(const FCubeRoot& Other) = delete;
 	FCubeRoot& operator=(const FCubeRoot& Other) = delete;
 
+	/**
+	* Runs the game loop on the calling thread until the window is closed or Stop() is called.
+	*/
 	void Start();
 
+	/**
+	* Makes Start() return after the current frame or tick. Can be called from any thread.
+	*/
+	void Stop() { mMustStop = true; }
+
+	/**
+	* Checks if the root runs without a window.
+	*/
+	bool IsHeadless() const { return mIsHeadless; }
+
+	/**
+	* Retrieves the timings of the ticks since the last report of a headless root.
+	*/
+	FTickStats GetTickStats() const;
+
 	FRenderSystem& GetRenderSystem(){ return *mRenderSystem; }
 	FPhysicsSystem& GetPhysicsSystem() { return *mPhysicsSystem; }
 	Atlas::FGameObjectManager& GetGameObjectManager() { return *mGameObjectManager; }
 	FChunkManager& GetChunkManager() { return *mChunkManager; }
+	FMeshLoader& GetMeshLoader() { return *mMeshLoader; }
 
 private:
 	void AllocateSingletons();
 	void LoadEngineSystems();
 	void GameLoop();
+	void HeadlessLoop();
 	void ServiceEvents();
 
+	/**
+	* Prints the tick timings since the last report and starts a new report.
+	*/
+	void ReportTicks();
+
 private:
 	struct Systems
 	{
@@ -51,12 +115,31 @@ private:
 	};
 
 private:
-	sf::Window                  mGameWindow;
+	std::unique_ptr<sf::Window> mGameWindow;  // Null for a headless root
 	Atlas::FWorld               mWorld;
 	FChunkManager*              mChunkManager;
 	FRenderSystem*              mRenderSystem;
 	FPhysicsSystem*             mPhysicsSystem;
 	FAudioSystem*               mAudioSystem;
+	FMeshLoader*                mMeshLoader;
 	Atlas::FGameObjectManager*  mGameObjectManager;
+
+	bool                        mIsHeadless;
+	std::atomic_bool            mMustStop;
+	STime::FTimeState           mTime;
+
+	// Tick data of a headless root
+	float                       mTickTime;
+	uint64_t                    mTicks;
+	uint64_t                    mOverruns;
+	uint64_t                    mTickCycles;
+	uint64_t                    mMaxTickCycles;
+	uint64_t                    mObjectCycles;
+	uint64_t                    mChunkCycles;
+	uint64_t                    mPhysicsCycles;
+
+public:
+	// Invoked at the start of each tick of a headless root with the number of the tick
+	TEvent<uint64_t> mOnTick;
 };
 
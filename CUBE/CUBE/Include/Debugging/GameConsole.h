@@ -6,7 +6,9 @@
 
 class FPhysicsSystem;
 class FRenderSystem;
+class FAudioSystem;
 class FChunkManager;
+class FMeshLoader;
 
 namespace FDebug
 {
@@ -15,6 +17,10 @@ namespace FDebug
 	* Commands:
 	* DrawPhysics bool
 	* LoadWorld string
+	* SetViewDistance int
+	* MemoryStats bool
+	* DumpMemory string
+	* MaxVoices int
 	*/
 	class GameConsole : public TSingleton<GameConsole>
 	{
@@ -26,19 +32,25 @@ namespace FDebug
 
 		void SetPhysicsSystem(FPhysicsSystem* Physics);
 		void SetRenderSystem(FRenderSystem* RenderSystem);
+		void SetAudioSystem(FAudioSystem* AudioSystem);
 		void SetChunkManager(FChunkManager* ChunkManager);
+		void SetMeshLoader(FMeshLoader* MeshLoader);
 
 	private:
 		void ProcessInput();
 		void ParseCommand();
+		void RenderMemoryStats();
 
 	private:
 		std::wstring        mCommandBuffer;
 		markup_t            mTextMarkup;
 		FPhysicsSystem*     mPhysicsSystem;
 		FRenderSystem*      mRenderSystem;
+		FAudioSystem*       mAudioSystem;
 		FChunkManager*      mChunkManager;
+		FMeshLoader*        mMeshLoader;
 		bool                mDrawPhysics;
+		bool                mShowMemoryStats;
 		bool                mIsActive;
 	};
 }
\ No newline at end of file
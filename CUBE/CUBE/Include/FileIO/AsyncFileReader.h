@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "GenericFile.h"
+
+/**
+* A read from a specific offset of a file, to be completed asynchronously.
+*/
+struct FAsyncReadRequest
+{
+	IFileHandle* File;
+	uint8_t*     Buffer;      // Must stay valid until the read completes
+	uint32_t     Size;
+	uint64_t     Offset;
+	void*        UserData;    // Handed back with the result
+};
+
+/**
+* The result of a completed asynchronous read.
+*/
+struct FAsyncReadResult
+{
+	void*   UserData;
+	int64_t BytesRead;        // Negative if the read failed
+};
+
+/**
+* Interface for readers that complete file reads in the background. Many reads
+* can be submitted at once and are completed in any order.
+* Readers are not synchronized, each must only be used by one thread at a time.
+*/
+class IAsyncFileReader
+{
+public:
+	/**
+	* Creates the fastest reader supported by the platform. io_uring is used on
+	* Linux kernels that support it, other platforms read on a thread pool.
+	* @param QueueDepth - The maximum number of reads in flight at once.
+	*/
+	static std::unique_ptr<IAsyncFileReader> Create(const uint32_t QueueDepth);
+
+public:
+	virtual ~IAsyncFileReader() {}
+
+	/**
+	* Starts reads. Reads beyond the queue depth are not accepted.
+	* @param Requests - The reads to start.
+	* @param Count - The number of reads.
+	* @return The number of reads that were started, from the front of Requests.
+	*/
+	virtual uint32_t Submit(const FAsyncReadRequest* Requests, const uint32_t Count) = 0;
+
+	/**
+	* Retrieves completed reads, waiting for them if needed.
+	* @param ResultsOut - Array to place results in.
+	* @param MaxResults - The size of ResultsOut.
+	* @param MinResults - The number of results to wait for. Limited by the number of reads in flight.
+	* @return The number of results placed in ResultsOut.
+	*/
+	virtual uint32_t Wait(FAsyncReadResult* ResultsOut, const uint32_t MaxResults, const uint32_t MinResults) = 0;
+
+	/**
+	* Retrieves the number of reads that were submitted and not retrieved yet.
+	*/
+	virtual uint32_t GetPendingCount() const = 0;
+
+	/**
+	* Retrieves the name of the backend, used for statistics.
+	*/
+	virtual const wchar_t* GetName() const = 0;
+};
+
+/**
+* Asynchronous reader that completes reads with positional reads on worker threads.
+* Used on platforms without a native asynchronous I/O interface.
+*/
+class FThreadPoolFileReader : public IAsyncFileReader
+{
+public:
+	// Default number of worker threads
+	static const uint32_t DEFAULT_THREAD_COUNT = 4;
+
+public:
+	FThreadPoolFileReader(const uint32_t QueueDepth, const uint32_t ThreadCount = DEFAULT_THREAD_COUNT);
+
+	/**
+	* Waits for reads in flight and stops the worker threads.
+	*/
+	~FThreadPoolFileReader();
+
+	FThreadPoolFileReader(const FThreadPoolFileReader& Other) = delete;
+	FThreadPoolFileReader& operator=(const FThreadPoolFileReader& Other) = delete;
+
+	uint32_t Submit(const FAsyncReadRequest* Requests, const uint32_t Count) override;
+
+	uint32_t Wait(FAsyncReadResult* ResultsOut, const uint32_t MaxResults, const uint32_t MinResults) override;
+
+	uint32_t GetPendingCount() const override { return mPendingCount; }
+
+	const wchar_t* GetName() const override { return L"thread pool"; }
+
+private:
+	/**
+	* Completes queued reads until the reader is destroyed.
+	*/
+	void WorkerThreadLoop();
+
+private:
+	std::deque<FAsyncReadRequest> mRequests;
+	std::deque<FAsyncReadResult>  mResults;
+	std::vector<std::thread>      mWorkers;
+	uint32_t                      mQueueDepth;
+	uint32_t                      mPendingCount;   // Submitted reads that were not retrieved
+
+	std::mutex                    mMutex;
+	std::condition_variable       mRequestAdded;
+	std::condition_variable       mReadCompleted;
+	bool                          mMustShutdown;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <atomic>
+#include <unordered_map>
+
+#include "RegionFile.h"
+#include "Math\Vector3.h"
+#include "ChunkSystems\Chunk.h"
+
+/**
+* On disk cache of chunk meshes, stored in a sidecar file next to each region file.
+* Each chunk's entry holds the packed quads of its mesh and a hash of the block layout
+* they were built from, a chunk whose blocks changed since then has a stale entry.
+* Chunks that load with a matching entry don't need to be meshed again.
+* The cache is not synchronized, it must only be used by one thread at a time.
+*/
+class FChunkMeshCache
+{
+public:
+	// Default maximum number of sidecar files that are open at once
+	static const uint32_t DEFAULT_MAX_OPEN_FILES = 16;
+
+	// Version of the cached mesh data. Sidecars with another version are discarded,
+	// it must be increased whenever meshing or the quad format changes.
+	static const uint32_t MESH_VERSION = 2;
+
+	/**
+	* Cache statistics, can be retrieved from any thread.
+	*/
+	struct FStats
+	{
+		uint64_t Hits;      // Meshes read from the cache
+		uint64_t Misses;    // Chunks without a cached mesh
+		uint64_t Stale;     // Chunks whose cached mesh was built from other blocks
+		uint64_t Stores;    // Meshes written to the cache
+		uint64_t Bytes;     // Bytes of quad data read from the cache
+	};
+
+public:
+	/**
+	* Constructs a cache for the region files of a world.
+	* @param WorldName - The name of the world directory the region files are in.
+	*/
+	FChunkMeshCache(const wchar_t* WorldName, const uint32_t MaxOpenFiles = DEFAULT_MAX_OPEN_FILES);
+
+	/**
+	* Closes all sidecar files.
+	*/
+	~FChunkMeshCache();
+
+	FChunkMeshCache(const FChunkMeshCache& Other) = delete;
+	FChunkMeshCache& operator=(const FChunkMeshCache& Other) = delete;
+
+	/**
+	* Retrieves the cached mesh of a chunk.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param BlockHash - Hash of the chunk's current block layout, from FBlockLayout::Hash().
+	* @param QuadsOut - Array to add the quads of the mesh to.
+	* @return True if the chunk had an up to date mesh.
+	*/
+	bool Find(const Vector3i& ChunkPosition, const uint64_t BlockHash, TScratchArray<FChunk::MeshQuad>& QuadsOut);
+
+	/**
+	* Stores the mesh of a chunk, replacing any mesh cached for it.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param BlockHash - Hash of the block layout the mesh was built from.
+	* @param Quads - The quads of the mesh.
+	* @param QuadCount - The number of quads.
+	*/
+	void Store(const Vector3i& ChunkPosition, const uint64_t BlockHash, const FChunk::MeshQuad* Quads, const uint32_t QuadCount);
+
+	/**
+	* Writes changed tables and closes all sidecar files. Must be called before
+	* the files of the world are copied or replaced.
+	*/
+	void CloseAll();
+
+	/**
+	* Retrieves the statistics of the cache.
+	*/
+	FStats GetStats() const;
+
+private:
+	/**
+	* Lookup table entry for a chunk's mesh. An offset of 0 means the chunk has no mesh.
+	*/
+	struct Entry
+	{
+		uint64_t BlockHash;
+		uint32_t Offset;       // Offset, in bytes, of the quad data from the start of the file
+		uint32_t QuadCount;
+	};
+
+	struct Header
+	{
+		static const uint32_t MAGIC = 0x434D4756; // "VGMC"
+		uint32_t Magic;
+		uint32_t Version;
+		Entry    ChunkEntry[FRegionFile::RegionData::REGION_SIZE * FRegionFile::RegionData::REGION_SIZE * FRegionFile::RegionData::REGION_SIZE];
+		// Quad data follows the table. A mesh is stored as the geometry of each quad,
+		// then the block type of each quad, then the corner occlusion of each quad. Meshes are given space in
+		// multiples of ALLOCATION_SIZE, so small changes can be written in place.
+		static const uint32_t ALLOCATION_SIZE = 512;
+	};
+
+	struct FSidecar
+	{
+		Header                         Table;
+		std::unique_ptr<IFileHandle>   File;
+		uint64_t                       FileSize;
+		bool                           IsTableDirty;
+		std::list<Vector3i>::iterator  UsageNode;
+	};
+
+	/**
+	* Retrieves the sidecar of a region, opening or creating its file if needed.
+	* @return Null if the file could not be opened.
+	*/
+	FSidecar* GetSidecar(const Vector3i& RegionPosition);
+
+	/**
+	* Writes the table of a sidecar if it changed and closes its file.
+	*/
+	void CloseSidecar(FSidecar& Sidecar);
+
+	/**
+	* Retrieves the index of a chunk's entry from its position within the region.
+	*/
+	static uint32_t GetTableIndex(const Vector3i& LocalPosition);
+
+	/**
+	* Retrieves the space, in bytes, given to a mesh with a number of quads.
+	*/
+	static uint32_t GetAllocatedSize(const uint32_t QuadCount);
+
+private:
+	const std::wstring  mWorldName;
+	std::unordered_map<Vector3i, std::unique_ptr<FSidecar>, Vector3iHash> mSidecars;
+	std::list<Vector3i> mUsageList;    // Open sidecars, most recently used at the front
+	uint32_t            mMaxOpenFiles;
+
+	std::atomic<uint64_t> mHits;
+	std::atomic<uint64_t> mMisses;
+	std::atomic<uint64_t> mStale;
+	std::atomic<uint64_t> mStores;
+	std::atomic<uint64_t> mBytes;
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+
+#include "ChunkSummaryCache.h"
+#include "Math\Vector3.h"
+#include "Memory\StackAllocator.h"
+
+class FChunkWriteQueue;
+
+/**
+* Memory budgeted cache of encoded chunk layouts that recently left the view distance.
+* Chunks that move back into view are loaded from the cache instead of being read from
+* region files again. Payloads of modified chunks are kept dirty and are only queued to be
+* written to file when they are evicted or the cache is flushed.
+* The cache is not synchronized, it must only be used by one thread at a time.
+*/
+class FChunkPayloadCache
+{
+public:
+	// Default memory budget for cached payloads
+	static const size_t DEFAULT_BYTE_BUDGET = 32 * 1024 * 1024;
+
+	/**
+	* Cache statistics, can be retrieved from any thread.
+	*/
+	struct FStats
+	{
+		uint64_t Hits;
+		uint64_t Misses;
+		uint64_t Evictions;
+		uint64_t WriteBacks;    // Dirty payloads queued to be written to file
+		size_t   Bytes;         // Size of all cached payloads
+		uint32_t Entries;
+	};
+
+public:
+	/**
+	* Constructs a cache that writes dirty payloads through a world's write queue.
+	*/
+	FChunkPayloadCache(FChunkWriteQueue& WriteQueue, const size_t ByteBudget = DEFAULT_BYTE_BUDGET);
+
+	/**
+	* Frees all payloads. Dirty payloads are not written, FlushDirty must be called before.
+	*/
+	~FChunkPayloadCache();
+
+	FChunkPayloadCache(const FChunkPayloadCache& Other) = delete;
+	FChunkPayloadCache& operator=(const FChunkPayloadCache& Other) = delete;
+
+	/**
+	* Adds the payload of an unloaded chunk to the cache, evicting the least recently
+	* used payloads if the budget is exceeded.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param Data - Encoded block layout of the chunk.
+	* @param DataSize - The size of the layout in bytes.
+	* @param Codec - The ID of the codec the layout is encoded with.
+	* @param IsDirty - True if the payload differs from the one on file.
+	* @param Summary - Summary of the payload, stored once a dirty payload is written.
+	*/
+	void Insert(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec, const bool IsDirty, const FChunkSummary& Summary);
+
+	/**
+	* Removes the payload of a chunk from the cache so it can be loaded.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param Scratch - Allocator to copy the payload into.
+	* @param SizeOut - The size of the payload in bytes.
+	* @param CodecOut - The ID of the codec the payload is encoded with.
+	* @param IsDirtyOut - True if the payload was never written to file.
+	* @return The payload, allocated from Scratch. Null if the chunk isn't cached.
+	*/
+	const uint8_t* Take(const Vector3i& ChunkPosition, FStackAllocator& Scratch, uint32_t& SizeOut, uint8_t& CodecOut, bool& IsDirtyOut);
+
+	/**
+	* Queues all dirty payloads to be written to file. Payloads stay cached.
+	*/
+	void FlushDirty();
+
+	/**
+	* Removes all payloads without writing them, used when a different world is loaded.
+	*/
+	void Clear();
+
+	/**
+	* Sets the memory budget of the cache, evicting payloads if needed.
+	*/
+	void SetByteBudget(const size_t ByteBudget);
+
+	/**
+	* Retrieves the statistics of the cache.
+	*/
+	FStats GetStats() const;
+
+private:
+	struct FEntry
+	{
+		std::unique_ptr<uint8_t[]>    Data;
+		uint32_t                      DataSize;
+		uint8_t                       Codec;
+		bool                          IsDirty;
+		FChunkSummary                 Summary;
+		std::list<Vector3i>::iterator UsageNode;   // Position of this entry in the usage list
+	};
+
+	typedef std::unordered_map<Vector3i, FEntry, Vector3iHash> EntryMap;
+
+	/**
+	* Removes an entry, queueing it to be written to file if dirty.
+	*/
+	void Evict(EntryMap::iterator Entry);
+
+	/**
+	* Removes an entry from the cache without writing it.
+	*/
+	void Remove(EntryMap::iterator Entry);
+
+	/**
+	* Queues a dirty entry to be written to file.
+	*/
+	void WriteBack(const Vector3i& ChunkPosition, FEntry& Entry);
+
+	/**
+	* Evicts least recently used entries until the cache fits its budget.
+	*/
+	void EnforceBudget();
+
+private:
+	FChunkWriteQueue&     mWriteQueue;
+	EntryMap              mEntries;
+	std::list<Vector3i>   mUsageList;      // Most recently inserted entries at the front
+	size_t                mByteBudget;
+
+	std::atomic<uint64_t> mHits;
+	std::atomic<uint64_t> mMisses;
+	std::atomic<uint64_t> mEvictions;
+	std::atomic<uint64_t> mWriteBacks;
+	std::atomic<size_t>   mBytes;
+	std::atomic<uint32_t> mEntryCount;
+};
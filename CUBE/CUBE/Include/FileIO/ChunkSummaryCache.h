@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+#include "RegionFile.h"
+#include "Math\Vector3.h"
+#include "ChunkSystems\BlockTypes.h"
+
+namespace EChunkSummary
+{
+	enum Type : uint8_t
+	{
+		Unknown,  // The chunk was never summarized
+		Mixed,    // The chunk holds more than one type of block
+		Air,      // Every block of the chunk is air
+		Solid     // Every block of the chunk is the same solid block
+	};
+}
+
+/**
+* What is known about the block layout of a chunk without reading it.
+*/
+struct FChunkSummary
+{
+	EChunkSummary::Type  Type;
+	FBlockTypes::BlockID Block;     // The block of uniform chunks
+	uint8_t              Height;    // Number of block layers from the bottom of the chunk up to its highest non-air block
+	uint8_t              Padding;
+};
+
+/**
+* Summaries of the chunks of a world, stored in a sidecar file next to each region
+* file. Chunks that are uniformly air or solid can be loaded without reading or
+* decoding their layout. Each region also keeps a heightmap of its chunk columns.
+* Summaries must be stored whenever the stored layout of a chunk changes.
+* Tables of the least recently used regions are written back and dropped from memory.
+*/
+class FChunkSummaryCache
+{
+public:
+	// Default maximum number of region tables kept in memory
+	static const uint32_t DEFAULT_MAX_TABLES = 64;
+
+	/**
+	* Cache statistics, can be retrieved from any thread.
+	*/
+	struct FStats
+	{
+		uint64_t Lookups;     // Summaries retrieved for loading chunks
+		uint64_t Uniform;     // Lookups that found a uniform chunk
+		uint64_t Stores;      // Summaries stored
+		uint32_t Tables;      // Region tables in memory
+	};
+
+public:
+	/**
+	* Constructs a cache for the region files of a world.
+	* @param WorldName - The name of the world directory the region files are in.
+	*/
+	FChunkSummaryCache(const wchar_t* WorldName, const uint32_t MaxTables = DEFAULT_MAX_TABLES);
+
+	/**
+	* Writes all changed tables.
+	*/
+	~FChunkSummaryCache();
+
+	FChunkSummaryCache(const FChunkSummaryCache& Other) = delete;
+	FChunkSummaryCache& operator=(const FChunkSummaryCache& Other) = delete;
+
+	/**
+	* Retrieves the summary of a chunk.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @return The summary, of type Unknown if the chunk was never summarized.
+	*/
+	FChunkSummary Find(const Vector3i& ChunkPosition);
+
+	/**
+	* Retrieves the summary of a chunk that is about to be loaded, counted in the statistics.
+	*/
+	FChunkSummary FindForLoad(const Vector3i& ChunkPosition);
+
+	/**
+	* Stores the summary of a chunk and updates the heightmap of its column.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param Summary - Summary of the chunk's stored block layout.
+	*/
+	void Store(const Vector3i& ChunkPosition, const FChunkSummary& Summary);
+
+	/**
+	* Retrieves the height of the highest non-air block in a chunk's column of its region,
+	* counted in blocks from the bottom of the region. Only summarized chunks are included.
+	* @param ChunkPosition - The chunk space position of any chunk in the column.
+	* @return The height, 0 if no summarized chunk in the column has a block.
+	*/
+	uint32_t GetColumnHeight(const Vector3i& ChunkPosition);
+
+	/**
+	* Writes changed tables and drops all tables from memory. Must be called before
+	* the files of the world are copied or replaced.
+	*/
+	void CloseAll();
+
+	/**
+	* Retrieves the statistics of the cache.
+	*/
+	FStats GetStats() const;
+
+private:
+	// Version of the table layout. Sidecars with another version are discarded.
+	static const uint32_t SUMMARY_VERSION = 1;
+
+	struct Header
+	{
+		static const uint32_t MAGIC = 0x53534756; // "VGSS"
+		static const uint32_t COLUMN_COUNT = FRegionFile::RegionData::REGION_SIZE * FRegionFile::RegionData::REGION_SIZE;
+		uint32_t      Magic;
+		uint32_t      Version;
+		FChunkSummary ChunkEntry[FRegionFile::RegionData::REGION_SIZE * FRegionFile::RegionData::REGION_SIZE * FRegionFile::RegionData::REGION_SIZE];
+		uint16_t      ColumnHeight[COLUMN_COUNT];  // Highest non-air block of each chunk column, in blocks from the bottom of the region
+	};
+
+	struct FTable
+	{
+		Header                         Table;
+		bool                           IsDirty;
+		std::list<Vector3i>::iterator  UsageNode;
+	};
+
+	/**
+	* Retrieves the table of a region, reading it from its sidecar if needed. Called with the lock held.
+	*/
+	FTable& GetTable(const Vector3i& RegionPosition);
+
+	/**
+	* Writes a table to its sidecar if it changed. Called with the lock held.
+	*/
+	void WriteTable(const Vector3i& RegionPosition, FTable& Table);
+
+	/**
+	* Retrieves the path of a region's sidecar.
+	*/
+	std::wstring GetSidecarPath(const Vector3i& RegionPosition) const;
+
+	/**
+	* Retrieves the index of a chunk's entry from its position within the region.
+	*/
+	static uint32_t GetTableIndex(const Vector3i& LocalPosition);
+
+	/**
+	* Retrieves the index of a chunk's column from its position within the region.
+	*/
+	static uint32_t GetColumnIndex(const Vector3i& LocalPosition);
+
+private:
+	const std::wstring  mWorldName;
+	std::unordered_map<Vector3i, std::unique_ptr<FTable>, Vector3iHash> mTables;
+	std::list<Vector3i> mUsageList;    // Tables in memory, most recently used at the front
+	uint32_t            mMaxTables;
+	mutable std::mutex  mMutex;
+
+	std::atomic<uint64_t> mLookups;
+	std::atomic<uint64_t> mUniform;
+	std::atomic<uint64_t> mStores;
+};
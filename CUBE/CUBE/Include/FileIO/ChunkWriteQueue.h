@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "ChunkSummaryCache.h"
+#include "Math\Vector3.h"
+#include "Memory\StackAllocator.h"
+
+class FWorldFileSystem;
+
+/**
+* Write-behind stage for chunk layouts. Queued layouts are written to their region
+* files by a persistence thread, so callers don't wait for the disk. Each batch is
+* grouped by region file and written in sector order. A chunk queued again before
+* it was written only has its newest layout written. Queued layouts can still be read
+* until they are on file. Queueing blocks while the queue is over its memory budget.
+* The summary of each layout is stored once the layout is on file, so summaries never
+* describe a layout that isn't written yet.
+*/
+class FChunkWriteQueue
+{
+public:
+	// Default memory budget for queued layouts
+	static const size_t DEFAULT_BYTE_BUDGET = 16 * 1024 * 1024;
+
+	/**
+	* Queue statistics, can be retrieved from any thread.
+	*/
+	struct FStats
+	{
+		uint32_t Depth;             // Layouts waiting to be written, including the batch being written
+		uint32_t PeakDepth;
+		size_t   Bytes;             // Size of all queued layouts
+		uint64_t Writes;            // Layouts written to file
+		uint64_t Coalesced;         // Layouts replaced by a newer one before they were written
+		uint64_t Stalls;            // Times a caller waited for the queue to drain
+		float    AverageLatency;    // Average time, in seconds, from queueing a layout to it being on file
+		float    MaxLatency;
+	};
+
+public:
+	/**
+	* Constructs a queue that writes to a world's file system and starts the persistence thread.
+	* @param SummaryCache - Receives the summaries of written layouts, must outlive the queue.
+	*/
+	FChunkWriteQueue(FWorldFileSystem& FileSystem, FChunkSummaryCache& SummaryCache, const size_t ByteBudget = DEFAULT_BYTE_BUDGET);
+
+	/**
+	* Writes all queued layouts and stops the persistence thread.
+	*/
+	~FChunkWriteQueue();
+
+	FChunkWriteQueue(const FChunkWriteQueue& Other) = delete;
+	FChunkWriteQueue& operator=(const FChunkWriteQueue& Other) = delete;
+
+	/**
+	* Queues the layout of a chunk to be written, replacing a queued layout of the
+	* same chunk. Blocks while the queue is over its budget.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param Data - Encoded block layout of the chunk.
+	* @param DataSize - The size of the layout in bytes.
+	* @param Codec - The ID of the codec the layout is encoded with.
+	* @param Summary - Summary of the layout, stored once the layout is written.
+	*/
+	void Push(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec, const FChunkSummary& Summary);
+
+	/**
+	* Retrieves the layout of a chunk that has not been written yet.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param Scratch - Allocator to copy the layout into.
+	* @param SizeOut - The size of the layout in bytes.
+	* @param CodecOut - The ID of the codec the layout is encoded with.
+	* @return The layout, allocated from Scratch. Null if the chunk isn't queued.
+	*/
+	const uint8_t* Find(const Vector3i& ChunkPosition, FStackAllocator& Scratch, uint32_t& SizeOut, uint8_t& CodecOut);
+
+	/**
+	* Blocks until all queued layouts are on file.
+	*/
+	void Flush();
+
+	/**
+	* Retrieves the statistics of the queue.
+	*/
+	FStats GetStats() const;
+
+private:
+	struct FEntry
+	{
+		std::unique_ptr<uint8_t[]> Data;
+		uint32_t                   DataSize;
+		uint8_t                    Codec;
+		FChunkSummary              Summary;
+		uint64_t                   QueueTime;   // Time the oldest unwritten layout of the chunk was queued
+	};
+
+	typedef std::unordered_map<Vector3i, FEntry, Vector3iHash> EntryMap;
+
+	/**
+	* Writes the batch being written, called without the lock.
+	*/
+	void WriteBatch();
+
+	/**
+	* Writes queued batches until the queue is destroyed.
+	*/
+	void PersistenceThreadLoop();
+
+private:
+	FWorldFileSystem&        mFileSystem;
+	FChunkSummaryCache&      mSummaryCache;
+	EntryMap                 mQueued;      // Layouts waiting for the next batch
+	EntryMap                 mWriting;     // Batch being written, only changed by the persistence thread with the lock held
+	size_t                   mByteBudget;
+
+	mutable std::mutex       mMutex;
+	std::condition_variable  mWriteRequested;
+	std::condition_variable  mWriteCompleted;
+	std::thread              mPersistenceThread;
+	bool                     mMustShutdown;
+
+	std::atomic<uint32_t>    mDepth;
+	std::atomic<uint32_t>    mPeakDepth;
+	std::atomic<size_t>      mBytes;
+	std::atomic<uint64_t>    mWrites;
+	std::atomic<uint64_t>    mCoalesced;
+	std::atomic<uint64_t>    mStalls;
+	std::atomic<uint64_t>    mLatencyCycles;      // Sum of the latency of all writes
+	std::atomic<uint64_t>    mMaxLatencyCycles;
+};
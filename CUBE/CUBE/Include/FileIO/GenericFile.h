@@ -4,6 +4,21 @@
 
 #include "Utils/Singleton.h"
 
+/**
+* Access pattern hints for a range of a file.
+*/
+namespace EFileAdvice
+{
+	enum Type
+	{
+		Normal,      // No particular access pattern
+		Sequential,  // Data will be accessed in order, read ahead aggressively
+		Random,      // Data will be accessed in random order, don't read ahead
+		WillNeed,    // Data will be accessed soon, start loading it
+		DontNeed     // Data won't be accessed soon, cached pages can be dropped
+	};
+}
+
 /**
 * Interface for platform file handles.
 */
@@ -58,6 +73,77 @@ public:
 	* Retrieves the size of this file.
 	*/
 	virtual uint32_t GetFileSize() const = 0;
+
+	/**
+	* Reads data from a specific offset in the file. Positional reads can be
+	* issued by multiple threads on the same handle without any locking.
+	* The position of the file pointer after the read is unspecified.
+	* @param DataOut Buffer for data to be written.
+	* @param NumBytesToRead Number of bytes to read from the file.
+	* @param Offset Offset, in bytes, from the start of the file.
+	* @return False if the number of bytes to read could not be read.
+	*/
+	virtual bool ReadAt(uint8_t* DataOut, const uint32_t NumBytesToRead, const uint64_t Offset) = 0;
+
+	/**
+	* Writes data to a specific offset in the file.
+	* The position of the file pointer after the write is unspecified.
+	* @param Data to write.
+	* @param NumBytesToWrite Number of bytes to write to the file.
+	* @param Offset Offset, in bytes, from the start of the file.
+	* @return False if the number of bytes to write could not be written.
+	*/
+	virtual bool WriteAt(const uint8_t* Data, const uint32_t NumBytesToWrite, const uint64_t Offset) = 0;
+
+	/**
+	* Allocates disk space for the file so writes up to Size bytes don't need to
+	* grow the file. The contents and reported size of the file are unchanged.
+	* @param Size The number of bytes to allocate.
+	* @return True if the space was allocated.
+	*/
+	virtual bool Reserve(const uint64_t Size) = 0;
+
+	/**
+	* Hints how a range of the file will be accessed. Platforms that don't
+	* support a hint ignore it.
+	* @param Advice The expected access pattern.
+	* @param Offset Start of the range, in bytes.
+	* @param Length Length of the range in bytes. 0 extends the range to the end of the file.
+	*/
+	virtual void Advise(const EFileAdvice::Type Advice, const uint64_t Offset = 0, const uint64_t Length = 0) = 0;
+};
+
+/**
+* Read-only view of the whole contents of a file mapped into memory. Pages are
+* read from disk when they are first touched, by whichever thread touches them.
+*/
+class IMappedFile
+{
+public:
+	virtual ~IMappedFile(){};
+
+	/**
+	* Retrieves the contents of the file.
+	*/
+	const uint8_t* GetData() const { return mData; }
+
+	/**
+	* Retrieves the size of the file.
+	*/
+	uint64_t GetSize() const { return mSize; }
+
+protected:
+	IMappedFile(const uint8_t* Data, const uint64_t Size)
+		: mData(Data)
+		, mSize(Size)
+	{}
+
+	IMappedFile(const IMappedFile& Other) = delete;
+	IMappedFile& operator=(const IMappedFile& Other) = delete;
+
+protected:
+	const uint8_t* mData;
+	uint64_t       mSize;
 };
 
 /**
@@ -107,6 +193,13 @@ public:
 	*/
 	virtual std::unique_ptr<IFileHandle> OpenReadWritable(const wchar_t* FileName, const bool AllowRead = false, const bool CreateNew = false) = 0;
 
+	/**
+	* Maps the contents of a file into memory for reading.
+	* @param Filename to map.
+	* @return The mapped file. Nullptr if the file could not be opened or is empty.
+	*/
+	virtual std::unique_ptr<IMappedFile> MapReadable(const wchar_t* Filename) = 0;
+
 	/**
 	* Deletes a file.
 	* @param Filename Name of the file to delete.
@@ -168,6 +261,15 @@ public:
 	*/
 	virtual bool FileExists(const wchar_t* Filename) = 0;
 
+	/**
+	* Gets the time a file was last written to. Times are only comparable
+	* with other times from the same file system.
+	* @param Filename - File to check.
+	* @param TimeOut - Receives the write time.
+	* @return False if the file doesn't exist.
+	*/
+	virtual bool GetWriteTime(const wchar_t* Filename, uint64_t& TimeOut) = 0;
+
 	/**
 	* Sets the current working directory to the directory of
 	* the running program .exe.
@@ -4,6 +4,8 @@
 #include "Math\Vector3.h"
 #include "SystemResources\SystemFile.h"
 #include <memory>
+#include <string>
+#include <mutex>
 
 /**
 * Represents a region file for storing world
@@ -37,22 +39,40 @@ public:
 
 	~FRegionFile();
 
+	FRegionFile(const FRegionFile& Other) = delete;
+	FRegionFile& operator=(const FRegionFile& Other) = delete;
+
 	/**
 	* Loads a specific region file. All region files for a world is placed in
-	* the Worlds/(world-name)/.vgr directory. 
+	* the Worlds/(world-name)/.vgr directory. If this region was loaded before,
+	* the lookup table kept in memory is used instead of reading it again.
+	* A region without a file is loaded empty, its file is created on the first write.
 	* @param WorldName - The name of this world this region is a part of.
 	* @param RegionPosition - The position of the region you world to load.
 	* @return True if the region file was loaded successfully.
 	*/
 	bool Load(const wchar_t* WorldName, const Vector3i& RegionPosition);
 
+	/**
+	* Closes the file handle of this region. The lookup table is written to
+	* file if it was changed and is kept in memory for when the region is loaded again.
+	*/
+	void Close();
+
+	/**
+	* Checks if this region currently has an open file handle. Loaded regions
+	* have no handle until their file exists.
+	*/
+	bool IsOpen() const { return mRegionFile != nullptr; }
+
 	/**
 	* Retrieve info about a specific chunk.
 	* @param ChunkPosition - Position of the chunk within this region.
 	* @param SizeOut - To put the size, in bytes, of the data for the chunk.
 	* @param SectorOffsetOut - The sector offset for this chunks data.
+	* @param CodecOut - The ID of the codec the chunk data was encoded with.
 	*/
-	void GetChunkDataInfo(const Vector3i& ChunkPosition, uint32_t& SizeOut, uint32_t& SectorOffsetOut);
+	void GetChunkDataInfo(const Vector3i& ChunkPosition, uint32_t& SizeOut, uint32_t& SectorOffsetOut, uint8_t& CodecOut);
 
 	/**
 	* Retrieves the data for the layout of a chunk.
@@ -67,8 +87,47 @@ public:
 	* @param ChunkPosition - Position of the chunk within this region.
 	* @param Data - Data to write.
 	* @param SizeOut - The size of the data to write.
+	* @param Codec - The ID of the codec the data is encoded with.
+	*/
+	void WriteChunkData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec = 0);
+
+	/**
+	* Retrieves where the sectors of a chunk are in the file from the lookup table, without
+	* reading the file. Used to read chunks asynchronously, the sectors start with the chunk
+	* data header and can be parsed with ParseChunkSectors().
+	* @param ChunkPosition - Position of the chunk within this region.
+	* @param FileOffsetOut - The offset of the first sector in bytes.
+	* @param ByteCountOut - The size of all sectors of the chunk in bytes.
+	* @return False if the chunk is not in the file.
+	*/
+	bool GetChunkSectors(const Vector3i& ChunkPosition, uint64_t& FileOffsetOut, uint32_t& ByteCountOut);
+
+	/**
+	* Retrieves the chunk data from sectors read from file.
+	* @param Sectors - The sectors of a chunk, starting with the chunk data header.
+	* @param ByteCount - The size of the sectors in bytes.
+	* @param SizeOut - The size of the chunk data in bytes.
+	* @param CodecOut - The ID of the codec the chunk data was encoded with.
+	* @return The chunk data within Sectors. Null if the header doesn't fit the sectors.
 	*/
-	void WriteChunkData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize);
+	static const uint8_t* ParseChunkSectors(const uint8_t* Sectors, const uint32_t ByteCount, uint32_t& SizeOut, uint8_t& CodecOut);
+
+	/**
+	* Retrieves the file handle of this region, null if it is not open.
+	*/
+	IFileHandle* GetFileHandle() const { return mRegionFile.get(); }
+
+	/**
+	* Retrieves the number of times chunk data was written to this region. Data read
+	* asynchronously is only valid if no writes happened while it was read.
+	*/
+	uint32_t GetWriteCount() const { return mWriteCount; }
+
+	/**
+	* Retrieves the lock held while chunk data of this region is read or written by
+	* different threads. Writes can move any chunk within the file.
+	*/
+	std::mutex& GetDataMutex() { return mDataMutex; }
 
 public:
 	/**
@@ -89,30 +148,54 @@ public:
 		LookupEntry ChunkEntry[REGION_SIZE * REGION_SIZE * REGION_SIZE];
 		// Sectors will follow the lookup table.
 		// Each sector is 4KiB and contains RLE chunk data.
-		// Chunk data starts with 4 byte data size at the beginning
-		// of the sector.
+		// Chunk data starts with a 4 byte header at the beginning
+		// of the sector. The low 24 bits of the header are the data
+		// size and the high 8 bits are the codec ID. Files written
+		// before codecs existed have a codec ID of 0 (RLE).
+		static const uint32_t CHUNK_SIZE_MASK = 0x00FFFFFF;
+		static const uint32_t CHUNK_CODEC_SHIFT = 24;
 	};
 
 private:
 	/**
 	* Adds a new chunk to the region file.
 	*/
-	void AddNewChunk(LookupEntry& ChunkEntry, const uint8_t* Data, const uint32_t DataSize);
+	void AddNewChunk(LookupEntry& ChunkEntry, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec);
 
 	/**
 	* Shifts chunk data to the left and relocates RelocationEntry to the end of the file.
 	*/
-	void RelocateAndAddChunkData(LookupEntry& RelocationEntry, const uint8_t* Data, const uint32_t DataSize);
+	void RelocateAndAddChunkData(LookupEntry& RelocationEntry, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec);
+
+	/**
+	* Writes the header and data of a chunk at the start of its sector.
+	*/
+	void WriteChunkSector(const LookupEntry& ChunkEntry, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec);
 
 	uint32_t GetTableIndex(Vector3i Position);
 
+	/**
+	* Retrieves the file position of a sector.
+	*/
+	static uint64_t GetSectorPosition(const uint32_t SectorOffset);
+
 private:
 	RegionData mRegionData;
 	std::unique_ptr<IFileHandle> mRegionFile;
+	std::wstring mFilepath;      // Path of the region file, set on load
+	bool mHasLookupTable;        // True once the lookup table was read from file
+	bool mIsLookupTableDirty;    // True if the lookup table differs from the one on file
+	uint32_t mWriteCount;
+	std::mutex mDataMutex;
 };
 
 inline uint32_t FRegionFile::GetTableIndex(Vector3i Position)
 {
 	const Vector3i PositionToIndex{ (int32_t)FRegionFile::RegionData::REGION_SIZE, (int32_t)FRegionFile::RegionData::REGION_SIZE * FRegionFile::RegionData::REGION_SIZE, 1 };
 	return (uint32_t)Vector3i::Dot(Position, PositionToIndex);
+}
+
+inline uint64_t FRegionFile::GetSectorPosition(const uint32_t SectorOffset)
+{
+	return sizeof(RegionData) + (uint64_t)SectorOffset * RegionData::SECTOR_SIZE;
 }
\ No newline at end of file
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <deque>
+#include <memory>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "RegionFile.h"
+#include "Math\Vector3.h"
+
+namespace ERegionFileState
+{
+	enum Type
+	{
+		Closed,
+		Opening,    // Being opened by the opener thread or an acquire
+		Open
+	};
+}
+
+/**
+* Keeps region files of a world open between uses, bounded by a maximum number
+* of open file handles. Regions that are in use are pinned and never closed. Unpinned
+* regions are closed in least recently used order when the handle limit is exceeded,
+* their lookup tables stay in memory so reopening does not read them again.
+* Cold regions can be opened on a background thread so callers never wait for file opens.
+* A region opened in the background stays open until it is first pinned, so a full cache
+* can't close it before the caller that requested it retries. Callers that no longer retry
+* cancel their requests with CancelPendingOpens(), so these regions can be closed again.
+*/
+class FRegionFileCache
+{
+public:
+	// Default maximum number of region files that are open at once
+	static const uint32_t DEFAULT_MAX_OPEN_FILES = 64;
+
+	// Default maximum number of lookup tables kept for closed regions
+	static const uint32_t DEFAULT_MAX_CLOSED_TABLES = 256;
+
+	/**
+	* Cache statistics, can be retrieved from any thread.
+	*/
+	struct FStats
+	{
+		uint64_t Hits;            // Acquires of regions that were already open
+		uint64_t Opens;           // Region files opened
+		uint64_t Closes;          // Region files closed to stay below the handle limit
+		uint64_t Misses;          // Acquires of regions that were not open yet
+		uint32_t OpenFiles;
+		uint32_t PinnedFiles;
+		uint32_t Tables;          // Lookup tables kept in memory
+	};
+
+public:
+	/**
+	* Constructs a cache for the region files of a world and starts the opener thread.
+	* @param WorldName - The name of the world directory the region files are in.
+	*/
+	FRegionFileCache(const wchar_t* WorldName, const uint32_t MaxOpenFiles = DEFAULT_MAX_OPEN_FILES);
+
+	/**
+	* Stops the opener thread and closes all region files.
+	*/
+	~FRegionFileCache();
+
+	FRegionFileCache(const FRegionFileCache& Other) = delete;
+	FRegionFileCache& operator=(const FRegionFileCache& Other) = delete;
+
+	/**
+	* Pins a region, opening its file on the calling thread if needed.
+	* @param RegionPosition - The region space position of the region.
+	*/
+	void Acquire(const Vector3i& RegionPosition);
+
+	/**
+	* Pins a region only if its file is already open. Otherwise the file is
+	* queued to be opened on the opener thread.
+	* @param RegionPosition - The region space position of the region.
+	* @return True if the region was pinned.
+	*/
+	bool TryAcquire(const Vector3i& RegionPosition);
+
+	/**
+	* Cancels the background opens requested by TryAcquire() that were not followed by a pin.
+	* Queued opens are dropped, and regions that were opened and never pinned become closable.
+	* Opens that are running finish, and their regions are closable right away.
+	*/
+	void CancelPendingOpens();
+
+	/**
+	* Unpins a region. The file stays open until it is the least recently used
+	* one and the handle limit is exceeded.
+	*/
+	void Release(const Vector3i& RegionPosition);
+
+	/**
+	* Retrieves the region file of a pinned region.
+	*/
+	FRegionFile& Get(const Vector3i& RegionPosition);
+
+	/**
+	* Unpins and closes all region files. Lookup tables stay in memory.
+	*/
+	void CloseAll();
+
+	/**
+	* Closes all region files and removes all lookup tables, used when the
+	* files of the world are replaced.
+	*/
+	void Clear();
+
+	/**
+	* Sets the maximum number of open region files, closing files if needed.
+	*/
+	void SetMaxOpenFiles(const uint32_t MaxOpenFiles);
+
+	/**
+	* Retrieves the statistics of the cache.
+	*/
+	FStats GetStats() const;
+
+private:
+	struct FRecord
+	{
+		FRegionFile                   File;
+		uint32_t                      ReferenceCount;
+		ERegionFileState::Type        State;
+		bool                          IsQueued;        // Waiting in the open queue
+		bool                          IsAwaitingAcquire;  // Opened in the background and not pinned since, kept out of the usage list
+		bool                          IsInUsageList;
+		std::list<Vector3i>::iterator UsageNode;   // Position in the open or closed usage list
+	};
+
+	typedef std::unordered_map<Vector3i, std::unique_ptr<FRecord>, Vector3iHash> RecordMap;
+
+	/**
+	* Finds the record of a region, adding a closed one if it doesn't exist.
+	*/
+	FRecord& FindOrAddRecord(const Vector3i& RegionPosition);
+
+	/**
+	* Queues a closed record to be opened on the opener thread.
+	*/
+	void QueueOpen(const Vector3i& RegionPosition, FRecord& Record);
+
+	/**
+	* Opens the file of a record that is in the opening state. The lock is
+	* released while the file is opened.
+	*/
+	void OpenRecord(std::unique_lock<std::mutex>& Lock, const Vector3i& RegionPosition, FRecord& Record);
+
+	/**
+	* Adds a reference to an open record, removing it from the usage list.
+	*/
+	void Pin(FRecord& Record);
+
+	/**
+	* Adds an unpinned record to the front of the usage list for its state.
+	*/
+	void AddToUsageList(const Vector3i& RegionPosition, FRecord& Record);
+
+	/**
+	* Removes a record from its usage list.
+	*/
+	void RemoveFromUsageList(FRecord& Record);
+
+	/**
+	* Closes least recently used files and removes least recently used tables
+	* until the cache is within its limits.
+	*/
+	void EnforceLimits();
+
+	/**
+	* Closes all files and waits for pending opens. Called with the lock held.
+	*/
+	void CloseAllLocked(std::unique_lock<std::mutex>& Lock);
+
+	/**
+	* Opens queued region files until the cache is destroyed.
+	*/
+	void OpenerThreadLoop();
+
+private:
+	const std::wstring       mWorldName;
+	RecordMap                mRecords;
+	std::list<Vector3i>      mOpenUsageList;      // Unpinned open regions, most recently used at the front
+	std::list<Vector3i>      mClosedUsageList;    // Closed regions, most recently used at the front
+	std::deque<Vector3i>     mOpenQueue;          // Regions waiting for the opener thread
+	uint32_t                 mMaxOpenFiles;
+	uint32_t                 mPendingOpens;       // Opens currently running without the lock
+	uint32_t                 mCancelCount;        // Calls to CancelPendingOpens(), tells the opener thread its open was cancelled
+
+	mutable std::mutex       mMutex;
+	std::condition_variable  mOpenRequested;
+	std::condition_variable  mOpenCompleted;
+	std::thread              mOpenerThread;
+	bool                     mMustShutdown;
+
+	std::atomic<uint64_t>    mHits;
+	std::atomic<uint64_t>    mOpens;
+	std::atomic<uint64_t>    mCloses;
+	std::atomic<uint64_t>    mMisses;
+	std::atomic<uint32_t>    mOpenFiles;
+	std::atomic<uint32_t>    mPinnedFiles;
+	std::atomic<uint32_t>    mTables;
+};
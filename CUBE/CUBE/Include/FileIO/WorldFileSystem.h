@@ -1,18 +1,60 @@
 #pragma once
 
 #include <string>
-#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
 
 #include "RegionFile.h"
+#include "RegionFileCache.h"
+#include "AsyncFileReader.h"
 #include "Math\Vector3.h"
+#include "Memory\StackAllocator.h"
 
 class FWorldFileSystem
 {
 public:
+	// The loaded world is copied to a temp directory in the worlds directory. Each world file
+	// system has its own, the first one uses TEMP_DIRECTORY_NAME and others append their index.
 	static const wchar_t TEMP_DIRECTORY_NAME[];
 	static const wchar_t WORLDS_DIRECTORY_NAME[];
 	static const wchar_t TEMP_DIRECTORY_PATH[];
 
+	// Maximum number of chunk reads in flight at once
+	static const uint32_t READ_QUEUE_DEPTH = 64;
+
+	/**
+	* A read of the data of a chunk that completes in the background.
+	*/
+	struct FChunkRead
+	{
+		Vector3i       ChunkPosition;
+		const uint8_t* Data;          // The chunk data once the read completed, null if the chunk is not in the world
+		uint32_t       DataSize;
+		uint8_t        Codec;
+
+		// State of the read while it is in flight
+		uint8_t*       Sectors;
+		uint32_t       SectorBytes;
+		uint32_t       WriteCount;    // Write count of the region when the read was submitted
+		uint64_t       SubmitTime;
+	};
+
+	/**
+	* Chunk read statistics, can be retrieved from any thread.
+	*/
+	struct FReadStats
+	{
+		uint64_t       Reads;            // Chunks read from file
+		uint64_t       Batches;          // Batches of asynchronous reads
+		uint64_t       Retries;          // Asynchronous reads repeated because they failed or the region was written meanwhile
+		float          AverageLatency;   // Average time, in seconds, from requesting chunk data to it being read
+		float          P99Latency;       // Upper bound of the 99th percentile latency
+		float          MaxLatency;
+		const wchar_t* Backend;          // The asynchronous I/O backend
+	};
+
 public:
 	FWorldFileSystem();
 	~FWorldFileSystem();
@@ -26,17 +68,37 @@ public:
 	* @return False if the world file could not be loaded, true otherwise.
 	*/
 	bool SetWorld(const wchar_t* WorldName);
+
+	/**
+	* Creates an empty world. Chunks of the world are generated as they are loaded.
+	* @param WorldName - The name of the world to create.
+	* @param WorldSize - The cubic size of the world in chunks.
+	* @param Seed - The seed chunks of this world are generated with.
+	* @return False if the world already exists or could not be created.
+	*/
+	bool CreateWorld(const wchar_t* WorldName, const uint32_t WorldSize, const uint32_t Seed);
 	
 	/**
 	* Chunk size of the current world.
 	*/
 	uint32_t GetWorldSize() const;
 
+	/**
+	* The seed used to generate missing chunks of the current world. Worlds
+	* built before chunks were generated on demand have a seed of 0.
+	*/
+	uint32_t GetWorldSeed() const;
+
 	/**
 	* The name of the currently loaded world.
 	*/
 	std::wstring GetWorldName() const;
 
+	/**
+	* The name of the temp directory of this world file system, within the worlds directory.
+	*/
+	const wchar_t* GetTempDirectoryName() const { return mTempDirectoryName.c_str(); }
+
 	/**
 	* Saves the current world data to it's original location on file.
 	*/
@@ -44,11 +106,26 @@ public:
 
 	/**
 	* Adds a reference the a region file in the region map. If the
-	* region file is not present, one is created.
+	* region file is not open, it is opened on the calling thread.
 	* @param X, Y, Z Coordinates of the chunk.
 	*/
 	void AddRegionFileReference(const Vector3i& ChunkPosition);
 
+	/**
+	* Adds a reference to a region file only if the file is already open.
+	* Otherwise the file is opened in the background and the call should be
+	* repeated later.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @return True if the reference was added.
+	*/
+	bool TryAddRegionFileReference(const Vector3i& ChunkPosition);
+
+	/**
+	* Cancels the background opens of TryAddRegionFileReference() calls that will not be repeated,
+	* so the files can be closed again.
+	*/
+	void CancelRegionFileOpens();
+
 	/**
 	* Removes a reference the a region file in the region map.
 	* @param X, Y, Z Coordinates of the chunk.
@@ -60,38 +137,114 @@ public:
 	*/
 	void ClearAllRegionFileReferences();
 
+	/**
+	* Sets the maximum number of region files that are kept open.
+	*/
+	void SetMaxOpenRegionFiles(const uint32_t MaxOpenFiles);
+
+	/**
+	* Retrieves statistics of the region file cache.
+	*/
+	FRegionFileCache::FStats GetRegionFileStats() const;
+
 	/**
 	* Retrieves data for a chunk within the currently loaded world.
 	* @param ChunkPosition - The chunk space position of the chunk.
-	* @param DataOut - Buffer to place chunk data.
+	* @param Scratch - Allocator to place chunk data in.
+	* @param SizeOut - The size of the chunk data in bytes. 0 if the chunk is not in the world.
+	* @param CodecOut - The ID of the codec the chunk data is encoded with.
+	* @return The chunk data, allocated from Scratch.
+	*/
+	const uint8_t* GetChunkData(const Vector3i& ChunkPosition, FStackAllocator& Scratch, uint32_t& SizeOut, uint8_t& CodecOut);
+
+	/**
+	* Retrieves the sector offset of a chunk within its region file, used to write chunks in file order.
+	* @param ChunkPosition - The chunk space position of the chunk. Its region must be referenced.
+	* @return The sector offset, UINT32_MAX if the chunk is not in the file.
+	*/
+	uint32_t GetChunkSectorOffset(const Vector3i& ChunkPosition);
+
+	/**
+	* Retrieves how many bytes SubmitChunkReads() allocates to read a chunk, used to budget a batch of reads.
+	* @param ChunkPosition - The chunk space position of the chunk. Its region must be referenced.
+	* @return The size of the chunk's sectors in bytes, 0 if the chunk is not in the file.
+	*/
+	uint32_t GetChunkReadSize(const Vector3i& ChunkPosition);
+
+	/**
+	* Starts reading the data of chunks in the background. The regions of the chunks must be
+	* referenced until their reads are retrieved with WaitForChunkReads().
+	* @param Reads - The reads to start, only ChunkPosition needs to be set. Must stay valid until the reads are retrieved.
+	* @param Count - The number of reads.
+	* @param Scratch - Allocator to place chunk data in. Must not be cleared until the reads are retrieved.
+	*/
+	void SubmitChunkReads(FChunkRead* Reads, const uint32_t Count, FStackAllocator& Scratch);
+
+	/**
+	* Retrieves completed chunk reads, waiting for at least one if any reads are in flight.
+	* Reads are retrieved in the order they complete.
+	* @param ReadsOut - Array to place the completed reads in.
+	* @param MaxReads - The size of ReadsOut.
+	* @return The number of reads placed in ReadsOut, 0 if no reads are left.
+	*/
+	uint32_t WaitForChunkReads(FChunkRead** ReadsOut, const uint32_t MaxReads);
+
+	/**
+	* Retrieves statistics of chunk reads.
 	*/
-	void GetChunkData(const Vector3i& ChunkPosition, std::vector<uint8_t>& DataOut);
+	FReadStats GetReadStats() const;
+
+	/**
+	* Resets the statistics of chunk reads, used to compare reading modes.
+	*/
+	void ResetReadStats();
 
 	/**
 	* Writes data for a chunk within the currently loaded world.
 	* @param ChunkPosition - The chunk space position of the chunk.
 	* @param Data - Buffer containing chunk data.
+	* @param DataSize - The size of the chunk data in bytes.
+	* @param Codec - The ID of the codec the chunk data is encoded with.
 	*/
-	void WriteChunkData(const Vector3i& ChunkPosition, const std::vector<uint8_t>& Data);
+	void WriteChunkData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec);
 
 private:
-	struct RegionFileRecord
-	{
-		FRegionFile File;
-		uint32_t ReferenceCount;
-	};
+	/**
+	* Reads the data of a chunk on the calling thread. The region must be referenced.
+	*/
+	const uint8_t* ReadChunkData(const Vector3i& ChunkPosition, FStackAllocator& Scratch, uint32_t& SizeOut, uint8_t& CodecOut);
 
-	// Hash functor for file table
-	struct Vector3iHash
-	{
-		std::size_t operator()(const Vector3i& Val)
-		{
-			return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
-		}
-	};
+	/**
+	* Validates the data of a completed asynchronous read, reading it again if needed.
+	*/
+	void CompleteChunkRead(FChunkRead& Read, const int64_t BytesRead);
+
+	/**
+	* Adds the latency of a chunk read to the statistics.
+	*/
+	void RecordRead(const uint64_t StartTime);
 
 private:
+	// Number of log2 microsecond buckets in the latency histogram
+	static const uint32_t LATENCY_BUCKETS = 32;
+
 	std::wstring mWorldName;
-	std::unordered_map<Vector3i, RegionFileRecord, Vector3iHash> mRegionFiles;
+	uint32_t mTempDirectoryIndex;
+	std::wstring mTempDirectoryName;
+	std::wstring mTempDirectoryPath;
+	FRegionFileCache mRegionFiles;
 	uint32_t mWorldSize;
+	uint32_t mWorldSeed;
+
+	// Asynchronous chunk reads, only used by the loader thread
+	std::unique_ptr<IAsyncFileReader> mAsyncReader;
+	std::vector<FChunkRead*> mReadyReads;     // Reads that completed without file I/O
+	FStackAllocator* mReadScratch;            // Allocator of the reads in flight
+
+	std::atomic<uint64_t> mReads;
+	std::atomic<uint64_t> mReadBatches;
+	std::atomic<uint64_t> mReadRetries;
+	std::atomic<uint64_t> mReadCycles;        // Sum of the latency of all reads
+	std::atomic<uint64_t> mMaxReadCycles;
+	std::atomic<uint64_t> mReadHistogram[LATENCY_BUCKETS];
 };
\ No newline at end of file
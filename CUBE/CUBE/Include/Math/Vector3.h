@@ -236,4 +236,15 @@ using Vector3i = TVector3<int32_t>;	/* Vector type for 32 bit integers */
 using Vector3ui = TVector3<uint32_t>; /* Vector type for 32 bit unsigned integers */
 using Vector3f = TVector3<float>; /* Vector type for floats */
 
+/**
+* Hash functor for using Vector3i as the key of unordered containers.
+*/
+struct Vector3iHash
+{
+	std::size_t operator()(const Vector3i& Val) const
+	{
+		return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
+	}
+};
+
 #include "Vector4.h"
\ No newline at end of file
@@ -0,0 +1,456 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "Common.h"
+#include "Misc/Assertions.h"
+#include "VirtualPoolAllocator.h"
+
+/**
+* Per-thread state shared by all instances of FConcurrentPoolAllocator.
+* Each pool is assigned a slot in every thread's magazine array on construction.
+* Slots are reused once their pool is destroyed, a new generation of the slot
+* makes threads drop elements they still cached for the destroyed pool.
+*/
+namespace FConcurrentPool
+{
+	// Max number of concurrent pools that can exist at once
+	static const uint32_t MAX_POOLS = 64;
+
+	/**
+	* A thread's cache of free elements for a single pool.
+	*/
+	struct FMagazine
+	{
+		void*    Head;       // Singly linked list of free elements
+		uint32_t Count;      // Number of elements in the list
+		uint32_t Generation; // Generation of the pool the elements belong to
+	};
+
+	/**
+	* Magazines of a single thread, indexed by pool ID.
+	* They are registered globally and never freed, so a pool can reclaim
+	* elements cached by any thread, including threads that already exited.
+	*/
+	struct FThreadMagazines
+	{
+		FMagazine         Magazines[MAX_POOLS];
+		FThreadMagazines* Next; // Next registered thread
+	};
+
+	/**
+	* Magazines of the calling thread, null until the thread first uses a pool.
+	*/
+	extern THREAD_LOCAL FThreadMagazines* ThreadMagazines;
+
+	/**
+	* Creates and registers the magazines of the calling thread.
+	*/
+	FThreadMagazines* RegisterThread();
+
+	/**
+	* Calls Visit on the magazine with the given pool ID of every registered thread.
+	* The owning threads must not use the pool while its magazines are visited.
+	*/
+	void VisitMagazines(const uint32_t ID, void(*Visit)(FMagazine& Magazine, void* UserData), void* UserData);
+
+	/**
+	* Retrieves an ID for a new pool that is unique among existing pools.
+	* @param GenerationOut - Receives the generation of the ID, never 0.
+	*/
+	uint32_t AcquirePoolID(uint32_t& GenerationOut);
+
+	/**
+	* Makes the ID of a destroyed pool available to new pools.
+	*/
+	void ReleasePoolID(const uint32_t ID);
+}
+
+template <uint32_t ElementSize, uint32_t ElementsPerBlock, uint32_t BatchSize = 16>
+/**
+* Thread-safe pool allocator that caches free elements per thread.
+* Allocations and frees operate on a thread-local magazine without any synchronization.
+* Magazines are refilled from and spilled to a global lock-free stack in batches of
+* BatchSize elements, only falling back to a locked FVirtualPoolAllocator when the global
+* stack is empty.
+* Elements cached by a thread are only reused by other threads after FConcurrentPoolAllocator::FlushThreadCache,
+* the destructor reclaims the magazines of all threads. Memory is only returned to the OS by FConcurrentPoolAllocator::Trim,
+* which waits for pops of the global stack in flight before anything is decommitted.
+* \n
+* @param ElementSize The size of each allocation object.
+* @param ElementsPerBlock The number of objects committed at once by the backing pool.
+* @param BatchSize The number of elements moved between a thread's magazine and the global stack.
+*/
+class FConcurrentPoolAllocator
+{
+public:
+	/**
+	* Ctor
+	* Constructs a concurrent pool allocator with specified alignment.
+	* @param Alignment for each allocation
+	* @param InitialCapacity - The number of objects to reserve address space for.
+	* @param Tag - The memory tag committed memory is reported to.
+	*/
+	FConcurrentPoolAllocator(uint32_t Alignment, uint32_t InitialCapacity, EMemoryTag Tag = EMemoryTag::Untagged)
+		: mBackingPool(Alignment, InitialCapacity, Tag)
+		, mBackingPoolMutex()
+		, mBatches()
+		, mPopsInFlight()
+		, mObjectsConstructed()
+		, mPoolGeneration(0)
+		, mPoolID(FConcurrentPool::AcquirePoolID(mPoolGeneration))
+	{
+		ASSERT(BatchSize > 0);
+		ASSERT(ElementSize >= sizeof(PoolElement) && "ElementSize must be large enough to store batch links.");
+
+		mBatches = 0;
+		mPopsInFlight = 0;
+		mObjectsConstructed = 0;
+	}
+
+	~FConcurrentPoolAllocator()
+	{
+		ASSERT(mObjectsConstructed == 0 && "All objects should be back in the pool on destruction.");
+		FConcurrentPool::VisitMagazines(mPoolID, &FConcurrentPoolAllocator::ReclaimMagazine, this);
+		Trim();
+		FConcurrentPool::ReleasePoolID(mPoolID);
+	}
+
+	/**
+	* Allocate a new element from the memory pool.
+	* If the OS can't provide more memory, nullptr is returned.
+	*/
+	void* Allocate()
+	{
+		FConcurrentPool::FMagazine& Magazine = GetMagazine();
+		if (Magazine.Count == 0 && !RefillMagazine(Magazine))
+			return nullptr;
+
+		PoolElement* Element = static_cast<PoolElement*>(Magazine.Head);
+		Magazine.Head = Element->Next;
+		Magazine.Count--;
+
+		mObjectsConstructed.fetch_add(1, std::memory_order_relaxed);
+		return Element;
+	}
+
+	/**
+	* Release an object back into the memory pool.
+	* Memory can be freed from any thread, not only the thread that allocated it.
+	*/
+	void Free(void* Data)
+	{
+		ASSERT(mObjectsConstructed > 0);
+
+		FConcurrentPool::FMagazine& Magazine = GetMagazine();
+		PoolElement* Element = static_cast<PoolElement*>(Data);
+		Element->Next = static_cast<PoolElement*>(Magazine.Head);
+		Magazine.Head = Element;
+		Magazine.Count++;
+
+		// Keep one batch for the thread, hand the rest to other threads
+		if (Magazine.Count >= 2 * BatchSize)
+		{
+			PushBatch(DetachBatch(Magazine, BatchSize));
+		}
+
+		mObjectsConstructed.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	/**
+	* Moves all elements cached by the calling thread to the global stack.
+	*/
+	void FlushThreadCache()
+	{
+		FConcurrentPool::FMagazine& Magazine = GetMagazine();
+		if (Magazine.Count > 0)
+		{
+			PushBatch(DetachBatch(Magazine, Magazine.Count));
+		}
+	}
+
+	/**
+	* Returns all elements on the global stack to the backing pool so empty
+	* blocks can be decommitted. Elements cached by threads are unaffected.
+	* Other threads may keep using the pool, but Trim spins until no thread
+	* is popping from the global stack.
+	*/
+	void Trim()
+	{
+		std::lock_guard<std::mutex> Lock(mBackingPoolMutex);
+
+		// Detach the whole stack, the new tag makes pops that read the old head retry
+		uint64_t OldHead = mBatches.load(std::memory_order_relaxed);
+		while (!mBatches.compare_exchange_weak(OldHead, (OldHead & ~POINTER_MASK) + TAG_INCREMENT)){}
+
+		// A pop that started before the detach may still read the first batch
+		while (mPopsInFlight.load() != 0)
+		{
+			std::this_thread::yield();
+		}
+
+		PoolElement* Batch = reinterpret_cast<PoolElement*>(static_cast<uintptr_t>(OldHead & POINTER_MASK));
+		while (Batch)
+		{
+			PoolElement* NextBatch = Batch->NextBatch;
+			while (Batch)
+			{
+				PoolElement* Next = Batch->Next;
+				mBackingPool.Free(Batch);
+				Batch = Next;
+			}
+
+			Batch = NextBatch;
+		}
+	}
+
+	/**
+	* Gets the number of objects that can be allocated
+	* before more address space is reserved.
+	*/
+	uint32_t Capacity()
+	{
+		std::lock_guard<std::mutex> Lock(mBackingPoolMutex);
+		return mBackingPool.Capacity();
+	}
+
+	/**
+	* Returns the number of objects in the pool
+	* that are constructed.
+	*/
+	uint32_t Size() const
+	{
+		return mObjectsConstructed.load(std::memory_order_relaxed);
+	}
+
+	/**
+	* Returns the number of bytes currently backed by physical memory.
+	*/
+	size_t CommittedBytes()
+	{
+		std::lock_guard<std::mutex> Lock(mBackingPoolMutex);
+		return mBackingPool.CommittedBytes();
+	}
+
+private:
+	// Disable copy ctor and copy assignment
+	FConcurrentPoolAllocator(const FConcurrentPoolAllocator& Other) = delete;
+	FConcurrentPoolAllocator& operator=(const FConcurrentPoolAllocator& Other) = delete;
+
+	/**
+	* Layout of a free element. The first element of a batch
+	* also links to the next batch on the global stack.
+	*/
+	struct PoolElement
+	{
+		PoolElement* Next;      // Next element within the magazine or batch
+		PoolElement* NextBatch; // Next batch on the global stack
+	};
+
+	// The global stack head stores a pointer in the low 48 bits and an ABA tag in the high 16 bits
+	static const uint64_t POINTER_MASK = (uint64_t(1) << 48) - 1;
+	static const uint64_t TAG_INCREMENT = uint64_t(1) << 48;
+
+	/**
+	* Retrieves the calling thread's magazine for this pool. A magazine left over
+	* from a destroyed pool with the same ID is emptied first.
+	*/
+	FConcurrentPool::FMagazine& GetMagazine()
+	{
+		FConcurrentPool::FThreadMagazines* ThreadMagazines = FConcurrentPool::ThreadMagazines;
+		if (!ThreadMagazines)
+		{
+			ThreadMagazines = FConcurrentPool::RegisterThread();
+		}
+
+		FConcurrentPool::FMagazine& Magazine = ThreadMagazines->Magazines[mPoolID];
+		if (Magazine.Generation != mPoolGeneration)
+		{
+			Magazine.Head = nullptr;
+			Magazine.Count = 0;
+			Magazine.Generation = mPoolGeneration;
+		}
+
+		return Magazine;
+	}
+
+	/**
+	* Moves the elements a thread cached for this pool to the global stack.
+	* Magazines still holding elements of a destroyed pool with the same ID are skipped.
+	*/
+	static void ReclaimMagazine(FConcurrentPool::FMagazine& Magazine, void* UserData)
+	{
+		FConcurrentPoolAllocator* Pool = static_cast<FConcurrentPoolAllocator*>(UserData);
+		if (Magazine.Generation == Pool->mPoolGeneration && Magazine.Count > 0)
+		{
+			Pool->PushBatch(DetachBatch(Magazine, Magazine.Count));
+		}
+	}
+
+	/**
+	* Removes Count elements from the front of a magazine and links them into a batch.
+	*/
+	static PoolElement* DetachBatch(FConcurrentPool::FMagazine& Magazine, const uint32_t Count)
+	{
+		ASSERT(Count > 0 && Count <= Magazine.Count);
+
+		PoolElement* Batch = static_cast<PoolElement*>(Magazine.Head);
+		PoolElement* Last = Batch;
+		for (uint32_t i = 1; i < Count; i++)
+		{
+			Last = Last->Next;
+		}
+
+		Magazine.Head = Last->Next;
+		Magazine.Count -= Count;
+		Last->Next = nullptr;
+		return Batch;
+	}
+
+	void PushBatch(PoolElement* Batch)
+	{
+		uint64_t OldHead = mBatches.load(std::memory_order_relaxed);
+		uint64_t NewHead;
+		do
+		{
+			Batch->NextBatch = reinterpret_cast<PoolElement*>(static_cast<uintptr_t>(OldHead & POINTER_MASK));
+			NewHead = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(Batch)) | ((OldHead & ~POINTER_MASK) + TAG_INCREMENT);
+		} while (!mBatches.compare_exchange_weak(OldHead, NewHead, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	PoolElement* PopBatch()
+	{
+		// Counted before the head is read, so Trim can't decommit a batch this thread still reads
+		mPopsInFlight.fetch_add(1);
+
+		uint64_t OldHead = mBatches.load();
+		PoolElement* Batch;
+		uint64_t NewHead;
+		do
+		{
+			Batch = reinterpret_cast<PoolElement*>(static_cast<uintptr_t>(OldHead & POINTER_MASK));
+			if (!Batch)
+				break;
+
+			// Batch may already be popped by another thread, the tag makes the exchange fail in that case
+			NewHead = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(Batch->NextBatch)) | ((OldHead & ~POINTER_MASK) + TAG_INCREMENT);
+		} while (!mBatches.compare_exchange_weak(OldHead, NewHead));
+
+		mPopsInFlight.fetch_sub(1, std::memory_order_release);
+		return Batch;
+	}
+
+	/**
+	* Fills an empty magazine from the global stack, or from the backing pool if the stack is empty.
+	*/
+	bool RefillMagazine(FConcurrentPool::FMagazine& Magazine)
+	{
+		if (PoolElement* Batch = PopBatch())
+		{
+			uint32_t Count = 0;
+			for (PoolElement* Element = Batch; Element; Element = Element->Next)
+			{
+				Count++;
+			}
+
+			Magazine.Head = Batch;
+			Magazine.Count = Count;
+			return true;
+		}
+
+		std::lock_guard<std::mutex> Lock(mBackingPoolMutex);
+		for (uint32_t i = 0; i < BatchSize; i++)
+		{
+			PoolElement* Element = static_cast<PoolElement*>(mBackingPool.Allocate());
+			if (!Element)
+				break;
+
+			Element->Next = static_cast<PoolElement*>(Magazine.Head);
+			Magazine.Head = Element;
+			Magazine.Count++;
+		}
+
+		return Magazine.Count > 0;
+	}
+
+private:
+	FVirtualPoolAllocator<ElementSize, ElementsPerBlock> mBackingPool;   // Source of new elements
+	std::mutex                                           mBackingPoolMutex;
+	std::atomic<uint64_t>                                mBatches;       // Tagged head of the global batch stack
+	std::atomic<uint32_t>                                mPopsInFlight;  // Threads currently popping from the global stack
+	std::atomic<uint32_t>                                mObjectsConstructed; // Number of active objects from the pool
+	uint32_t                                             mPoolGeneration; // Generation of the pool ID, set with the ID
+	const uint32_t                                       mPoolID;        // Index of this pool's thread magazines
+};
+
+
+
+template <typename ElementType, uint32_t ElementsPerBlock, uint32_t BatchSize = 16>
+/**
+* A wrapper class of FConcurrentPoolAllocator for conveniently creating a
+* pool for a specific object type.
+* \n
+* @param ElementType The object contained within the pool
+* @param ElementsPerBlock The number of objects committed at once by the backing pool.
+* @param BatchSize The number of elements moved between a thread's magazine and the global stack.
+*/
+class FConcurrentPoolAllocatorType : private FConcurrentPoolAllocator<sizeof(ElementType), ElementsPerBlock, BatchSize>
+{
+	typedef FConcurrentPoolAllocator<sizeof(ElementType), ElementsPerBlock, BatchSize> Super;
+
+public:
+	FConcurrentPoolAllocatorType(uint32_t Alignment, uint32_t InitialCapacity, EMemoryTag Tag = EMemoryTag::Untagged)
+		: Super(Alignment, InitialCapacity, Tag)
+	{
+
+	}
+
+	~FConcurrentPoolAllocatorType() = default;
+
+	/**
+	* Allocate a new element from the memory pool.
+	* If the OS can't provide more memory, nullptr is returned.
+	*/
+	ElementType* Allocate()
+	{
+		return reinterpret_cast<ElementType*>(Super::Allocate());
+	}
+
+	/**
+	* Release an object back into the memory pool.
+	* The objects' destructor is called within this function
+	* before memory is freed.
+	*/
+	void Free(ElementType* Data)
+	{
+		Data->~ElementType();
+		Super::Free((void*)Data);
+	}
+
+	void FlushThreadCache()
+	{
+		Super::FlushThreadCache();
+	}
+
+	void Trim()
+	{
+		Super::Trim();
+	}
+
+	uint32_t Capacity()
+	{
+		return Super::Capacity();
+	}
+
+	uint32_t Size() const
+	{
+		return Super::Size();
+	}
+
+	size_t CommittedBytes()
+	{
+		return Super::CommittedBytes();
+	}
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include "Common.h"
+
+// Define as 0 to compile out all allocation tracking
+#ifndef MEMORY_TRACKING_ENABLED
+	#define MEMORY_TRACKING_ENABLED 1
+#endif
+
+/**
+* Subsystems that memory usage is reported for.
+*/
+enum class EMemoryTag : uint8_t
+{
+	Untagged,
+	ChunkBlocks,
+	ChunkMeshes,
+	ChunkCollision,
+	ChunkGPU,
+	ChunkCache,
+	Scratch,
+	GameObjects,
+	Physics,
+	Audio,
+	MeshResources,
+	Count
+};
+
+/**
+* Tracks live, peak and allocation count statistics for each memory tag.
+* Allocators report to the tracker with the tag they were created with,
+* or the calling thread's current tag. All statistics are updated with
+* relaxed atomics, so reporting is safe from any thread.
+*/
+class SMemoryTracker
+{
+public:
+	/**
+	* A snapshot of the statistics for a tag.
+	*/
+	struct FTagStats
+	{
+		uint64_t LiveBytes;
+		uint64_t PeakBytes;
+		uint64_t LiveCount;      // Number of active allocations
+		uint64_t TotalCount;     // Number of allocations made
+	};
+
+public:
+	/**
+	* Records an allocation for a tag.
+	*/
+	static void OnAllocate(const EMemoryTag Tag, const size_t Bytes);
+
+	/**
+	* Records a free for a tag.
+	*/
+	static void OnFree(const EMemoryTag Tag, const size_t Bytes);
+
+	/**
+	* Records an allocation that changed size, such as a GL buffer being reuploaded.
+	* An OldBytes of 0 counts as a new allocation and a NewBytes of 0 counts as a free.
+	*/
+	static void OnResize(const EMemoryTag Tag, const size_t OldBytes, const size_t NewBytes);
+
+	/**
+	* Retrieves the tag set for the calling thread by FMemoryTagScope.
+	*/
+	static EMemoryTag GetCurrentTag();
+
+	/**
+	* Sets the tag for the calling thread.
+	*/
+	static void SetCurrentTag(const EMemoryTag Tag);
+
+	/**
+	* Retrieves the statistics for a tag.
+	*/
+	static FTagStats GetStats(const EMemoryTag Tag);
+
+	/**
+	* Retrieves the display name of a tag.
+	*/
+	static const char* GetTagName(const EMemoryTag Tag);
+
+	/**
+	* Writes the statistics of every tag to a text file.
+	* @return True if the file was written.
+	*/
+	static bool DumpToFile(const char* Filename);
+
+	/**
+	* Routes Bullet and FMOD allocations through the tracker. Must be called
+	* before the physics and audio systems are created.
+	*/
+	static void InstallThirdPartyHooks();
+};
+
+/**
+* Sets the memory tag of the calling thread for the lifetime of the scope.
+* The previous tag is restored when the scope exits.
+*/
+class FMemoryTagScope
+{
+public:
+	FMemoryTagScope(const EMemoryTag Tag)
+		: mPreviousTag(SMemoryTracker::GetCurrentTag())
+	{
+		SMemoryTracker::SetCurrentTag(Tag);
+	}
+
+	~FMemoryTagScope()
+	{
+		SMemoryTracker::SetCurrentTag(mPreviousTag);
+	}
+
+	FMemoryTagScope(const FMemoryTagScope& Other) = delete;
+	FMemoryTagScope& operator=(const FMemoryTagScope& Other) = delete;
+
+private:
+	const EMemoryTag mPreviousTag;
+};
+
+#if !MEMORY_TRACKING_ENABLED
+	inline void SMemoryTracker::OnAllocate(const EMemoryTag, const size_t) {}
+	inline void SMemoryTracker::OnFree(const EMemoryTag, const size_t) {}
+	inline void SMemoryTracker::OnResize(const EMemoryTag, const size_t, const size_t) {}
+	inline EMemoryTag SMemoryTracker::GetCurrentTag() { return EMemoryTag::Untagged; }
+	inline void SMemoryTracker::SetCurrentTag(const EMemoryTag) {}
+#endif
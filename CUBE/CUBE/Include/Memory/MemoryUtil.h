@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 
 #define ALIGNED_ALLOC(Alignment) \
 	void* operator new(size_t Size) { return FMemory::AllocateAligned(Size, (Alignment)); }  \
@@ -41,4 +42,43 @@ namespace FMemory
 	* @param Data to be freed.
 	*/
 	void FreeAligned(void* Data);
+
+	/**
+	* Retrieves the granularity, in bytes, that virtual memory is
+	* committed and decommitted with.
+	*/
+	uint32_t GetPageSize();
+
+	/**
+	* Reserves a range of virtual address space without backing it with
+	* physical memory. Any part of the range must be committed with
+	* FMemory::CommitVirtual before it is accessed.
+	* @param Bytes - Size of the range. Should be a multiple of the page size.
+	* @return The start of the reserved range. Nullptr if the reservation failed.
+	*/
+	void* ReserveVirtual(const size_t Bytes);
+
+	/**
+	* Backs a page aligned part of a reserved range with physical memory.
+	* Newly committed memory is zero filled.
+	* @param Address - Start of the pages to commit.
+	* @param Bytes - Number of bytes to commit. Should be a multiple of the page size.
+	* @return True if the memory was committed.
+	*/
+	bool CommitVirtual(void* Address, const size_t Bytes);
+
+	/**
+	* Returns the physical memory backing a page aligned part of a reserved range
+	* to the OS. The address range stays reserved and can be committed again.
+	* @param Address - Start of the pages to decommit.
+	* @param Bytes - Number of bytes to decommit. Should be a multiple of the page size.
+	*/
+	void DecommitVirtual(void* Address, const size_t Bytes);
+
+	/**
+	* Releases a complete range obtained from FMemory::ReserveVirtual.
+	* @param Address - Start of the reserved range.
+	* @param Bytes - Size of the reserved range.
+	*/
+	void ReleaseVirtual(void* Address, const size_t Bytes);
 }
\ No newline at end of file
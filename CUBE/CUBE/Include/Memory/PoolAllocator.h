@@ -3,6 +3,7 @@
 #include <cstdint>
 #include "Misc/Assertions.h"
 #include "MemoryUtil.h"
+#include "MemoryTracker.h"
 
 #include <algorithm>
 
@@ -25,8 +26,12 @@ public:
 	* Ctor
 	* Constructs a fixed size pool allocator with specified alignment.
 	* @param Alignment for each allocation
+	* @param Tag - The memory tag the pool reports its memory to.
 	*/
-	FPoolAllocator(uint32_t Alignment)
+	FPoolAllocator(uint32_t Alignment, EMemoryTag Tag = EMemoryTag::Untagged)
+		: mObjectsConstructed(0)
+		, mPoolBytes(0)
+		, mTag(Tag)
 	{
 		ASSERT(0 < BlockSize && "BlockSize must be larger that 0");
 		ASSERT(ElementSize >= sizeof(PoolElement) && "ElementSize must at least the size of a standard pointer type.");
@@ -35,8 +40,10 @@ public:
 		const uint32_t BlockGap = std::max(ElementSize, Alignment);
 
 		// Obtain a block of memory
-		uint8_t* RawMem = (uint8_t*)FMemory::AllocateAligned(BlockGap * BlockSize, Alignment);
+		mPoolBytes = BlockGap * BlockSize;
+		uint8_t* RawMem = (uint8_t*)FMemory::AllocateAligned(mPoolBytes, Alignment);
 		mNextFreeBlock = (PoolElement*)RawMem;
+		SMemoryTracker::OnAllocate(mTag, mPoolBytes);
 
 		// Link the blocks of memory together
 		for (int i = 1; i < BlockSize; i++)
@@ -66,6 +73,7 @@ public:
 		}
 
 		FMemory::FreeAligned(MemoryStart);
+		SMemoryTracker::OnFree(mTag, mPoolBytes);
 	}
 
 	/**
@@ -127,6 +135,8 @@ private:
 private:
 	PoolElement* mNextFreeBlock; // Entry into the freelist
 	uint32_t mObjectsConstructed; // Number of active objects from the pool
+	uint32_t mPoolBytes;          // Size of the pool's memory
+	EMemoryTag mTag;              // Tag memory is reported to
 };
 
 
@@ -144,8 +154,8 @@ template <typename ElementType, uint32_t BlockSize>
 class FPoolAllocatorType : private FPoolAllocator<sizeof(ElementType), BlockSize>
 {
 public:
-	FPoolAllocatorType(uint8_t Alignment)
-		:FPoolAllocator(Alignment)
+	FPoolAllocatorType(uint8_t Alignment, EMemoryTag Tag = EMemoryTag::Untagged)
+		:FPoolAllocator(Alignment, Tag)
 	{
 
 	}
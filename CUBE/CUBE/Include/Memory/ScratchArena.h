@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include "Misc/Assertions.h"
+#include "StackAllocator.h"
+
+/**
+* Access to per-thread scratch arenas for short lived temporaries.
+* Each thread that uses a scratch arena receives its own FStackAllocator,
+* so no synchronization is needed while allocating. Memory from an arena
+* should be released with an FScratchScope when a job finishes.
+*/
+class SScratchArena
+{
+public:
+	// Size of each thread's arena
+	static const uint32_t ARENA_SIZE = 4 * 1024 * 1024;
+
+	/**
+	* Retrieves the arena of the calling thread. Arenas released by
+	* threads that finished are reused before new ones are created.
+	*/
+	static FStackAllocator& Get();
+
+	/**
+	* Hands the calling thread's arena back to be reused by other threads.
+	* Should be called by threads that used a scratch arena before they exit.
+	*/
+	static void ReleaseThreadArena();
+
+	/**
+	* Retrieves the highest number of bytes used by any single
+	* arena at the end of a scratch scope.
+	*/
+	static uint32_t GetPeakUsage();
+
+	/**
+	* Records the peak usage of an arena.
+	*/
+	static void UpdatePeakUsage(const FStackAllocator& Arena);
+
+private:
+	static std::atomic<uint32_t> mPeakUsage;
+};
+
+/**
+* Restores the calling thread's scratch arena to its state at construction
+* when the scope exits. All scratch memory allocated within the scope is
+* released at once.
+*/
+class FScratchScope
+{
+public:
+	FScratchScope()
+		: mArena(SScratchArena::Get())
+		, mMarker(mArena.GetMarker())
+	{}
+
+	~FScratchScope()
+	{
+		SScratchArena::UpdatePeakUsage(mArena);
+		mArena.ClearToMarker(mMarker);
+	}
+
+	/**
+	* Retrieves the arena this scope marks.
+	*/
+	FStackAllocator& GetArena()
+	{
+		return mArena;
+	}
+
+	FScratchScope(const FScratchScope& Other) = delete;
+	FScratchScope& operator=(const FScratchScope& Other) = delete;
+
+private:
+	FStackAllocator&          mArena;
+	FStackAllocator::UMarker  mMarker;
+};
+
+template <typename ElementType>
+/**
+* A growable array of trivially copyable elements that lives in a scratch arena.
+* The array grows in place while it is the most recent allocation in the arena,
+* otherwise elements are copied to a new location at the top of the arena.
+* Memory is released with the arena's scope, never by the array.
+*/
+class TScratchArray
+{
+public:
+	TScratchArray(FStackAllocator& Arena, const uint32_t InitialCapacity = 64)
+		: mArena(Arena)
+		, mData(nullptr)
+		, mSize(0)
+		, mCapacity(0)
+		, mEndMarker(0)
+	{
+		Reserve(InitialCapacity);
+	}
+
+	TScratchArray(const TScratchArray& Other) = delete;
+	TScratchArray& operator=(const TScratchArray& Other) = delete;
+
+	/**
+	* Appends an element to the end of the array.
+	*/
+	void Add(const ElementType& Element)
+	{
+		if (mSize == mCapacity)
+			Reserve(mCapacity * 2);
+
+		mData[mSize++] = Element;
+	}
+
+	/**
+	* Resizes the array. New elements are uninitialized.
+	*/
+	void Resize(const uint32_t Size)
+	{
+		if (Size > mCapacity)
+			Reserve(Size);
+
+		mSize = Size;
+	}
+
+	/**
+	* Makes sure the array can hold at least Capacity elements.
+	*/
+	void Reserve(const uint32_t Capacity)
+	{
+		if (Capacity <= mCapacity)
+			return;
+
+		if (mData && mArena.GetMarker() == mEndMarker)
+		{
+			// Still at the top of the arena, extend in place
+			mArena.Allocate((Capacity - mCapacity) * sizeof(ElementType));
+		}
+		else
+		{
+			ElementType* NewData = static_cast<ElementType*>(mArena.Allocate(Capacity * sizeof(ElementType), __alignof(ElementType)));
+			if (mSize > 0)
+				std::memcpy(NewData, mData, mSize * sizeof(ElementType));
+
+			mData = NewData;
+		}
+
+		mCapacity = Capacity;
+		mEndMarker = mArena.GetMarker();
+	}
+
+	ElementType& operator[](const uint32_t Index)
+	{
+		ASSERT(Index < mSize);
+		return mData[Index];
+	}
+
+	const ElementType& operator[](const uint32_t Index) const
+	{
+		ASSERT(Index < mSize);
+		return mData[Index];
+	}
+
+	ElementType* Data() { return mData; }
+	const ElementType* Data() const { return mData; }
+	uint32_t Size() const { return mSize; }
+
+	ElementType* begin() { return mData; }
+	ElementType* end() { return mData + mSize; }
+	const ElementType* begin() const { return mData; }
+	const ElementType* end() const { return mData + mSize; }
+
+private:
+	FStackAllocator&          mArena;
+	ElementType*              mData;
+	uint32_t                  mSize;
+	uint32_t                  mCapacity;
+	FStackAllocator::UMarker  mEndMarker; // Arena marker directly after the array's memory
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include "MemoryTracker.h"
 
 /**
 * A fixed-size stack based allocator. Arbitrary length
@@ -15,7 +16,8 @@ public:
 	using UMarker = uint32_t;
 
 	/**
-	* Creates a fixed size stack allocator.
+	* Creates a fixed size stack allocator. The memory is reported
+	* to the calling thread's current memory tag.
 	*/
 	FStackAllocator(const uint32_t SizeBytes);
 
@@ -55,6 +57,22 @@ public:
 	*/
 	UMarker GetMarker() const;
 
+	/**
+	* Retrieves the highest location marker the stack has reached
+	* since construction or the last call to ResetPeakMarker.
+	*/
+	UMarker GetPeakMarker() const;
+
+	/**
+	* Sets the peak location marker to the current location marker.
+	*/
+	void ResetPeakMarker();
+
+	/**
+	* Retrieves the size of the stack in bytes.
+	*/
+	uint32_t GetCapacity() const;
+
 	/**
 	* Clears all data from the stack.
 	*/
@@ -77,5 +95,8 @@ private:
 
 	// The current location we are at in the memory stack
 	UMarker mCurrentMarker;
+	UMarker mPeakMarker;
 	UMarker mCapacity;
+
+	EMemoryTag mTag;
 };
\ No newline at end of file
@@ -0,0 +1,387 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "Misc/Assertions.h"
+#include "MemoryUtil.h"
+#include "MemoryTracker.h"
+
+template <uint32_t ElementSize, uint32_t ElementsPerBlock>
+/**
+* Growable pool allocator that reserves virtual address space up front, but
+* only commits physical memory in fixed size blocks as they are needed.
+* Once every element of a block has been freed, the block's pages are returned
+* to the OS (one empty block is kept committed to avoid thrashing at the boundary).
+* When all reserved address space is in use, another segment is reserved, so the
+* pool is never exhausted unless the OS runs out of address space.
+* On destruction of this object, all allocations need to be freed back into
+* the pool with FVirtualPoolAllocator::Free.
+* \n
+* @param ElementSize The size of each allocation object.
+* @param ElementsPerBlock The number of objects committed at once.
+*/
+class FVirtualPoolAllocator
+{
+public:
+	/**
+	* Ctor
+	* Constructs a virtual pool allocator with specified alignment.
+	* No memory is committed until the first allocation.
+	* @param Alignment for each allocation
+	* @param InitialCapacity - The number of objects to reserve address space for in each segment.
+	* @param Tag - The memory tag committed memory is reported to.
+	*/
+	FVirtualPoolAllocator(uint32_t Alignment, uint32_t InitialCapacity, EMemoryTag Tag = EMemoryTag::Untagged)
+		: mSegments()
+		, mBlocks()
+		, mAvailableBlocks()
+		, mDecommittedBlocks()
+		, mElementStride(0)
+		, mBlockBytes(0)
+		, mBlocksPerSegment(0)
+		, mNextUnusedBlock(0)
+		, mCommittedBlocks(0)
+		, mEmptyBlocks(0)
+		, mObjectsConstructed(0)
+		, mTag(Tag)
+	{
+		ASSERT(0 < ElementsPerBlock && "ElementsPerBlock must be larger that 0");
+		ASSERT(ElementSize >= sizeof(PoolElement) && "ElementSize must at least the size of a standard pointer type.");
+		ASSERT(Alignment > 0 && (Alignment & (Alignment - 1)) == 0 && "Alignment must be a power of 2.");
+
+		const uint32_t PageSize = FMemory::GetPageSize();
+		ASSERT(Alignment <= PageSize && "Alignment can't be larger than the page size.");
+
+		// Round each element up to the alignment and each block up to whole pages
+		mElementStride = (ElementSize + Alignment - 1) & ~(Alignment - 1);
+		mBlockBytes = ((mElementStride * ElementsPerBlock) + PageSize - 1) / PageSize * PageSize;
+		mBlocksPerSegment = (std::max)(1u, (InitialCapacity + ElementsPerBlock - 1) / ElementsPerBlock);
+	}
+
+	~FVirtualPoolAllocator()
+	{
+		ASSERT(mObjectsConstructed == 0 && "All objects should be back in the pool on destruction.");
+
+		for (uint8_t* Segment : mSegments)
+		{
+			FMemory::ReleaseVirtual(Segment, SegmentBytes());
+		}
+
+		for (uint32_t i = 0; i < mCommittedBlocks; i++)
+		{
+			SMemoryTracker::OnFree(mTag, mBlockBytes);
+		}
+	}
+
+	/**
+	* Allocate a new element from the memory pool.
+	* Pages are committed and address space reserved as needed.
+	* If the OS can't provide more memory, nullptr is returned.
+	*/
+	void* Allocate()
+	{
+		if (mAvailableBlocks.empty() && !CommitBlock())
+			return nullptr;
+
+		const uint32_t Index = mAvailableBlocks.back();
+		BlockInfo& Block = mBlocks[Index];
+
+		void* Memory;
+		if (Block.FreeList)
+		{
+			Memory = Block.FreeList;
+			Block.FreeList = Block.FreeList->Next;
+		}
+		else
+		{
+			// Elements that were never handed out don't need to be linked
+			Memory = BlockAddress(Index) + (Block.Untouched * mElementStride);
+			Block.Untouched++;
+		}
+
+		if (Block.Used == 0 && Block.IsRetained)
+		{
+			Block.IsRetained = false;
+			mEmptyBlocks--;
+		}
+
+		Block.Used++;
+		if (Block.Used == ElementsPerBlock)
+		{
+			Block.IsAvailable = false;
+			mAvailableBlocks.pop_back();
+		}
+
+		mObjectsConstructed++;
+		return Memory;
+	}
+
+	/**
+	* Release an object back into the memory pool.
+	* If this empties the object's block, the block may be decommitted.
+	*/
+	void Free(void* Data)
+	{
+		ASSERT(mObjectsConstructed > 0);
+
+		const uint32_t Index = FindBlock(Data);
+		BlockInfo& Block = mBlocks[Index];
+		ASSERT(Block.IsCommitted && Block.Used > 0);
+
+		PoolElement* Element = (PoolElement*)Data;
+		Element->Next = Block.FreeList;
+		Block.FreeList = Element;
+		Block.Used--;
+		mObjectsConstructed--;
+
+		if (Block.Used == 0)
+		{
+			if (mEmptyBlocks == 0)
+			{
+				// Keep a single empty block around for the next allocation
+				Block.IsRetained = true;
+				mEmptyBlocks++;
+			}
+			else
+			{
+				DecommitBlock(Index);
+				return;
+			}
+		}
+
+		if (!Block.IsAvailable)
+		{
+			Block.IsAvailable = true;
+			mAvailableBlocks.push_back(Index);
+		}
+	}
+
+	/**
+	* Gets the number of objects that can be allocated
+	* before more address space is reserved.
+	*/
+	uint32_t Capacity() const
+	{
+		return static_cast<uint32_t>(mBlocks.size()) * ElementsPerBlock;
+	}
+
+	/**
+	* Returns the number of objects in the pool
+	* that are constructed.
+	*/
+	uint32_t Size() const
+	{
+		return mObjectsConstructed;
+	}
+
+	/**
+	* Returns the number of bytes currently backed by physical memory.
+	*/
+	size_t CommittedBytes() const
+	{
+		return static_cast<size_t>(mCommittedBlocks) * mBlockBytes;
+	}
+
+	/**
+	* Returns the number of bytes of address space reserved by the pool.
+	*/
+	size_t ReservedBytes() const
+	{
+		return mSegments.size() * SegmentBytes();
+	}
+
+private:
+	// Disable copy ctor and copy assignment
+	FVirtualPoolAllocator(const FVirtualPoolAllocator& Other) = delete;
+	FVirtualPoolAllocator& operator=(const FVirtualPoolAllocator& Other) = delete;
+
+	struct PoolElement
+	{
+		PoolElement* Next{nullptr};
+	};
+
+	struct BlockInfo
+	{
+		PoolElement* FreeList{nullptr}; // Freed elements within the block
+		uint32_t     Used{0};           // Number of active objects in the block
+		uint32_t     Untouched{0};      // Elements below this index have been handed out at least once
+		bool         IsCommitted{false};
+		bool         IsAvailable{false}; // If the block is in mAvailableBlocks
+		bool         IsRetained{false};  // If the block is the retained empty block
+	};
+
+	size_t SegmentBytes() const
+	{
+		return static_cast<size_t>(mBlockBytes) * mBlocksPerSegment;
+	}
+
+	uint8_t* BlockAddress(const uint32_t Index) const
+	{
+		return mSegments[Index / mBlocksPerSegment] + static_cast<size_t>(Index % mBlocksPerSegment) * mBlockBytes;
+	}
+
+	/**
+	* Finds the index of the block that contains an allocation.
+	*/
+	uint32_t FindBlock(const void* Data) const
+	{
+		const uint8_t* Address = static_cast<const uint8_t*>(Data);
+		const size_t Bytes = SegmentBytes();
+
+		for (uint32_t i = 0; i < mSegments.size(); i++)
+		{
+			if (Address >= mSegments[i] && Address < mSegments[i] + Bytes)
+			{
+				return i * mBlocksPerSegment + static_cast<uint32_t>((Address - mSegments[i]) / mBlockBytes);
+			}
+		}
+
+		ASSERT(false && "Memory was not allocated from this pool.");
+		return 0;
+	}
+
+	/**
+	* Commits a new block and makes it the next block to allocate from.
+	* Previously decommitted blocks are reused before new address space is touched.
+	*/
+	bool CommitBlock()
+	{
+		uint32_t Index;
+		if (!mDecommittedBlocks.empty())
+		{
+			Index = mDecommittedBlocks.back();
+		}
+		else
+		{
+			if (mNextUnusedBlock == mBlocks.size())
+			{
+				uint8_t* Segment = static_cast<uint8_t*>(FMemory::ReserveVirtual(SegmentBytes()));
+				if (!Segment)
+					return false;
+
+				mSegments.push_back(Segment);
+				mBlocks.resize(mBlocks.size() + mBlocksPerSegment);
+			}
+
+			Index = mNextUnusedBlock;
+		}
+
+		if (!FMemory::CommitVirtual(BlockAddress(Index), mBlockBytes))
+			return false;
+
+		if (!mDecommittedBlocks.empty())
+			mDecommittedBlocks.pop_back();
+		else
+			mNextUnusedBlock++;
+
+		BlockInfo& Block = mBlocks[Index];
+		Block.IsCommitted = true;
+		Block.IsAvailable = true;
+		mAvailableBlocks.push_back(Index);
+		mCommittedBlocks++;
+		SMemoryTracker::OnAllocate(mTag, mBlockBytes);
+		return true;
+	}
+
+	/**
+	* Returns an empty block's memory to the OS.
+	*/
+	void DecommitBlock(const uint32_t Index)
+	{
+		FMemory::DecommitVirtual(BlockAddress(Index), mBlockBytes);
+
+		BlockInfo& Block = mBlocks[Index];
+		if (Block.IsAvailable)
+		{
+			// The block can be anywhere in the stack, so it is searched for
+			mAvailableBlocks.erase(std::find(mAvailableBlocks.begin(), mAvailableBlocks.end(), Index));
+			Block.IsAvailable = false;
+		}
+
+		Block.FreeList = nullptr;
+		Block.Untouched = 0;
+		Block.IsCommitted = false;
+		mDecommittedBlocks.push_back(Index);
+		mCommittedBlocks--;
+		SMemoryTracker::OnFree(mTag, mBlockBytes);
+	}
+
+private:
+	std::vector<uint8_t*>  mSegments;          // Reserved address ranges
+	std::vector<BlockInfo> mBlocks;            // Info for each block of every segment
+	std::vector<uint32_t>  mAvailableBlocks;   // Committed blocks with free elements
+	std::vector<uint32_t>  mDecommittedBlocks; // Blocks that were committed at one point
+	uint32_t               mElementStride;     // The byte gap between each allocation
+	uint32_t               mBlockBytes;        // Bytes in each block, a multiple of the page size
+	uint32_t               mBlocksPerSegment;  // Blocks reserved with each segment
+	uint32_t               mNextUnusedBlock;   // Blocks at and above this index have never been committed
+	uint32_t               mCommittedBlocks;   // Number of blocks backed by physical memory
+	uint32_t               mEmptyBlocks;       // Number of committed blocks without active objects
+	uint32_t               mObjectsConstructed; // Number of active objects from the pool
+	EMemoryTag             mTag;               // Tag committed memory is reported to
+};
+
+
+
+template <typename ElementType, uint32_t ElementsPerBlock>
+/**
+* A wrapper class of FVirtualPoolAllocator for conveniently creating a
+* pool for a specific object type.
+* \n
+* @param ElementType The object contained within the pool
+* @param ElementsPerBlock The number of objects committed at once.
+*/
+class FVirtualPoolAllocatorType : private FVirtualPoolAllocator<sizeof(ElementType), ElementsPerBlock>
+{
+	typedef FVirtualPoolAllocator<sizeof(ElementType), ElementsPerBlock> Super;
+
+public:
+	FVirtualPoolAllocatorType(uint32_t Alignment, uint32_t InitialCapacity, EMemoryTag Tag = EMemoryTag::Untagged)
+		: Super(Alignment, InitialCapacity, Tag)
+	{
+
+	}
+
+	~FVirtualPoolAllocatorType() = default;
+
+	/**
+	* Allocate a new element from the memory pool.
+	* If the OS can't provide more memory, nullptr is returned.
+	*/
+	ElementType* Allocate()
+	{
+		return reinterpret_cast<ElementType*>(Super::Allocate());
+	}
+
+	/**
+	* Release an object back into the memory pool.
+	* The objects' destructor is called within this function
+	* before memory is freed.
+	*/
+	void Free(ElementType* Data)
+	{
+		Data->~ElementType();
+		Super::Free((void*)Data);
+	}
+
+	uint32_t Capacity() const
+	{
+		return Super::Capacity();
+	}
+
+	uint32_t Size() const
+	{
+		return Super::Size();
+	}
+
+	size_t CommittedBytes() const
+	{
+		return Super::CommittedBytes();
+	}
+
+	size_t ReservedBytes() const
+	{
+		return Super::ReservedBytes();
+	}
+};
@@ -2,6 +2,8 @@
 
 #include <cstdint>
 
+#include "Common.h"
+
 namespace FString
 {
 	/**
@@ -91,4 +93,30 @@ namespace FString
 
 		return ~Result;
 	}
+
+	/**
+	* Processes the 8 bits of a character for HashCRC32Constant().
+	*/
+	CONSTEXPR uint32_t HashCRC32Bits(const uint32_t Result, const int32_t Bits)
+	{
+		return (Bits == 0) ? Result : HashCRC32Bits((Result >> 1) ^ ((0u - (Result & 1u)) & 0x04C11DB7u), Bits - 1);
+	}
+
+	/**
+	* Processes the characters of a string for HashCRC32Constant().
+	*/
+	CONSTEXPR uint32_t HashCRC32Step(const char* String, const uint32_t Result)
+	{
+		return (*String == '\0') ? ~Result : HashCRC32Step(String + 1, HashCRC32Bits(Result ^ (uint32_t)(int32_t)*String, 8));
+	}
+
+	/**
+	* Version of HashCRC32() that can be evaluated at compile time, gives the same hash.
+	* Only meant for string literals, use HashCRC32() for strings only known at runtime.
+	* @param String Null-terminated c-string to be hashed.
+	*/
+	CONSTEXPR uint32_t HashCRC32Constant(const char* String)
+	{
+		return HashCRC32Step(String, 0);
+	}
 }
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "..\FileIO\AsyncFileReader.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <sys/uio.h>
+
+/**
+* Asynchronous reader using the io_uring interface of Linux 5.1 and later.
+* Reads are placed in the submission ring and the kernel completes them without
+* any threads of our own. Completions are retrieved from the completion ring.
+*/
+class FIoUringFileReader : public IAsyncFileReader
+{
+public:
+	/**
+	* Creates an io_uring reader.
+	* @param QueueDepth - The maximum number of reads in flight at once.
+	* @return The reader, null if io_uring is not supported by the kernel.
+	*/
+	static std::unique_ptr<IAsyncFileReader> Create(const uint32_t QueueDepth);
+
+public:
+	/**
+	* Waits for reads in flight and unmaps the rings.
+	*/
+	~FIoUringFileReader();
+
+	FIoUringFileReader(const FIoUringFileReader& Other) = delete;
+	FIoUringFileReader& operator=(const FIoUringFileReader& Other) = delete;
+
+	uint32_t Submit(const FAsyncReadRequest* Requests, const uint32_t Count) override;
+
+	uint32_t Wait(FAsyncReadResult* ResultsOut, const uint32_t MaxResults, const uint32_t MinResults) override;
+
+	uint32_t GetPendingCount() const override { return GetInFlightCount() + (uint32_t)mReaped.size(); }
+
+	const wchar_t* GetName() const override { return L"io_uring"; }
+
+private:
+	/**
+	* A read in flight. The kernel reads the iovec when the read starts, so it
+	* must stay valid until the read completes.
+	*/
+	struct FSlot
+	{
+		struct iovec Vector;
+		void*        UserData;
+	};
+
+	FIoUringFileReader();
+
+	/**
+	* Maps the rings of a ring file descriptor.
+	* @return False if the rings could not be mapped.
+	*/
+	bool MapRings(const uint32_t QueueDepth);
+
+	/**
+	* Passes unsubmitted entries to the kernel, optionally waiting for completions.
+	* @return False if the kernel rejected the call.
+	*/
+	bool Enter(const uint32_t MinCompletions);
+
+	/**
+	* Moves completions from the completion ring to ResultsOut and frees their slots.
+	* @return The number of results placed in ResultsOut.
+	*/
+	uint32_t ReapCompletions(FAsyncReadResult* ResultsOut, const uint32_t MaxResults);
+
+	/**
+	* Takes every read out of the kernel after it rejected a call. Entries the kernel never took
+	* are failed, reads in flight are waited for. No buffer is written once this returns, the
+	* results are kept for Wait() and failed reads are read again synchronously by the caller.
+	*/
+	void ReapAll();
+
+	/**
+	* Retrieves the number of reads the kernel may still write buffers for.
+	*/
+	uint32_t GetInFlightCount() const { return (uint32_t)(mSlots.size() - mFreeSlots.size()); }
+
+private:
+	int mRingFile;
+
+	// Submission ring
+	void*      mSubmitRing;
+	size_t     mSubmitRingSize;
+	uint32_t*  mSubmitHead;
+	uint32_t*  mSubmitTail;
+	uint32_t   mSubmitMask;
+	uint32_t*  mSubmitArray;
+	void*      mSubmitEntries;     // Array of io_uring_sqe
+	size_t     mSubmitEntriesSize;
+	uint32_t   mUnsubmitted;       // Entries in the ring the kernel has not consumed yet
+
+	// Completion ring, shares the submission ring's mapping on kernels that support it
+	void*      mCompleteRing;
+	size_t     mCompleteRingSize;
+	uint32_t*  mCompleteHead;
+	uint32_t*  mCompleteTail;
+	uint32_t   mCompleteMask;
+	void*      mCompletions;       // Array of io_uring_cqe
+
+	std::vector<FSlot>    mSlots;
+	std::vector<uint32_t> mFreeSlots;
+	std::vector<FAsyncReadResult> mReaped;  // Results taken out of the kernel by ReapAll(), not retrieved yet
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "..\FileIO\GenericFile.h"
+
+#include <cstdint>
+#include <string>
+
+/**
+* Wrapper class for file handle operations on POSIX platforms.
+*/
+class FPosixHandle : public IFileHandle
+{
+public:
+	/**
+	* Constructs a POSIX file handle from a file descriptor.
+	*/
+	FPosixHandle(int FileDescriptor = -1);
+
+	~FPosixHandle();
+
+	FPosixHandle(const FPosixHandle& Other) = delete;
+	FPosixHandle& operator=(const FPosixHandle& Other) = delete;
+
+	bool Read(uint8_t* DataOut, uint32_t NumBytesToRead) override;
+
+	bool Write(const uint8_t* Data, const uint32_t NumBytesToWrite) override;
+
+	bool Seek(const uint64_t Distance) override;
+
+	bool SeekFromEnd(const uint64_t Distance) override;
+
+	bool SeekFromStart(const uint64_t Distance) override;
+
+	uint32_t GetFileSize() const override;
+
+	bool ReadAt(uint8_t* DataOut, const uint32_t NumBytesToRead, const uint64_t Offset) override;
+
+	bool WriteAt(const uint8_t* Data, const uint32_t NumBytesToWrite, const uint64_t Offset) override;
+
+	bool Reserve(const uint64_t Size) override;
+
+	void Advise(const EFileAdvice::Type Advice, const uint64_t Offset = 0, const uint64_t Length = 0) override;
+
+	/**
+	* Retrieves the file descriptor, used by readers that issue I/O to the kernel directly.
+	*/
+	int GetFileDescriptor() const { return mFileDescriptor; }
+
+private:
+	/**
+	* Moves the current file pointer a specified distance based on
+	* a specified whence.
+	* @return True if the seek succeeded.
+	*/
+	bool FileSeek(const uint64_t Distance, const int Whence);
+
+private:
+	int mFileDescriptor;
+};
+
+
+/**
+* File mapped into memory with mmap(2).
+*/
+class FPosixMappedFile : public IMappedFile
+{
+public:
+	FPosixMappedFile(const uint8_t* Data, const uint64_t Size);
+
+	/**
+	* Unmaps the file.
+	*/
+	~FPosixMappedFile();
+};
+
+
+/**
+* Wrapper class for file operations on POSIX platforms.
+* Wide file names are converted to the multibyte encoding of the current locale.
+*/
+class FPosixFileSystem : public IFileSystem
+{
+public:
+	FPosixFileSystem();
+	~FPosixFileSystem() = default;
+
+	std::unique_ptr<IFileHandle> OpenWritable(const wchar_t* FileName, const bool AllowShareRead = false, const bool CreateNew = false) override;
+	std::unique_ptr<IFileHandle> OpenReadable(const wchar_t* Filename) override;
+	std::unique_ptr<IFileHandle> OpenReadWritable(const wchar_t* FileName, const bool AllowRead = false, const bool CreateNew = false) override;
+	std::unique_ptr<IMappedFile> MapReadable(const wchar_t* Filename) override;
+
+	bool DeleteFilename(const wchar_t* Filename) override;
+
+	bool CurrentDirectory(wchar_t* DataOut, const uint32_t BufferLength) override;
+
+	bool DeleteDirectory(const wchar_t* DirectoryName) override;
+
+	bool RenameDirectory(const wchar_t* CurrentName, const wchar_t* NewName) override;
+
+	bool CreateFileDirectory(const wchar_t* DirectoryName) override;
+
+	bool GetProgramDirectory(wchar_t* DataOut, const uint32_t BufferLength) override;
+
+	bool SetDirectory(const wchar_t* DirectoryName) override;
+
+	bool FileExists(const wchar_t* Filename) override;
+
+	bool GetWriteTime(const wchar_t* Filename, uint64_t& TimeOut) override;
+
+	bool SetToProgramDirectory() override;
+
+	bool CopyFileDirectory(const wchar_t* From, const wchar_t* To) override;
+
+private:
+	void SetProgramDirectory();
+
+	/**
+	* Opens a file with open(2) flags.
+	*/
+	std::unique_ptr<IFileHandle> OpenFile(const wchar_t* Filename, const int Flags);
+
+	/**
+	* Recursively copies a directory using narrow paths.
+	*/
+	bool CopyDirectory(const std::string& From, const std::string& To);
+
+	/**
+	* Copies the contents of a single file using narrow paths.
+	*/
+	bool CopySingleFile(const std::string& From, const std::string& To);
+};
+
+using FFileHandle = FPosixHandle;
+using FFileSystem = FPosixFileSystem;
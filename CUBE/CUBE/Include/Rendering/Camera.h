@@ -3,6 +3,7 @@
 #include "Math\Transform.h"
 #include "Math\Matrix4.h"
 #include "Math\Frustum.h"
+#include "Common.h"
 
 /**
 * The camera that a scene is view by.
@@ -10,8 +11,8 @@
 class FCamera
 {
 public:
-	// Current rendering camera
-	static FCamera* Main;
+	// Current rendering camera of the world run by the calling thread
+	static THREAD_LOCAL FCamera* Main;
 
 public:
 	FTransform Transform;
@@ -19,7 +20,7 @@ public:
 public:
 	/**
 	* Constructs a camera at world origin.
-	* If this is the only camera instantiated, it will be assign
+	* If this is the only camera instantiated by the thread, it will be assign
 	* to FCamera::Main.
 	*/
 	FCamera();
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Components\ObjectMesh.h"
+
+/**
+* Header at the start of a cooked mesh file. All values are little endian.
+* The vertices follow the header, the indices follow the vertices at a 4 byte
+* aligned offset.
+*/
+struct FCookedMeshHeader
+{
+	static const uint32_t MAGIC = 0x484D4356;  // "VCMH"
+	static const uint32_t VERSION = 1;
+
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t VertexCount;
+	uint32_t IndexCount;
+	uint32_t IndexSize;        // Size of an index in bytes, 2 or 4
+	uint32_t VertexOffset;     // Offset of the vertices from the start of the file
+	uint32_t IndexOffset;      // Offset of the indices from the start of the file
+	float    BoundsMin[3];
+	float    BoundsMax[3];
+	float    BoundsRadius;
+};
+
+/**
+* Quantized vertex of a cooked mesh.
+*/
+struct FCookedVertex
+{
+	uint16_t Position[3];  // Position within the bounds of the mesh, 0 is the minimum and 65535 the maximum
+	int8_t   Normal[2];    // Octahedral encoded unit normal
+	uint8_t  Color[4];     // RGBA color, alpha is unused
+};
+
+/**
+* Converts Wavefront OBJ models into cooked meshes and decodes cooked meshes.
+* Cooked meshes are ordered for the post transform vertex cache, their vertices
+* are ordered by first use, their attributes are quantized and their bounds are
+* stored with them, so loading one is a copy and dequantize pass.
+*/
+class SCookedMesh
+{
+public:
+	// Number of vertices the cooker optimizes the post transform cache for
+	static const uint32_t VERTEX_CACHE_SIZE = 32;
+
+	/**
+	* Cooks a .obj model.
+	* @param ObjFilepath - The model to cook.
+	* @param CookedFilepath - File to write the cooked mesh to.
+	* @return True if the mesh was cooked.
+	*/
+	static bool Cook(const char* ObjFilepath, const wchar_t* CookedFilepath);
+
+	/**
+	* Cooks a .obj model if the cooked mesh is missing or older than the model.
+	* @param ObjFilepath - The model to cook.
+	* @param CookedFilepath - File the cooked mesh is written to.
+	* @return False if the model had to be cooked and cooking failed.
+	*/
+	static bool CookIfStale(const char* ObjFilepath, const wchar_t* CookedFilepath);
+
+	/**
+	* Decodes a cooked mesh. The data is validated so a damaged file fails to decode.
+	* @param Data - The contents of a cooked mesh file.
+	* @param Size - The size of the data in bytes.
+	* @param VerticesOut - Receives the vertices of the mesh.
+	* @param IndicesOut - Receives the indices of the mesh.
+	* @param BoundsOut - Receives the bounds of the mesh.
+	* @return True if the mesh was decoded.
+	*/
+	static bool Decode(const uint8_t* Data, const uint64_t Size, std::vector<MeshVertex>& VerticesOut, std::vector<uint32_t>& IndicesOut, FMeshBounds& BoundsOut);
+
+	/**
+	* Reorders triangles for the post transform vertex cache with Tom Forsyth's
+	* linear-speed vertex cache optimisation.
+	* @param Indices - Triangle list to reorder.
+	* @param VertexCount - Number of vertices the indices refer to.
+	*/
+	static void OptimizeVertexCache(std::vector<uint32_t>& Indices, const uint32_t VertexCount);
+};
@@ -45,6 +45,12 @@ public:
 	*/
 	void SetGlobalAmbient(const Vector3f& Ambient);
 
+	/**
+	* Sets whether occlusion is sampled in screen space. The occlusion
+	* baked into chunk meshes is applied either way.
+	*/
+	void SetScreenSpaceOcclusion(const bool Enabled);
+
 private:
 	void GenerateNoiseTexture(const uint32_t Size);
 	void GenerateSampleTexture(const uint32_t KernalSize);
@@ -62,5 +68,6 @@ private:
 	GLuint         mSampleTex;
 
 	FShaderProgram mBlur;
+	bool           mUseSSAO;
 };
 
@@ -112,6 +112,35 @@ public:
 	*/
 	void MapAndActivateB(const void* VertexData, const uint32_t VertexSize, const uint32_t* IndexData, const uint32_t IndexSize);
 
+	/**
+	* Allocates the OpenGL buffers for an upload in several parts. The mesh is
+	* inactive until FinishUploadB() is called.
+	* @param VertexSize - The size, in bytes, of the vertex data.
+	* @param IndexCount - Number of indices.
+	*/
+	void AllocateB(const uint32_t VertexSize, const uint32_t IndexCount);
+
+	/**
+	* Copies part of the vertex data into the vertex buffer allocated by AllocateB().
+	* @param VertexData - Vertices to copy.
+	* @param Offset - Offset, in bytes, into the vertex buffer.
+	* @param Size - The size, in bytes, of the vertex data.
+	*/
+	void UploadVerticesB(const void* VertexData, const uint32_t Offset, const uint32_t Size);
+
+	/**
+	* Copies part of the index data into the index buffer allocated by AllocateB().
+	* @param IndexData - Indices to copy.
+	* @param First - Index of the first index to copy into.
+	* @param Count - Number of indices to copy.
+	*/
+	void UploadIndicesB(const uint32_t* IndexData, const uint32_t First, const uint32_t Count);
+
+	/**
+	* Activates a mesh whose buffers were filled after AllocateB().
+	*/
+	void FinishUploadB();
+
 	/**
 	* Clears all vertex and index data held locally be this
 	* object.
@@ -185,12 +214,18 @@ private:
 	GLuint mVertexArray;
 	GLuint mBuffers[2];
 
+	// Size of the data uploaded to the GL buffers
+	size_t mBufferBytes;
+
 	// Buffer usage mode
 	GLuint mUsageMode;
 
 	// Number of indices currently in the index buffer
 	uint32_t mIndexCount;
 
+	// Number of indices allocated by AllocateB()
+	uint32_t mAllocatedIndexCount;
+
 	bool mIsActive;
 };
 
@@ -335,6 +370,36 @@ public:
 	*/
 	void MapAndActivate(const VertexType* VertexData, const uint32_t VertexSize, const uint32_t* IndexData, const uint32_t IndexSize);
 
+	/**
+	* Allocates the OpenGL buffers for an upload in several parts, so a large
+	* mesh can be uploaded over several frames. The mesh is inactive until
+	* FinishUpload() is called.
+	* @param VertexCount - Number of vertices.
+	* @param IndexCount - Number of indices.
+	*/
+	void Allocate(const uint32_t VertexCount, const uint32_t IndexCount);
+
+	/**
+	* Copies part of the vertices into the vertex buffer allocated by Allocate().
+	* @param VertexData - Vertices to copy.
+	* @param First - Index of the first vertex to copy into.
+	* @param Count - Number of vertices to copy.
+	*/
+	void UploadVertices(const VertexType* VertexData, const uint32_t First, const uint32_t Count);
+
+	/**
+	* Copies part of the indices into the index buffer allocated by Allocate().
+	* @param IndexData - Indices to copy.
+	* @param First - Index of the first index to copy into.
+	* @param Count - Number of indices to copy.
+	*/
+	void UploadIndices(const uint32_t* IndexData, const uint32_t First, const uint32_t Count);
+
+	/**
+	* Activates a mesh whose buffers were filled after Allocate().
+	*/
+	void FinishUpload();
+
 	/**
 	* Change the usage mode of GL buffers used
 	* by this mesh.
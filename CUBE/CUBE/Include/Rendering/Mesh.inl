@@ -152,6 +152,30 @@ inline void TMesh<T>::MapAndActivate(const VertexType* VertexData, const uint32_
 	MapAndActivateB((void*)VertexData, NumVertices * sizeof(VertexType), IndexData, IndexSize);
 }
 
+template <typename T>
+inline void TMesh<T>::Allocate(const uint32_t VertexCount, const uint32_t IndexCount)
+{
+	AllocateB(VertexCount * sizeof(VertexType), IndexCount);
+}
+
+template <typename T>
+inline void TMesh<T>::UploadVertices(const VertexType* VertexData, const uint32_t First, const uint32_t Count)
+{
+	UploadVerticesB((const void*)VertexData, First * sizeof(VertexType), Count * sizeof(VertexType));
+}
+
+template <typename T>
+inline void TMesh<T>::UploadIndices(const uint32_t* IndexData, const uint32_t First, const uint32_t Count)
+{
+	UploadIndicesB(IndexData, First, Count);
+}
+
+template <typename T>
+inline void TMesh<T>::FinishUpload()
+{
+	FinishUploadB();
+}
+
 //template <typename T>
 //inline void TMesh<T>::MapIndexBuffer(uint32_t* Data, uint32_t Size)
 //{
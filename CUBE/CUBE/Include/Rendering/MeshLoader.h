@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#include "Components\ObjectMesh.h"
+
+/**
+* Loads cooked meshes into the mesh holder in the background. A loader thread maps
+* and decodes the files, the main thread uploads the decoded meshes to the GPU in
+* slices of UPLOAD_SLICE_BYTES within a time budget per frame. A mesh is added to the
+* mesh holder when it is requested and is skipped by the renderer until it is uploaded.
+* Must only be used from the thread that owns the OpenGL context.
+*/
+class FMeshLoader
+{
+public:
+	// Largest part of a mesh uploaded at once
+	static const uint32_t UPLOAD_SLICE_BYTES = 256 * 1024;
+
+	// Default time, in seconds, spent uploading meshes per update
+	static const float DEFAULT_UPLOAD_BUDGET;
+
+	/**
+	* Loader statistics.
+	*/
+	struct FStats
+	{
+		uint32_t Pending;          // Meshes requested and not uploaded yet
+		uint64_t Loaded;           // Meshes uploaded
+		uint64_t Failed;           // Meshes that failed to map or decode
+		uint64_t UploadedBytes;
+		float    AverageLatency;   // Average time, in seconds, from requesting a mesh to it being uploaded
+		float    MaxLatency;
+		float    ColdStartTime;    // Time, in seconds, from the first request until the loader was first idle. Zero until then
+	};
+
+public:
+	/**
+	* Starts the loader thread.
+	*/
+	FMeshLoader();
+
+	/**
+	* Stops the loader thread, requests that were not decoded yet are dropped.
+	*/
+	~FMeshLoader();
+
+	FMeshLoader(const FMeshLoader& Other) = delete;
+	FMeshLoader& operator=(const FMeshLoader& Other) = delete;
+
+	/**
+	* Requests a cooked mesh to be loaded and adds it to the mesh holder.
+	* @param Name - Name of the mesh in the mesh holder.
+	* @param Filepath - The cooked mesh file.
+	*/
+	void Load(const char* Name, const wchar_t* Filepath);
+
+	/**
+	* Uploads decoded meshes to the GPU. At least one slice is uploaded per call
+	* if a mesh is waiting, then slices are uploaded until the time budget is spent.
+	* @param TimeBudget - Time, in seconds, to spend uploading.
+	*/
+	void Update(const float TimeBudget = DEFAULT_UPLOAD_BUDGET);
+
+	/**
+	* Checks if every requested mesh is uploaded.
+	*/
+	bool IsIdle() const { return mPending == 0; }
+
+	/**
+	* Retrieves the statistics of the loader.
+	*/
+	FStats GetStats() const;
+
+private:
+	struct FRequest
+	{
+		std::string  Name;
+		std::wstring Filepath;
+		uint64_t     RequestTime;
+	};
+
+	struct FDecodedMesh
+	{
+		FRequest                Request;
+		std::vector<MeshVertex> Vertices;
+		std::vector<uint32_t>   Indices;
+		FMeshBounds             Bounds;
+		uint32_t                UploadedVertices;
+		uint32_t                UploadedIndices;
+		bool                    Failed;
+	};
+
+	/**
+	* Uploads the next slice of the mesh being uploaded.
+	* @return True if the mesh is completely uploaded.
+	*/
+	bool UploadSlice(FDecodedMesh& Mesh);
+
+	/**
+	* Decodes requested meshes until the loader is destroyed.
+	*/
+	void LoadThreadLoop();
+
+private:
+	std::deque<FRequest>                      mRequests;   // Meshes waiting for the loader thread
+	std::deque<std::unique_ptr<FDecodedMesh>> mDecoded;    // Meshes waiting for the main thread
+	std::unique_ptr<FDecodedMesh>             mUploading;  // Mesh being uploaded, only used by the main thread
+
+	std::mutex               mMutex;
+	std::condition_variable  mLoadRequested;
+	std::thread              mLoadThread;
+	bool                     mMustShutdown;
+
+	uint32_t                 mPending;
+	uint64_t                 mLoaded;
+	uint64_t                 mFailed;
+	uint64_t                 mUploadedBytes;
+	uint64_t                 mLatencyCycles;      // Sum of the latency of all loaded meshes
+	uint64_t                 mMaxLatencyCycles;
+	uint64_t                 mFirstRequestTime;
+	uint64_t                 mColdStartCycles;
+};
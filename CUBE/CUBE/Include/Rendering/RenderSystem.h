@@ -48,6 +48,18 @@ public:
 	*/
 	void RenderGeometry();
 
+	/**
+	* Sets if the scene is replaced by a view of chunk overdraw. Each fragment that passes
+	* the depth test brightens its pixel, bright areas are shaded many times per frame.
+	*/
+	void SetOverdrawView(const bool Enabled) { mShowOverdraw = Enabled; }
+
+	/**
+	* Retrieves the number of fragments that passed the depth test while constructing
+	* the GBuffer. Counted by the GPU, the count lags a few frames behind.
+	*/
+	uint64_t GetGBufferFragmentCount() const { return mGBufferFragments; }
+
 	/**
 	* Get the current world space coordinates of each of the 8 corners
 	* of the view volume.
@@ -94,6 +106,16 @@ private:
 	*/
 	void LightingPass();
 
+	/**
+	* Draws chunk overdraw in place of the lit scene.
+	*/
+	void OverdrawPass();
+
+	/**
+	* Retrieves the fragment count of the oldest query before it is reused for this frame.
+	*/
+	void ReadFragmentQuery();
+
 	/**
 	* Updates the bounding box for the current view volume.
 	*/
@@ -139,6 +161,7 @@ private:
 	FChunkManager&        mChunkManager;
 	FShaderProgram        mDeferredRender;
 	FShaderProgram        mChunkRender;
+	FShaderProgram        mOverdrawRender;
 	PostProcessContainer  mPostProcesses;
 	//FBox                  mViewAABB;
 
@@ -154,4 +177,11 @@ private:
 	FUniformBlock   mResolutionBlock;
 	FUniformBlock   mProjectionInfoBlock;
 	GLuint          mBlockInfoBuffer;
+
+	// GBuffer fragment counting, queries are reused in turn so results are read frames later without stalling
+	static const uint32_t FRAGMENT_QUERY_COUNT = 3;
+	GLuint          mFragmentQueries[FRAGMENT_QUERY_COUNT];
+	uint32_t        mQueryFrame;
+	uint64_t        mGBufferFragments;
+	bool            mShowOverdraw;
 };
\ No newline at end of file
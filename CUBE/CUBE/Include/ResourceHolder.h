@@ -1,5 +1,6 @@
 #pragma once
-#include <map>
+#include <vector>
+#include <utility>
 #include <cstdint>
 #include <memory>
 
@@ -8,6 +9,10 @@
 template <typename Resource>
 /**
 * Singleton class for loading resources from files.
+* Resources are found by the ID of their name, see STRING_ID() to
+* compute the ID of a name at compile time.
+* Resources are shared by every world in the process. Load them before worlds
+* run on other threads, the holder is only read from several threads at once.
 */
 class TResourceHolder
 {
@@ -45,8 +50,25 @@ public:
 	*/
 	static Resource& Get(const char* Name);
 
+	/**
+	* Retrieves a resource by the ID of its name.
+	*/
+	static Resource& Get(const uint32_t ID);
+
+private:
+	/**
+	* Stores a resource under the ID of its name.
+	*/
+	static void Insert(const uint32_t ID, std::unique_ptr<Resource> ResourcePtr);
+
+	/**
+	* Finds the first entry with an ID not less than ID.
+	*/
+	static typename std::vector<std::pair<uint32_t, std::unique_ptr<Resource>>>::iterator LowerBound(const uint32_t ID);
+
 private:
-	static std::map<uint32_t, std::unique_ptr<Resource>> mResourceMap;
+	// Resources sorted by ID, few are loaded while many are looked up so a binary search beats a tree
+	static std::vector<std::pair<uint32_t, std::unique_ptr<Resource>>> mResources;
 };
 
 class FShader;
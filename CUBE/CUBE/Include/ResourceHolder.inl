@@ -1,23 +1,20 @@
 #pragma once
-#include "Misc\StringUtil.h"
+#include <algorithm>
+#include "StringID.h"
 #include "Misc\Assertions.h"
 
 template <typename Resource>
 inline void TResourceHolder<Resource>::Load(const char* Name)
 {
 	std::unique_ptr<Resource> ResourcePtr(new Resource);
-	uint32_t GUID = FString::HashCRC32(Name);
-	auto Insert = mResourceMap.insert({ GUID, std::move(ResourcePtr) });
-	ASSERT(Insert.second && "Duplicate keys in resource map.");
+	Insert(FString::HashCRC32(Name), std::move(ResourcePtr));
 }
 
 template <typename Resource>
 inline void TResourceHolder<Resource>::Load(const char* Name, const wchar_t* Filename)
 {
 	std::unique_ptr<Resource> ResourcePtr(new Resource(Filename));
-	uint32_t GUID = FString::HashCRC32(Name);
-	auto Insert = mResourceMap.insert({ GUID, std::move(ResourcePtr) });
-	ASSERT(Insert.second && "Duplicate keys in resource map.");
+	Insert(FString::HashCRC32(Name), std::move(ResourcePtr));
 }
 
 template <typename Resource>
@@ -25,25 +22,55 @@ template <typename FirstParam>
 inline void TResourceHolder<Resource>::Load(const char* Name, const wchar_t* Filename, const FirstParam& Param)
 {
 	std::unique_ptr<Resource> ResourcePtr(new Resource(Filename, Param));
-	uint32_t GUID = FString::HashCRC32(Name);
-	auto Insert = mResourceMap.insert({ GUID, std::move(ResourcePtr) });
-	ASSERT(Insert.second && "Duplicate keys in resource map.");
+	Insert(FString::HashCRC32(Name), std::move(ResourcePtr));
 }
 
 template <typename Resource>
 inline void TResourceHolder<Resource>::Unload(const char* Name)
 {
-	auto NumErased = mResourceMap.erase(FString::HashCRC32(Name));
-	ASSERT(NumErased == 1 && "Tried to unload a non-existent resource.");
+	const uint32_t ID = FString::HashCRC32(Name);
+	auto Found = LowerBound(ID);
+	const bool IsLoaded = (Found != mResources.end() && Found->first == ID);
+	ASSERT(IsLoaded && "Tried to unload a non-existent resource.");
+
+	if (IsLoaded)
+		mResources.erase(Found);
 }
 
 template <typename Resource>
 inline Resource& TResourceHolder<Resource>::Get(const char* Name)
 {
-	auto Found = mResourceMap.find(FString::HashCRC32(Name));
-	ASSERT(Found != mResourceMap.end() && "Resource not in resource map.");
+	return Get(FString::HashCRC32(Name));
+}
+
+template <typename Resource>
+inline Resource& TResourceHolder<Resource>::Get(const uint32_t ID)
+{
+	auto Found = LowerBound(ID);
+	ASSERT(Found != mResources.end() && Found->first == ID && "Resource not in resource map.");
 	return *Found->second;
 }
 
 template <typename Resource>
-std::map<uint32_t, std::unique_ptr<Resource>> TResourceHolder<Resource>::mResourceMap;
\ No newline at end of file
+inline void TResourceHolder<Resource>::Insert(const uint32_t ID, std::unique_ptr<Resource> ResourcePtr)
+{
+	// Resources are held by pointer, so references handed out stay valid when entries move
+	auto Found = LowerBound(ID);
+	const bool IsDuplicate = (Found != mResources.end() && Found->first == ID);
+	ASSERT(!IsDuplicate && "Duplicate keys in resource map.");
+
+	if (!IsDuplicate)
+		mResources.insert(Found, std::make_pair(ID, std::move(ResourcePtr)));
+}
+
+template <typename Resource>
+inline typename std::vector<std::pair<uint32_t, std::unique_ptr<Resource>>>::iterator TResourceHolder<Resource>::LowerBound(const uint32_t ID)
+{
+	return std::lower_bound(mResources.begin(), mResources.end(), ID, [](const std::pair<uint32_t, std::unique_ptr<Resource>>& Entry, const uint32_t Value)
+	{
+		return Entry.first < Value;
+	});
+}
+
+template <typename Resource>
+std::vector<std::pair<uint32_t, std::unique_ptr<Resource>>> TResourceHolder<Resource>::mResources;
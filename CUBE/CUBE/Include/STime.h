@@ -1,42 +1,83 @@
 #pragma once
 
 #include "Clock.h"
+#include "Common.h"
 
 /**
-* Interface for useful time values.
+* Interface for useful time values. Every thread that runs a game loop can
+* keep its own time, see SetThreadTime(), other threads share a default.
 */
 class STime
 {
+public:
+	/**
+	* Time values of one game loop.
+	*/
+	struct FTimeState
+	{
+		FTimeState()
+			: GameClock()
+			, FrameStart(0)
+			, FrameEnd(0)
+			, DeltaTime(1.0f / 30.0f)
+			, FixedUpdate(0)
+		{}
+
+		FClock   GameClock;
+		uint64_t FrameStart;
+		uint64_t FrameEnd;
+		float    DeltaTime;
+		float    FixedUpdate;
+	};
+
 public:
 	static float GetDeltaTime()
 	{
-		return mDeltaTime;
+		return GetState().DeltaTime;
 	}
 
 	static float GetFixedUpdate()
 	{
-		return mFixedUpdate;
+		return GetState().FixedUpdate;
 	}
 
 	static void SetFixedUpdate(float Time)
 	{
-		mFixedUpdate = Time;
+		GetState().FixedUpdate = Time;
 	}
 
 	static FClock& GetGameClock()
 	{
-		return mGameClock;
+		return GetState().GameClock;
+	}
+
+	/**
+	* Makes the calling thread use its own time values, used by threads that each run
+	* the game loop of a different world.
+	* @param State - The time of the thread, null to use the default again.
+	*/
+	static void SetThreadTime(FTimeState* State)
+	{
+		mThreadState = State;
 	}
 
 	static void StartGameTimer();
 
 	static void UpdateGameTimer();
 
+	/**
+	* Advances the game timer by a fixed tick, however long the tick took to run.
+	* Used instead of UpdateGameTimer() when the game runs at a fixed tick.
+	*/
+	static void StepGameTimer(const float TickTime);
+
 private:
-	static FClock mGameClock;
-	static uint64_t mFrameStart;
-	static uint64_t mFrameEnd;
-	static float mDeltaTime;
-	static float mFixedUpdate;
-};
+	static FTimeState& GetState()
+	{
+		return mThreadState ? *mThreadState : mDefaultState;
+	}
 
+private:
+	static FTimeState mDefaultState;
+	static THREAD_LOCAL FTimeState* mThreadState;
+};
@@ -1,12 +1,27 @@
 #pragma once
 #include <cstdint>
 #include <string>
+#include <type_traits>
+
+#include "Misc\StringUtil.h"
+
+/**
+* The ID of a string literal, equal to FStringID(Name).GetID(). The hash is computed at
+* compile time, Visual Studio 2013 lacks constexpr so there it is computed once per use
+* the first time the use is reached. Names used this way are not in the debug name map.
+*/
+#if defined(_MSC_VER) && _MSC_VER < 1900
+	#define STRING_ID(Name) ([]() -> uint32_t { static const uint32_t ID = FString::HashCRC32(Name); return ID; }())
+#else
+	#define STRING_ID(Name) (std::integral_constant<uint32_t, FString::HashCRC32Constant(Name)>::value)
+#endif
 
 /**
 * A class the allows string names to be represented
 * as a compact integer, which allows for faster and more
 * efficient operations than when done with strings. All strings
-* are hashed into IDs and stored in a hashtable for fast lookups.
+* are hashed into IDs. Debug builds also keep the name of every ID
+* in a hashtable to report collisions and retrieve names.
 */
 class FStringID
 {
@@ -37,7 +52,8 @@ public:
 	StringID GetID() const { return mID; };
 
 	/**
-	* Retrieves the string representation of the string id.
+	* Retrieves the string representation of the string id. Builds
+	* without the name map return the ID in hexadecimal instead.
 	*/
 	const std::string GetName() const;
 
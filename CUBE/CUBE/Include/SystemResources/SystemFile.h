@@ -2,4 +2,6 @@
 
 #ifdef _WIN32
 	#include "Windows\WindowsFile.h"
+#elif defined(__unix__) || defined(__APPLE__)
+	#include "Posix\PosixFile.h"
 #endif
\ No newline at end of file
@@ -33,6 +33,14 @@ public:
 		return Instance;
 	}
 
+	/**
+	* Retrieves the instance, null if none exists.
+	*/
+	static T* TryGetInstancePtr()
+	{
+		return Instance;
+	}
+
 private:
 	// Disable copy ctor and assignment
 	TSingleton(const TSingleton<T>& Other) = delete;
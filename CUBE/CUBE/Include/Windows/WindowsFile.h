@@ -32,6 +32,14 @@ public:
 
 	uint32_t GetFileSize() const override;
 
+	bool ReadAt(uint8_t* DataOut, const uint32_t NumBytesToRead, const uint64_t Offset) override;
+
+	bool WriteAt(const uint8_t* Data, const uint32_t NumBytesToWrite, const uint64_t Offset) override;
+
+	bool Reserve(const uint64_t Size) override;
+
+	void Advise(const EFileAdvice::Type Advice, const uint64_t Offset = 0, const uint64_t Length = 0) override;
+
 private:
 	/**
 	* Moves the current file pointer a specified distance based on
@@ -45,6 +53,25 @@ private:
 };
 
 
+/**
+* File mapped into memory with a Windows file mapping object.
+*/
+class FWindowsMappedFile : public IMappedFile
+{
+public:
+	FWindowsMappedFile(HANDLE FileHandle, HANDLE MappingHandle, const uint8_t* View, const uint64_t Size);
+
+	/**
+	* Unmaps the view and closes the file.
+	*/
+	~FWindowsMappedFile();
+
+private:
+	HANDLE mFileHandle;
+	HANDLE mMappingHandle;
+};
+
+
 /**
 * Wrapper class for file operations on the Windows platform.
 */
@@ -57,6 +84,7 @@ public:
 	std::unique_ptr<IFileHandle> OpenWritable(const wchar_t* FileName, const bool AllowShareRead = false, const bool CreateNew = false) override;
 	std::unique_ptr<IFileHandle> OpenReadable(const wchar_t* Filename) override;
 	std::unique_ptr<IFileHandle> OpenReadWritable(const wchar_t* FileName, const bool AllowRead = false, const bool CreateNew = false) override;
+	std::unique_ptr<IMappedFile> MapReadable(const wchar_t* Filename) override;
 
 	bool DeleteFilename(const wchar_t* Filename) override;
 
@@ -74,6 +102,8 @@ public:
 
 	bool FileExists(const wchar_t* Filename) override;
 
+	bool GetWriteTime(const wchar_t* Filename, uint64_t& TimeOut) override;
+
 	bool SetToProgramDirectory() override;
 
 	bool CopyFileDirectory(const wchar_t* From, const wchar_t* To) override;
@@ -6,22 +6,30 @@ layout (binding = 7) uniform sampler2D AOTex;
 
 uniform uint uBlurSize = 4;
 uniform vec3 uAmbient = vec3(.3, .3, .3);
+uniform bool uUseSSAO = true;
 
 out vec4 oColor;
 
 void main()
 {
 	ivec2 ScreenCoord = ivec2(gl_FragCoord.xy);
-	float Sum = 0.0;
-	for(uint y = 0; y < uBlurSize; ++y)
+	float Sum = 1.0;
+	if (uUseSSAO)
 	{
-		for(uint x = 0; x < uBlurSize; ++x)
+		Sum = 0.0;
+		for(uint y = 0; y < uBlurSize; ++y)
 		{
-			Sum += texelFetch(AOTex, ScreenCoord + ivec2(x, y), 0).r;
+			for(uint x = 0; x < uBlurSize; ++x)
+			{
+				Sum += texelFetch(AOTex, ScreenCoord + ivec2(x, y), 0).r;
+			}
 		}
+
+		Sum /= (uBlurSize * uBlurSize);
 	}
 
-	Sum /= (uBlurSize * uBlurSize);
+	// Occlusion baked into the chunk meshes darkens the ambient light as well
+	Sum *= GetOcclusion(ScreenCoord);
 	oColor = vec4(Sum * uAmbient * GetColor(ScreenCoord), 1);
 }
 
@@ -3,12 +3,13 @@
 #include "UniformBlocks.glsl"
 
 layout (location = 0) in vec4 iPosition;
-layout (location = 4) in uint Normal8_Block8;
+layout (location = 4) in uint Occlusion8_Normal8_Block8;
 
 out VS_OUT 
 {
 	vec3 Normal;
 	vec3 Color;
+	float Occlusion;
 	flat uint MaterialID;
 } vs_out;
 
@@ -24,15 +25,21 @@ const vec3 BlockNormals[6] =
 	vec3( 0,  0, -1)
 };
 
+// Ambient light reaching a vertex by the number of its 3 neighbor blocks that occlude it, from most occluded
+const float OcclusionCurve[4] = { 0.45, 0.65, 0.85, 1.0 };
+
 void main()
 {
 	// Unpack color
-	vs_out.Color = texelFetch(BlockColors, int(Normal8_Block8 & 0xFF), 0).xyz;
+	vs_out.Color = texelFetch(BlockColors, int(Occlusion8_Normal8_Block8 & 0xFF), 0).xyz;
 
 	// Unpack normal and lookup with table
-	vec3 WorldNormal = BlockNormals[(Normal8_Block8 & 0xFF00) >> 8];
+	vec3 WorldNormal = BlockNormals[(Occlusion8_Normal8_Block8 & 0xFF00) >> 8];
 	vs_out.Normal = mat3(Transforms.View) * WorldNormal;
 
+	// Occlusion baked by the mesher, interpolated across the quad
+	vs_out.Occlusion = OcclusionCurve[(Occlusion8_Normal8_Block8 >> 16) & 0x3];
+
 	vs_out.MaterialID = uint(gl_VertexID);
 
 	gl_Position = Transforms.Projection * Transforms.View * iPosition;
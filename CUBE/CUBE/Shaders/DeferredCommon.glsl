@@ -33,6 +33,12 @@ vec3 GetColor(ivec2 ScreenCoord)
 	return vec3(unpackHalf2x16(Data0.x), ColorZNormX.x);
 }
 
+float GetOcclusion(ivec2 ScreenCoord)
+{
+	uvec4 Data0 = texelFetch(GBuffer0, ScreenCoord, 0);
+	return float(Data0.w >> 24) / 255.0;
+}
+
 float GetLinearDepth(ivec2 ScreenCoord)
 {
 	float Depth = texelFetch(DepthTexture, ScreenCoord, 0).r;
@@ -47,7 +53,7 @@ void UnpackGBuffer(ivec2 ScreenCoord, out FragmentData_t Fragment)
 	vec2 ColorZNormX = unpackHalf2x16(Data0.y);
 	Fragment.Color = vec3(unpackHalf2x16(Data0.x), ColorZNormX.x);
 	Fragment.Normal = normalize(vec3(ColorZNormX.y, unpackHalf2x16(Data0.z)));
-	Fragment.MaterialID = Data0.w;
+	Fragment.MaterialID = Data0.w & 0xFFFFFF;
 
 	Fragment.ViewCoord = GetViewPosition(ScreenCoord);
 }
\ No newline at end of file
@@ -6,6 +6,7 @@ in VS_OUT
 {
 	vec3 Normal;
 	vec3 Color;
+	float Occlusion;
 	flat uint MaterialID;
 } fs_in;
 
@@ -16,7 +17,9 @@ void main()
 	OutVec0.x = packHalf2x16(fs_in.Color.xy);
 	OutVec0.y = packHalf2x16(vec2(fs_in.Color.z, fs_in.Normal.x));
 	OutVec0.z = packHalf2x16(fs_in.Normal.yz);
-	OutVec0.w = fs_in.MaterialID;
+
+	// Baked occlusion in the high 8 bits
+	OutVec0.w = (uint(clamp(fs_in.Occlusion, 0.0, 1.0) * 255.0 + 0.5) << 24) | (fs_in.MaterialID & 0xFFFFFF);
 
 	color0 = OutVec0;
 }
\ No newline at end of file
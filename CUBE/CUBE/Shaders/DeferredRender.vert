@@ -10,6 +10,7 @@ out VS_OUT
 {
 	vec3 Normal;
 	vec3 Color;
+	float Occlusion;
 	flat uint MaterialID;
 } vs_out;
 
@@ -17,6 +18,7 @@ void main()
 {
 	vs_out.Color = vColor.xyz;
 	vs_out.Normal = mat3(Transforms.View) * mat3(Transforms.Model) * vNormal;
+	vs_out.Occlusion = 1.0;
 	vs_out.MaterialID = uint(gl_VertexID);
 
 	gl_Position = Transforms.Projection * Transforms.View * Transforms.Model * vec4(vPosition, 1.0);
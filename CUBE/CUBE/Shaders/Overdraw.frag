@@ -0,0 +1,9 @@
+#version 430 core
+
+layout (location = 0) out vec4 color0;
+
+void main()
+{
+	// Blended additively, each shaded fragment brightens the pixel
+	color0 = vec4(0.08, 0.04, 0.02, 1.0);
+}
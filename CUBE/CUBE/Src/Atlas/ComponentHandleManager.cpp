@@ -5,6 +5,8 @@ namespace Atlas
 {
 	const FComponentHandle& SComponentHandleManager::GetHandle(const EComponent::Type Type)
 	{
+		std::lock_guard<std::mutex> Lock(ComponentMapMutex);
+
 		// If an identifier is not assigned, assign one
 		auto Found = ComponentMap.find(Type);
 		if (Found == ComponentMap.end())
@@ -16,4 +18,5 @@ namespace Atlas
 	}
 
 	std::unordered_map <EComponent::Type, FComponentHandle> SComponentHandleManager::ComponentMap;
+	std::mutex SComponentHandleManager::ComponentMapMutex;
 }
\ No newline at end of file
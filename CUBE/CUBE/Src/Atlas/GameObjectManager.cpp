@@ -12,6 +12,7 @@ namespace Atlas
 		, mSystemComponents()
 		, mDestroyQueue()
 	{
+		FMemoryTagScope MemoryTag(EMemoryTag::GameObjects);
 		mGameObjects.Init<FGameObject>(DEFAULT_CONTAINER_SIZE);
 	}
 
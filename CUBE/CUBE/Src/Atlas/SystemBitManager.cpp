@@ -4,6 +4,8 @@ namespace Atlas
 {
 	std::bitset<BITSIZE> SSystemBitManager::GetBitMaskFor(const std::type_index& type)
 	{
+		std::lock_guard<std::mutex> Lock(mMutex);
+
 		// if the System is not in the map, assign a bit to it and add it to the map
 		if (mSystemBitMap.find(type) == mSystemBitMap.end())
 		{
@@ -16,4 +18,5 @@ namespace Atlas
 
 	std::bitset<BITSIZE> SSystemBitManager::mNextBit(1);
 	std::unordered_map<std::type_index, std::bitset<BITSIZE>> SSystemBitManager::mSystemBitMap;
+	std::mutex SSystemBitManager::mMutex;
 }
\ No newline at end of file
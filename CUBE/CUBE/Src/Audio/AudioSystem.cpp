@@ -2,11 +2,22 @@
 #include "FMOD\fmod_errors.h"
 #include "Components\SoundEmitter.h"
 #include "Components\SoundListener.h"
+#include "STime.h"
+#include <algorithm>
+#include <cmath>
 
-FAudioSystem::FAudioSystem(Atlas::FWorld& World)
+const float FAudioSystem::MOVE_THRESHOLD = 0.05f;
+
+FAudioSystem::FAudioSystem(Atlas::FWorld& World, const EAudioOutput::Type Output)
 	: ISystem(World)
 	, mSystem(nullptr)
 	, mListenerSubSystem(nullptr)
+	, mSoundCache(nullptr)
+	, mAudible()
+	, mMaxVoices(DEFAULT_MAX_VOICES)
+	, mRealVoices(0)
+	, mAttributeUpdates(0)
+	, mVirtualizations(0)
 {
 	FMOD_RESULT Result = FMOD::System_Create(&mSystem);
 	if (Result != FMOD_OK)
@@ -15,13 +26,23 @@ FAudioSystem::FAudioSystem(Atlas::FWorld& World)
 		exit(-1);
 	}
 
-	Result = mSystem->init(512, FMOD_INIT_NORMAL, 0);
+	// The null output only mixes when the system is updated, streams are read from the update as well
+	FMOD_INITFLAGS Flags = FMOD_INIT_NORMAL;
+	if (Output == EAudioOutput::Null)
+	{
+		mSystem->setOutput(FMOD_OUTPUTTYPE_NOSOUND_NRT);
+		Flags |= FMOD_INIT_STREAM_FROM_UPDATE | FMOD_INIT_MIX_FROM_UPDATE;
+	}
+
+	Result = mSystem->init(512, Flags, 0);
 	if (Result != FMOD_OK)
 	{
 		printf("FMOD error! (%d) %s\n", Result, FMOD_ErrorString(Result));
 		exit(-1);
 	}
 
+	mSoundCache = new FSoundCache(mSystem);
+
 	AddComponentType<Atlas::EComponent::SoundEmitter>();
 	mListenerSubSystem = &AddSubSystem<FAudioListenerSystem>(mSystem);
 }
@@ -29,6 +50,8 @@ FAudioSystem::FAudioSystem(Atlas::FWorld& World)
 
 FAudioSystem::~FAudioSystem()
 {
+	delete mSoundCache;
+
 	mSystem->close();
 	FMOD_RESULT Result = mSystem->release();
 	if (Result != FMOD_OK)
@@ -41,48 +64,178 @@ FAudioSystem::~FAudioSystem()
 
 void FAudioSystem::Update()
 {
-	FMOD_VECTOR Velocity = { 0.0f, 0.0f, 0.0f }; // Disregard velocity for now
+	// Audibility depends on where the listener is this frame
+	mListenerSubSystem->Update();
+	mSoundCache->Update();
+
+	const Vector3f ListenerPosition = mListenerSubSystem->GetListenerPosition();
+	const float DeltaTime = STime::GetDeltaTime();
+	mAudible.clear();
 
 	auto& Objects = GetGameObjects();
 	for (auto& Object : Objects)
 	{
-		const Vector3f Position = Object->Transform.GetWorldPosition();
-		FMOD_VECTOR FMODPosition = { Position.x, Position.y, Position.z };
-
 		FSoundEmitter& Emitter = Object->GetComponent<Atlas::EComponent::SoundEmitter>();
-		Emitter.Channel->set3DAttributes(&FMODPosition, &Velocity);
 
 		if (Emitter.Filename.size() > 0)
 		{
-			if (Emitter.Sound)
-				Emitter.Sound->release();
-
-			FMOD_MODE Mode = FMOD_3D;
-			if (Emitter.Looping)
-				Mode |= FMOD_LOOP_NORMAL;
+			StopChannel(Emitter);
+			if (Emitter.SoundID != FSoundCache::INVALID_ID)
+				mSoundCache->Release(Emitter.SoundID);
 
-			mSystem->createSound(Emitter.Filename.data(), Mode, nullptr, &Emitter.Sound);
+			Emitter.SoundID = mSoundCache->Acquire(Emitter.Filename, Emitter.Looping, Emitter.LoadPolicy);
+			Emitter.IsPlaying = false;
 			Emitter.Filename.resize(0);
 		}
 
 		if (Emitter.ActivateSound)
 		{
-			mSystem->playSound(Emitter.Sound, nullptr, false, &Emitter.Channel);
+			// Sounds still loading start playing once they are loaded
+			StopChannel(Emitter);
+			Emitter.IsPlaying = (Emitter.SoundID != FSoundCache::INVALID_ID);
+			Emitter.PlaybackTime = 0.0f;
 			Emitter.ActivateSound = false;
 		}
+
+		if (!Emitter.IsPlaying)
+			continue;
+
+		if (!mSoundCache->GetSound(Emitter.SoundID))
+		{
+			Emitter.IsPlaying = !mSoundCache->HasFailed(Emitter.SoundID);
+			continue;
+		}
+
+		if (Emitter.Channel)
+		{
+			// Channels of sounds that ended are invalid
+			bool IsChannelPlaying = false;
+			if (Emitter.Channel->isPlaying(&IsChannelPlaying) != FMOD_OK || !IsChannelPlaying)
+			{
+				Emitter.Channel = nullptr;
+				Emitter.IsPlaying = false;
+				continue;
+			}
+		}
+		else if (!Emitter.Looping && Emitter.PlaybackTime >= mSoundCache->GetLength(Emitter.SoundID))
+		{
+			// Virtual sounds end when they would have ended on a channel
+			Emitter.IsPlaying = false;
+			continue;
+		}
+
+		Emitter.PlaybackTime += DeltaTime;
+
+		// Gain falls off with distance, closer than a block counts as a block away
+		const Vector3f Position = Object->Transform.GetWorldPosition();
+		const float DistanceSquared = std::max((Position - ListenerPosition).LengthSquared(), 1.0f);
+		mAudible.push_back(FAudibleEmitter{ &Emitter, Position, Emitter.Volume / DistanceSquared });
 	}
 
-	// Update audio listener
-	mListenerSubSystem->Update();
+	const uint32_t RealCount = std::min((uint32_t)mAudible.size(), mMaxVoices);
+	std::nth_element(mAudible.begin(), mAudible.begin() + RealCount, mAudible.end(), [](const FAudibleEmitter& Left, const FAudibleEmitter& Right)
+	{
+		return Left.Audibility > Right.Audibility;
+	});
 
+	// Free the channels of inaudible emitters before handing them to the audible ones
+	for (uint32_t i = RealCount; i < mAudible.size(); i++)
+	{
+		if (mAudible[i].Emitter->Channel)
+			Virtualize(*mAudible[i].Emitter);
+	}
+
+	FMOD_VECTOR Velocity = { 0.0f, 0.0f, 0.0f }; // Disregard velocity for now
+	for (uint32_t i = 0; i < RealCount; i++)
+	{
+		FSoundEmitter& Emitter = *mAudible[i].Emitter;
+		const Vector3f& Position = mAudible[i].Position;
+
+		if (!Emitter.Channel)
+		{
+			Realize(Emitter, Position);
+		}
+		else if ((Position - Emitter.LastPosition).LengthSquared() > MOVE_THRESHOLD * MOVE_THRESHOLD)
+		{
+			FMOD_VECTOR FMODPosition = { Position.x, Position.y, Position.z };
+			Emitter.Channel->set3DAttributes(&FMODPosition, &Velocity);
+			Emitter.LastPosition = Position;
+			mAttributeUpdates++;
+		}
+	}
+
+	mRealVoices = RealCount;
 	mSystem->update();
 }
 
+FAudioSystem::FStats FAudioSystem::GetStats() const
+{
+	FStats Stats;
+	Stats.Emitters = (uint32_t)GetGameObjects().size();
+	Stats.RealVoices = mRealVoices;
+	Stats.VirtualVoices = (uint32_t)mAudible.size() - mRealVoices;
+	Stats.AttributeUpdates = mAttributeUpdates;
+	Stats.Virtualizations = mVirtualizations;
+	Stats.Cache = mSoundCache->GetStats();
+	return Stats;
+}
+
+void FAudioSystem::Realize(FSoundEmitter& Emitter, const Vector3f& Position)
+{
+	FMOD::Sound* Sound = mSoundCache->GetSound(Emitter.SoundID);
+
+	// Start paused so the channel is placed and seeked before it is heard
+	if (mSystem->playSound(Sound, nullptr, true, &Emitter.Channel) != FMOD_OK)
+	{
+		Emitter.Channel = nullptr;
+		return;
+	}
+
+	const float Length = mSoundCache->GetLength(Emitter.SoundID);
+	const float Time = (Emitter.Looping && Length > 0.0f) ? std::fmod(Emitter.PlaybackTime, Length) : Emitter.PlaybackTime;
+
+	FMOD_VECTOR FMODPosition = { Position.x, Position.y, Position.z };
+	FMOD_VECTOR Velocity = { 0.0f, 0.0f, 0.0f };
+	Emitter.Channel->setMode(Emitter.Looping ? FMOD_LOOP_NORMAL : FMOD_LOOP_OFF);
+	Emitter.Channel->setVolume(Emitter.Volume);
+	Emitter.Channel->setPosition((uint32_t)(Time * 1000.0f), FMOD_TIMEUNIT_MS);
+	Emitter.Channel->set3DAttributes(&FMODPosition, &Velocity);
+	Emitter.Channel->setPaused(false);
+
+	Emitter.LastPosition = Position;
+	mAttributeUpdates++;
+}
+
+void FAudioSystem::Virtualize(FSoundEmitter& Emitter)
+{
+	// The channel knows the exact playback time, the emitter only counts frames
+	uint32_t Position = 0;
+	if (Emitter.Channel->getPosition(&Position, FMOD_TIMEUNIT_MS) == FMOD_OK)
+		Emitter.PlaybackTime = Position / 1000.0f;
+
+	StopChannel(Emitter);
+	mVirtualizations++;
+}
+
+void FAudioSystem::StopChannel(FSoundEmitter& Emitter)
+{
+	if (Emitter.Channel)
+		Emitter.Channel->stop();
+
+	Emitter.Channel = nullptr;
+}
+
 void FAudioSystem::OnGameObjectRemove(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent)
 {
 	GameObject; // remove compiler warning
 	FSoundEmitter& Emitter = *static_cast<FSoundEmitter*>(&UpdateComponent);
-	Emitter.Sound->release();
+	StopChannel(Emitter);
+
+	if (Emitter.SoundID != FSoundCache::INVALID_ID)
+		mSoundCache->Release(Emitter.SoundID);
+
+	Emitter.SoundID = FSoundCache::INVALID_ID;
+	Emitter.IsPlaying = false;
 }
 
 void FAudioSystem::OnGameObjectAdd(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent)
@@ -90,7 +243,8 @@ void FAudioSystem::OnGameObjectAdd(Atlas::FGameObject& GameObject, Atlas::ICompo
 	GameObject; // remove compiler warning
 	FSoundEmitter& Emitter = *static_cast<FSoundEmitter*>(&UpdateComponent);
 	Emitter.Channel = nullptr;
-	Emitter.Sound = nullptr;
+	Emitter.SoundID = FSoundCache::INVALID_ID;
+	Emitter.IsPlaying = false;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -100,6 +254,7 @@ void FAudioSystem::OnGameObjectAdd(Atlas::FGameObject& GameObject, Atlas::ICompo
 FAudioListenerSystem::FAudioListenerSystem(Atlas::FWorld& World, FMOD::System* System)
 	: ISystem(World)
 	, mSystem(System)
+	, mListenerPosition()
 {
 	AddComponentType<Atlas::EComponent::SoundListener>();
 }
@@ -117,6 +272,7 @@ void FAudioListenerSystem::Update()
 		FGameObject& Object = *Objects[0];
 		const Vector3f ListenerPosition = Object.Transform.GetWorldPosition();
 		FMOD_VECTOR FMODPosition = { ListenerPosition.x, ListenerPosition.y, ListenerPosition.z };
+		mListenerPosition = ListenerPosition;
 
 		const FQuaternion Rotation = Object.Transform.GetRotation();
 		const Vector3f ForwardDirection = Rotation * -Vector3f::Forward;
@@ -0,0 +1,245 @@
+#include "Audio\SoundCache.h"
+#include <cstring>
+
+FSoundCache::FSoundCache(FMOD::System* System)
+	: mSystem(System)
+	, mEntries()
+	, mFreeEntries()
+	, mDecodedSounds()
+	, mLoading()
+	, mAutoPolicies()
+	, mStats()
+{
+	std::memset(&mStats, 0, sizeof(mStats));
+}
+
+FSoundCache::~FSoundCache()
+{
+	for (FEntry& Entry : mEntries)
+	{
+		if (Entry.Sound)
+			Entry.Sound->release();
+	}
+}
+
+FSoundCache::SoundID FSoundCache::Acquire(const std::string& Filename, const bool Looping, const ESoundLoad::Type Policy)
+{
+	mStats.Requests++;
+
+	// Files the Auto policy streams are never shared, so shared sounds are found without reading the file size
+	if (Policy != ESoundLoad::Stream)
+	{
+		auto Found = mDecodedSounds.find(Filename);
+		if (Found != mDecodedSounds.end())
+		{
+			mEntries[Found->second].RefCount++;
+			mStats.Hits++;
+			return Found->second;
+		}
+	}
+
+	// Files the Auto policy has not seen are probed as streams, reading their size on FMOD's loader thread
+	ESoundLoad::Type Load = Policy;
+	if (Policy == ESoundLoad::Auto)
+	{
+		auto Chosen = mAutoPolicies.find(Filename);
+		Load = (Chosen != mAutoPolicies.end()) ? Chosen->second : ESoundLoad::Auto;
+	}
+
+	SoundID ID;
+	if (!mFreeEntries.empty())
+	{
+		ID = mFreeEntries.back();
+		mFreeEntries.pop_back();
+	}
+	else
+	{
+		ID = (SoundID)mEntries.size();
+		mEntries.emplace_back();
+	}
+
+	FEntry& Entry = mEntries[ID];
+	Entry.Filename = Filename;
+	Entry.Sound = nullptr;
+	Entry.Length = 0.0f;
+	Entry.RefCount = 1;
+	Entry.State = ESoundState::Loading;
+	Entry.IsStream = (Load != ESoundLoad::Decode);
+	Entry.IsProbing = (Load == ESoundLoad::Auto);
+
+	// Decoded sounds are shared, so they loop per channel instead
+	FMOD_MODE Mode = FMOD_3D | FMOD_NONBLOCKING;
+	if (Entry.IsStream)
+		Mode |= FMOD_CREATESTREAM | (Looping ? FMOD_LOOP_NORMAL : FMOD_LOOP_OFF);
+	else
+		Mode |= FMOD_CREATESAMPLE;
+
+	mStats.Loads++;
+	if (mSystem->createSound(Filename.c_str(), Mode, nullptr, &Entry.Sound) != FMOD_OK || !Entry.Sound)
+	{
+		Entry.Sound = nullptr;
+		Entry.State = ESoundState::Failed;
+		mStats.Failures++;
+		return ID;
+	}
+
+	if (!Entry.IsStream)
+		mDecodedSounds[Filename] = ID;
+
+	mLoading.push_back(ID);
+	return ID;
+}
+
+void FSoundCache::Release(const SoundID ID)
+{
+	FEntry& Entry = mEntries[ID];
+	if (--Entry.RefCount > 0)
+		return;
+
+	// Releasing a sound that is still opening blocks until it opened, Update() releases it later
+	if (Entry.State != ESoundState::Loading)
+		FreeEntry(ID);
+}
+
+FMOD::Sound* FSoundCache::GetSound(const SoundID ID) const
+{
+	const FEntry& Entry = mEntries[ID];
+	return (Entry.State == ESoundState::Ready) ? Entry.Sound : nullptr;
+}
+
+bool FSoundCache::HasFailed(const SoundID ID) const
+{
+	return mEntries[ID].State == ESoundState::Failed;
+}
+
+float FSoundCache::GetLength(const SoundID ID) const
+{
+	return mEntries[ID].Length;
+}
+
+void FSoundCache::Update()
+{
+	for (uint32_t i = 0; i < mLoading.size();)
+	{
+		const SoundID ID = mLoading[i];
+		FEntry& Entry = mEntries[ID];
+
+		FMOD_OPENSTATE OpenState;
+		const FMOD_RESULT Result = Entry.Sound->getOpenState(&OpenState, nullptr, nullptr, nullptr);
+		if (Result == FMOD_OK && OpenState != FMOD_OPENSTATE_READY && OpenState != FMOD_OPENSTATE_ERROR)
+		{
+			i++;
+			continue;
+		}
+
+		bool IsReady = (Result == FMOD_OK && OpenState == FMOD_OPENSTATE_READY);
+		if (IsReady && Entry.IsProbing)
+		{
+			// Small files are reopened decoded and keep loading
+			if (!FinishProbe(ID))
+			{
+				i++;
+				continue;
+			}
+
+			IsReady = (Entry.Sound != nullptr);
+		}
+
+		mLoading[i] = mLoading.back();
+		mLoading.pop_back();
+
+		if (IsReady)
+		{
+			uint32_t Length = 0;
+			Entry.Sound->getLength(&Length, FMOD_TIMEUNIT_MS);
+			Entry.Length = Length / 1000.0f;
+			Entry.State = ESoundState::Ready;
+		}
+		else
+		{
+			// Failed sounds are no longer shared so the next request tries again
+			Entry.State = ESoundState::Failed;
+			if (Entry.Sound)
+				Entry.Sound->release();
+			Entry.Sound = nullptr;
+			mStats.Failures++;
+
+			auto Found = mDecodedSounds.find(Entry.Filename);
+			if (Found != mDecodedSounds.end() && Found->second == ID)
+				mDecodedSounds.erase(Found);
+		}
+
+		if (Entry.RefCount == 0)
+			FreeEntry(ID);
+	}
+}
+
+FSoundCache::FStats FSoundCache::GetStats() const
+{
+	FStats Stats = mStats;
+	Stats.Resident = 0;
+	Stats.Streams = 0;
+	Stats.Loading = (uint32_t)mLoading.size();
+
+	for (const FEntry& Entry : mEntries)
+	{
+		if (Entry.Sound)
+		{
+			Stats.Resident++;
+			Stats.Streams += Entry.IsStream ? 1 : 0;
+		}
+	}
+
+	return Stats;
+}
+
+bool FSoundCache::FinishProbe(const SoundID ID)
+{
+	FEntry& Entry = mEntries[ID];
+	Entry.IsProbing = false;
+
+	// Only the sound data is counted, headers are left out
+	uint32_t DataSize = 0;
+	Entry.Sound->getLength(&DataSize, FMOD_TIMEUNIT_RAWBYTES);
+
+	const ESoundLoad::Type Load = (DataSize > STREAM_THRESHOLD) ? ESoundLoad::Stream : ESoundLoad::Decode;
+	mAutoPolicies[Entry.Filename] = Load;
+
+	// Large files keep the stream, sounds no emitter holds anymore are not reopened
+	if (Load == ESoundLoad::Stream || Entry.RefCount == 0)
+		return true;
+
+	Entry.Sound->release();
+	Entry.Sound = nullptr;
+	Entry.IsStream = false;
+
+	mStats.Loads++;
+	if (mSystem->createSound(Entry.Filename.c_str(), FMOD_3D | FMOD_NONBLOCKING | FMOD_CREATESAMPLE, nullptr, &Entry.Sound) != FMOD_OK || !Entry.Sound)
+	{
+		// Failed by Update() like a sound that failed to open
+		Entry.Sound = nullptr;
+		return true;
+	}
+
+	// Requests made while the file was probed opened their own sounds, later requests share this one
+	if (mDecodedSounds.find(Entry.Filename) == mDecodedSounds.end())
+		mDecodedSounds[Entry.Filename] = ID;
+
+	return false;
+}
+
+void FSoundCache::FreeEntry(const SoundID ID)
+{
+	FEntry& Entry = mEntries[ID];
+
+	auto Found = mDecodedSounds.find(Entry.Filename);
+	if (Found != mDecodedSounds.end() && Found->second == ID)
+		mDecodedSounds.erase(Found);
+
+	if (Entry.Sound)
+		Entry.Sound->release();
+
+	Entry.Sound = nullptr;
+	Entry.Filename.clear();
+	mFreeEntries.push_back(ID);
+}
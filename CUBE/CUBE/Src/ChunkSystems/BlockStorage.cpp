@@ -0,0 +1,268 @@
+#include "ChunkSystems\BlockStorage.h"
+#include <cstring>
+#include <utility>
+
+FBlockLayout::FBlockLayout(FPageAllocator* PageAllocator)
+	: mVersion(0)
+	, mPageAllocator(PageAllocator)
+{
+	std::memset(mPages, 0, sizeof(mPages));
+}
+
+void FBlockLayout::CopyTo(FBlock* BlocksOut) const
+{
+	for (int32_t y = 0; y < PAGE_COUNT; y++)
+	{
+		std::memcpy(BlocksOut + y * BLOCKS_PER_PAGE, mPages[y]->Blocks, BLOCKS_PER_PAGE * sizeof(FBlock));
+	}
+}
+
+uint64_t FBlockLayout::Hash() const
+{
+	// Four independent lanes keep the multiplies from waiting on each other. Pages are
+	// hashed in order, so the hash is the same as for the contiguous layout.
+	static_assert(BLOCKS_PER_PAGE * sizeof(FBlock) % (4 * sizeof(uint64_t)) == 0, "Blocks are hashed 32 bytes at a time.");
+	const uint64_t Prime = 0x100000001B3ull;
+
+	uint64_t Lanes[4] = { 0xCBF29CE484222325ull, 0x84222325CBF29CE4ull, 0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full };
+	for (int32_t y = 0; y < PAGE_COUNT; y++)
+	{
+		const uint64_t* BlockWords = reinterpret_cast<const uint64_t*>(mPages[y]->Blocks);
+		for (uint32_t i = 0; i < BLOCKS_PER_PAGE * sizeof(FBlock) / sizeof(uint64_t); i += 4)
+		{
+			Lanes[0] = (Lanes[0] ^ BlockWords[i + 0]) * Prime;
+			Lanes[1] = (Lanes[1] ^ BlockWords[i + 1]) * Prime;
+			Lanes[2] = (Lanes[2] ^ BlockWords[i + 2]) * Prime;
+			Lanes[3] = (Lanes[3] ^ BlockWords[i + 3]) * Prime;
+		}
+	}
+
+	uint64_t Hash = 0;
+	for (uint64_t Lane : Lanes)
+	{
+		// Mix each lane so all bits of a block affect the high bits of the hash
+		Lane ^= Lane >> 33;
+		Lane *= 0xFF51AFD7ED558CCDull;
+		Lane ^= Lane >> 33;
+		Hash = (Hash ^ Lane) * Prime;
+	}
+
+	return Hash ^ (Hash >> 29);
+}
+
+bool FBlockLayout::IsUniform(FBlockTypes::BlockID& IDOut) const
+{
+	// Compare whole words against the first block repeated across a word
+	static_assert(sizeof(FBlock) == 1, "Uniform check assumes blocks are single bytes.");
+	const uint64_t Pattern = mPages[0]->Blocks[0].ID * 0x0101010101010101ull;
+
+	uint64_t Difference = 0;
+	for (int32_t y = 0; y < PAGE_COUNT; y++)
+	{
+		// Layers sharing the page of the layer below were already checked
+		if (y > 0 && mPages[y] == mPages[y - 1])
+			continue;
+
+		const uint64_t* BlockWords = reinterpret_cast<const uint64_t*>(mPages[y]->Blocks);
+		for (uint32_t i = 0; i < BLOCKS_PER_PAGE / sizeof(uint64_t); i++)
+		{
+			Difference |= BlockWords[i] ^ Pattern;
+		}
+	}
+
+	IDOut = mPages[0]->Blocks[0].ID;
+	return (Difference == 0);
+}
+
+uint32_t FBlockLayout::GetHeight() const
+{
+	// Scan the layers from the top down
+	static_assert(FBlock::AIR_BLOCK_ID == 0 && sizeof(FBlock) == 1, "Height check assumes air blocks are zero bytes.");
+
+	for (int32_t y = PAGE_COUNT - 1; y >= 0; y--)
+	{
+		const uint64_t* LayerWords = reinterpret_cast<const uint64_t*>(mPages[y]->Blocks);
+		uint64_t IsEmpty = 0;
+		for (uint32_t i = 0; i < BLOCKS_PER_PAGE / sizeof(uint64_t); i++)
+		{
+			IsEmpty |= LayerWords[i];
+		}
+
+		if (IsEmpty != 0)
+			return (uint32_t)y + 1;
+	}
+
+	return 0;
+}
+
+void FBlockLayout::ReleasePages()
+{
+	for (FPage*& Page : mPages)
+	{
+		if (Page)
+			RemovePageReference(Page);
+
+		Page = nullptr;
+	}
+}
+
+void FBlockLayout::AddPageReference(FPage* Page)
+{
+	Page->RefCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FBlockLayout::RemovePageReference(FPage* Page)
+{
+	// The last holder frees the page once every other holder is done reading it
+	if (Page->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		mPageAllocator->Free(Page);
+}
+
+FBlockSnapshot::FBlockSnapshot()
+	: FBlockLayout(nullptr)
+{
+}
+
+FBlockSnapshot::FBlockSnapshot(FBlockSnapshot&& Other)
+	: FBlockLayout(nullptr)
+{
+	*this = std::move(Other);
+}
+
+FBlockSnapshot& FBlockSnapshot::operator=(FBlockSnapshot&& Other)
+{
+	if (this != &Other)
+	{
+		ReleasePages();
+		std::memcpy(mPages, Other.mPages, sizeof(mPages));
+		std::memset(Other.mPages, 0, sizeof(Other.mPages));
+		mVersion = Other.mVersion;
+		mPageAllocator = Other.mPageAllocator;
+	}
+
+	return *this;
+}
+
+FBlockSnapshot::~FBlockSnapshot()
+{
+	ReleasePages();
+}
+
+FBlockStorage::FBlockStorage(FPageAllocator& PageAllocator)
+	: FBlockLayout(&PageAllocator)
+	, mPageMutex()
+{
+}
+
+FBlockStorage::~FBlockStorage()
+{
+	ReleasePages();
+}
+
+void FBlockStorage::Assign(const FBlock* Blocks)
+{
+	FPage* Pages[PAGE_COUNT];
+	for (int32_t y = 0; y < PAGE_COUNT; y++)
+	{
+		const FBlock* Layer = Blocks + y * BLOCKS_PER_PAGE;
+		if (y > 0 && std::memcmp(Layer, Pages[y - 1]->Blocks, BLOCKS_PER_PAGE * sizeof(FBlock)) == 0)
+		{
+			Pages[y] = Pages[y - 1];
+			AddPageReference(Pages[y]);
+			continue;
+		}
+
+		Pages[y] = new (mPageAllocator->Allocate()) FPage{};
+		std::memcpy(Pages[y]->Blocks, Layer, BLOCKS_PER_PAGE * sizeof(FBlock));
+	}
+
+	std::lock_guard<std::mutex> Lock(mPageMutex);
+	ReleasePages();
+	std::memcpy(mPages, Pages, sizeof(mPages));
+	mVersion++;
+}
+
+void FBlockStorage::Fill(const FBlockTypes::BlockID ID)
+{
+	FPage* Page = new (mPageAllocator->Allocate()) FPage{};
+	std::memset(Page->Blocks, ID, BLOCKS_PER_PAGE * sizeof(FBlock));
+	Page->RefCount = PAGE_COUNT;
+
+	std::lock_guard<std::mutex> Lock(mPageMutex);
+	ReleasePages();
+	for (FPage*& Layer : mPages)
+	{
+		Layer = Page;
+	}
+
+	mVersion++;
+}
+
+void FBlockStorage::Release()
+{
+	std::lock_guard<std::mutex> Lock(mPageMutex);
+	ReleasePages();
+	mVersion++;
+}
+
+bool FBlockStorage::SetBlock(const int32_t Index, const FBlock Block, FBlock* ReplacedOut)
+{
+	std::lock_guard<std::mutex> Lock(mPageMutex);
+
+	// The layout may have been released since the caller found its chunk
+	FPage*& Page = mPages[Index / BLOCKS_PER_PAGE];
+	if (!Page)
+		return false;
+
+	if (ReplacedOut)
+		*ReplacedOut = Page->Blocks[Index % BLOCKS_PER_PAGE];
+
+	if (Page->RefCount.load(std::memory_order_acquire) > 1)
+	{
+		// Snapshots and other layers keep the old page
+		FPage* Copy = new (mPageAllocator->Allocate()) FPage{};
+		std::memcpy(Copy->Blocks, Page->Blocks, BLOCKS_PER_PAGE * sizeof(FBlock));
+		RemovePageReference(Page);
+		Page = Copy;
+	}
+
+	Page->Blocks[Index % BLOCKS_PER_PAGE] = Block;
+	mVersion++;
+	return true;
+}
+
+bool FBlockStorage::ReadBlock(const int32_t Index, FBlock& BlockOut) const
+{
+	std::lock_guard<std::mutex> Lock(mPageMutex);
+
+	const FPage* Page = mPages[Index / BLOCKS_PER_PAGE];
+	if (!Page)
+		return false;
+
+	BlockOut = Page->Blocks[Index % BLOCKS_PER_PAGE];
+	return true;
+}
+
+FBlockSnapshot FBlockStorage::Snapshot() const
+{
+	FBlockSnapshot Snapshot;
+
+	std::lock_guard<std::mutex> Lock(mPageMutex);
+	for (int32_t y = 0; y < PAGE_COUNT; y++)
+	{
+		if (mPages[y])
+			AddPageReference(mPages[y]);
+
+		Snapshot.mPages[y] = mPages[y];
+	}
+
+	Snapshot.mVersion = mVersion;
+	Snapshot.mPageAllocator = mPageAllocator;
+	return Snapshot;
+}
+
+uint32_t FBlockStorage::GetCurrentVersion() const
+{
+	std::lock_guard<std::mutex> Lock(mPageMutex);
+	return mVersion;
+}
@@ -4,11 +4,16 @@
 #include "Debugging\DebugText.h"
 #include "Rendering\Screen.h"
 #include "ChunkSystems\ChunkManager.h"
+#include "ChunkSystems\ChunkGenerator.h"
 #include "Physics\PhysicsSystem.h"
+#include <cstring>
 
-FPoolAllocator<sizeof(FBlock) * FChunk::BLOCKS_PER_CHUNK, FChunk::POOL_SIZE> FChunk::ChunkAllocator(__alignof(FChunk));
-FPoolAllocatorType<FChunkMesh, FChunk::POOL_SIZE> FChunk::MeshAllocator(__alignof(FChunkMesh));
-FPoolAllocatorType<FChunk::CollisionData, FChunk::POOL_SIZE> FChunk::CollisionAllocator(__alignof(FChunk::CollisionData));
+// Bit positions of the fields packed into FChunk::MeshQuad::Geometry
+static const uint32_t QUAD_U_SHIFT = 6;
+static const uint32_t QUAD_V_SHIFT = 11;
+static const uint32_t QUAD_WIDTH_SHIFT = 16;
+static const uint32_t QUAD_HEIGHT_SHIFT = 21;
+static const uint32_t QUAD_SIDE_SHIFT = 26;
 
 int32_t FChunk::BlockIndex(Vector3i Position)
 {
@@ -25,21 +30,55 @@ int32_t FChunk::BlockIndex(int32_t X, int32_t Y, int32_t Z)
 	return FChunk::BlockIndex(Vector3i{ X, Y, Z });
 }
 
-FChunk::FChunk()
-	: mBlocks(nullptr)
+static_assert(FChunk::CHUNK_SIZE == FBlockLayout::SIZE, "Block layouts must have the dimensions of a chunk.");
+
+FChunk::FAllocators::FAllocators()
+	: PageAllocator(__alignof(FBlockLayout::FPage), FBlockLayout::POOL_CAPACITY, EMemoryTag::ChunkBlocks)
+	, MeshAllocator(__alignof(FChunkMesh), FChunk::POOL_CAPACITY, EMemoryTag::ChunkMeshes)
+	, CollisionAllocator(__alignof(FChunk::CollisionData), FChunk::POOL_CAPACITY, EMemoryTag::ChunkCollision)
+{
+}
+
+void FChunk::FAllocators::FlushThreadCaches()
+{
+	PageAllocator.FlushThreadCache();
+	MeshAllocator.FlushThreadCache();
+	CollisionAllocator.FlushThreadCache();
+}
+
+void FChunk::FAllocators::Trim()
+{
+	FlushThreadCaches();
+	PageAllocator.Trim();
+	MeshAllocator.Trim();
+	CollisionAllocator.Trim();
+}
+
+size_t FChunk::FAllocators::CommittedBytes()
+{
+	return PageAllocator.CommittedBytes() + MeshAllocator.CommittedBytes() + CollisionAllocator.CommittedBytes();
+}
+
+FChunk::FChunk(FAllocators& Allocators)
+	: mAllocators(Allocators)
+	, mBlocks(Allocators.PageAllocator)
+	, mMeshVersion(0)
 	, mCollisionData(nullptr)
 	, mIsLoaded()
 	, mIsEmpty()
+	, mIsModified()
+	, mIsMeshSkipped()
 {
 	mIsLoaded = false;
 	mIsEmpty = true;
+	mIsModified = false;
+	mIsMeshSkipped = false;
 
-	// Allocate mesh, block, and collision data
-	mMesh = new (MeshAllocator.Allocate()) FChunkMesh{};
-	mBlocks = static_cast<FBlock*>(ChunkAllocator.Allocate());
+	// Allocate mesh and collision data, blocks are allocated when the chunk is loaded
+	mMesh = new (mAllocators.MeshAllocator.Allocate()) FChunkMesh{};
 
 	// Construct Collision fields with new memory
-	mCollisionData = new (CollisionAllocator.Allocate()) CollisionData{};
+	mCollisionData = new (mAllocators.CollisionAllocator.Allocate()) CollisionData{};
 
 	// Set collision data
 	CollisionData& CollisionInfo = *mCollisionData;
@@ -51,82 +90,94 @@ FChunk::FChunk()
 
 FChunk::~FChunk()
 {
-	ChunkAllocator.Free(mBlocks);
-	MeshAllocator.Free(mMesh);
-	CollisionAllocator.Free(mCollisionData);
+	mAllocators.MeshAllocator.Free(mMesh);
+	mAllocators.CollisionAllocator.Free(mCollisionData);
 }
 
 
-bool FChunk::Load(const std::vector<uint8_t>& BlockData)
+bool FChunk::Load(const uint8_t* BlockData, const uint32_t DataSize, const uint8_t Codec)
 {
 	ASSERT(!mIsLoaded);
 
-	// Current index to access block type
-	int32_t TypeIndex = 0;
-	int32_t DataSize = BlockData.size();
-	int32_t IsEmpty = 0;
-
-	// Write RLE data for chunk
-	for (int32_t y = 0; y < CHUNK_SIZE && TypeIndex < DataSize; y++)
-	{
-		for (int32_t x = 0; x < CHUNK_SIZE; x++)
-		{
-			int32_t BaseIndex = BlockIndex(x, y, 0);
-			for (int32_t z = 0; z < CHUNK_SIZE;)
-			{
-				uint8_t Count = 0;
-				FBlockTypes::BlockID BlockType = (FBlockTypes::BlockID)BlockData[TypeIndex];
-				uint8_t RunLength = BlockData[TypeIndex + 1];
+	mIsModified = false;
+	mIsMeshSkipped = false;
 
-				// If a single block is not None, this number can never be 0 again
-				IsEmpty += (int32_t)BlockType - (int32_t)FBlock::AIR_BLOCK_ID;
+	// Codecs decode into contiguous memory, the layout is then split into pages
+	FScratchScope Scratch;
+	FBlock* Blocks = static_cast<FBlock*>(Scratch.GetArena().Allocate(BLOCKS_PER_CHUNK * sizeof(FBlock), 16));
 
-				for (Count = 0; Count < RunLength; Count++)
-				{
-					mBlocks[BaseIndex + z + Count].ID = BlockType;
-				}
+	const IChunkCodec* ChunkCodec = SChunkCodecs::Get(Codec);
+	if (!BlockData || !ChunkCodec || !ChunkCodec->Decode(BlockData, DataSize, Blocks))
+	{
+		if (BlockData)
+			FDebug::PrintF("Unable to decode chunk data with codec %u, loading as empty.\n", (uint32_t)Codec);
 
-				z += RunLength;
-				TypeIndex += 2;
-			}
-		}
+		mBlocks.Fill(FBlock::AIR_BLOCK_ID);
+		mMeshVersion = mBlocks.GetVersion();
+		mIsLoaded = true;
+		return true;
 	}
 
+	// If a single block is not air, the chunk is not empty
+	static_assert(FBlock::AIR_BLOCK_ID == 0 && sizeof(FBlock) == 1, "Empty check assumes air blocks are zero bytes.");
+	const uint64_t* BlockWords = reinterpret_cast<const uint64_t*>(Blocks);
+	uint64_t IsEmpty = 0;
+	for (uint32_t i = 0; i < BLOCKS_PER_CHUNK / sizeof(uint64_t); i++)
+	{
+		IsEmpty |= BlockWords[i];
+	}
 
+	mBlocks.Assign(Blocks);
+	mMeshVersion = mBlocks.GetVersion();
 	mIsLoaded = true;
 	return (IsEmpty == 0);
 }
 
-void FChunk::Unload(std::vector<uint8_t>& BlockDataOut)
+bool FChunk::Generate(FChunkGenerator& Generator, const Vector3i& ChunkPosition)
+{
+	ASSERT(!mIsLoaded);
+
+	mIsModified = false;
+	mIsMeshSkipped = false;
+
+	FScratchScope Scratch;
+	FBlock* Blocks = static_cast<FBlock*>(Scratch.GetArena().Allocate(BLOCKS_PER_CHUNK * sizeof(FBlock), 16));
+	const bool IsEmpty = Generator.Generate(ChunkPosition, Blocks);
+
+	mBlocks.Assign(Blocks);
+	mMeshVersion = mBlocks.GetVersion();
+	mIsLoaded = true;
+	return IsEmpty;
+}
+
+bool FChunk::Fill(const FBlockTypes::BlockID ID)
+{
+	ASSERT(!mIsLoaded);
+
+	mIsModified = false;
+	mIsMeshSkipped = false;
+	mBlocks.Fill(ID);
+
+	mMeshVersion = mBlocks.GetVersion();
+	mIsLoaded = true;
+	return (ID == FBlock::AIR_BLOCK_ID);
+}
+
+uint32_t FChunk::Unload(uint8_t* BlockDataOut, const EChunkCodec::Type Codec)
 {
 	ASSERT(mIsLoaded);
 
 	mIsLoaded = false;
 
-	// Extract RLE data for chunk
-	for (int32_t y = 0; y < CHUNK_SIZE; y++)
-	{
-		for (int32_t x = 0; x < CHUNK_SIZE; x++)
-		{
-			for (int32_t z = 0; z < CHUNK_SIZE;)
-			{
-				const uint32_t CurrentBlockIndex = BlockIndex(x, y, z);
-				const FBlockTypes::BlockID CurrentBlock = mBlocks[CurrentBlockIndex].ID;
-				uint8_t Length = 1;
-
-				FBlockTypes::BlockID NextBlock = mBlocks[CurrentBlockIndex + (int32_t)Length].ID;
-				while (CurrentBlock == NextBlock && Length + z < CHUNK_SIZE)
-				{
-					Length++;
-					NextBlock = mBlocks[CurrentBlockIndex + (int32_t)Length].ID;
-				}
+	// Codecs encode from contiguous memory. Unloaded chunks hold no pages.
+	FScratchScope Scratch;
+	FBlock* Blocks = static_cast<FBlock*>(Scratch.GetArena().Allocate(BLOCKS_PER_CHUNK * sizeof(FBlock), 16));
+	Snapshot().CopyTo(Blocks);
+	mBlocks.Release();
 
-				// Append RLE data
-				BlockDataOut.insert(BlockDataOut.end(), { CurrentBlock, Length });
-				z += (int32_t)Length;
-			}
-		}
-	}
+	const uint32_t DataSize = SChunkCodecs::Get(Codec)->Encode(Blocks, BlockDataOut);
+	ASSERT(DataSize <= MAX_ENCODED_SIZE);
+	return DataSize;
 }
 
 void FChunk::ShutDown(FPhysicsSystem& PhysicsSystem)
@@ -150,10 +201,10 @@ void FChunk::Render(const GLenum RenderMode)
 	mMesh->Render(RenderMode);
 }
 
-void FChunk::SwapMeshBuffer(FPhysicsSystem& PhysicsSystem)
+void FChunk::SwapMeshBuffer(FPhysicsSystem& PhysicsSystem, const bool UploadMesh)
 {
 	bool WasEmpty = (mMesh->GetIndexCount(FChunkMesh::FrontBuffer{}) == 0);
-	mMesh->SwapBuffer();
+	mMesh->SwapBuffer(UploadMesh);
 	mMesh->ClearBackBuffer();
 	mIsEmpty = (mMesh->GetIndexCount(FChunkMesh::FrontBuffer{}) == 0);
 
@@ -175,10 +226,170 @@ void FChunk::SwapMeshBuffer(FPhysicsSystem& PhysicsSystem)
 	}
 }
 
-void FChunk::RebuildMesh(const Vector3f& WorldPosition)
+void FChunk::DiscardMesh()
+{
+	mMesh->ClearBackBuffer();
+}
+
+void FChunk::RebuildMesh(const Vector3f& WorldPosition, const FBlockSnapshot& Blocks)
+{
+	// Quads are collected in scratch memory, then expanded into the mesh back buffer
+	FScratchScope Scratch;
+	TScratchArray<MeshQuad> Quads{ Scratch.GetArena(), 1024 };
+
+	GreedyMesh(Blocks, Quads);
+	RebuildMesh(WorldPosition, Quads.Data(), Quads.Size(), Blocks.GetVersion());
+}
+
+void FChunk::RebuildMesh(const Vector3f& WorldPosition, const MeshQuad* Quads, const uint32_t QuadCount, const uint32_t BlockVersion)
 {
-	GreedyMesh(WorldPosition);
+	mIsMeshSkipped = false;
+	mMeshVersion = BlockVersion;
 
+	// Group the quads by slice so each slice can later be replaced on its own
+	FScratchScope Scratch;
+	uint32_t SliceStart[FChunkMesh::MAX_SLICES + 1] = {};
+	for (uint32_t i = 0; i < QuadCount; i++)
+	{
+		const uint32_t Geometry = Quads[i].Geometry;
+		SliceStart[SliceIndex((Geometry >> QUAD_SIDE_SHIFT) & 0x7, Geometry & 0x3F) + 1]++;
+	}
+
+	for (uint32_t Slice = 0; Slice < FChunkMesh::MAX_SLICES; Slice++)
+	{
+		SliceStart[Slice + 1] += SliceStart[Slice];
+	}
+
+	TScratchArray<MeshQuad> SortedQuads{ Scratch.GetArena(), QuadCount };
+	SortedQuads.Resize(QuadCount);
+
+	uint32_t SliceEnd[FChunkMesh::MAX_SLICES];
+	std::memcpy(SliceEnd, SliceStart, sizeof(SliceEnd));
+	for (uint32_t i = 0; i < QuadCount; i++)
+	{
+		const uint32_t Geometry = Quads[i].Geometry;
+		SortedQuads[SliceEnd[SliceIndex((Geometry >> QUAD_SIDE_SHIFT) & 0x7, Geometry & 0x3F)]++] = Quads[i];
+	}
+
+	// Add data to mesh. The back buffer keeps its memory from previous builds.
+	mMesh->BeginBuild(QuadCount);
+	FChunkMesh::VertexData& Vertices = mMesh->GetVertexBuffer(FChunkMesh::BackBuffer{});
+	FChunkMesh::IndexData& Indices = mMesh->GetIndexBuffer(FChunkMesh::BackBuffer{});
+
+	for (uint32_t i = 0; i < QuadCount; i++)
+	{
+		ExpandQuad(SortedQuads[i], WorldPosition, Vertices, Indices);
+	}
+
+	for (uint32_t Slice = 0; Slice < FChunkMesh::MAX_SLICES; Slice++)
+	{
+		mMesh->SetSlice(Slice, SliceStart[Slice], SliceStart[Slice + 1] - SliceStart[Slice]);
+	}
+
+	BuildCollisionMesh();
+}
+
+void FChunk::PatchMesh(const Vector3f& WorldPosition, const FBlockSnapshot& Blocks, const MeshPatch& Patch, const bool HasPendingSwap)
+{
+	ASSERT(!mIsMeshSkipped);
+
+	// Slices outside of the patch were built from older layouts, but none of their faces changed since
+	mMeshVersion = Blocks.GetVersion();
+
+	FScratchScope Scratch;
+	TScratchArray<MeshQuad> Quads{ Scratch.GetArena(), 256 };
+
+	// Vertices of a slice are built here, then spliced into the mesh
+	FChunkMesh::VertexData Vertices;
+	FChunkMesh::IndexData Indices;
+
+	mMesh->BeginPatch(HasPendingSwap);
+
+	for (int32_t d = 0; d < 3; d++)
+	{
+		for (int32_t Layer = 0; Layer <= CHUNK_SIZE; Layer++)
+		{
+			if ((Patch.Layers[d] & (1ull << Layer)) == 0)
+				continue;
+
+			for (const bool BackFace : { true, false })
+			{
+				Quads.Resize(0);
+				MeshSlice(Blocks, d, Layer, BackFace, Quads);
+
+				Vertices.clear();
+				Indices.clear();
+				for (const MeshQuad& Quad : Quads)
+				{
+					ExpandQuad(Quad, WorldPosition, Vertices, Indices);
+				}
+
+				const uint32_t Side = 2 * d + (BackFace ? 1 : 0);
+				mMesh->ReplaceSlice(SliceIndex(Side, Layer), Vertices.data(), Indices.data(), Quads.Size());
+			}
+		}
+	}
+
+	BuildCollisionMesh();
+}
+
+void FChunk::MeshPatch::AddBlock(const Vector3i& LocalPosition)
+{
+	// The faces on both sides of the block along each axis
+	Layers[0] |= 3ull << LocalPosition.x;
+	Layers[1] |= 3ull << LocalPosition.y;
+	Layers[2] |= 3ull << LocalPosition.z;
+}
+
+uint32_t FChunk::MeshPatch::LayerCount() const
+{
+	uint32_t Count = 0;
+	for (uint64_t AxisLayers : Layers)
+	{
+		for (; AxisLayers != 0; AxisLayers &= AxisLayers - 1)
+		{
+			Count++;
+		}
+	}
+
+	return Count;
+}
+
+uint32_t FChunk::SliceIndex(const uint32_t Side, const uint32_t Layer)
+{
+	static_assert(FChunkMesh::MAX_SLICES == 6 * (CHUNK_SIZE + 1), "A mesh slice is needed for each side and layer of faces.");
+	ASSERT(Side < 6 && Layer <= CHUNK_SIZE);
+
+	return Side * (CHUNK_SIZE + 1) + Layer;
+}
+
+void FChunk::ExpandQuad(const MeshQuad& Quad, const Vector3f& WorldPosition, FChunkMesh::VertexData& VerticesOut, FChunkMesh::IndexData& IndicesOut)
+{
+	const uint32_t Geometry = Quad.Geometry;
+	const uint32_t Side = (Geometry >> QUAD_SIDE_SHIFT) & 0x7;
+
+	// Sides come in front and back pairs for each axis
+	const int32_t d = Side / 2;
+	const int32_t u = (d + 1) % 3;
+	const int32_t v = (d + 2) % 3;
+
+	float x[3], du[3] = { 0.0f, 0.0f, 0.0f }, dv[3] = { 0.0f, 0.0f, 0.0f };
+	x[d] = (float)(Geometry & 0x3F);
+	x[u] = (float)((Geometry >> QUAD_U_SHIFT) & 0x1F);
+	x[v] = (float)((Geometry >> QUAD_V_SHIFT) & 0x1F);
+	du[u] = (float)(((Geometry >> QUAD_WIDTH_SHIFT) & 0x1F) + 1);
+	dv[v] = (float)(((Geometry >> QUAD_HEIGHT_SHIFT) & 0x1F) + 1);
+
+	const Vector3f Corner{ x[0], x[1], x[2] };
+	const Vector3f Width{ du[0], du[1], du[2] };
+	const Vector3f Height{ dv[0], dv[1], dv[2] };
+	const Vector3f Origin = Corner + WorldPosition;
+
+	AddQuad(Origin, Origin + Width, Origin + Width + Height, Origin + Height, (Side & 1) != 0, Side, FBlock{ Quad.BlockType }, Quad.Occlusion, VerticesOut, IndicesOut);
+}
+
+void FChunk::BuildCollisionMesh()
+{
 	int32_t VertexCount = (int)mMesh->GetVertexCount(FChunkMesh::BackBuffer{});
 
 	if (VertexCount != 0)
@@ -208,181 +419,215 @@ void FChunk::RebuildMesh(const Vector3f& WorldPosition)
 
 void FChunk::SetBlock(const Vector3i& Position, FBlockTypes::BlockID ID)
 {
-	mBlocks[BlockIndex(Position)].ID = ID;
+	// The loader thread may unload the chunk at any time, blocks of unloaded chunks are left alone
+	if (mBlocks.SetBlock(BlockIndex(Position), FBlock{ ID }))
+		mIsModified = true;
 }
 
 FBlockTypes::BlockID FChunk::GetBlock(const Vector3i& Position) const
 {
-	return mBlocks[BlockIndex(Position)].ID;
+	// Unloaded chunks hold no blocks
+	FBlock Block{ FBlock::AIR_BLOCK_ID };
+	mBlocks.ReadBlock(BlockIndex(Position), Block);
+	return Block.ID;
 }
 
 FBlockTypes::BlockID FChunk::DestroyBlock(const Vector3i& Position)
 {
-	FBlockTypes::BlockID ID = mBlocks[BlockIndex(Position)].ID;
-	mBlocks[BlockIndex(Position)].ID = FBlock::AIR_BLOCK_ID;
-	return ID;
+	FBlock Destroyed{ FBlock::AIR_BLOCK_ID };
+	if (mBlocks.SetBlock(BlockIndex(Position), FBlock{ FBlock::AIR_BLOCK_ID }, &Destroyed))
+		mIsModified = true;
+
+	return Destroyed.ID;
 }
 
-void FChunk::GreedyMesh(const Vector3f WorldPosition)
+void FChunk::GreedyMesh(const FBlockLayout& Blocks, TScratchArray<MeshQuad>& QuadsOut)
 {
 	// Greedy mesh algorithm by Mikola Lysenko from http://0fps.net/2012/06/30/meshing-in-a-minecraft-game/
 	// Java implementation from https://github.com/roboleary/GreedyMesh/blob/master/src/mygame/Main.java
 
-	// Vertex and index data to be sent to the mesh
-	FChunkMesh::VertexDataPtr Vertices{ new FChunkMesh::VertexData{} };
-	FChunkMesh::IndexDataPtr Indices{ new FChunkMesh::IndexData{} };
-
-	// Variables to be used by the algorithm
-	int32_t i, j, k, Length, Width, Height, u, v, n, Side = 0;
-	int32_t x[3], q[3], du[3], dv[3];
-
-	// This mask will contain matching voxel faces as we
-	// loop through each direction in the chunk
-	FBlock Mask[CHUNK_SIZE * CHUNK_SIZE];
-
 	// Start with a for loop the will flip face direction once we iterate through
 	// the chunk in one direction.
 	for (bool BackFace = true, b = false; b != BackFace; BackFace = BackFace && b, b = !b)
 	{
-
 		// Iterate through each dimension of the chunk
 		for (int32_t d = 0; d < 3; d++)
 		{
-			// Get the other 2 axes
-			u = (d + 1) % 3;
-			v = (d + 2) % 3;
-
-			x[0] = 0;
-			x[1] = 0;
-			x[2] = 0;
-
-			// Used to check against covering voxels
-			q[0] = 0;
-			q[1] = 0;
-			q[2] = 0;
-			q[d] = 1;
-
-			if (d == 0)
-			{ 
-				Side = BackFace ? NormalID::West : NormalID::East;
+			// Move through the dimension from front to back
+			for (int32_t Layer = 0; Layer <= CHUNK_SIZE; Layer++)
+			{
+				MeshSlice(Blocks, d, Layer, BackFace, QuadsOut);
 			}
-			else if (d == 1) 
-			{ 
-				Side = BackFace ? NormalID::Bottom : NormalID::Top;
+		}
+	}
+}
+
+void FChunk::MeshSlice(const FBlockLayout& Blocks, const int32_t d, const int32_t Layer, const bool BackFace, TScratchArray<MeshQuad>& QuadsOut)
+{
+	// Variables to be used by the algorithm
+	int32_t i, j, k, Length, Width, Height, n;
+	int32_t x[3], q[3];
+
+	// This mask will contain matching voxel faces in the layer, the block type in the low
+	// byte and the corner occlusion in the high byte. Only faces with the same occlusion merge.
+	uint16_t Mask[CHUNK_SIZE * CHUNK_SIZE];
+
+	// Get the other 2 axes
+	const int32_t u = (d + 1) % 3;
+	const int32_t v = (d + 2) % 3;
+
+	x[0] = 0;
+	x[1] = 0;
+	x[2] = 0;
+
+	// Used to check against covering voxels
+	q[0] = 0;
+	q[1] = 0;
+	q[2] = 0;
+	q[d] = 1;
+
+	// Sides come in front and back pairs for each axis
+	static_assert(NormalID::East == 0 && NormalID::West == 1 && NormalID::Top == 2 && NormalID::Bottom == 3 &&
+		NormalID::North == 4 && NormalID::South == 5, "Sides are computed from the axis and face direction.");
+	const uint32_t Side = 2 * d + (BackFace ? 1 : 0);
+
+	// Faces are occluded by the blocks next to the one they point into
+	const int32_t AirLayer = (BackFace) ? Layer - 1 : Layer;
+	const bool HasOcclusion = AirLayer >= 0 && AirLayer < CHUNK_SIZE;
+	int32_t AirSide[3];
+
+	// Compute mask, comparing the blocks on both sides of the layer
+	x[d] = Layer - 1;
+	n = 0;
+
+	for (x[v] = 0; x[v] < CHUNK_SIZE; x[v]++)
+	{
+		for (x[u] = 0; x[u] < CHUNK_SIZE; x[u]++)
+		{
+			// Check covering voxel
+			FBlock Voxel1 = (x[d] >= 0) ? Blocks.GetBlock(BlockIndex(x[0], x[1], x[2])) : FBlock{ FBlock::AIR_BLOCK_ID };
+			FBlock Voxel2 = (x[d] < CHUNK_SIZE - 1) ? Blocks.GetBlock(BlockIndex(x[0] + q[0], x[1] + q[1], x[2] + q[2])) : FBlock{ FBlock::AIR_BLOCK_ID };
+
+			// If both voxels are active and the same type, mark the mask with an inactive block, if not
+			// choose the appropriate voxel to mark
+			const FBlock Face = (BackFace) ? Voxel2 : Voxel1;
+			if (Voxel1 == Voxel2 || Face.ID == FBlock::AIR_BLOCK_ID)
+			{
+				Mask[n++] = FBlock::AIR_BLOCK_ID;
+				continue;
 			}
-			else if (d == 2) 
-			{ 
-				Side = BackFace ? NormalID::South : NormalID::North;
+
+			uint8_t Occlusion = 0xFF;
+			if (HasOcclusion)
+			{
+				AirSide[d] = AirLayer;
+				AirSide[u] = x[u];
+				AirSide[v] = x[v];
+				Occlusion = FaceOcclusion(Blocks, AirSide, u, v);
 			}
 
-			// Move through the dimension from front to back
-			for (x[d] = -1; x[d] < CHUNK_SIZE;)
+			Mask[n++] = (uint16_t)Face.ID | ((uint16_t)Occlusion << 8);
+		}
+	}
+
+	x[d] = Layer;
+
+	// Generate the mesh for the mask
+	n = 0;
+
+	for (j = 0; j < CHUNK_SIZE; j++)
+	{
+		for (i = 0; i < CHUNK_SIZE;)
+		{
+			if (Mask[n] != FBlock::AIR_BLOCK_ID)
 			{
-				// Compute mask
-				n = 0;
+				// Compute the width
+				for (Width = 1; i + Width < CHUNK_SIZE && (Mask[n + Width] == Mask[n]); Width++){}
 
-				for (x[v] = 0; x[v] < CHUNK_SIZE; x[v]++)
+				// Compute Height
+				bool Done = false;
+
+				for (Height = 1; j + Height < CHUNK_SIZE; Height++)
 				{
-					for (x[u] = 0; x[u] < CHUNK_SIZE; x[u]++)
+					for (k = 0; k < Width; k++)
 					{
-						// Check covering voxel
-						FBlock Voxel1 = (x[d] >= 0) ? mBlocks[BlockIndex(x[0], x[1], x[2])] : FBlock{ FBlock::AIR_BLOCK_ID };
-						FBlock Voxel2 = (x[d] < CHUNK_SIZE - 1) ? mBlocks[BlockIndex(x[0] + q[0], x[1] + q[1], x[2] + q[2])] : FBlock{ FBlock::AIR_BLOCK_ID };
-
-						// If both voxels are active and the same type, mark the mask with an inactive block, if not
-						// choose the appropriate voxel to mark
-						if (Voxel1 == Voxel2)
-							Mask[n++] = FBlock{ FBlock::AIR_BLOCK_ID };
-						else
-							Mask[n++] = (BackFace) ? Voxel2 : Voxel1;
+						if (Mask[n + k + Height*CHUNK_SIZE] != Mask[n])
+						{
+							Done = true;
+							break;
+						}
 					}
+
+					if (Done) 
+						break;
 				}
 
-				x[d]++;
 
-				// Generate the mesh for the mask
-				n = 0;
+				// Add the quad
+				x[u] = i;
+				x[v] = j;
+
+				MeshQuad Quad;
+				Quad.Geometry = (uint32_t)x[d] | ((uint32_t)x[u] << QUAD_U_SHIFT) | ((uint32_t)x[v] << QUAD_V_SHIFT) |
+					((uint32_t)(Width - 1) << QUAD_WIDTH_SHIFT) | ((uint32_t)(Height - 1) << QUAD_HEIGHT_SHIFT) | (Side << QUAD_SIDE_SHIFT);
+				Quad.BlockType = (FBlockTypes::BlockID)(Mask[n] & 0xFF);
+				Quad.Occlusion = (uint8_t)(Mask[n] >> 8);
+				QuadsOut.Add(Quad);
 
-				for (j = 0; j < CHUNK_SIZE; j++)
+
+				// Zero the mask
+				for (Length = 0; Length < Height; Length++)
 				{
-					for (i = 0; i < CHUNK_SIZE;)
+					for (k = 0; k < Width; k++)
 					{
-						if (Mask[n].ID != FBlock::AIR_BLOCK_ID)
-						{
-							// Compute the width
-							for (Width = 1; i + Width < CHUNK_SIZE && (Mask[n + Width] == Mask[n]); Width++){}
-
-							// Compute Height
-							bool Done = false;
-
-							for (Height = 1; j + Height < CHUNK_SIZE; Height++)
-							{
-								for (k = 0; k < Width; k++)
-								{
-									if (Mask[n + k + Height*CHUNK_SIZE] != Mask[n])
-									{
-										Done = true;
-										break;
-									}
-								}
-
-								if (Done) 
-									break;
-							}
-
-
-							// Add the quad
-							x[u] = i;
-							x[v] = j;
-
-							du[0] = 0;
-							du[1] = 0;
-							du[2] = 0;
-							du[u] = Width;
-
-							dv[0] = 0;
-							dv[1] = 0;
-							dv[2] = 0;
-							dv[v] = Height;
-
-							const Vector3f Corners[4] = 
-							{
-								{ Vector3f{ x[0], x[1], x[2] } + WorldPosition },
-								{ Vector3f{ x[0] + du[0], x[1] + du[1], x[2] + du[2] } + WorldPosition },
-								{ Vector3f{ x[0] + du[0] + dv[0], x[1] + du[1] + dv[1], x[2] + du[2] + dv[2] } + WorldPosition },
-								{ Vector3f{ x[0] + dv[0], x[1] + dv[1], x[2] + dv[2] } + WorldPosition }
-							};
-
-							AddQuad(Corners[0], Corners[1], Corners[2], Corners[3], BackFace, Side, Mask[n], *Vertices, *Indices);
-
-
-							// Zero the mask
-							for (Length = 0; Length < Height; Length++)
-							{
-								for (k = 0; k < Width; k++)
-								{
-									Mask[n + k + Length * CHUNK_SIZE].ID = FBlock::AIR_BLOCK_ID;
-								}
-							}
-
-							// Increment counters
-							i += Width;
-							n += Width;
-						}
-						else
-						{
-							i++;
-							n++;
-						}
+						Mask[n + k + Length * CHUNK_SIZE] = FBlock::AIR_BLOCK_ID;
 					}
 				}
+
+				// Increment counters
+				i += Width;
+				n += Width;
+			}
+			else
+			{
+				i++;
+				n++;
 			}
 		}
 	}
+}
+
+uint8_t FChunk::FaceOcclusion(const FBlockLayout& Blocks, const int32_t AirSide[3], const int32_t u, const int32_t v)
+{
+	// Blocks outside of the chunk do not occlude, neighbor chunks are not available while meshing
+	auto IsSolid = [&](const int32_t du, const int32_t dv)
+	{
+		int32_t p[3] = { AirSide[0], AirSide[1], AirSide[2] };
+		p[u] += du;
+		p[v] += dv;
+
+		if (p[u] < 0 || p[u] >= CHUNK_SIZE || p[v] < 0 || p[v] >= CHUNK_SIZE)
+			return 0;
+
+		return (Blocks.GetBlock(BlockIndex(p[0], p[1], p[2])).ID != FBlock::AIR_BLOCK_ID) ? 1 : 0;
+	};
+
+	// Corners in the order of MeshQuad::Occlusion
+	static const int32_t CornerOffsets[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+
+	uint8_t Occlusion = 0;
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		const int32_t Side1 = IsSolid(CornerOffsets[c][0], 0);
+		const int32_t Side2 = IsSolid(0, CornerOffsets[c][1]);
+		const int32_t Corner = IsSolid(CornerOffsets[c][0], CornerOffsets[c][1]);
+
+		// A corner between two sides is fully occluded whatever the diagonal block is
+		const int32_t Value = (Side1 && Side2) ? 0 : 3 - (Side1 + Side2 + Corner);
+		Occlusion |= (uint8_t)(Value << (2 * c));
+	}
 
-	// Add data to mesh
-	mMesh->AddVertexData(std::move(Vertices));
-	mMesh->AddIndexData(std::move(Indices));
+	return Occlusion;
 }
 
 void FChunk::AddQuad(	const Vector3f& BottomLeft,
@@ -392,6 +637,7 @@ void FChunk::AddQuad(	const Vector3f& BottomLeft,
 						const bool IsBackface,
 						const uint32_t Side,
 						const FBlock FaceInfo,
+						const uint8_t Occlusion,
 						FChunkMesh::VertexData& VerticesOut,
 						FChunkMesh::IndexData& IndicesOut)
 {
@@ -404,28 +650,45 @@ void FChunk::AddQuad(	const Vector3f& BottomLeft,
 	BottomLeftData.Position = BottomLeft;
 	BottomLeftData.BlockType = FaceInfo.ID;
 	BottomLeftData.NormalID= Side;
+	BottomLeftData.Occlusion = Occlusion & 0x3;
 
 	FChunkMesh::Vertex BottomRightData;
 	BottomRightData.Position = BottomRight;
 	BottomRightData.BlockType = FaceInfo.ID;
 	BottomRightData.NormalID = Side;
+	BottomRightData.Occlusion = (Occlusion >> 6) & 0x3;
 
 	FChunkMesh::Vertex TopLeftData;
 	TopLeftData.Position = TopLeft;
 	TopLeftData.BlockType = FaceInfo.ID;
 	TopLeftData.NormalID = Side;
+	TopLeftData.Occlusion = (Occlusion >> 2) & 0x3;
 
 	FChunkMesh::Vertex TopRightData;
 	TopRightData.Position = TopRight;
 	TopRightData.BlockType = FaceInfo.ID;
 	TopRightData.NormalID = Side;
+	TopRightData.Occlusion = (Occlusion >> 4) & 0x3;
 
 	VerticesOut.insert(VerticesOut.end(), { BottomLeftData, BottomRightData, TopRightData, TopLeftData });
 	
 
 
+	// Split the quad along the diagonal between its less occluded corners, so occlusion
+	// of a single corner is not stretched over both triangles
+	const bool FlipDiagonal = (BottomLeftData.Occlusion + TopRightData.Occlusion) < (BottomRightData.Occlusion + TopLeftData.Occlusion);
+
 	// Add adjusted indices.
-	if (IsBackface)
+	if (IsBackface && FlipDiagonal)
+	{
+		IndicesOut.insert(IndicesOut.end(), {	1 + BaseIndex, 
+												2 + BaseIndex, 
+												3 + BaseIndex, 
+												3 + BaseIndex, 
+												0 + BaseIndex, 
+												1 + BaseIndex });
+	}
+	else if (IsBackface)
 	{
 		IndicesOut.insert(IndicesOut.end(), {	0 + BaseIndex, 
 												1 + BaseIndex, 
@@ -435,6 +698,15 @@ void FChunk::AddQuad(	const Vector3f& BottomLeft,
 												0 + BaseIndex });
 
 	}
+	else if (FlipDiagonal)
+	{
+		IndicesOut.insert(IndicesOut.end(), {	1 + BaseIndex, 
+												0 + BaseIndex, 
+												3 + BaseIndex, 
+												1 + BaseIndex, 
+												3 + BaseIndex, 
+												2 + BaseIndex });
+	}
 	else
 	{
 		IndicesOut.insert(IndicesOut.end(), {	0 + BaseIndex, 
@@ -0,0 +1,614 @@
+#include "ChunkSystems\ChunkCodec.h"
+#include "ChunkSystems\Chunk.h"
+#include "FileIO\RegionFile.h"
+#include "SystemResources\SystemFile.h"
+#include "Misc\Assertions.h"
+#include "Clock.h"
+
+#include <cstring>
+#include <wchar.h>
+#include <memory>
+#include <iostream>
+
+// SSE2 is part of every x64 target, AVX2 is only used when the compiler targets it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CHUNK_CODEC_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__) && defined(CHUNK_CODEC_SSE2)
+	#define CHUNK_CODEC_AVX2 1
+	#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+std::atomic<uint8_t> SChunkCodecs::mDefaultCodec(EChunkCodec::RLE);
+
+namespace
+{
+	static const int32_t CHUNK_SIZE = FChunk::CHUNK_SIZE;
+	static const uint32_t BLOCKS_PER_CHUNK = FChunk::BLOCKS_PER_CHUNK;
+
+	// Rows of blocks along the z axis are contiguous, ordered by y then x
+	static const uint32_t ROWS_PER_CHUNK = BLOCKS_PER_CHUNK / CHUNK_SIZE;
+	static_assert(sizeof(FBlock) == 1 && CHUNK_SIZE == 32, "Run length rows are 32 bytes.");
+
+	uint32_t CountTrailingZeros(const uint32_t Value)
+	{
+#ifdef _MSC_VER
+		unsigned long Index;
+		_BitScanForward(&Index, Value);
+		return (uint32_t)Index;
+#else
+		return (uint32_t)__builtin_ctz(Value);
+#endif
+	}
+
+	/**
+	* Finds where runs end in a row of blocks.
+	* @return Mask with a bit set for the last block of each run.
+	*/
+	uint32_t FindRunEnds(const uint8_t* Row)
+	{
+#ifdef CHUNK_CODEC_SSE2
+		// Compare each block with the next one, the last block of the
+		// row is compared to a shifted in 0 and always ends a run
+		const __m128i Low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row));
+		const __m128i LowNext = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row + 1));
+		const __m128i High = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row + 16));
+		const __m128i HighNext = _mm_srli_si128(High, 1);
+
+		const uint32_t LowEqual = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(Low, LowNext));
+		const uint32_t HighEqual = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(High, HighNext));
+		return ~(LowEqual | (HighEqual << 16)) | 0x80000000u;
+#else
+		uint32_t RunEnds = 0x80000000u;
+		for (int32_t z = 0; z < CHUNK_SIZE - 1; z++)
+		{
+			if (Row[z] != Row[z + 1])
+				RunEnds |= 1u << z;
+		}
+		return RunEnds;
+#endif
+	}
+
+	/**
+	* Fills a run of blocks within a row. Runs are written with full row width stores,
+	* bytes past the run are overwritten by the runs that follow it. Only runs near the
+	* end of the chunk are written exactly.
+	*/
+	void FillRun(uint8_t* Destination, const uint8_t BlockType, const uint32_t RunLength, const uint8_t* End)
+	{
+#ifdef CHUNK_CODEC_SSE2
+		if (Destination + CHUNK_SIZE <= End)
+		{
+#ifdef CHUNK_CODEC_AVX2
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(Destination), _mm256_set1_epi8((char)BlockType));
+#else
+			const __m128i Fill = _mm_set1_epi8((char)BlockType);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Destination), Fill);
+			if (RunLength > 16)
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(Destination + 16), Fill);
+#endif
+			return;
+		}
+#endif
+		std::memset(Destination, BlockType, RunLength);
+	}
+
+	/**
+	* Block type and run length pairs for each row of blocks along the z axis,
+	* ordered by y then x. This is the original chunk format.
+	*/
+	class FRLECodec : public IChunkCodec
+	{
+	public:
+		uint32_t Encode(const FBlock* Blocks, uint8_t* DataOut) const override
+		{
+			uint32_t DataSize = 0;
+			const uint8_t* Row = reinterpret_cast<const uint8_t*>(Blocks);
+
+			for (uint32_t RowIndex = 0; RowIndex < ROWS_PER_CHUNK; RowIndex++, Row += CHUNK_SIZE)
+			{
+				uint32_t RunEnds = FindRunEnds(Row);
+				uint32_t RunStart = 0;
+
+				while (RunEnds != 0)
+				{
+					const uint32_t RunEnd = CountTrailingZeros(RunEnds);
+					DataOut[DataSize++] = Row[RunStart];
+					DataOut[DataSize++] = (uint8_t)(RunEnd - RunStart + 1);
+
+					RunStart = RunEnd + 1;
+					RunEnds &= RunEnds - 1;
+				}
+			}
+
+			return DataSize;
+		}
+
+		bool Decode(const uint8_t* Data, const uint32_t DataSize, FBlock* BlocksOut) const override
+		{
+			uint32_t TypeIndex = 0;
+			uint8_t* Row = reinterpret_cast<uint8_t*>(BlocksOut);
+			const uint8_t* End = Row + BLOCKS_PER_CHUNK;
+
+			for (uint32_t RowIndex = 0; RowIndex < ROWS_PER_CHUNK; RowIndex++, Row += CHUNK_SIZE)
+			{
+				for (uint32_t z = 0; z < CHUNK_SIZE;)
+				{
+					if (TypeIndex + 2 > DataSize)
+						return false;
+
+					const uint8_t BlockType = Data[TypeIndex];
+					const uint8_t RunLength = Data[TypeIndex + 1];
+					TypeIndex += 2;
+
+					if (RunLength == 0 || z + RunLength > CHUNK_SIZE)
+						return false;
+
+					FillRun(Row + z, BlockType, RunLength, End);
+					z += RunLength;
+				}
+			}
+
+			return TypeIndex == DataSize;
+		}
+
+		const wchar_t* GetName() const override
+		{
+			return L"RLE";
+		}
+	};
+
+	/**
+	* Byte oriented LZ77 of the raw block array.
+	* The stream is a list of sequences, each starting with a token byte. The high nibble
+	* of the token is the literal count and the low nibble is the match length - MIN_MATCH.
+	* A nibble of 15 is followed by extra length bytes, added until a byte that isn't 255.
+	* Literals follow the token, then a 2 byte match offset. The last sequence only has literals.
+	*/
+	class FLZCodec : public IChunkCodec
+	{
+		static const uint32_t MIN_MATCH = 4;
+		static const uint32_t HASH_BITS = 12;
+		static const uint32_t MAX_OFFSET = 0xFFFF;
+
+		static uint32_t Read32(const uint8_t* Data)
+		{
+			uint32_t Value;
+			std::memcpy(&Value, Data, sizeof(Value));
+			return Value;
+		}
+
+		static uint32_t Hash(const uint32_t Sequence)
+		{
+			return (Sequence * 2654435761u) >> (32 - HASH_BITS);
+		}
+
+		static uint8_t* WriteLength(uint8_t* Out, uint32_t Length)
+		{
+			for (; Length >= 255; Length -= 255)
+				*Out++ = 255;
+			*Out++ = (uint8_t)Length;
+			return Out;
+		}
+
+		static bool ReadLength(const uint8_t*& In, const uint8_t* InEnd, uint32_t& Length)
+		{
+			uint8_t Byte;
+			do
+			{
+				if (In >= InEnd)
+					return false;
+				Byte = *In++;
+				Length += Byte;
+			} while (Byte == 255);
+
+			return true;
+		}
+
+		static uint8_t* WriteSequence(uint8_t* Out, const uint8_t* Literals, const uint32_t LiteralCount, const uint32_t Offset, const uint32_t MatchLength)
+		{
+			uint8_t* Token = Out++;
+			*Token = 0;
+
+			if (LiteralCount >= 15)
+			{
+				*Token = 15 << 4;
+				Out = WriteLength(Out, LiteralCount - 15);
+			}
+			else
+			{
+				*Token = (uint8_t)(LiteralCount << 4);
+			}
+
+			std::memcpy(Out, Literals, LiteralCount);
+			Out += LiteralCount;
+
+			// Final sequence has no match
+			if (MatchLength == 0)
+				return Out;
+
+			*Out++ = (uint8_t)(Offset & 0xFF);
+			*Out++ = (uint8_t)(Offset >> 8);
+
+			const uint32_t EncodedMatch = MatchLength - MIN_MATCH;
+			if (EncodedMatch >= 15)
+			{
+				*Token |= 15;
+				Out = WriteLength(Out, EncodedMatch - 15);
+			}
+			else
+			{
+				*Token |= (uint8_t)EncodedMatch;
+			}
+
+			return Out;
+		}
+
+	public:
+		uint32_t Encode(const FBlock* Blocks, uint8_t* DataOut) const override
+		{
+			const uint8_t* In = reinterpret_cast<const uint8_t*>(Blocks);
+			uint8_t* Out = DataOut;
+
+			// Positions are stored + 1 so 0 means an empty slot
+			uint32_t HashTable[1 << HASH_BITS];
+			std::memset(HashTable, 0, sizeof(HashTable));
+
+			uint32_t Anchor = 0;
+			uint32_t Position = 0;
+			while (Position + MIN_MATCH <= BLOCKS_PER_CHUNK)
+			{
+				const uint32_t Sequence = Read32(In + Position);
+				uint32_t& Slot = HashTable[Hash(Sequence)];
+				const uint32_t Candidate = Slot;
+				Slot = Position + 1;
+
+				if (Candidate == 0 || Position - (Candidate - 1) > MAX_OFFSET || Read32(In + Candidate - 1) != Sequence)
+				{
+					Position++;
+					continue;
+				}
+
+				const uint32_t MatchStart = Candidate - 1;
+				uint32_t MatchLength = MIN_MATCH;
+				while (Position + MatchLength < BLOCKS_PER_CHUNK && In[MatchStart + MatchLength] == In[Position + MatchLength])
+				{
+					MatchLength++;
+				}
+
+				Out = WriteSequence(Out, In + Anchor, Position - Anchor, Position - MatchStart, MatchLength);
+				Position += MatchLength;
+				Anchor = Position;
+			}
+
+			Out = WriteSequence(Out, In + Anchor, BLOCKS_PER_CHUNK - Anchor, 0, 0);
+			return (uint32_t)(Out - DataOut);
+		}
+
+		bool Decode(const uint8_t* Data, const uint32_t DataSize, FBlock* BlocksOut) const override
+		{
+			const uint8_t* In = Data;
+			const uint8_t* InEnd = Data + DataSize;
+			uint8_t* Out = reinterpret_cast<uint8_t*>(BlocksOut);
+			uint8_t* const OutStart = Out;
+			uint8_t* const OutEnd = Out + BLOCKS_PER_CHUNK;
+
+			while (In < InEnd)
+			{
+				const uint8_t Token = *In++;
+
+				uint32_t LiteralCount = Token >> 4;
+				if (LiteralCount == 15 && !ReadLength(In, InEnd, LiteralCount))
+					return false;
+
+				if (LiteralCount > (uint32_t)(InEnd - In) || LiteralCount > (uint32_t)(OutEnd - Out))
+					return false;
+
+				std::memcpy(Out, In, LiteralCount);
+				In += LiteralCount;
+				Out += LiteralCount;
+
+				// Final sequence
+				if (In == InEnd)
+					break;
+
+				if (InEnd - In < 2)
+					return false;
+
+				const uint32_t Offset = In[0] | (In[1] << 8);
+				In += 2;
+
+				uint32_t MatchLength = Token & 15;
+				if (MatchLength == 15 && !ReadLength(In, InEnd, MatchLength))
+					return false;
+				MatchLength += MIN_MATCH;
+
+				if (Offset == 0 || Offset > (uint32_t)(Out - OutStart) || MatchLength > (uint32_t)(OutEnd - Out))
+					return false;
+
+				// Matches may overlap the output, runs of a single block are offset 1
+				const uint8_t* Match = Out - Offset;
+				if (Offset >= MatchLength)
+				{
+					std::memcpy(Out, Match, MatchLength);
+				}
+				else if (Offset == 1)
+				{
+					std::memset(Out, *Match, MatchLength);
+				}
+				else
+				{
+					for (uint32_t i = 0; i < MatchLength; i++)
+						Out[i] = Match[i];
+				}
+
+				Out += MatchLength;
+			}
+
+			return Out == OutEnd;
+		}
+
+		const wchar_t* GetName() const override
+		{
+			return L"LZ";
+		}
+	};
+
+	/**
+	* A palette of the block types within the chunk followed by the palette index of each
+	* block, packed with the fewest bits that can address the palette. The first byte is the
+	* palette size - 1. Chunks of a single block type are stored with only the palette.
+	*/
+	class FPaletteCodec : public IChunkCodec
+	{
+		static uint32_t BitsForPaletteSize(const uint32_t PaletteSize)
+		{
+			uint32_t Bits = 0;
+			while ((1u << Bits) < PaletteSize)
+				Bits++;
+			return Bits;
+		}
+
+	public:
+		uint32_t Encode(const FBlock* Blocks, uint8_t* DataOut) const override
+		{
+			const uint8_t* In = reinterpret_cast<const uint8_t*>(Blocks);
+
+			// Build the palette in order of first appearance
+			uint8_t PaletteIndex[256];
+			bool InPalette[256] = {};
+			uint32_t PaletteSize = 0;
+			uint8_t* Palette = DataOut + 1;
+
+			for (uint32_t i = 0; i < BLOCKS_PER_CHUNK; i++)
+			{
+				const uint8_t ID = In[i];
+				if (!InPalette[ID])
+				{
+					InPalette[ID] = true;
+					PaletteIndex[ID] = (uint8_t)PaletteSize;
+					Palette[PaletteSize++] = ID;
+				}
+			}
+
+			DataOut[0] = (uint8_t)(PaletteSize - 1);
+			uint8_t* Out = Palette + PaletteSize;
+
+			const uint32_t Bits = BitsForPaletteSize(PaletteSize);
+			if (Bits == 0)
+				return (uint32_t)(Out - DataOut);
+
+			// Pack indices little endian, least significant bits first
+			uint64_t BitBuffer = 0;
+			uint32_t BitCount = 0;
+			for (uint32_t i = 0; i < BLOCKS_PER_CHUNK; i++)
+			{
+				BitBuffer |= (uint64_t)PaletteIndex[In[i]] << BitCount;
+				BitCount += Bits;
+
+				while (BitCount >= 8)
+				{
+					*Out++ = (uint8_t)BitBuffer;
+					BitBuffer >>= 8;
+					BitCount -= 8;
+				}
+			}
+
+			if (BitCount > 0)
+				*Out++ = (uint8_t)BitBuffer;
+
+			return (uint32_t)(Out - DataOut);
+		}
+
+		bool Decode(const uint8_t* Data, const uint32_t DataSize, FBlock* BlocksOut) const override
+		{
+			if (DataSize == 0)
+				return false;
+
+			const uint32_t PaletteSize = (uint32_t)Data[0] + 1;
+			const uint8_t* Palette = Data + 1;
+			const uint32_t Bits = BitsForPaletteSize(PaletteSize);
+			const uint32_t PackedSize = (BLOCKS_PER_CHUNK * Bits + 7) / 8;
+
+			if (DataSize != 1 + PaletteSize + PackedSize)
+				return false;
+
+			uint8_t* Out = reinterpret_cast<uint8_t*>(BlocksOut);
+			if (Bits == 0)
+			{
+				std::memset(Out, Palette[0], BLOCKS_PER_CHUNK);
+				return true;
+			}
+
+			const uint8_t* In = Palette + PaletteSize;
+			const uint32_t Mask = (1u << Bits) - 1;
+			uint64_t BitBuffer = 0;
+			uint32_t BitCount = 0;
+
+			for (uint32_t i = 0; i < BLOCKS_PER_CHUNK; i++)
+			{
+				while (BitCount < Bits)
+				{
+					BitBuffer |= (uint64_t)(*In++) << BitCount;
+					BitCount += 8;
+				}
+
+				const uint32_t Index = (uint32_t)BitBuffer & Mask;
+				BitBuffer >>= Bits;
+				BitCount -= Bits;
+
+				if (Index >= PaletteSize)
+					return false;
+
+				Out[i] = Palette[Index];
+			}
+
+			return true;
+		}
+
+		const wchar_t* GetName() const override
+		{
+			return L"Palette";
+		}
+	};
+
+	const FRLECodec     RLECodec;
+	const FLZCodec      LZCodec;
+	const FPaletteCodec PaletteCodec;
+
+	const IChunkCodec* const Codecs[EChunkCodec::Count] =
+	{
+		&RLECodec,
+		&LZCodec,
+		&PaletteCodec
+	};
+}
+
+const IChunkCodec* SChunkCodecs::Get(const uint8_t CodecID)
+{
+	if (CodecID >= EChunkCodec::Count)
+		return nullptr;
+
+	return Codecs[CodecID];
+}
+
+EChunkCodec::Type SChunkCodecs::Find(const wchar_t* Name)
+{
+	for (uint8_t i = 0; i < EChunkCodec::Count; i++)
+	{
+		if (wcscmp(Codecs[i]->GetName(), Name) == 0)
+			return (EChunkCodec::Type)i;
+	}
+
+	return EChunkCodec::Count;
+}
+
+EChunkCodec::Type SChunkCodecs::GetDefault()
+{
+	return (EChunkCodec::Type)mDefaultCodec.load(std::memory_order_relaxed);
+}
+
+void SChunkCodecs::SetDefault(const EChunkCodec::Type Codec)
+{
+	ASSERT(Codec < EChunkCodec::Count);
+	mDefaultCodec.store(Codec, std::memory_order_relaxed);
+}
+
+bool SChunkCodecs::ReencodeWorld(const wchar_t* WorldName, const EChunkCodec::Type Codec, FReencodeReport* ReportOut)
+{
+	ASSERT(Codec < EChunkCodec::Count);
+
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	std::wstring WorldPath{ L"./Worlds/" };
+	WorldPath += WorldName;
+
+	// Get the world size in chunks
+	int32_t WorldSize = 0;
+	auto WorldInfoFile = FileSystem.OpenReadable((WorldPath + L"/WorldInfo.vgw").c_str());
+	if (!WorldInfoFile || !WorldInfoFile->Read((uint8_t*)&WorldSize, 4))
+		return false;
+
+	FReencodeReport Report = {};
+	const IChunkCodec* NewCodec = Get(Codec);
+	std::unique_ptr<FBlock[]> Blocks{ new FBlock[BLOCKS_PER_CHUNK] };
+	std::unique_ptr<FBlock[]> Verify{ new FBlock[BLOCKS_PER_CHUNK] };
+	std::unique_ptr<uint8_t[]> Data{ new uint8_t[FChunk::MAX_ENCODED_SIZE] };
+	std::unique_ptr<uint8_t[]> Encoded{ new uint8_t[FChunk::MAX_ENCODED_SIZE] };
+
+	const int32_t RegionSize = (int32_t)FRegionFile::RegionData::REGION_SIZE;
+	const int32_t NumRegions = (WorldSize / RegionSize) + 1;
+
+	for (int32_t ry = 0; ry < NumRegions; ry++)
+	{
+		for (int32_t rx = 0; rx < NumRegions; rx++)
+		{
+			for (int32_t rz = 0; rz < NumRegions; rz++)
+			{
+				// Don't create regions that were never generated
+				wchar_t RegionName[64];
+				swprintf(RegionName, 64, L"/x%dy%dz%d.vgr", rx, ry, rz);
+				if (!FileSystem.FileExists((WorldPath + RegionName).c_str()))
+					continue;
+
+				FRegionFile Region;
+				if (!Region.Load(WorldName, Vector3i{ rx, ry, rz }))
+					continue;
+
+				for (int32_t y = 0; y < RegionSize; y++)
+				{
+					for (int32_t x = 0; x < RegionSize; x++)
+					{
+						for (int32_t z = 0; z < RegionSize; z++)
+						{
+							const Vector3i ChunkPosition{ x, y, z };
+							uint32_t DataSize = 0, SectorOffset = 0;
+							uint8_t OldCodecID = 0;
+
+							Region.GetChunkDataInfo(ChunkPosition, DataSize, SectorOffset, OldCodecID);
+							const IChunkCodec* OldCodec = Get(OldCodecID);
+							if (DataSize == 0 || DataSize > FChunk::MAX_ENCODED_SIZE || !OldCodec)
+								continue;
+
+							Region.GetChunkData(SectorOffset, Data.get(), DataSize);
+							if (!OldCodec->Decode(Data.get(), DataSize, Blocks.get()))
+							{
+								std::wcerr << L"Corrupt chunk data in region " << RegionName << std::endl;
+								continue;
+							}
+
+							const uint32_t EncodedSize = NewCodec->Encode(Blocks.get(), Encoded.get());
+							Region.WriteChunkData(ChunkPosition, Encoded.get(), EncodedSize, Codec);
+
+							// Time a load of the new encoding, from file and decode only
+							uint64_t StartTime = FClock::ReadSystemTimer();
+							Region.GetChunkDataInfo(ChunkPosition, DataSize, SectorOffset, OldCodecID);
+							Region.GetChunkData(SectorOffset, Data.get(), DataSize);
+							const uint64_t DecodeStartTime = FClock::ReadSystemTimer();
+							NewCodec->Decode(Data.get(), DataSize, Verify.get());
+							const uint64_t EndTime = FClock::ReadSystemTimer();
+
+							ASSERT(std::memcmp(Blocks.get(), Verify.get(), BLOCKS_PER_CHUNK) == 0);
+
+							Report.ChunkCount++;
+							Report.RawBytes += BLOCKS_PER_CHUNK;
+							Report.EncodedBytes += EncodedSize;
+							Report.DecodeSeconds += FClock::CyclesToSeconds(EndTime - DecodeStartTime);
+							Report.LoadSeconds += FClock::CyclesToSeconds(EndTime - StartTime);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (ReportOut)
+		*ReportOut = Report;
+
+	return true;
+}
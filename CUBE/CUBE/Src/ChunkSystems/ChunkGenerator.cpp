@@ -0,0 +1,224 @@
+#include "ChunkSystems\ChunkGenerator.h"
+#include "ChunkSystems\Chunk.h"
+#include "Misc\Assertions.h"
+
+#include <algorithm>
+#include <cstring>
+
+static_assert(FChunk::CHUNK_SIZE == 32, "Column height arrays assume 32 block chunks.");
+
+namespace
+{
+	// Fixed point scale of noise values and interpolation factors
+	const int64_t FIXED_ONE = 65536;
+
+	/**
+	* Hashes a noise lattice point. Only integer math is used so results
+	* don't depend on the compiler or floating point settings.
+	*/
+	int64_t LatticeValue(const int32_t X, const int32_t Z, const uint32_t Seed)
+	{
+		uint32_t Hash = Seed ^ ((uint32_t)X * 0x27D4EB2Du);
+		Hash = (Hash ^ (Hash >> 15)) * 0x85EBCA6Bu;
+		Hash ^= (uint32_t)Z * 0x165667B1u;
+		Hash = (Hash ^ (Hash >> 13)) * 0xC2B2AE35u;
+		Hash ^= Hash >> 16;
+		return (int64_t)(Hash & 0xFFFF);
+	}
+
+	/**
+	* Smoothstep of a fixed point fraction.
+	*/
+	int64_t Fade(const int64_t T)
+	{
+		return (T * T * (3 * FIXED_ONE - 2 * T)) / (FIXED_ONE * FIXED_ONE);
+	}
+
+	int64_t Lerp(const int64_t A, const int64_t B, const int64_t T)
+	{
+		return A + ((B - A) * T) / FIXED_ONE;
+	}
+
+	/**
+	* Divides rounding towards negative infinity, so lattice cells are the same size on both sides of 0.
+	*/
+	int32_t FloorDivide(const int32_t Value, const int32_t Divisor)
+	{
+		return (Value >= 0) ? (Value / Divisor) : -((-Value + Divisor - 1) / Divisor);
+	}
+}
+
+FChunkGenerator::FChunkGenerator(const uint32_t Seed)
+	: mTerrainLevels()
+	, mHeightCache(new FColumn[HEIGHT_CACHE_SIZE])
+	, mSeed(Seed)
+	, mMinHeight(0)
+	, mMaxHeight(1)
+	, mFeatureSize(256)
+	, mOctaveCount(5)
+{
+	InvalidateCache();
+}
+
+void FChunkGenerator::SetSeed(const uint32_t Seed)
+{
+	mSeed = Seed;
+	InvalidateCache();
+}
+
+void FChunkGenerator::SetMinHeight(const int32_t MinHeight)
+{
+	mMinHeight = MinHeight;
+	InvalidateCache();
+}
+
+void FChunkGenerator::SetMaxHeight(const int32_t MaxHeight)
+{
+	ASSERT(MaxHeight <= INT16_MAX && "Heights are cached as 16 bit values.");
+	mMaxHeight = MaxHeight;
+	InvalidateCache();
+}
+
+void FChunkGenerator::SetFeatureSize(const int32_t FeatureSize)
+{
+	ASSERT(FeatureSize > 0 && ((FeatureSize - 1) & FeatureSize) == 0 && "Feature size must be a power of 2");
+	mFeatureSize = FeatureSize;
+	InvalidateCache();
+}
+
+void FChunkGenerator::SetOctaveCount(const uint32_t OctaveCount)
+{
+	mOctaveCount = std::min(std::max(OctaveCount, 1u), MAX_OCTAVE_COUNT);
+	InvalidateCache();
+}
+
+void FChunkGenerator::AddTerrainLevel(const int32_t StartingHeight, const FBlockTypes::BlockID ID)
+{
+	// Keep levels sorted in reverse order to be used in generation
+	auto Position = std::find_if(mTerrainLevels.begin(), mTerrainLevels.end(), [StartingHeight](const TerrainLevelRecord& Val)
+	{
+		return Val.StartingHeight < StartingHeight;
+	});
+
+	mTerrainLevels.insert(Position, TerrainLevelRecord{ StartingHeight, ID });
+}
+
+int32_t FChunkGenerator::GetHeight(const int32_t WorldX, const int32_t WorldZ) const
+{
+	int64_t Sum = 0;
+	int64_t TotalAmplitude = 0;
+
+	for (uint32_t Octave = 0; Octave < mOctaveCount; Octave++)
+	{
+		const int32_t CellSize = std::max(mFeatureSize >> Octave, 1);
+		const int64_t Amplitude = (int64_t)1 << (mOctaveCount - 1 - Octave);
+		const uint32_t OctaveSeed = mSeed + Octave * 0x9E3779B9u;
+
+		// Lattice cell and position within it
+		const int32_t CellX = FloorDivide(WorldX, CellSize);
+		const int32_t CellZ = FloorDivide(WorldZ, CellSize);
+		const int64_t Tx = Fade(((int64_t)(WorldX - CellX * CellSize) * FIXED_ONE) / CellSize);
+		const int64_t Tz = Fade(((int64_t)(WorldZ - CellZ * CellSize) * FIXED_ONE) / CellSize);
+
+		const int64_t Near = Lerp(LatticeValue(CellX, CellZ, OctaveSeed), LatticeValue(CellX + 1, CellZ, OctaveSeed), Tx);
+		const int64_t Far = Lerp(LatticeValue(CellX, CellZ + 1, OctaveSeed), LatticeValue(CellX + 1, CellZ + 1, OctaveSeed), Tx);
+
+		Sum += Lerp(Near, Far, Tz) * Amplitude;
+		TotalAmplitude += Amplitude;
+	}
+
+	// Map the noise to the height range
+	return mMinHeight + (int32_t)((Sum * (mMaxHeight - mMinHeight)) / (TotalAmplitude * 0xFFFF));
+}
+
+bool FChunkGenerator::Generate(const Vector3i& ChunkPosition, FBlock* BlocksOut)
+{
+	static const int32_t SLAB_SIZE = FChunk::CHUNK_SIZE * FChunk::CHUNK_SIZE;
+
+	const FColumn& Column = GetColumn(ChunkPosition.x, ChunkPosition.z);
+	const int32_t BaseY = ChunkPosition.y * FChunk::CHUNK_SIZE;
+
+	// Chunks above the terrain are empty
+	if (BaseY > Column.MaxHeight)
+	{
+		std::memset(BlocksOut, FBlock::AIR_BLOCK_ID, FChunk::BLOCKS_PER_CHUNK * sizeof(FBlock));
+		return true;
+	}
+
+	bool IsEmpty = true;
+	for (int32_t y = 0; y < FChunk::CHUNK_SIZE; y++)
+	{
+		const int32_t WorldY = BaseY + y;
+		FBlock* Slab = BlocksOut + y * SLAB_SIZE;
+
+		// Find the terrain at this level
+		auto TerrainLevel = std::find_if(mTerrainLevels.begin(), mTerrainLevels.end(), [WorldY](const TerrainLevelRecord& Val)
+		{
+			return Val.StartingHeight <= WorldY;
+		});
+
+		const FBlockTypes::BlockID BlockType = (TerrainLevel != mTerrainLevels.end()) ? TerrainLevel->ID : FBlock::AIR_BLOCK_ID;
+
+		if (BlockType == FBlock::AIR_BLOCK_ID || WorldY > Column.MaxHeight)
+		{
+			std::memset(Slab, FBlock::AIR_BLOCK_ID, SLAB_SIZE * sizeof(FBlock));
+			continue;
+		}
+
+		IsEmpty = false;
+
+		if (WorldY <= Column.MinHeight)
+		{
+			// Entire slab is below the terrain
+			std::memset(Slab, BlockType, SLAB_SIZE * sizeof(FBlock));
+		}
+		else
+		{
+			for (int32_t i = 0; i < SLAB_SIZE; i++)
+			{
+				Slab[i].ID = (Column.Heights[i] >= WorldY) ? BlockType : FBlock::AIR_BLOCK_ID;
+			}
+		}
+	}
+
+	return IsEmpty;
+}
+
+const FChunkGenerator::FColumn& FChunkGenerator::GetColumn(const int32_t ChunkX, const int32_t ChunkZ)
+{
+	const uint32_t Slot = ((uint32_t)ChunkX * 73856093u ^ (uint32_t)ChunkZ * 83492791u) % HEIGHT_CACHE_SIZE;
+	FColumn& Column = mHeightCache[Slot];
+
+	if (Column.IsValid && Column.ChunkX == ChunkX && Column.ChunkZ == ChunkZ)
+		return Column;
+
+	Column.ChunkX = ChunkX;
+	Column.ChunkZ = ChunkZ;
+	Column.MinHeight = INT32_MAX;
+	Column.MaxHeight = INT32_MIN;
+	Column.IsValid = true;
+
+	const int32_t WorldX = ChunkX * FChunk::CHUNK_SIZE;
+	const int32_t WorldZ = ChunkZ * FChunk::CHUNK_SIZE;
+
+	for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
+	{
+		for (int32_t z = 0; z < FChunk::CHUNK_SIZE; z++)
+		{
+			const int32_t Height = GetHeight(WorldX + x, WorldZ + z);
+			Column.Heights[x * FChunk::CHUNK_SIZE + z] = (int16_t)Height;
+			Column.MinHeight = std::min(Column.MinHeight, Height);
+			Column.MaxHeight = std::max(Column.MaxHeight, Height);
+		}
+	}
+
+	return Column;
+}
+
+void FChunkGenerator::InvalidateCache()
+{
+	for (uint32_t i = 0; i < HEIGHT_CACHE_SIZE; i++)
+	{
+		mHeightCache[i].IsValid = false;
+	}
+}
@@ -1,4 +1,5 @@
 #include "ChunkSystems\ChunkManager.h"
+#include "ChunkSystems\ChunkGenerator.h"
 #include "Input\ButtonEvent.h"
 #include "Debugging\ConsoleOutput.h"
 #include "Rendering\GLUtils.h"
@@ -8,47 +9,153 @@
 #include "Rendering\RenderSystem.h"
 #include "SFML\Window\Context.hpp"
 #include "STime.h"
+#include "Clock.h"
 #include "GL\glew.h"
 #include <algorithm>
 
 static const uint32_t DEFAULT_VIEW_DISTANCE = 14;
 static const uint32_t MESH_SWAPS_PER_FRAME = 25;
-static const int32_t CHUNKS_TO_LOAD_PER_ITERATION = 8;
+static const uint32_t CHUNKS_TO_LOAD_PER_BATCH = 32;
+static const uint32_t LOAD_BATCH_BYTES = 1024 * 1024;   // Scratch memory for chunk data of a batch
+
+// Chunks with more changed layers of faces than this are rebuilt whole
+static const uint32_t MAX_PATCH_LAYERS = 24;
+
+// Stale meshes of chunks that keep changing are swapped in anyway after this many seconds
+static const float STALE_MESH_TIMEOUT = 0.25f;
+
+// Squared camera distances to chunks, in chunks, are sorted as 16 bit integers of this scale
+static const float RENDER_DISTANCE_KEY_SCALE = 16.0f;
+
+// Offsets to the 6 neighbors of a chunk
+static const Vector3i NEIGHBOR_OFFSETS[] = { Vector3i{ 1, 0, 0 }, Vector3i{ -1, 0, 0 }, Vector3i{ 0, 1, 0 }, Vector3i{ 0, -1, 0 }, Vector3i{ 0, 0, 1 }, Vector3i{ 0, 0, -1 } };
 
 // Height is half width
 static const uint32_t DEFAULT_CHUNK_SIZE = (2 * DEFAULT_VIEW_DISTANCE + 1) * (DEFAULT_VIEW_DISTANCE + 1) * (2 * DEFAULT_VIEW_DISTANCE + 1);
 
+// Key of slots without a chunk
+static const uint64_t UNUSED_SLOT_KEY = UINT64_MAX;
+
+/**
+* Packs a chunk position into the key of the slot it is assigned to.
+*/
+static uint64_t SlotKey(const Vector3i& ChunkPosition)
+{
+	return ((uint64_t)(ChunkPosition.x & 0x1FFFFF) << 42) | ((uint64_t)(ChunkPosition.y & 0x1FFFFF) << 21) | (uint64_t)(ChunkPosition.z & 0x1FFFFF);
+}
+
+/**
+* Summarizes the block layout of a loaded chunk.
+*/
+static FChunkSummary SummarizeChunk(const FChunk& Chunk)
+{
+	const FBlockSnapshot Blocks = Chunk.Snapshot();
+
+	FChunkSummary Summary;
+	Summary.Height = (uint8_t)Blocks.GetHeight();
+	Summary.Padding = 0;
+
+	if (Blocks.IsUniform(Summary.Block))
+	{
+		Summary.Type = (Summary.Block == FBlock::AIR_BLOCK_ID) ? EChunkSummary::Air : EChunkSummary::Solid;
+	}
+	else
+	{
+		Summary.Type = EChunkSummary::Mixed;
+		Summary.Block = FBlock::AIR_BLOCK_ID;
+	}
+
+	return Summary;
+}
+
 FChunkManager::FChunkManager()
-	: mFileSystem()
+	: mChunkAllocators()
+	, mFileSystem()
+	, mSummaryCache(mFileSystem.GetTempDirectoryName())
+	, mWriteQueue(mFileSystem, mSummaryCache)
+	, mPayloadCache(mWriteQueue)
+	, mMeshCache(mFileSystem.GetTempDirectoryName())
 	, mChunks(nullptr)
 	, mChunkPositions()
 	, mRenderList()
+	, mRenderEntries()
+	, mRenderSortScratch()
 	, mLoadList()
 	, mRebuildList()
+	, mPatchList()
 	, mBufferSwapQueue()
 	, mLoaderThread()
 	, mRebuildListMutex()
 	, mBufferSwapMutex()
 	, mNeedsToRefreshVisibleList()
 	, mMustShutdown()
-	, mLastCameraChunk()
+	, mChunkGenerator(nullptr)
+	, mPersistGeneratedChunks()
+	, mUseAsyncReads()
+	, mSkippedMeshes()
+	, mUseMeshCache()
+	, mVisibleStartTime(0)
+	, mWorldVisibleSeconds()
+	, mViewpoints()
+	, mViewpointMutex()
+	, mSlotMap()
+	, mVisibleSlots()
+	, mSlotKeys(nullptr)
+	, mSlotContents()
+	, mEvictableSlots()
+	, mDesiredChunks()
+	, mDesiredOrder()
+	, mSlotCount(DEFAULT_CHUNK_SIZE)
+	, mResidentChunkLimit(0)
+	, mRequestedCount()
+	, mDesiredCount()
+	, mLoadCount()
+	, mEvictionCount()
+	, mUseMeshPatching()
+	, mPatchCount()
+	, mRebuildCount()
+	, mEditTimes()
+	, mVisibleEditCount(0)
+	, mEditLatencyCycles(0)
+	, mMaxEditLatencyCycles(0)
+	, mStaleSwapCount(0)
+	, mIsRenderingEnabled(true)
+	, mSortRenderList(true)
 	, mWorldSize(0)
 	, mViewDistance(DEFAULT_VIEW_DISTANCE)
 	, mPhysicsSystem(nullptr)
 	, mOnBlockDestroy()
 	, mOnBlockSet()
 {
-	mChunks = new FChunk[DEFAULT_CHUNK_SIZE];
+	AllocateChunks();
 	mChunkPositions = new Vector4i[DEFAULT_CHUNK_SIZE];
+	mSlotKeys = new std::atomic<uint64_t>[DEFAULT_CHUNK_SIZE];
 	mNeedsToRefreshVisibleList = false;
 	mMustShutdown = false;
+	mPersistGeneratedChunks = false;
+	mUseAsyncReads = true;
+	mSkippedMeshes = 0;
+	mUseMeshCache = false;
+	mWorldVisibleSeconds = 0.0f;
+	mRequestedCount = 0;
+	mDesiredCount = 0;
+	mLoadCount = 0;
+	mEvictionCount = 0;
+	mUseMeshPatching = true;
+	mPatchCount = 0;
+	mRebuildCount = 0;
+
+	mEditTimes.assign(DEFAULT_CHUNK_SIZE, 0);
+	mSlotContents.assign(DEFAULT_CHUNK_SIZE, Vector3i{ -1, -1, -1 });
+	mViewpoints.push_back(FViewpoint{ Vector3f{}, Vector3i{}, DEFAULT_VIEW_DISTANCE, 1.0f, true });
 }
 
 FChunkManager::~FChunkManager()
 {
 	Shutdown();
-	delete[] mChunks;
+	FreeChunks();
 	delete[] mChunkPositions;
+	delete[] mSlotKeys;
 }
 
 void FChunkManager::Shutdown()
@@ -62,9 +169,15 @@ void FChunkManager::Shutdown()
 	SwapChunkBuffers();
 	UnloadAllChunks();
 
+	// Sidecar tables must be on file before the world directory is copied or replaced
+	mMeshCache.CloseAll();
+	mSummaryCache.CloseAll();
+
 	mLoadList = std::queue<Vector3i>();
 	mRebuildList.clear();
+	mPatchList.clear();
 	mRenderList.clear();
+	mBufferSwapQueue.clear();
 
 	mMustShutdown = false;
 }
@@ -72,12 +185,28 @@ void FChunkManager::Shutdown()
 void FChunkManager::LoadWorld(const wchar_t* WorldName)
 {
 	Shutdown();
+
+	// Cached layouts belong to the previous world
+	mPayloadCache.Clear();
 	mFileSystem.SetWorld(WorldName);
 
+	// Missing chunks must be generated the same way every time the world is loaded
+	if (mChunkGenerator)
+		mChunkGenerator->SetSeed(mFileSystem.GetWorldSeed());
+
 	mWorldSize = mFileSystem.GetWorldSize();
 	InitializeWorld();
 }
 
+bool FChunkManager::CreateWorld(const wchar_t* WorldName, const uint32_t WorldSize, const uint32_t Seed)
+{
+	if (!mFileSystem.CreateWorld(WorldName, WorldSize, Seed))
+		return false;
+
+	LoadWorld(WorldName);
+	return true;
+}
+
 void FChunkManager::SaveWorld()
 {
 	Shutdown();
@@ -88,7 +217,106 @@ void FChunkManager::SaveWorld()
 void FChunkManager::SetViewDistance(const uint32_t Distance)
 {
 	Shutdown();
-	ReallocateChunkData(Distance);
+
+	mViewDistance = Distance;
+	{
+		std::lock_guard<std::mutex> Lock(mViewpointMutex);
+		mViewpoints[MAIN_VIEWPOINT].Radius = Distance;
+	}
+
+	ReallocateChunkData();
+	InitializeWorld();
+}
+
+void FChunkManager::SetResidentChunkLimit(const uint32_t Limit)
+{
+	Shutdown();
+
+	mResidentChunkLimit = Limit;
+	ReallocateChunkData();
+
+	InitializeWorld();
+}
+
+uint32_t FChunkManager::AddViewpoint(const Vector3f& Position, const uint32_t Radius, const float Weight)
+{
+	std::lock_guard<std::mutex> Lock(mViewpointMutex);
+
+	const FViewpoint Viewpoint{ Position, Position / FChunk::CHUNK_SIZE, (int32_t)Radius, Weight, true };
+	mNeedsToRefreshVisibleList = true;
+
+	// Reuse the IDs of removed viewpoints
+	for (uint32_t i = 0; i < mViewpoints.size(); i++)
+	{
+		if (!mViewpoints[i].IsActive)
+		{
+			mViewpoints[i] = Viewpoint;
+			return i;
+		}
+	}
+
+	mViewpoints.push_back(Viewpoint);
+	return (uint32_t)mViewpoints.size() - 1;
+}
+
+void FChunkManager::SetViewpointPosition(const uint32_t ID, const Vector3f& Position)
+{
+	std::lock_guard<std::mutex> Lock(mViewpointMutex);
+	ASSERT(ID < mViewpoints.size() && mViewpoints[ID].IsActive);
+
+	FViewpoint& Viewpoint = mViewpoints[ID];
+	Viewpoint.Position = Position;
+
+	// Only update residency when the viewpoint crosses a chunk boundary
+	const Vector3i ChunkPosition = Position / FChunk::CHUNK_SIZE;
+	if (Viewpoint.ChunkPosition != ChunkPosition)
+	{
+		Viewpoint.ChunkPosition = ChunkPosition;
+		mNeedsToRefreshVisibleList = true;
+	}
+}
+
+void FChunkManager::RemoveViewpoint(const uint32_t ID)
+{
+	std::lock_guard<std::mutex> Lock(mViewpointMutex);
+	ASSERT(ID != MAIN_VIEWPOINT && ID < mViewpoints.size());
+
+	mViewpoints[ID].IsActive = false;
+	mNeedsToRefreshVisibleList = true;
+}
+
+FChunkManager::FResidencyStats FChunkManager::GetResidencyStats() const
+{
+	FResidencyStats Stats;
+	Stats.Requested = mRequestedCount;
+	Stats.Desired = mDesiredCount;
+	Stats.Slots = ChunkCount();
+	Stats.Loads = mLoadCount;
+	Stats.Evictions = mEvictionCount;
+
+	{
+		std::lock_guard<std::mutex> Lock(mBufferSwapMutex);
+		Stats.Resident = (uint32_t)mSlotMap.size();
+	}
+
+	Stats.Viewpoints = 0;
+	std::lock_guard<std::mutex> Lock(mViewpointMutex);
+	for (const FViewpoint& Viewpoint : mViewpoints)
+	{
+		Stats.Viewpoints += Viewpoint.IsActive ? 1 : 0;
+	}
+
+	return Stats;
+}
+
+void FChunkManager::SetChunkGenerator(FChunkGenerator* Generator)
+{
+	// The loader thread uses the generator
+	Shutdown();
+
+	mChunkGenerator = Generator;
+	if (mChunkGenerator)
+		mChunkGenerator->SetSeed(mFileSystem.GetWorldSeed());
 
 	InitializeWorld();
 }
@@ -101,27 +329,72 @@ void FChunkManager::InitializeWorld()
 		mChunkPositions[i] = Vector4i{ -1, -1, -1 };
 	}
 
+	// All slots start unused
+	mSlotContents.assign(ChunkCount(), Vector3i{ -1, -1, -1 });
+	for (uint32_t i = 0; i < ChunkCount(); i++)
+	{
+		mSlotKeys[i] = UNUSED_SLOT_KEY;
+	}
+	mEvictableSlots.clear();
+	mSlotMap.clear();
+	mVisibleSlots.clear();
+
+	mLoadCount = 0;
+	mEvictionCount = 0;
+	mEditTimes.assign(ChunkCount(), 0);
+
+	// Time until the world is visible is measured from here
+	mVisibleStartTime = FClock::ReadSystemTimer();
+	mWorldVisibleSeconds = 0.0f;
+
 	// Activate loader thread
 	mNeedsToRefreshVisibleList = true;
 	mLoaderThread = std::thread(&FChunkManager::ChunkLoaderThreadLoop, this);
 }
 
-void FChunkManager::ReallocateChunkData(const int32_t NewViewDistance)
+void FChunkManager::ReallocateChunkData()
 {
+	// Chunks only have colliders once they were swapped with a physics system
 	const uint32_t Size = ChunkCount();
-	for (uint32_t i = 0; i < Size; i++)
+	for (uint32_t i = 0; i < Size && mPhysicsSystem; i++)
 	{
 		mChunks[i].ShutDown(*mPhysicsSystem);
 	}
 
-	mViewDistance = NewViewDistance;
-	const uint32_t NewSize = ChunkCount();
-
-	// Resize data
-	delete[] mChunks;
+	FreeChunks();
 	delete[] mChunkPositions;
-	mChunks = new FChunk[NewSize];
-	mChunkPositions = new Vector4i[NewSize];
+	delete[] mSlotKeys;
+	mChunkAllocators.Trim();
+
+	// Height is half width
+	mSlotCount = (mResidentChunkLimit > 0) ? mResidentChunkLimit : (2 * mViewDistance + 1) * (mViewDistance + 1) * (2 * mViewDistance + 1);
+
+	AllocateChunks();
+	mChunkPositions = new Vector4i[ChunkCount()];
+	mSlotKeys = new std::atomic<uint64_t>[ChunkCount()];
+}
+
+void FChunkManager::AllocateChunks()
+{
+	// Chunks are constructed with the pools of this world, so they can't be allocated with new[]
+	const uint32_t Size = ChunkCount();
+	mChunks = static_cast<FChunk*>(::operator new(Size * sizeof(FChunk)));
+	for (uint32_t i = 0; i < Size; i++)
+	{
+		new (&mChunks[i]) FChunk{ mChunkAllocators };
+	}
+}
+
+void FChunkManager::FreeChunks()
+{
+	const uint32_t Size = ChunkCount();
+	for (uint32_t i = 0; i < Size; i++)
+	{
+		mChunks[i].~FChunk();
+	}
+
+	::operator delete(mChunks);
+	mChunks = nullptr;
 }
 
 void FChunkManager::UnloadAllChunks()
@@ -131,27 +404,39 @@ void FChunkManager::UnloadAllChunks()
 	{
 		if (mChunks[i].IsLoaded())
 		{
-			const Vector3i UnloadChunkPosition = mChunkPositions[i];
+			const Vector3i UnloadChunkPosition = mSlotContents[i];
 
 			if (UnloadChunkPosition.y != -1)
 			{
 				// Buffer for all chunk data
-				std::vector<uint8_t> ChunkData;
+				FScratchScope Scratch;
+				uint8_t* ChunkData = static_cast<uint8_t*>(Scratch.GetArena().Allocate(FChunk::MAX_ENCODED_SIZE));
+
+				// The summary is stored by the write queue once the layout is on file
+				const bool IsModified = mChunks[i].IsModified();
+				const FChunkSummary Summary = IsModified ? SummarizeChunk(mChunks[i]) : FChunkSummary{};
 
 				// Unload the chunk currently in this index
-				mChunks[i].Unload(ChunkData);
+				const EChunkCodec::Type Codec = SChunkCodecs::GetDefault();
+				const uint32_t DataSize = mChunks[i].Unload(ChunkData, Codec);
 
-				// Write the data to file
-				mFileSystem.WriteChunkData(UnloadChunkPosition, ChunkData);
+				// Keep the layout cached for when the world is reinitialized
+				mPayloadCache.Insert(UnloadChunkPosition, ChunkData, DataSize, Codec, IsModified, Summary);
 			}
 		}
 	}
 
+	// Write all modified chunks to file, region files are closed once the writes are done
+	mPayloadCache.FlushDirty();
+	mWriteQueue.Flush();
 	mFileSystem.ClearAllRegionFileReferences();
 }
 
 void FChunkManager::Render(FRenderSystem& Renderer, const GLenum RenderMode)
 {
+	if (!mIsRenderingEnabled)
+		return;
+
 	UpdateRenderList();
 
 	// Render everything in the renderlist
@@ -166,15 +451,9 @@ void FChunkManager::Render(FRenderSystem& Renderer, const GLenum RenderMode)
 
 void FChunkManager::Update()
 {
-	// Get the chunk that the camera is currently in.
-	const Vector3i CameraChunk = FCamera::Main->Transform.GetWorldPosition() / FChunk::CHUNK_SIZE;
-
-	// Only update visibility list when that camera crosses a chunk boundary
-	if (mLastCameraChunk != CameraChunk)
-	{
-		mLastCameraChunk = CameraChunk;
-		mNeedsToRefreshVisibleList = true;
-	}
+	// The main viewpoint follows the camera
+	if (FCamera::Main)
+		SetViewpointPosition(MAIN_VIEWPOINT, FCamera::Main->Transform.GetWorldPosition());
 
 	SwapChunkBuffers();
 }
@@ -183,20 +462,63 @@ void FChunkManager::SwapChunkBuffers()
 {
 	std::unique_lock<std::mutex> Lock(mBufferSwapMutex, std::try_to_lock);
 
-	if (Lock.owns_lock())
+	// Colliders are updated with the meshes
+	if (Lock.owns_lock() && mPhysicsSystem)
 	{
+		const uint64_t Now = FClock::ReadSystemTimer();
 		int32_t SwapCount = MESH_SWAPS_PER_FRAME;
-		while (SwapCount > 0 && !mBufferSwapQueue.empty())
+		size_t Remaining = mBufferSwapQueue.size();
+		while (SwapCount > 0 && Remaining > 0)
 		{
 			const Vector3i ChunkPosition = mBufferSwapQueue.front();
 			mBufferSwapQueue.pop_front();
+			Remaining--;
+
+			// Slots are only reassigned after the swaps of their chunks are cancelled
+			const int32_t Index = FindSlot(ChunkPosition);
+			ASSERT(Index >= 0);
+
+			// Edits of the chunk that was evicted from the slot can't become visible anymore
+			const Vector4i SwappedPosition{ ChunkPosition, 1 };
+			const bool IsNewChunk = (mChunkPositions[Index] != SwappedPosition);
+			if (IsNewChunk)
+				mEditTimes[Index] = 0;
+
+			// A mesh built before the latest edit is not uploaded, it stays pending so the update
+			// queued for the edit builds on it. Chunks that keep changing are swapped in anyway.
+			const bool IsStale = mChunks[Index].IsMeshStale();
+			if (IsStale && mEditTimes[Index] != 0 && Now - mEditTimes[Index] < FClock::SecondsToCycles(STALE_MESH_TIMEOUT))
+			{
+				mBufferSwapQueue.push_back(ChunkPosition);
+				mStaleSwapCount++;
+				continue;
+			}
 
-			const uint32_t Index = ChunkIndex(ChunkPosition);
+			mChunks[Index].SwapMeshBuffer(*mPhysicsSystem, mIsRenderingEnabled);
 
-			mChunks[Index].SwapMeshBuffer(*mPhysicsSystem);
+			if (IsNewChunk)
+			{
+				// The evicted chunk may already be visible in another slot
+				auto Evicted = mVisibleSlots.find(Vector3i{ mChunkPositions[Index] });
+				if (Evicted != mVisibleSlots.end() && Evicted->second == (uint32_t)Index)
+					mVisibleSlots.erase(Evicted);
 
-			mChunkPositions[Index] = Vector4i{ ChunkPosition, 1 };
+				mVisibleSlots[ChunkPosition] = Index;
+			}
+
+			mChunkPositions[Index] = SwappedPosition;
 			SwapCount--;
+
+			// Edits are visible once a mesh built after them is swapped in
+			if (mEditTimes[Index] != 0 && !IsStale)
+			{
+				const uint64_t Latency = Now - mEditTimes[Index];
+				mEditLatencyCycles += Latency;
+				if (Latency > mMaxEditLatencyCycles)
+					mMaxEditLatencyCycles = Latency;
+				mVisibleEditCount++;
+				mEditTimes[Index] = 0;
+			}
 		}
 	}
 }
@@ -212,17 +534,26 @@ void FChunkManager::SetBlock(const Vector3i& Position, FBlockTypes::BlockID ID)
 		const Vector4i ChunkPosition = Vector4i(Position / FChunk::CHUNK_SIZE, 1);
 		const Vector3i LocalPosition = Vector3i{ Position.x % FChunk::CHUNK_SIZE, Position.y % FChunk::CHUNK_SIZE, Position.z % FChunk::CHUNK_SIZE };
 
-		int32_t Index = ChunkIndex(ChunkPosition);
+		int32_t Index = FindVisibleSlot(ChunkPosition);
 
 		// Only set if the right chunk is loaded
-		if (ChunkPosition == mChunkPositions[Index])
+		if (Index >= 0)
 		{
-			mChunks[Index].SetBlock(LocalPosition, ID);
-			mOnBlockSet.Invoke(Position, ID);
+			{
+				// Snapshots for mesh updates are taken with the lock held, so every edit they include has its update queued
+				std::lock_guard<std::mutex> Lock(mRebuildListMutex);
+
+				// The loader changes slot keys with the lock held, the slot may have been reassigned since it was found
+				if (!IsSlotEditable(Index, ChunkPosition))
+					return;
+
+				mChunks[Index].SetBlock(LocalPosition, ID);
+				QueueMeshUpdate(Index, LocalPosition);
+
+				QueueExposedNeighborRebuilds(ChunkPosition, LocalPosition);
+			}
 
-			std::lock_guard<std::mutex> Lock(mRebuildListMutex);
-			if (std::find(mRebuildList.begin(), mRebuildList.end(), Index) == mRebuildList.end())
-				mRebuildList.push_back(Index);
+			mOnBlockSet.Invoke(Position, ID);
 		}
 	}
 }
@@ -236,10 +567,10 @@ FBlockTypes::BlockID FChunkManager::GetBlock(Vector3i Position) const
 		const Vector4i ChunkPosition = Vector4i(Position / FChunk::CHUNK_SIZE, 1);
 		Position = Vector3i{ Position.x % FChunk::CHUNK_SIZE, Position.y % FChunk::CHUNK_SIZE, Position.z % FChunk::CHUNK_SIZE };
 
-		int32_t Index = ChunkIndex(ChunkPosition);
+		int32_t Index = FindVisibleSlot(ChunkPosition);
 
 		// Only get if the right chunk is loaded
-		if (ChunkPosition == mChunkPositions[Index])
+		if (Index >= 0)
 		{
 			return mChunks[Index].GetBlock(Position);
 		}
@@ -248,6 +579,25 @@ FBlockTypes::BlockID FChunkManager::GetBlock(Vector3i Position) const
 	return FBlock::AIR_BLOCK_ID;
 }
 
+uint32_t FChunkManager::GetSurfaceHeight(const int32_t X, const int32_t Z)
+{
+	const int32_t BlockWorldSize = mWorldSize * FChunk::CHUNK_SIZE;
+	if (std::min(X, Z) < 0 || std::max(X, Z) >= BlockWorldSize)
+		return 0;
+
+	// Column heights are kept per region, find the highest region of the column with blocks
+	const int32_t RegionSize = (int32_t)FRegionFile::RegionData::REGION_SIZE;
+	for (int32_t RegionY = (mWorldSize - 1) / RegionSize; RegionY >= 0; RegionY--)
+	{
+		const Vector3i ChunkPosition{ X / FChunk::CHUNK_SIZE, RegionY * RegionSize, Z / FChunk::CHUNK_SIZE };
+		const uint32_t Height = mSummaryCache.GetColumnHeight(ChunkPosition);
+		if (Height > 0)
+			return RegionY * RegionSize * FChunk::CHUNK_SIZE + Height;
+	}
+
+	return 0;
+}
+
 void FChunkManager::DestroyBlock(const Vector3i& Position)
 {
 	int32_t BlockWorldSize = mWorldSize * FChunk::CHUNK_SIZE;
@@ -257,21 +607,36 @@ void FChunkManager::DestroyBlock(const Vector3i& Position)
 		const Vector4i ChunkPosition = Vector4i(Position / FChunk::CHUNK_SIZE, 1);
 		const Vector3i LocalPosition = Vector3i{ Position.x % FChunk::CHUNK_SIZE, Position.y % FChunk::CHUNK_SIZE, Position.z % FChunk::CHUNK_SIZE };
 
-		int32_t Index = ChunkIndex(ChunkPosition);
+		int32_t Index = FindVisibleSlot(ChunkPosition);
 
 		// Only destroy if the right chunk is loaded
-		if (ChunkPosition == mChunkPositions[Index])
+		if (Index >= 0)
 		{
-			const FBlockTypes::BlockID ID = mChunks[Index].DestroyBlock(LocalPosition);
-			mOnBlockDestroy.Invoke(Position, ID);
+			FBlockTypes::BlockID ID;
+			{
+				std::lock_guard<std::mutex> Lock(mRebuildListMutex);
+				if (!IsSlotEditable(Index, ChunkPosition))
+					return;
+
+				ID = mChunks[Index].DestroyBlock(LocalPosition);
+				QueueMeshUpdate(Index, LocalPosition);
 
-			std::lock_guard<std::mutex> Lock(mRebuildListMutex);
-			if (std::find(mRebuildList.begin(), mRebuildList.end(), Index) == mRebuildList.end())
-				mRebuildList.push_back(Index);
+				QueueExposedNeighborRebuilds(ChunkPosition, LocalPosition);
+			}
+
+			mOnBlockDestroy.Invoke(Position, ID);
 		}
 	}
 }
 
+void FChunkManager::SetAsyncChunkReads(const bool Enabled)
+{
+	mUseAsyncReads = Enabled;
+
+	// Statistics only describe one mode at a time
+	mFileSystem.ResetReadStats();
+}
+
 void FChunkManager::SetPhysicsSystem(FPhysicsSystem& Physics)
 {
 	mPhysicsSystem = &Physics;
@@ -290,180 +655,542 @@ void FChunkManager::ChunkLoaderThreadLoop()
 		mNeedsToRefreshVisibleList = false;
 		UpdateVisibleList();
 	}
+
+	mChunkAllocators.FlushThreadCaches();
+	SScratchArena::ReleaseThreadArena();
 }
 
 void FChunkManager::UpdateLoadList()
 {
-	uint32_t LoadsLeft = CHUNKS_TO_LOAD_PER_ITERATION;
+	// A chunk of the batch that was found in memory
+	struct FCachedLoad
+	{
+		Vector3i       ChunkPosition;
+		const uint8_t* Data;
+		uint32_t       DataSize;
+		uint8_t        Codec;
+		bool           IsCacheDirty;
+	};
+
+	// Data of the whole batch is released once all of its chunks are loaded
+	FScratchScope Scratch;
+	const FStackAllocator::UMarker BatchMarker = Scratch.GetArena().GetMarker();
+
+	FCachedLoad CachedLoads[CHUNKS_TO_LOAD_PER_BATCH];
+	FWorldFileSystem::FChunkRead FileReads[CHUNKS_TO_LOAD_PER_BATCH];
+	Vector3i UniformLoads[CHUNKS_TO_LOAD_PER_BATCH];
+	FChunkSummary UniformSummaries[CHUNKS_TO_LOAD_PER_BATCH];
+	uint32_t CachedCount = 0;
+	uint32_t UniformCount = 0;
+	uint32_t FileReadCount = 0;
+	uint32_t AttemptsLeft = CHUNKS_TO_LOAD_PER_BATCH;
+
+	// File reads allocate their sectors when submitted, so their bytes are reserved when queued
+	uint32_t ReservedReadBytes = 0;
 
 	std::unique_lock<std::mutex> BufferSwapLock(mBufferSwapMutex, std::defer_lock);
 
-	// Buffer for all chunk data
-	std::vector<uint8_t> ChunkData;
-	while (!mLoadList.empty() && LoadsLeft > 0)
+	while (!mLoadList.empty() && AttemptsLeft > 0 && Scratch.GetArena().GetMarker() - BatchMarker + ReservedReadBytes < LOAD_BATCH_BYTES)
 	{
 		Vector3i ChunkPosition = mLoadList.front();
 		mLoadList.pop();
+		AttemptsLeft--;
+
+		// Chunks wanted by more than one viewpoint are only loaded once
+		if (FindSlot(ChunkPosition) >= 0)
+			continue;
+
+		// Every slot holds a chunk that is still wanted, the rest waits until a viewpoint moves
+		if (mEvictableSlots.empty())
+		{
+			mLoadList = std::queue<Vector3i>();
+			mFileSystem.CancelRegionFileOpens();
+			break;
+		}
+
+		// Cold regions are opened in the background, come back to this chunk when its file is ready
+		if (!mFileSystem.TryAddRegionFileReference(ChunkPosition))
+		{
+			mLoadList.push(ChunkPosition);
+			continue;
+		}
 
-		const uint32_t Index = ChunkIndex(ChunkPosition);
+		const uint32_t Index = mEvictableSlots.back();
+		mEvictableSlots.pop_back();
 
-		// Get region position info for unloaded chunk
-		Vector3i UnloadChunkPosition = mChunkPositions[Index];
+		const Vector3i UnloadChunkPosition = mSlotContents[Index];
 
-		// If this chunk is already in the swap list, remove it. This prevents redundant buffer swaps and
-		// tells us which chunk position is really currently loaded within the chunk data.
+		// A pending swap of the evicted chunk must not reach the new chunk's slot, and its mesh
+		// must not be swapped in for the new chunk
 		BufferSwapLock.lock();
-		auto InSwapList = std::find(mBufferSwapQueue.begin(), mBufferSwapQueue.end(), ChunkPosition);
+		auto InSwapList = std::find(mBufferSwapQueue.begin(), mBufferSwapQueue.end(), UnloadChunkPosition);
 		if (InSwapList != mBufferSwapQueue.end())
-		{
-			UnloadChunkPosition = *InSwapList;
 			mBufferSwapQueue.erase(InSwapList);
-		}
+		mChunks[Index].DiscardMesh();
+
+		mSlotMap.erase(UnloadChunkPosition);
+		mSlotMap[ChunkPosition] = Index;
 		BufferSwapLock.unlock();
 
+		{
+			// Edits check the key with this lock held, so none reach the slot while it is unloaded
+			// and loaded. The key of the new chunk is set once its blocks are loaded.
+			std::lock_guard<std::mutex> RebuildLock(mRebuildListMutex);
+			mSlotKeys[Index].store(UNUSED_SLOT_KEY, std::memory_order_release);
+		}
+
+		mSlotContents[Index] = ChunkPosition;
+		mLoadCount++;
+
 		///// Unload Chunk ////////////////////////////////////////////////////////////////
 		///////////////////////////////////////////////////////////////////////////////////
 		if (mChunks[Index].IsLoaded())
 		{
-			// Unload the chunk currently in this index
-			mChunks[Index].Unload(ChunkData);
+			const FStackAllocator::UMarker UnloadMarker = Scratch.GetArena().GetMarker();
+			uint8_t* UnloadData = static_cast<uint8_t*>(Scratch.GetArena().Allocate(FChunk::MAX_ENCODED_SIZE));
 
 			ASSERT(UnloadChunkPosition.y != -1);
-			// Write the data to file
-			mFileSystem.WriteChunkData(UnloadChunkPosition, ChunkData);
+			mEvictionCount++;
+
+			// The summary is stored by the write queue once the layout is on file
+			const bool IsModified = mChunks[Index].IsModified();
+			const FChunkSummary Summary = IsModified ? SummarizeChunk(mChunks[Index]) : FChunkSummary{};
+
+			// Unload the chunk currently in this index
+			const EChunkCodec::Type Codec = SChunkCodecs::GetDefault();
+			const uint32_t UnloadSize = mChunks[Index].Unload(UnloadData, Codec);
+
+			// Cache the data in case the chunk comes back into view, modified chunks are written to file on eviction
+			mPayloadCache.Insert(UnloadChunkPosition, UnloadData, UnloadSize, Codec, IsModified, Summary);
 			mFileSystem.RemoveRegionFileReference(UnloadChunkPosition);
+
+			Scratch.GetArena().ClearToMarker(UnloadMarker);
 		}
 
-		///// Load Chunk /////////////////////////////////////////////////////////////////////
+		///// Find Chunk Data ////////////////////////////////////////////////////////////////
 		//////////////////////////////////////////////////////////////////////////////////////
-		
-		// Get info for chunk data within its region
-		ChunkData.clear();
-		mFileSystem.AddRegionFileReference(ChunkPosition);
-		mFileSystem.GetChunkData(ChunkPosition, ChunkData);
-	
-		// Load and build the chunk
-		Vector3i WorldPosition = ChunkPosition * FChunk::CHUNK_SIZE;
-		bool DoesntNeedRebuild = mChunks[Index].Load(ChunkData);
-
-		if (!DoesntNeedRebuild)
-			mChunks[Index].RebuildMesh(WorldPosition);
 
-		BufferSwapLock.lock();
-			mBufferSwapQueue.push_back(ChunkPosition);
-		BufferSwapLock.unlock();
+		// Recently unloaded chunks are still cached, evicted chunks may not be on file yet
+		FCachedLoad& Cached = CachedLoads[CachedCount];
+		Cached.ChunkPosition = ChunkPosition;
+		Cached.Codec = EChunkCodec::RLE;
+		Cached.IsCacheDirty = false;
+
+		Cached.Data = mPayloadCache.Take(ChunkPosition, Scratch.GetArena(), Cached.DataSize, Cached.Codec, Cached.IsCacheDirty);
+		if (!Cached.Data)
+			Cached.Data = mWriteQueue.Find(ChunkPosition, Scratch.GetArena(), Cached.DataSize, Cached.Codec);
+
+		if (Cached.Data)
+		{
+			CachedCount++;
+			continue;
+		}
+
+		// Chunks that are all air or all one block don't need to be read
+		const FChunkSummary Summary = mSummaryCache.FindForLoad(ChunkPosition);
+		if (Summary.Type == EChunkSummary::Air || Summary.Type == EChunkSummary::Solid)
+		{
+			UniformLoads[UniformCount] = ChunkPosition;
+			UniformSummaries[UniformCount++] = Summary;
+		}
+		else
+		{
+			FileReads[FileReadCount++].ChunkPosition = ChunkPosition;
+			ReservedReadBytes += mFileSystem.GetChunkReadSize(ChunkPosition);
+		}
+	}
+
+	///// Load Chunks ////////////////////////////////////////////////////////////////////
+	//////////////////////////////////////////////////////////////////////////////////////
+
+	// The disk works on the reads while chunks found in memory are loaded
+	const bool UseAsyncReads = mUseAsyncReads;
+	if (UseAsyncReads && FileReadCount > 0)
+		mFileSystem.SubmitChunkReads(FileReads, FileReadCount, Scratch.GetArena());
+
+	for (uint32_t i = 0; i < UniformCount; i++)
+	{
+		LoadUniformChunk(UniformLoads[i], UniformSummaries[i]);
+	}
+
+	for (uint32_t i = 0; i < CachedCount; i++)
+	{
+		const FCachedLoad& Cached = CachedLoads[i];
+		LoadChunk(Cached.ChunkPosition, Cached.Data, Cached.DataSize, Cached.Codec, true, Cached.IsCacheDirty);
+	}
+
+	if (UseAsyncReads)
+	{
+		// Chunks are loaded in the order their reads complete
+		FWorldFileSystem::FChunkRead* Completed[CHUNKS_TO_LOAD_PER_BATCH];
+		uint32_t CompletedCount;
 
-		ChunkData.clear();
-		LoadsLeft--;
+		while ((CompletedCount = mFileSystem.WaitForChunkReads(Completed, CHUNKS_TO_LOAD_PER_BATCH)) > 0)
+		{
+			for (uint32_t i = 0; i < CompletedCount; i++)
+			{
+				const FWorldFileSystem::FChunkRead& Read = *Completed[i];
+				LoadChunk(Read.ChunkPosition, Read.Data, Read.DataSize, Read.Codec, false, false);
+			}
+		}
+	}
+	else
+	{
+		for (uint32_t i = 0; i < FileReadCount; i++)
+		{
+			FScratchScope ReadScratch;
+
+			uint32_t DataSize;
+			uint8_t Codec = EChunkCodec::RLE;
+			const uint8_t* ChunkData = mFileSystem.GetChunkData(FileReads[i].ChunkPosition, ReadScratch.GetArena(), DataSize, Codec);
+			LoadChunk(FileReads[i].ChunkPosition, ChunkData, DataSize, Codec, false, false);
+		}
+	}
+
+	// All chunks in view have been built
+	if (mLoadList.empty() && mVisibleStartTime != 0)
+	{
+		mWorldVisibleSeconds = FClock::CyclesToSeconds(FClock::ReadSystemTimer() - mVisibleStartTime);
+		mVisibleStartTime = 0;
 	}
 }
 
+void FChunkManager::LoadChunk(const Vector3i& ChunkPosition, const uint8_t* ChunkData, const uint32_t DataSize, const uint8_t Codec, const bool IsCached, const bool IsCacheDirty)
+{
+	const int32_t Index = FindSlot(ChunkPosition);
+	ASSERT(Index >= 0);
+
+	// Load the chunk
+	if (!ChunkData && mChunkGenerator)
+	{
+		// Chunks that were never saved are generated, they are only written to file when modified
+		mChunks[Index].Generate(*mChunkGenerator, ChunkPosition);
+		if (mPersistGeneratedChunks)
+			mChunks[Index].MarkModified();
+	}
+	else
+	{
+		mChunks[Index].Load(ChunkData, DataSize, Codec);
+	}
+
+	// Summaries only describe layouts on file, generated chunks are summarized once they are saved.
+	// Cached layouts were summarized when they were read, or are once the write queue writes them.
+	const FChunkSummary Summary = SummarizeChunk(mChunks[Index]);
+	if (ChunkData && !IsCached)
+		mSummaryCache.Store(ChunkPosition, Summary);
+
+	// Cached changes that were never written still need to be saved
+	if (IsCacheDirty)
+		mChunks[Index].MarkModified();
+
+	FinishChunkLoad(ChunkPosition, Summary);
+}
+
+void FChunkManager::LoadUniformChunk(const Vector3i& ChunkPosition, const FChunkSummary& Summary)
+{
+	mChunks[FindSlot(ChunkPosition)].Fill(Summary.Block);
+	FinishChunkLoad(ChunkPosition, Summary);
+}
+
+void FChunkManager::FinishChunkLoad(const Vector3i& ChunkPosition, const FChunkSummary& Summary)
+{
+	const int32_t Index = FindSlot(ChunkPosition);
+
+	{
+		// The chunk can be edited from here on
+		std::lock_guard<std::mutex> RebuildLock(mRebuildListMutex);
+		mSlotKeys[Index].store(SlotKey(ChunkPosition), std::memory_order_release);
+	}
+
+	// Empty chunks have no mesh, solid chunks surrounded by solid chunks can't be seen
+	if (Summary.Type == EChunkSummary::Solid && IsEnclosed(ChunkPosition))
+	{
+		mChunks[Index].SkipMesh();
+		mSkippedMeshes++;
+	}
+	else if (Summary.Type != EChunkSummary::Air)
+	{
+		BuildLoadedChunkMesh(Index, ChunkPosition);
+	}
+
+	std::lock_guard<std::mutex> BufferSwapLock(mBufferSwapMutex);
+	mBufferSwapQueue.push_back(ChunkPosition);
+}
+
+bool FChunkManager::IsEnclosed(const Vector3i& ChunkPosition)
+{
+	for (const Vector3i& Offset : NEIGHBOR_OFFSETS)
+	{
+		const Vector3i Neighbor = ChunkPosition + Offset;
+
+		// Faces on the border of the world can be seen from outside
+		if (std::min({ Neighbor.x, Neighbor.y, Neighbor.z }) < 0 || std::max({ Neighbor.x, Neighbor.y, Neighbor.z }) >= mWorldSize)
+			return false;
+
+		// Summaries of loaded neighbors are stale once their blocks change
+		const int32_t Index = FindSlot(Neighbor);
+		if (Index >= 0 && mChunks[Index].IsLoaded() && mChunks[Index].IsModified())
+			return false;
+
+		if (mSummaryCache.Find(Neighbor).Type != EChunkSummary::Solid)
+			return false;
+	}
+
+	return true;
+}
+
+void FChunkManager::QueueExposedNeighborRebuilds(const Vector3i& ChunkPosition, const Vector3i& LocalPosition)
+{
+	for (const Vector3i& Offset : NEIGHBOR_OFFSETS)
+	{
+		// Only blocks on the border of the chunk touch the neighbor
+		const Vector3i Adjacent = LocalPosition + Offset;
+		if (std::min({ Adjacent.x, Adjacent.y, Adjacent.z }) >= 0 && std::max({ Adjacent.x, Adjacent.y, Adjacent.z }) < FChunk::CHUNK_SIZE)
+			continue;
+
+		const Vector3i Neighbor = ChunkPosition + Offset;
+		if (std::min({ Neighbor.x, Neighbor.y, Neighbor.z }) < 0 || std::max({ Neighbor.x, Neighbor.y, Neighbor.z }) >= mWorldSize)
+			continue;
+
+		const int32_t Index = FindVisibleSlot(Neighbor);
+		if (Index >= 0 && mChunks[Index].IsMeshSkipped() &&
+			std::find(mRebuildList.begin(), mRebuildList.end(), Index) == mRebuildList.end())
+		{
+			mRebuildList.push_back(Index);
+		}
+	}
+}
+
+void FChunkManager::BuildLoadedChunkMesh(const uint32_t Index, const Vector3i& ChunkPosition)
+{
+	const Vector3f WorldPosition = ChunkPosition * FChunk::CHUNK_SIZE;
+	const FBlockSnapshot Blocks = mChunks[Index].Snapshot();
+
+	if (!mUseMeshCache)
+	{
+		mChunks[Index].RebuildMesh(WorldPosition, Blocks);
+		return;
+	}
+
+	FScratchScope Scratch;
+	TScratchArray<FChunk::MeshQuad> Quads{ Scratch.GetArena(), 1024 };
+
+	// Mesh the chunk only if the cached mesh is missing or was built from other blocks
+	const uint64_t BlockHash = Blocks.Hash();
+	if (!mMeshCache.Find(ChunkPosition, BlockHash, Quads))
+	{
+		FChunk::GreedyMesh(Blocks, Quads);
+		mMeshCache.Store(ChunkPosition, BlockHash, Quads.Data(), Quads.Size());
+	}
+
+	mChunks[Index].RebuildMesh(WorldPosition, Quads.Data(), Quads.Size(), Blocks.GetVersion());
+}
+
 void FChunkManager::UpdateRebuildList()
 {
 	std::unique_lock<std::mutex> RebuildLock(mRebuildListMutex);
 	std::unique_lock<std::mutex> BufferSwapLock(mBufferSwapMutex, std::defer_lock);
 
-	while (!mRebuildList.empty())
+	while (!mRebuildList.empty() || !mPatchList.empty())
 	{
-		int32_t ChunkIndex = mRebuildList.front();
-		mRebuildList.pop_front();
+		// Whole rebuilds first, they also cover the patches of their chunks
+		int32_t ChunkIndex;
+		FChunk::MeshPatch Patch = {};
+		const bool IsPatch = mRebuildList.empty();
+		if (IsPatch)
+		{
+			ChunkIndex = mPatchList.begin()->first;
+			Patch = mPatchList.begin()->second;
+			mPatchList.erase(mPatchList.begin());
+		}
+		else
+		{
+			ChunkIndex = mRebuildList.front();
+			mRebuildList.pop_front();
+			mPatchList.erase(ChunkIndex);
+		}
+
+		// The slot may hold a newer chunk than the one that was last swapped in
+		const Vector3i ChunkPosition = mSlotContents[ChunkIndex];
+
+		// Edits are made with the lock held, so the snapshot has exactly the edits queued so far
+		FBlockSnapshot Blocks;
+		if (ChunkPosition.y != -1)
+			Blocks = mChunks[ChunkIndex].Snapshot();
 		RebuildLock.unlock();
 
-		const Vector3i ChunkPosition = mChunkPositions[ChunkIndex];
 		if (ChunkPosition.y != -1)
 		{
 			// Check if its already in the swap list and remove if it is.
 			BufferSwapLock.lock();
 			auto InSwapList = std::find(mBufferSwapQueue.begin(), mBufferSwapQueue.end(), ChunkPosition);
-			if (InSwapList != mBufferSwapQueue.end())
+			const bool HasPendingSwap = (InSwapList != mBufferSwapQueue.end());
+			if (HasPendingSwap)
 				mBufferSwapQueue.erase(InSwapList);
 			BufferSwapLock.unlock();
 
-			mChunks[ChunkIndex].RebuildMesh(ChunkPosition * FChunk::CHUNK_SIZE);
+			// Skipped meshes have nothing to patch
+			if (IsPatch && !mChunks[ChunkIndex].IsMeshSkipped())
+			{
+				mChunks[ChunkIndex].PatchMesh(ChunkPosition * FChunk::CHUNK_SIZE, Blocks, Patch, HasPendingSwap);
+				mPatchCount++;
+			}
+			else
+			{
+				mChunks[ChunkIndex].RebuildMesh(ChunkPosition * FChunk::CHUNK_SIZE, Blocks);
+				mRebuildCount++;
+			}
 
 			BufferSwapLock.lock();
-				mBufferSwapQueue.push_back(mChunkPositions[ChunkIndex]);
+				mBufferSwapQueue.push_back(ChunkPosition);
 			BufferSwapLock.unlock();
 		}
 		RebuildLock.lock();
 	}
 }
 
-void FChunkManager::UpdateVisibleList()
+void FChunkManager::QueueMeshUpdate(const uint32_t Index, const Vector3i& LocalPosition)
 {
-	// Offset the camera chunk position so the loop centers the camera
-	Vector3i CameraChunkOffset = mLastCameraChunk - Vector3i{ mViewDistance, 0, mViewDistance };
+	if (mEditTimes[Index] == 0)
+		mEditTimes[Index] = FClock::ReadSystemTimer();
 
-	// Get the total range of visible area.
-	const int32_t HorizontalBounds = 2 * mViewDistance + 1;
+	// Chunks that are rebuilt anyway don't need a patch
+	if (std::find(mRebuildList.begin(), mRebuildList.end(), Index) != mRebuildList.end())
+		return;
 
-	// Clear previous load and visibile list when moving across chunks.
-	mLoadList = std::queue<Vector3i>();
+	// Patches of many layers cost more than meshing the whole chunk
+	FChunk::MeshPatch& Patch = mPatchList[Index];
+	Patch.AddBlock(LocalPosition);
 
-	// Add all chunks in the visible range to the visible list.
-	// First add the xz plane that the camera is currently on.
-	if (CameraChunkOffset.y < mWorldSize && CameraChunkOffset.y >= 0)
+	if (!mUseMeshPatching || Patch.LayerCount() > MAX_PATCH_LAYERS)
 	{
-		for (int32_t x = 0; x < HorizontalBounds; x++)
-		{
-			const int32_t xPosition = CameraChunkOffset.x + x;
-			if (xPosition >= mWorldSize || xPosition < 0)
-				continue;
+		mPatchList.erase(Index);
+		mRebuildList.push_back(Index);
+	}
+}
 
-			for (int32_t z = 0; z < HorizontalBounds; z++)
-			{
-				const int32_t zPosition = CameraChunkOffset.z + z;
-				if (zPosition >= mWorldSize || zPosition < 0)
-					continue;
+FChunkManager::FMeshUpdateStats FChunkManager::GetMeshUpdateStats() const
+{
+	FMeshUpdateStats Stats;
+	Stats.Patches = mPatchCount;
+	Stats.Rebuilds = mRebuildCount;
+	Stats.Edits = mVisibleEditCount;
+	Stats.StaleSwaps = mStaleSwapCount;
+	Stats.AverageLatency = (Stats.Edits > 0) ? FClock::CyclesToSeconds(mEditLatencyCycles / Stats.Edits) : 0.0f;
+	Stats.MaxLatency = FClock::CyclesToSeconds(mMaxEditLatencyCycles);
+	return Stats;
+}
+
+void FChunkManager::UpdateVisibleList()
+{
+	std::vector<FViewpoint> Viewpoints;
+	{
+		std::lock_guard<std::mutex> Lock(mViewpointMutex);
+		Viewpoints = mViewpoints;
+	}
+
+	// Merge the areas of all viewpoints, each chunk keeps its highest priority
+	mDesiredChunks.clear();
+	uint32_t RequestedCount = 0;
 
-				const Vector4i ChunkPosition{ xPosition, CameraChunkOffset.y, zPosition, 1 };
-				const int32_t VisibleChunkIndex = ChunkIndex(ChunkPosition);
+	for (const FViewpoint& Viewpoint : Viewpoints)
+	{
+		if (!Viewpoint.IsActive)
+			continue;
+
+		const Vector3f Center = Viewpoint.Position / (float)FChunk::CHUNK_SIZE;
+		const float InverseWeight = 1.0f / (Viewpoint.Weight * Viewpoint.Weight);
+
+		// Height is half width
+		const Vector3i Min = Viewpoint.ChunkPosition - Vector3i{ Viewpoint.Radius, Viewpoint.Radius / 2, Viewpoint.Radius };
+		const Vector3i Max = Viewpoint.ChunkPosition + Vector3i{ Viewpoint.Radius, Viewpoint.Radius / 2, Viewpoint.Radius };
 
-				// If this visible chunk is not loaded, load it.
-				if (mChunkPositions[VisibleChunkIndex] != ChunkPosition)
+		for (int32_t x = std::max(Min.x, 0); x <= std::min(Max.x, mWorldSize - 1); x++)
+		{
+			for (int32_t y = std::max(Min.y, 0); y <= std::min(Max.y, mWorldSize - 1); y++)
+			{
+				for (int32_t z = std::max(Min.z, 0); z <= std::min(Max.z, mWorldSize - 1); z++)
 				{
-					mLoadList.push(ChunkPosition);
+					const Vector3i ChunkPosition{ x, y, z };
+					const Vector3f Offset = Vector3f{ x + 0.5f, y + 0.5f, z + 0.5f } - Center;
+					const float Priority = Vector3f::Dot(Offset, Offset) * InverseWeight;
+
+					auto Found = mDesiredChunks.emplace(ChunkPosition, Priority);
+					if (!Found.second)
+						Found.first->second = std::min(Found.first->second, Priority);
+
+					RequestedCount++;
 				}
 			}
 		}
 	}
 
-	// Now add the world by alternating the xz planes from below to above the camera's chunk
-	for (int32_t v = 1; v <= mViewDistance / 2; v++)
+	mRequestedCount = RequestedCount;
+	mDesiredCount = (uint32_t)mDesiredChunks.size();
+
+	// Only the nearest chunks of the union fit in the slots
+	mDesiredOrder.clear();
+	for (const auto& Desired : mDesiredChunks)
 	{
-		for (int32_t y = -v; y < v + 1; y += 2 * v)
+		mDesiredOrder.push_back(std::make_pair(Desired.second, Desired.first));
+	}
+
+	std::sort(mDesiredOrder.begin(), mDesiredOrder.end(), [](const std::pair<float, Vector3i>& Lhs, const std::pair<float, Vector3i>& Rhs) { return Lhs.first < Rhs.first; });
+
+	if (mDesiredOrder.size() > ChunkCount())
+	{
+		for (auto Dropped = mDesiredOrder.begin() + ChunkCount(); Dropped != mDesiredOrder.end(); ++Dropped)
 		{
-			const int32_t yPosition = CameraChunkOffset.y + y;
+			mDesiredChunks.erase(Dropped->second);
+		}
 
-			if (yPosition >= mWorldSize || yPosition < 0)
-				continue;
+		mDesiredOrder.resize(ChunkCount());
+	}
 
-			for (int32_t x = 0; x < HorizontalBounds; x++)
-			{
-				const int32_t xPosition = CameraChunkOffset.x + x;
+	// Slots of chunks no viewpoint wants anymore can be reused, unused slots are taken first
+	mEvictableSlots.clear();
+	for (uint32_t i = 0; i < ChunkCount(); i++)
+	{
+		if (mSlotContents[i].y != -1 && mDesiredChunks.find(mSlotContents[i]) == mDesiredChunks.end())
+			mEvictableSlots.push_back(i);
+	}
+
+	for (uint32_t i = 0; i < ChunkCount(); i++)
+	{
+		if (mSlotContents[i].y == -1)
+			mEvictableSlots.push_back(i);
+	}
 
-				if (xPosition >= mWorldSize || xPosition < 0)
-					continue;
+	// Clear previous load list when moving across chunks, then load the missing chunks nearest first.
+	// Regions opened for chunks of the old list may never be used.
+	mLoadList = std::queue<Vector3i>();
+	mFileSystem.CancelRegionFileOpens();
+	for (const auto& Desired : mDesiredOrder)
+	{
+		if (FindSlot(Desired.second) < 0)
+			mLoadList.push(Desired.second);
+	}
+}
 
-				for (int32_t z = 0; z < HorizontalBounds; z++)
-				{
-					const int32_t zPosition = CameraChunkOffset.z + z;
+int32_t FChunkManager::FindSlot(const Vector3i& Position) const
+{
+	auto Found = mSlotMap.find(Position);
+	return (Found != mSlotMap.end()) ? (int32_t)Found->second : -1;
+}
 
-					if (zPosition >= mWorldSize || zPosition < 0)
-						continue;
+bool FChunkManager::IsSlotEditable(const uint32_t Index, const Vector3i& Position) const
+{
+	return mSlotKeys[Index].load(std::memory_order_acquire) == SlotKey(Position);
+}
 
-					const Vector4i ChunkPosition{ xPosition, yPosition, zPosition, 1 };
-					const int32_t VisibleChunkIndex = ChunkIndex(ChunkPosition);
+int32_t FChunkManager::FindVisibleSlot(const Vector3i& Position) const
+{
+	auto Found = mVisibleSlots.find(Position);
+	if (Found == mVisibleSlots.end())
+		return -1;
 
-					// If this visible chunk is not loaded, load it.
-					if (mChunkPositions[VisibleChunkIndex] != ChunkPosition)
-					{
-						mLoadList.push(ChunkPosition);
-					}
-				}
-			}
-		}
-	}
+	// The loader may have given the slot to another chunk since this one was swapped in
+	return IsSlotEditable(Found->second, Position) ? (int32_t)Found->second : -1;
 }
 
 void FChunkManager::UpdateRenderList()
@@ -482,13 +1209,68 @@ void FChunkManager::UpdateRenderList()
 	// Check each visible chunk against the frustum
 	const uint32_t ListSize = ChunkCount();
 
+	if (!mSortRenderList)
+	{
+		for (uint32_t i = 0; i < ListSize; i++)
+		{
+			Vector4f CenterFloats{mChunkPositions[i]};
+
+			if (!mChunks[i].IsEmpty() && ViewFrustum.IsUniformAABBVisible(CenterFloats, 1.0f))
+			{
+				mRenderList.push_back(i);
+			}
+		}
+
+		return;
+	}
+
+	// Key each visible chunk by its quantized squared distance to the camera, in the high bits above its index
+	const Vector3f CameraPosition = FCamera::Main->Transform.GetWorldPosition() / (float)FChunk::CHUNK_SIZE;
+	mRenderEntries.clear();
+
 	for (uint32_t i = 0; i < ListSize; i++)
 	{
 		Vector4f CenterFloats{mChunkPositions[i]};
 
 		if (!mChunks[i].IsEmpty() && ViewFrustum.IsUniformAABBVisible(CenterFloats, 1.0f))
 		{
-			mRenderList.push_back(i);
+			const Vector3f Offset = Vector3f{ CenterFloats.x + 0.5f, CenterFloats.y + 0.5f, CenterFloats.z + 0.5f } - CameraPosition;
+			const float DistanceKey = (Offset.x * Offset.x + Offset.y * Offset.y + Offset.z * Offset.z) * RENDER_DISTANCE_KEY_SCALE;
+			const uint64_t Key = (DistanceKey < 65535.0f) ? (uint64_t)DistanceKey : 65535;
+
+			mRenderEntries.push_back((Key << 32) | i);
+		}
+	}
+
+	// Two 8 bit passes of a stable radix sort order the entries front to back. Chunks at the
+	// same distance keep their slot order, so the order doesn't flicker between frames.
+	mRenderSortScratch.resize(mRenderEntries.size());
+	for (uint32_t Shift = 32; Shift < 48; Shift += 8)
+	{
+		uint32_t Offsets[256] = {};
+		for (const uint64_t Entry : mRenderEntries)
+		{
+			Offsets[(Entry >> Shift) & 0xFF]++;
 		}
+
+		uint32_t Total = 0;
+		for (uint32_t& Offset : Offsets)
+		{
+			const uint32_t Count = Offset;
+			Offset = Total;
+			Total += Count;
+		}
+
+		for (const uint64_t Entry : mRenderEntries)
+		{
+			mRenderSortScratch[Offsets[(Entry >> Shift) & 0xFF]++] = Entry;
+		}
+
+		mRenderEntries.swap(mRenderSortScratch);
+	}
+
+	for (const uint64_t Entry : mRenderEntries)
+	{
+		mRenderList.push_back((uint32_t)Entry);
 	}
 }
\ No newline at end of file
@@ -1,14 +1,19 @@
 #include "ChunkSystems\ChunkMesh.h"
 #include "Rendering\GLBindings.h"
 #include "Rendering\GLUtils.h"
+#include "Memory\MemoryTracker.h"
+#include <algorithm>
 
 GLuint FChunkMesh::BufferUsageMode = GL_STATIC_DRAW;
 
 FChunkMesh::FChunkMesh()
-	: mVertexArray(0)
+	: mPatchRanges()
+	, mBackState(BackBufferState::Cleared)
+	, mVertexArray(0)
 	, mActiveBuffer()
 {
 	mActiveBuffer = false;
+	mBufferBytes[Buffer::Vertex] = mBufferBytes[Buffer::Index] = 0;
 
 	// Setup vertex and index data with dummy object
 	// to prevent nullptr references
@@ -18,6 +23,24 @@ FChunkMesh::FChunkMesh()
 	mIndices[0] = IndexDataPtr{ new IndexData{} };
 	mIndices[1] = IndexDataPtr{ new IndexData{} };
 
+	mBuffers[Buffer::Vertex] = mBuffers[Buffer::Index] = 0;
+}
+
+
+FChunkMesh::~FChunkMesh()
+{
+	if (mVertexArray != 0)
+	{
+		glDeleteBuffers(2, mBuffers);
+		glDeleteVertexArrays(1, &mVertexArray);
+	}
+
+	SMemoryTracker::OnResize(EMemoryTag::ChunkGPU, mBufferBytes[Buffer::Vertex], 0);
+	SMemoryTracker::OnResize(EMemoryTag::ChunkGPU, mBufferBytes[Buffer::Index], 0);
+}
+
+void FChunkMesh::CreateGLObjects()
+{
 	glGenVertexArrays(1, &mVertexArray);
 	glGenBuffers(2, mBuffers);
 
@@ -29,14 +52,6 @@ FChunkMesh::FChunkMesh()
 			glEnableVertexAttribArray(GLAttributePosition::ChunkData);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mBuffers[Buffer::Index]);
 	glBindVertexArray(0);
-
-}
-
-
-FChunkMesh::~FChunkMesh()
-{
-	glDeleteBuffers(2, mBuffers);
-	glDeleteVertexArrays(1, &mVertexArray);
 }
 
 void FChunkMesh::AddVertexData(VertexDataPtr VertexData)
@@ -51,23 +66,163 @@ void FChunkMesh::AddIndexData(IndexDataPtr Indices)
 
 void FChunkMesh::Render(GLenum RenderMode)
 {
+	// Nothing was uploaded yet
+	if (mVertexArray == 0)
+		return;
+
 	glBindVertexArray(mVertexArray);
 	glDrawElements(RenderMode, mIndices[mActiveBuffer]->size(), GL_UNSIGNED_INT, BUFFER_OFFSET(0));
 }
 
-void FChunkMesh::SwapBuffer()
+void FChunkMesh::SwapBuffer(const bool Upload)
 {
-	glBindBuffer(GL_ARRAY_BUFFER, mBuffers[Buffer::Vertex]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * mVertices[!mActiveBuffer]->size(), mVertices[!mActiveBuffer]->data(), BufferUsageMode);
+	if (!Upload)
+	{
+		mActiveBuffer = !mActiveBuffer;
+		return;
+	}
+
+	if (mVertexArray == 0)
+		CreateGLObjects();
+
+	const Vertex* Vertices = mVertices[!mActiveBuffer]->data();
+	const uint32_t* Indices = mIndices[!mActiveBuffer]->data();
+	const size_t VertexBytes = sizeof(Vertex) * mVertices[!mActiveBuffer]->size();
+	const size_t IndexBytes = sizeof(uint32_t) * mIndices[!mActiveBuffer]->size();
+
+	// The GL buffers hold the active mesh, a patch of it only uploads the changed quads
+	if (mBackState == BackBufferState::Patched && VertexBytes <= mBufferBytes[Buffer::Vertex] && IndexBytes <= mBufferBytes[Buffer::Index])
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, mBuffers[Buffer::Vertex]);
+		for (const auto& Range : mPatchRanges)
+		{
+			glBufferSubData(GL_ARRAY_BUFFER, Range.first * 4 * sizeof(Vertex), Range.second * 4 * sizeof(Vertex), Vertices + Range.first * 4);
+		}
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mBuffers[Buffer::Index]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * mIndices[!mActiveBuffer]->size(), mIndices[!mActiveBuffer]->data(), BufferUsageMode);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mBuffers[Buffer::Index]);
+		for (const auto& Range : mPatchRanges)
+		{
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, Range.first * 6 * sizeof(uint32_t), Range.second * 6 * sizeof(uint32_t), Indices + Range.first * 6);
+		}
+	}
+	else
+	{
+		// Meshes that are patched keep growing, leave room for the slices of the next patches
+		const size_t VertexCapacity = (mBackState == BackBufferState::Patched) ? VertexBytes + VertexBytes / 4 : VertexBytes;
+		const size_t IndexCapacity = (mBackState == BackBufferState::Patched) ? IndexBytes + IndexBytes / 4 : IndexBytes;
+
+		glBindBuffer(GL_ARRAY_BUFFER, mBuffers[Buffer::Vertex]);
+		glBufferData(GL_ARRAY_BUFFER, VertexCapacity, nullptr, BufferUsageMode);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, VertexBytes, Vertices);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mBuffers[Buffer::Index]);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, IndexCapacity, nullptr, BufferUsageMode);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, IndexBytes, Indices);
+
+		SMemoryTracker::OnResize(EMemoryTag::ChunkGPU, mBufferBytes[Buffer::Vertex], VertexCapacity);
+		SMemoryTracker::OnResize(EMemoryTag::ChunkGPU, mBufferBytes[Buffer::Index], IndexCapacity);
+		mBufferBytes[Buffer::Vertex] = VertexCapacity;
+		mBufferBytes[Buffer::Index] = IndexCapacity;
+	}
 
 	mActiveBuffer = !mActiveBuffer;
 }
 
 void FChunkMesh::ClearBackBuffer()
 {
-	mVertices[!mActiveBuffer]   = VertexDataPtr{ new VertexData{} };
-	mIndices[!mActiveBuffer]    = IndexDataPtr{ new IndexData{} };
+	mVertices[!mActiveBuffer]->clear();
+	mIndices[!mActiveBuffer]->clear();
+	mSlices[!mActiveBuffer].clear();
+	mPatchRanges.clear();
+	mBackState = BackBufferState::Cleared;
+}
+
+void FChunkMesh::BeginBuild(const uint32_t QuadCount)
+{
+	ClearBackBuffer();
+	mVertices[!mActiveBuffer]->reserve(QuadCount * 4);
+	mIndices[!mActiveBuffer]->reserve(QuadCount * 6);
+	mSlices[!mActiveBuffer].assign(MAX_SLICES, SliceRange{ 0, 0, 0 });
+	mBackState = BackBufferState::Built;
+}
+
+void FChunkMesh::SetSlice(const uint32_t Slice, const uint32_t FirstQuad, const uint32_t QuadCount)
+{
+	ASSERT(Slice < MAX_SLICES && QuadCount <= UINT16_MAX);
+	mSlices[!mActiveBuffer][Slice] = SliceRange{ FirstQuad, (uint16_t)QuadCount, (uint16_t)QuadCount };
+}
+
+void FChunkMesh::BeginPatch(const bool IsActiveMeshStale)
+{
+	if (mBackState != BackBufferState::Cleared)
+		return;
+
+	// A cleared mesh was about to be swapped in, patches start from an empty mesh
+	if (IsActiveMeshStale)
+	{
+		mBackState = BackBufferState::Built;
+		return;
+	}
+
+	// Vectors keep their memory, so copying is cheap compared to meshing the whole chunk
+	*mVertices[!mActiveBuffer] = *mVertices[mActiveBuffer];
+	*mIndices[!mActiveBuffer] = *mIndices[mActiveBuffer];
+	mSlices[!mActiveBuffer] = mSlices[mActiveBuffer];
+	mBackState = BackBufferState::Patched;
+}
+
+void FChunkMesh::ReplaceSlice(const uint32_t Slice, const Vertex* Vertices, const uint32_t* Indices, const uint32_t QuadCount)
+{
+	ASSERT(Slice < MAX_SLICES && QuadCount <= UINT16_MAX);
+	ASSERT(mBackState != BackBufferState::Cleared);
+
+	VertexData& VertexBuffer = *mVertices[!mActiveBuffer];
+	IndexData& IndexBuffer = *mIndices[!mActiveBuffer];
+
+	// Meshes that were never built have no quads in any slice
+	std::vector<SliceRange>& Slices = mSlices[!mActiveBuffer];
+	if (Slices.empty())
+		Slices.assign(MAX_SLICES, SliceRange{ 0, 0, 0 });
+
+	SliceRange& Range = Slices[Slice];
+	if (QuadCount > Range.Capacity)
+	{
+		// The old range is left as degenerate quads
+		DegenerateQuads(Range.FirstQuad, Range.Capacity);
+		AddPatchRange(Range.FirstQuad, Range.Capacity);
+
+		Range.FirstQuad = (uint32_t)VertexBuffer.size() / 4;
+		Range.Capacity = (uint16_t)QuadCount;
+		VertexBuffer.resize(VertexBuffer.size() + QuadCount * 4);
+		IndexBuffer.resize(IndexBuffer.size() + QuadCount * 6);
+	}
+
+	const uint32_t BaseIndex = Range.FirstQuad * 4;
+	std::copy(Vertices, Vertices + QuadCount * 4, VertexBuffer.begin() + BaseIndex);
+	for (uint32_t i = 0; i < QuadCount * 6; i++)
+	{
+		IndexBuffer[Range.FirstQuad * 6 + i] = Indices[i] + BaseIndex;
+	}
+
+	DegenerateQuads(Range.FirstQuad + QuadCount, Range.Capacity - QuadCount);
+	AddPatchRange(Range.FirstQuad, Range.Capacity);
+	Range.QuadCount = (uint16_t)QuadCount;
+}
+
+void FChunkMesh::DegenerateQuads(const uint32_t FirstQuad, const uint32_t QuadCount)
+{
+	IndexData& IndexBuffer = *mIndices[!mActiveBuffer];
+	for (uint32_t Quad = FirstQuad; Quad < FirstQuad + QuadCount; Quad++)
+	{
+		std::fill(IndexBuffer.begin() + Quad * 6, IndexBuffer.begin() + Quad * 6 + 6, Quad * 4);
+	}
+}
+
+void FChunkMesh::AddPatchRange(const uint32_t FirstQuad, const uint32_t QuadCount)
+{
+	// Built meshes are uploaded whole
+	if (mBackState != BackBufferState::Patched || QuadCount == 0)
+		return;
+
+	mPatchRanges.push_back(std::make_pair(FirstQuad, QuadCount));
 }
\ No newline at end of file
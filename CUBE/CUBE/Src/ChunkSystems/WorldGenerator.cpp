@@ -4,7 +4,10 @@
 #include "FileIO\RegionFile.h"
 #include "Math\FMath.h"
 #include "SystemResources\SystemFile.h"
+#include "Clock.h"
 #include <algorithm>
+#include <atomic>
+#include <thread>
 
 FWorldGenerator::FWorldGenerator()
 	: mTerrainLevels()
@@ -13,6 +16,8 @@ FWorldGenerator::FWorldGenerator()
 	, mWorldSizeInChunks(2)
 	, mMaxHeight(1)
 	, mMinHeight(0)
+	, mThreadCount(std::max(std::thread::hardware_concurrency(), 1u))
+	, mLastBuildStats()
 {
 
 }
@@ -39,10 +44,14 @@ void FWorldGenerator::SetBounds(const Vector2f LowerBounds, const Vector2f Upper
 	mUpperBounds = UpperBounds;
 }
 
+void FWorldGenerator::SetThreadCount(const uint32_t ThreadCount)
+{
+	mThreadCount = std::max(ThreadCount, 1u);
+}
+
 void FWorldGenerator::Build(noise::module::Module& NoiseModule, const wchar_t* WorldName)
 {
-	utils::NoiseMap HeightMap;
-	BuildHeightMap(NoiseModule, HeightMap);
+	const uint64_t StartTime = FClock::ReadSystemTimer();
 	BuildWorldInfoFile(WorldName);
 
 	// Sort terrain levels in reverse order to be used in world generation.
@@ -52,69 +61,132 @@ void FWorldGenerator::Build(noise::module::Module& NoiseModule, const wchar_t* W
 	});
 
 	const int32_t NumRegions = (mWorldSizeInChunks / FRegionFile::RegionData::REGION_SIZE) + 1;
+	const int32_t TileCount = NumRegions * NumRegions;
+	std::atomic<int32_t> NextTile(0);
 
-	for (int32_t y = 0; y < NumRegions; y++)
+	auto WorkerLoop = [&]()
 	{
-		for (int32_t x = 0; x < NumRegions; x++)
+		// Each worker reuses its tile and chunk buffer for every tile it builds
+		FHeightTile Tile;
+		std::vector<uint8_t> ChunkDataBuffer;
+
+		for (int32_t TileIndex = NextTile++; TileIndex < TileCount; TileIndex = NextTile++)
 		{
-			for (int32_t z = 0; z < NumRegions; z++)
-			{
-				BuildRegion(WorldName, Vector3i{ x, y, z }, HeightMap);
-			}
+			BuildTile(NoiseModule, WorldName, TileIndex, Tile, ChunkDataBuffer);
 		}
+	};
+
+	// The calling thread builds tiles as well
+	const uint32_t ThreadCount = std::min(mThreadCount, (uint32_t)TileCount);
+	std::vector<std::thread> Workers;
+	for (uint32_t i = 1; i < ThreadCount; i++)
+	{
+		Workers.emplace_back(WorkerLoop);
+	}
+
+	WorkerLoop();
+
+	for (auto& Worker : Workers)
+	{
+		Worker.join();
 	}
 
+	// Regions past the edge of the world are built but hold no chunks, so they are not counted
+	const int32_t RegionSize = (int32_t)FRegionFile::RegionData::REGION_SIZE;
+	const int32_t RegionsWithChunks = (mWorldSizeInChunks + RegionSize - 1) / RegionSize;
+	mLastBuildStats.RegionCount = RegionsWithChunks * RegionsWithChunks * RegionsWithChunks;
+	mLastBuildStats.ThreadCount = ThreadCount;
+	mLastBuildStats.Seconds = FClock::CyclesToSeconds(FClock::ReadSystemTimer() - StartTime);
 }
 
-void FWorldGenerator::BuildHeightMap(const noise::module::Module& NoiseModule, utils::NoiseMap& HeightMapOut)
+void FWorldGenerator::BuildHeightTile(const noise::module::Module& NoiseModule, const Vector2i& WorldOrigin, const Vector2i& Size, FHeightTile& TileOut) const
 {
-	utils::NoiseMapBuilderPlane heightMapBuilder;
-	heightMapBuilder.SetSourceModule(NoiseModule);
-	heightMapBuilder.SetDestNoiseMap(HeightMapOut);
-
+	// Samples are spaced as if the whole world was one heightmap, so neighboring tiles line up.
+	// Heightmap rows run along the world x axis and columns along the world z axis.
 	const int32_t WorldSize = mWorldSizeInChunks * FChunk::CHUNK_SIZE;
-	heightMapBuilder.SetDestSize(WorldSize, WorldSize);
-	heightMapBuilder.SetBounds(mLowerBounds.x, mUpperBounds.x, mLowerBounds.y, mUpperBounds.y);
-	heightMapBuilder.Build();
+	const double RowDelta = (mUpperBounds.y - mLowerBounds.y) / (double)WorldSize;
+	const double ColumnDelta = (mUpperBounds.x - mLowerBounds.x) / (double)WorldSize;
+
+	TileOut.OriginX = WorldOrigin.x - TILE_BORDER;
+	TileOut.OriginZ = WorldOrigin.y - TILE_BORDER;
+	const int32_t Rows = Size.x + 2 * TILE_BORDER;
+	const int32_t Columns = Size.y + 2 * TILE_BORDER;
+
+	utils::NoiseMapBuilderPlane HeightMapBuilder;
+	HeightMapBuilder.SetSourceModule(NoiseModule);
+	HeightMapBuilder.SetDestNoiseMap(TileOut.Map);
+	HeightMapBuilder.SetDestSize(Columns, Rows);
+	HeightMapBuilder.SetBounds(mLowerBounds.x + TileOut.OriginZ * ColumnDelta, mLowerBounds.x + (TileOut.OriginZ + Columns) * ColumnDelta,
+		mLowerBounds.y + TileOut.OriginX * RowDelta, mLowerBounds.y + (TileOut.OriginX + Rows) * RowDelta);
+	HeightMapBuilder.Build();
 }
 
-void FWorldGenerator::BuildRegion(const wchar_t* WorldName, const Vector3i& RegionPosition, const utils::NoiseMap& HeightMapOut)
+void FWorldGenerator::BuildTile(const noise::module::Module& NoiseModule, const wchar_t* WorldName, const int32_t TileIndex, FHeightTile& Tile, std::vector<uint8_t>& ChunkDataBuffer) const
 {
 	const int32_t RegionSize = (int32_t)FRegionFile::RegionData::REGION_SIZE;
-	FRegionFile Region;
-	Region.Load(WorldName, RegionPosition);
+	const int32_t NumRegions = (mWorldSizeInChunks / RegionSize) + 1;
+	const Vector3i TilePosition{ TileIndex / NumRegions, 0, TileIndex % NumRegions };
 
-	// Determine the bounds of this region
-	Vector3i RegionBounds = Vector3i{ mWorldSizeInChunks, mWorldSizeInChunks, mWorldSizeInChunks } - (RegionPosition * RegionSize);
+	// Regions past the edge of the world have no chunks and don't need a heightmap
+	const Vector3i TileBounds = GetRegionBounds(TilePosition);
+	if (TileBounds.x > 0 && TileBounds.z > 0)
+	{
+		const Vector2i WorldOrigin{ TilePosition.x * RegionSize * FChunk::CHUNK_SIZE, TilePosition.z * RegionSize * FChunk::CHUNK_SIZE };
+		const Vector2i Size{ TileBounds.x * FChunk::CHUNK_SIZE, TileBounds.z * FChunk::CHUNK_SIZE };
+		BuildHeightTile(NoiseModule, WorldOrigin, Size, Tile);
+	}
 
-	for (int32_t i = 0; i < 3; i++)
+	for (int32_t y = 0; y < NumRegions; y++)
 	{
-		if (RegionBounds[i] >= RegionSize)
-			RegionBounds[i] = RegionSize;
-		else
-			RegionBounds[i] = RegionBounds[i] % RegionSize;
+		BuildRegion(WorldName, Vector3i{ TilePosition.x, y, TilePosition.z }, Tile, ChunkDataBuffer);
 	}
+}
+
+void FWorldGenerator::BuildRegion(const wchar_t* WorldName, const Vector3i& RegionPosition, const FHeightTile& HeightTile, std::vector<uint8_t>& ChunkDataBuffer) const
+{
+	const int32_t RegionSize = (int32_t)FRegionFile::RegionData::REGION_SIZE;
+	FRegionFile Region;
+	Region.Load(WorldName, RegionPosition);
 
+	const Vector3i RegionBounds = GetRegionBounds(RegionPosition);
 
-	// Build each chunk within the region
+	// Build each chunk within the region, chunks are written as soon as they are built
 	for (int32_t y = 0; y < RegionBounds.y; y++)
 	{
 		for (int32_t x = 0; x < RegionBounds.x; x++)
 		{
 			for (int32_t z = 0; z < RegionBounds.z; z++)
 			{
-				std::vector<uint8_t> ChunkDataBuffer;
+				ChunkDataBuffer.clear();
 				const Vector3i LocalChunkPosition{ x, y, z };
 				const Vector3i WorldChunkPosition = (LocalChunkPosition + (RegionPosition * RegionSize)) * FChunk::CHUNK_SIZE;
 
-				uint32_t DataSize = BuildChunk(WorldChunkPosition, HeightMapOut, ChunkDataBuffer);
+				uint32_t DataSize = BuildChunk(WorldChunkPosition, HeightTile, ChunkDataBuffer);
 				Region.WriteChunkData(LocalChunkPosition, ChunkDataBuffer.data(), DataSize);
 			}
 		}
 	}
 }
 
-uint32_t FWorldGenerator::BuildChunk(const Vector3i& WorldPosition, const utils::NoiseMap& HeightMap, std::vector<uint8_t>& DataOut)
+Vector3i FWorldGenerator::GetRegionBounds(const Vector3i& RegionPosition) const
+{
+	const int32_t RegionSize = (int32_t)FRegionFile::RegionData::REGION_SIZE;
+
+	// Determine the bounds of this region
+	Vector3i RegionBounds = Vector3i{ mWorldSizeInChunks, mWorldSizeInChunks, mWorldSizeInChunks } - (RegionPosition * RegionSize);
+
+	for (int32_t i = 0; i < 3; i++)
+	{
+		if (RegionBounds[i] >= RegionSize)
+			RegionBounds[i] = RegionSize;
+		else
+			RegionBounds[i] = RegionBounds[i] % RegionSize;
+	}
+
+	return RegionBounds;
+}
+
+uint32_t FWorldGenerator::BuildChunk(const Vector3i& WorldPosition, const FHeightTile& HeightTile, std::vector<uint8_t>& DataOut) const
 {
 	uint32_t DataSize = 0;
 	const float MinHeight = (float)mMinHeight;
@@ -134,10 +206,11 @@ uint32_t FWorldGenerator::BuildChunk(const Vector3i& WorldPosition, const utils:
 
 		for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
 		{
-			const float* SlabValues = HeightMap.GetConstSlabPtr(WorldPosition.x + x);
+			const float* SlabValues = HeightTile.Map.GetConstSlabPtr(WorldPosition.x + x - HeightTile.OriginX);
 			for (int32_t z = 0; z < FChunk::CHUNK_SIZE;)
 			{
-				const int32_t WorldZ = z + WorldPosition.z;
+				// Position within the tile, the border covers the sample read past the chunk edge
+				const int32_t WorldZ = z + WorldPosition.z - HeightTile.OriginZ;
 
 				float xzHeight = FMath::MapValue(SlabValues[WorldZ] + 1, -1.0f, 1.0f, MinHeight, MaxHeight);
 				bool IsAir = xzHeight < WorldY;
@@ -9,6 +9,8 @@ FTypelessPageArray::FTypelessPageArray()
 	, mPageSize(0)
 	, mActiveCount(0)
 	, mNextFreePage(0)
+	, mPages()
+	, mTag(EMemoryTag::Untagged)
 {
 }
 
@@ -26,6 +28,7 @@ void FTypelessPageArray::Init(const uint32_t PageSize, const uint32_t ElementSiz
 	mPageSize = PageSize;
 
 	DeleteAllPages();
+	mTag = SMemoryTracker::GetCurrentTag();
 	AddPage();
 	mNextFreePage = 0;
 }
@@ -97,7 +100,9 @@ void FTypelessPageArray::AddPage()
 	mPages.push_back(Page{});
 	Page& NewPage = mPages.back();
 
-	NewPage.Data = (uint8_t*)FMemory::AllocateAligned(std::max(mPageSize, mAlignment) * mElementSize, mAlignment);
+	NewPage.Bytes = std::max(mPageSize, mAlignment) * mElementSize;
+	NewPage.Data = (uint8_t*)FMemory::AllocateAligned(NewPage.Bytes, mAlignment);
+	SMemoryTracker::OnAllocate(mTag, NewPage.Bytes);
 
 	// Fill the dead list with every element
 	for (uint32_t i = 0; i < mPageSize; i++)
@@ -113,6 +118,7 @@ void FTypelessPageArray::DeleteAllPages()
 		if (Page.Data)
 		{
 			FMemory::FreeAligned(Page.Data);
+			SMemoryTracker::OnFree(mTag, Page.Bytes);
 		}
 	}
 
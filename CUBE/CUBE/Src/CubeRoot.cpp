@@ -18,6 +18,7 @@
 #include "Rendering\Screen.h"
 #include "Rendering\Camera.h"
 #include "Rendering\RenderSystem.h"
+#include "Rendering\MeshLoader.h"
 #include "Rendering\Light.h"
 #include "Components\Collider.h"
 #include "Components\RigidBody.h"
@@ -25,6 +26,7 @@
 #include "Audio\AudioSystem.h"
 #include "Debugging\DebugDraw.h"
 #include "Debugging\DebugText.h"
+#include "Memory\MemoryTracker.h"
 #include "Input\TextEntered.h"
 #include "Debugging\GameConsole.h"
 #include "ResourceHolder.h"
@@ -33,15 +35,42 @@
 #include "Components\SoundEmitter.h"
 #include "Components\SoundListener.h"
 
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
 using namespace Atlas;
 
+const float FCubeRoot::TICK_REPORT_INTERVAL = 10.0f;
+
+// Roots in the process, the first one creates the singletons shared by all of them
+static std::mutex SharedSingletonMutex;
+static uint32_t RootCount = 0;
+
 FCubeRoot::FCubeRoot(const wchar_t* AppName, const Vector2ui Resolution, const uint32_t WindowStyle)
-	: mGameWindow(sf::VideoMode{ Resolution.x, Resolution.y }, AppName, WindowStyle, sf::ContextSettings(24, 8, 0, 4, 4))
+	: mGameWindow(new sf::Window{ sf::VideoMode{ Resolution.x, Resolution.y }, AppName, WindowStyle, sf::ContextSettings(24, 8, 0, 4, 4) })
 	, mWorld()
 	, mChunkManager(nullptr)
 	, mRenderSystem(nullptr)
 	, mPhysicsSystem(nullptr)
+	, mAudioSystem(nullptr)
+	, mMeshLoader(nullptr)
 	, mGameObjectManager(nullptr)
+	, mIsHeadless(false)
+	, mMustStop(false)
+	, mTime()
+	, mTickTime(1.0f / 60.0f)
+	, mTicks(0)
+	, mOverruns(0)
+	, mTickCycles(0)
+	, mMaxTickCycles(0)
+	, mObjectCycles(0)
+	, mChunkCycles(0)
+	, mPhysicsCycles(0)
 {
 	if (glewInit())
 	{
@@ -49,7 +78,7 @@ FCubeRoot::FCubeRoot(const wchar_t* AppName, const Vector2ui Resolution, const u
 		exit(EXIT_FAILURE);
 	}
 
-	SMouseAxis::SetWindow(mGameWindow);
+	SMouseAxis::SetWindow(*mGameWindow);
 	SMouseAxis::UpdateDelta();
 	SMouseAxis::UpdateDelta();
 	
@@ -57,9 +86,48 @@ FCubeRoot::FCubeRoot(const wchar_t* AppName, const Vector2ui Resolution, const u
 	LoadEngineSystems();
 }
 
+FCubeRoot::FCubeRoot(const uint32_t TickRate)
+	: mGameWindow(nullptr)
+	, mWorld()
+	, mChunkManager(nullptr)
+	, mRenderSystem(nullptr)
+	, mPhysicsSystem(nullptr)
+	, mAudioSystem(nullptr)
+	, mMeshLoader(nullptr)
+	, mGameObjectManager(nullptr)
+	, mIsHeadless(true)
+	, mMustStop(false)
+	, mTime()
+	, mTickTime(1.0f / std::max(TickRate, 1u))
+	, mTicks(0)
+	, mOverruns(0)
+	, mTickCycles(0)
+	, mMaxTickCycles(0)
+	, mObjectCycles(0)
+	, mChunkCycles(0)
+	, mPhysicsCycles(0)
+{
+	AllocateSingletons();
+	LoadEngineSystems();
+}
+
 void FCubeRoot::AllocateSingletons()
 {
-	IFileSystem* FileSystem = new FFileSystem;
+	{
+		std::lock_guard<std::mutex> Lock(SharedSingletonMutex);
+		if (RootCount++ == 0)
+		{
+			// Must be hooked before any physics or audio objects are created
+			SMemoryTracker::InstallThirdPartyHooks();
+
+			IFileSystem* FileSystem = new FFileSystem;
+		}
+	}
+
+	// The debug singletons draw with OpenGL, only one root can have a window
+	if (mIsHeadless)
+		return;
+
 	FDebug::Text* DebugText = new FDebug::Text;
 	FDebug::Draw* DebugDraw = new FDebug::Draw;
 	FDebug::GameConsole*  GameConsole = new FDebug::GameConsole;
@@ -71,15 +139,30 @@ void FCubeRoot::LoadEngineSystems()
 
 	// Load all subsystems
 	FSystemManager& SystemManager = mWorld.GetSystemManager();
-	mRenderSystem = &SystemManager.AddSystem<FRenderSystem>(mGameWindow, *mChunkManager);
+	if (!mIsHeadless)
+	{
+		mMeshLoader = new FMeshLoader;
+		mRenderSystem = &SystemManager.AddSystem<FRenderSystem>(*mGameWindow, *mChunkManager);
+	}
 	mPhysicsSystem = &SystemManager.AddSystem<FPhysicsSystem>();
-	mAudioSystem = &SystemManager.AddSystem<FAudioSystem>();
+	if (!mIsHeadless)
+		mAudioSystem = &SystemManager.AddSystem<FAudioSystem>();
 
-	// Pass console dependencies
-	FDebug::GameConsole& Console = FDebug::GameConsole::GetInstance();
-	Console.SetChunkManager(mChunkManager);
-	Console.SetPhysicsSystem(mPhysicsSystem);
-	Console.SetRenderSystem(mRenderSystem);
+	if (mIsHeadless)
+	{
+		// Chunks only need their colliders
+		mChunkManager->SetRenderingEnabled(false);
+	}
+	else
+	{
+		// Pass console dependencies
+		FDebug::GameConsole& Console = FDebug::GameConsole::GetInstance();
+		Console.SetChunkManager(mChunkManager);
+		Console.SetPhysicsSystem(mPhysicsSystem);
+		Console.SetRenderSystem(mRenderSystem);
+		Console.SetAudioSystem(mAudioSystem);
+		Console.SetMeshLoader(mMeshLoader);
+	}
 
 	mChunkManager->SetPhysicsSystem(*mPhysicsSystem);
 	mGameObjectManager = &mWorld.GetObjectManager();
@@ -97,18 +180,48 @@ void FCubeRoot::LoadEngineSystems()
 
 FCubeRoot::~FCubeRoot()
 {
+	delete mMeshLoader;
 	delete mChunkManager;
-	delete FDebug::GameConsole::GetInstancePtr();
-	delete FDebug::Draw::GetInstancePtr();
-	delete FDebug::Text::GetInstancePtr();
-	delete IFileSystem::GetInstancePtr();
+	if (!mIsHeadless)
+	{
+		delete FDebug::GameConsole::GetInstancePtr();
+		delete FDebug::Draw::GetInstancePtr();
+		delete FDebug::Text::GetInstancePtr();
+	}
+
+	std::lock_guard<std::mutex> Lock(SharedSingletonMutex);
+	if (--RootCount == 0)
+		delete IFileSystem::GetInstancePtr();
 }
 
 void FCubeRoot::Start()
 {
+	mMustStop = false;
+
+	// Each root keeps its own time, so roots can run on different threads
+	STime::SetThreadTime(&mTime);
 	STime::StartGameTimer();
 	mWorld.Start();
-	GameLoop();
+
+	if (mIsHeadless)
+		HeadlessLoop();
+	else
+		GameLoop();
+
+	STime::SetThreadTime(nullptr);
+}
+
+FCubeRoot::FTickStats FCubeRoot::GetTickStats() const
+{
+	FTickStats Stats;
+	Stats.Ticks = mTicks;
+	Stats.Overruns = mOverruns;
+	Stats.AverageTick = (mTicks > 0) ? FClock::CyclesToSeconds(mTickCycles / mTicks) : 0.0f;
+	Stats.MaxTick = FClock::CyclesToSeconds(mMaxTickCycles);
+	Stats.AverageObjects = (mTicks > 0) ? FClock::CyclesToSeconds(mObjectCycles / mTicks) : 0.0f;
+	Stats.AverageChunks = (mTicks > 0) ? FClock::CyclesToSeconds(mChunkCycles / mTicks) : 0.0f;
+	Stats.AveragePhysics = (mTicks > 0) ? FClock::CyclesToSeconds(mPhysicsCycles / mTicks) : 0.0f;
+	return Stats;
 }
 
 void FCubeRoot::GameLoop()
@@ -116,13 +229,14 @@ void FCubeRoot::GameLoop()
 	STime::SetFixedUpdate(1.0f / 60.0f);
 
 	// Game Loop
-	while (mGameWindow.isOpen())
+	while (mGameWindow->isOpen() && !mMustStop)
 	{	
 		mGameObjectManager->Update();
 		mChunkManager->Update();
 
 		mPhysicsSystem->Update();
 		mAudioSystem->Update();
+		mMeshLoader->Update();
 		mRenderSystem->Update();
 
 		STime::UpdateGameTimer();
@@ -130,6 +244,77 @@ void FCubeRoot::GameLoop()
 	}
 }
 
+void FCubeRoot::HeadlessLoop()
+{
+	STime::SetFixedUpdate(mTickTime);
+
+	const uint64_t TickCycles = FClock::SecondsToCycles(mTickTime);
+	const uint32_t TicksPerReport = std::max((uint32_t)(TICK_REPORT_INTERVAL / mTickTime), 1u);
+	uint64_t TickNumber = 0;
+	uint64_t NextTick = FClock::ReadSystemTimer();
+
+	while (!mMustStop)
+	{
+		const uint64_t TickStart = FClock::ReadSystemTimer();
+		mOnTick.Invoke(TickNumber++);
+
+		mGameObjectManager->Update();
+		const uint64_t ObjectsEnd = FClock::ReadSystemTimer();
+
+		mChunkManager->Update();
+		const uint64_t ChunksEnd = FClock::ReadSystemTimer();
+
+		mPhysicsSystem->Update();
+		const uint64_t TickEnd = FClock::ReadSystemTimer();
+
+		mObjectCycles += ObjectsEnd - TickStart;
+		mChunkCycles += ChunksEnd - ObjectsEnd;
+		mPhysicsCycles += TickEnd - ChunksEnd;
+		mTickCycles += TickEnd - TickStart;
+		mMaxTickCycles = std::max(mMaxTickCycles, TickEnd - TickStart);
+		mTicks++;
+
+		// The world always advances by a whole tick, an overrun delays the following ticks
+		STime::StepGameTimer(mTickTime);
+		NextTick += TickCycles;
+		if (TickEnd > NextTick)
+		{
+			mOverruns++;
+			NextTick = TickEnd;
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds((uint64_t)(FClock::CyclesToSeconds(NextTick - TickEnd) * 1000000.0f)));
+		}
+
+		if (mTicks == TicksPerReport)
+			ReportTicks();
+	}
+}
+
+void FCubeRoot::ReportTicks()
+{
+	const FTickStats Stats = GetTickStats();
+	const FChunkManager::FResidencyStats Residency = mChunkManager->GetResidencyStats();
+
+	// Printed at once so reports of roots on other threads don't interleave
+	std::ostringstream Report;
+	Report << std::fixed << std::setprecision(2)
+		<< "Ticks: " << Stats.Ticks << " Overruns: " << Stats.Overruns
+		<< " Tick: " << Stats.AverageTick * 1000.0f << " ms (max " << Stats.MaxTick * 1000.0f << " ms, budget " << mTickTime * 1000.0f << " ms)"
+		<< " Objects: " << Stats.AverageObjects * 1000.0f << " ms Chunks: " << Stats.AverageChunks * 1000.0f << " ms Physics: " << Stats.AveragePhysics * 1000.0f << " ms"
+		<< " Resident: " << Residency.Resident << "/" << Residency.Slots << " Viewpoints: " << Residency.Viewpoints << "\n";
+	std::cout << Report.str() << std::flush;
+
+	mTicks = 0;
+	mOverruns = 0;
+	mTickCycles = 0;
+	mMaxTickCycles = 0;
+	mObjectCycles = 0;
+	mChunkCycles = 0;
+	mPhysicsCycles = 0;
+}
+
 void FCubeRoot::ServiceEvents()
 {
 	// Windows events
@@ -143,10 +328,10 @@ void FCubeRoot::ServiceEvents()
 
 		
 	// Service window events
-	while (mGameWindow.pollEvent(Event))
+	while (mGameWindow->pollEvent(Event))
 	{
 		if (Event.type == Event.Closed || SButtonEvent::GetKeyDown(sf::Keyboard::Escape))
-			mGameWindow.close();
+			mGameWindow->close();
 
 		if (SButtonEvent::IsButtonEvent(Event))
 		{
@@ -4,9 +4,16 @@
 #include "Input\TextEntered.h"
 #include "Physics\PhysicsSystem.h"
 #include "ChunkSystems\ChunkManager.h"
+#include "Rendering\RenderSystem.h"
+#include "Audio\AudioSystem.h"
+#include "Rendering\MeshLoader.h"
 #include "Rendering\Screen.h"
 #include "Rendering\Camera.h"
 #include "STime.h"
+#include "Memory\MemoryTracker.h"
+#include "ChunkSystems\ChunkCodec.h"
+#include <string>
+#include <sstream>
 
 namespace FDebug
 {
@@ -15,9 +22,12 @@ namespace FDebug
 		, mTextMarkup()
 		, mPhysicsSystem(nullptr)
 		, mRenderSystem(nullptr)
+		, mAudioSystem(nullptr)
 		, mChunkManager(nullptr)
+		, mMeshLoader(nullptr)
 		, mIsActive(false)
 		, mDrawPhysics(false)
+		, mShowMemoryStats(false)
 	{
 		const vec4 White{ { 1, 1, 1, 1 } };
 		const vec4 Background{ { 0.3f, 0.3f, 0.3f, 0.8f } };
@@ -62,19 +72,106 @@ namespace FDebug
 		swprintf_s(String, L"+");
 		DebugText.AddText(std::wstring{ String }, SScreen::GetResolution() / 2, TextMarkup);
 
-		swprintf_s(String, L"Chunks used: %d", FChunk::ChunkAllocator.Size());
-		DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 100), TextMarkup);
+		if (mChunkManager)
+		{
+			FChunk::FAllocators& ChunkAllocators = mChunkManager->GetChunkAllocators();
+			swprintf_s(String, L"Chunks used: %d   Block pages: %d   Chunk memory: %.1f MB", ChunkAllocators.MeshAllocator.Size(), ChunkAllocators.PageAllocator.Size(), ChunkAllocators.CommittedBytes() / (1024.0f * 1024.0f));
+			DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 100), TextMarkup);
+		}
 
 		Vector3i ChunkPosition = Vector3i(CameraPosition.x / FChunk::CHUNK_SIZE, CameraPosition.y / FChunk::CHUNK_SIZE, CameraPosition.z / FChunk::CHUNK_SIZE);
 		swprintf_s(String, L"Chunk Position: %d %d %d", ChunkPosition.x, ChunkPosition.y, ChunkPosition.z);
 		DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 150), TextMarkup);
 
+		swprintf_s(String, L"Scratch arena peak: %.1f KB", SScratchArena::GetPeakUsage() / 1024.0f);
+		DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 200), TextMarkup);
+
+		if (mChunkManager)
+		{
+			const FChunkPayloadCache::FStats CacheStats = mChunkManager->GetPayloadCacheStats();
+			const uint64_t Lookups = CacheStats.Hits + CacheStats.Misses;
+			swprintf_s(String, L"Chunk cache: %u chunks  %.1f MB  hit rate %.1f%%  write backs %llu", CacheStats.Entries, CacheStats.Bytes / (1024.0f * 1024.0f),
+				(Lookups > 0) ? (100.0f * CacheStats.Hits / Lookups) : 0.0f, CacheStats.WriteBacks);
+			DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 250), TextMarkup);
+
+			const FRegionFileCache::FStats RegionStats = mChunkManager->GetRegionFileStats();
+			swprintf_s(String, L"Region files: %u open  %u pinned  %u tables  opens %llu  closes %llu", RegionStats.OpenFiles, RegionStats.PinnedFiles,
+				RegionStats.Tables, RegionStats.Opens, RegionStats.Closes);
+			DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 300), TextMarkup);
+
+			// Compare the visible time of a world with a cold and a warm mesh cache
+			const FChunkMeshCache::FStats MeshStats = mChunkManager->GetMeshCacheStats();
+			swprintf_s(String, L"Mesh cache: hits %llu  misses %llu  stale %llu  %.1f MB read  world visible in %.2fs", MeshStats.Hits, MeshStats.Misses,
+				MeshStats.Stale, MeshStats.Bytes / (1024.0f * 1024.0f), mChunkManager->GetWorldVisibleTime());
+			DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 350), TextMarkup);
+
+			const FChunkWriteQueue::FStats WriteStats = mChunkManager->GetWriteQueueStats();
+			swprintf_s(String, L"Write queue: %u queued (peak %u)  %.1f MB  writes %llu  coalesced %llu  stalls %llu  latency %.1f ms (max %.1f ms)",
+				WriteStats.Depth, WriteStats.PeakDepth, WriteStats.Bytes / (1024.0f * 1024.0f), WriteStats.Writes, WriteStats.Coalesced, WriteStats.Stalls,
+				WriteStats.AverageLatency * 1000.0f, WriteStats.MaxLatency * 1000.0f);
+			DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 400), TextMarkup);
+
+			// Compare with "AsyncChunkReads false" on a cold page cache
+			const FWorldFileSystem::FReadStats ReadStats = mChunkManager->GetChunkReadStats();
+			swprintf_s(String, L"Chunk reads (%ls): %llu  batches %llu  retries %llu  latency %.2f ms (p99 %.2f ms  max %.2f ms)", ReadStats.Backend,
+				ReadStats.Reads, ReadStats.Batches, ReadStats.Retries, ReadStats.AverageLatency * 1000.0f, ReadStats.P99Latency * 1000.0f, ReadStats.MaxLatency * 1000.0f);
+			DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 450), TextMarkup);
+
+			const FChunkSummaryCache::FStats SummaryStats = mChunkManager->GetSummaryCacheStats();
+			swprintf_s(String, L"Chunk summaries: %llu lookups  %llu uniform (%.1f%%)  %llu stored  %u regions  %llu meshes skipped", SummaryStats.Lookups,
+				SummaryStats.Uniform, SummaryStats.Lookups ? 100.0f * SummaryStats.Uniform / SummaryStats.Lookups : 0.0f, SummaryStats.Stores,
+				SummaryStats.Tables, mChunkManager->GetSkippedMeshCount());
+			DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 500), TextMarkup);
+
+			const FChunkManager::FResidencyStats Residency = mChunkManager->GetResidencyStats();
+			swprintf_s(String, L"Residency: %u viewpoints  %u requested  %u desired  %u / %u slots  loads %llu  evictions %llu", Residency.Viewpoints,
+				Residency.Requested, Residency.Desired, Residency.Resident, Residency.Slots, Residency.Loads, Residency.Evictions);
+			DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 600), TextMarkup);
+
+			// Compare with "MeshPatching false" while placing blocks
+			const FChunkManager::FMeshUpdateStats MeshUpdates = mChunkManager->GetMeshUpdateStats();
+			swprintf_s(String, L"Mesh updates: %llu patched  %llu rebuilt  %llu stale held  edit to visible %.1f ms (max %.1f ms)", MeshUpdates.Patches,
+				MeshUpdates.Rebuilds, MeshUpdates.StaleSwaps, MeshUpdates.AverageLatency * 1000.0f, MeshUpdates.MaxLatency * 1000.0f);
+			DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 650), TextMarkup);
+		}
+
+		if (mRenderSystem)
+		{
+			// Compare with "FrontToBack false", "ShowOverdraw true" shows where the fragments are shaded
+			const Vector2ui Resolution = SScreen::GetResolution();
+			const uint64_t Fragments = mRenderSystem->GetGBufferFragmentCount();
+			swprintf_s(String, L"GBuffer fragments: %llu  (%.2f per pixel)", Fragments, (float)Fragments / (Resolution.x * Resolution.y));
+			DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 550), TextMarkup);
+		}
+
+		if (mAudioSystem)
+		{
+			// Compare with a lower "MaxVoices" while many emitters play
+			const FAudioSystem::FStats AudioStats = mAudioSystem->GetStats();
+			swprintf_s(String, L"Audio: %u emitters  %u real  %u virtual  %llu virtualized  %llu 3D updates  sounds %u (%u streams, %u loading)  hits %llu / %llu",
+				AudioStats.Emitters, AudioStats.RealVoices, AudioStats.VirtualVoices, AudioStats.Virtualizations, AudioStats.AttributeUpdates,
+				AudioStats.Cache.Resident, AudioStats.Cache.Streams, AudioStats.Cache.Loading, AudioStats.Cache.Hits, AudioStats.Cache.Requests);
+			DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 700), TextMarkup);
+		}
+
+		if (mMeshLoader)
+		{
+			const FMeshLoader::FStats MeshStats = mMeshLoader->GetStats();
+			swprintf_s(String, L"Meshes: %llu loaded  %u pending  %llu failed  %.1f MB uploaded  latency %.2f ms (max %.2f ms)  cold start %.2f ms",
+				MeshStats.Loaded, MeshStats.Pending, MeshStats.Failed, MeshStats.UploadedBytes / (1024.0f * 1024.0f),
+				MeshStats.AverageLatency * 1000.0f, MeshStats.MaxLatency * 1000.0f, MeshStats.ColdStartTime * 1000.0f);
+			DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 750), TextMarkup);
+		}
+
 		///////////////////////////////////////////////
 		///////////////////////////////
 
 		if (mDrawPhysics)
 			mPhysicsSystem->RenderCollisionObjects();
 
+		if (mShowMemoryStats)
+			RenderMemoryStats();
+
 		if (SButtonEvent::GetKeyDown(sf::Keyboard::Tilde))
 		{
 			mIsActive = !mIsActive;
@@ -127,11 +224,90 @@ namespace FDebug
 		{
 			mChunkManager->LoadWorld(mCommandBuffer.substr(10).c_str());
 		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 11) == std::wstring{ L"CreateWorld" })
+		{
+			// CreateWorld <name> <size> <seed>
+			std::wistringstream Arguments{ mCommandBuffer.substr(11) };
+			std::wstring WorldName;
+			uint32_t WorldSize = 0, Seed = 0;
+			if (Arguments >> WorldName >> WorldSize >> Seed)
+				mChunkManager->CreateWorld(WorldName.c_str(), WorldSize, Seed);
+		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 22) == std::wstring{ L"PersistGeneratedChunks" })
+		{
+			mChunkManager->SetPersistGeneratedChunks(mCommandBuffer.size() > 23 && mCommandBuffer.substr(23) == std::wstring{ L"true" });
+		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 9) == std::wstring{ L"MeshCache" })
+		{
+			mChunkManager->SetMeshCacheEnabled(!(mCommandBuffer.size() > 10 && mCommandBuffer.substr(10) == std::wstring{ L"false" }));
+		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 15) == std::wstring{ L"AsyncChunkReads" })
+		{
+			mChunkManager->SetAsyncChunkReads(!(mCommandBuffer.size() > 16 && mCommandBuffer.substr(16) == std::wstring{ L"false" }));
+		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 11) == std::wstring{ L"FrontToBack" })
+		{
+			mChunkManager->SetFrontToBackRendering(!(mCommandBuffer.size() > 12 && mCommandBuffer.substr(12) == std::wstring{ L"false" }));
+		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 12) == std::wstring{ L"MeshPatching" })
+		{
+			mChunkManager->SetMeshPatching(!(mCommandBuffer.size() > 13 && mCommandBuffer.substr(13) == std::wstring{ L"false" }));
+		}
+		else if (mRenderSystem && mCommandBuffer.substr(0, 12) == std::wstring{ L"ShowOverdraw" })
+		{
+			mRenderSystem->SetOverdrawView(mCommandBuffer.size() > 13 && mCommandBuffer.substr(13) == std::wstring{ L"true" });
+		}
+		else if (mAudioSystem && mCommandBuffer.substr(0, 9) == std::wstring{ L"MaxVoices" })
+		{
+			if (mCommandBuffer.size() > 10)
+				mAudioSystem->SetMaxVoices((uint32_t)std::stoi(mCommandBuffer.substr(10)));
+		}
 		else if (mChunkManager && mCommandBuffer.substr(0, 15) == std::wstring{ L"SetViewDistance" })
 		{
 			std::wstring Distance = mCommandBuffer.substr(16, 18);
 			mChunkManager->SetViewDistance((int32_t)std::stoi(Distance));
 		}
+		else if (mCommandBuffer.substr(0, 13) == std::wstring{ L"SetChunkCodec" })
+		{
+			// Only affects chunks written from now on, stored chunks keep their codec until rewritten
+			const EChunkCodec::Type Codec = (mCommandBuffer.size() > 14) ? SChunkCodecs::Find(mCommandBuffer.substr(14).c_str()) : EChunkCodec::Count;
+			if (Codec != EChunkCodec::Count)
+				SChunkCodecs::SetDefault(Codec);
+		}
+		else if (mCommandBuffer.substr(0, 11) == std::wstring{ L"MemoryStats" })
+		{
+			mShowMemoryStats = (mCommandBuffer.size() > 12 && mCommandBuffer.substr(12) == std::wstring{ L"true" });
+		}
+		else if (mCommandBuffer.substr(0, 10) == std::wstring{ L"DumpMemory" })
+		{
+			const std::wstring Filename = (mCommandBuffer.size() > 11) ? mCommandBuffer.substr(11) : std::wstring{ L"MemoryStats.txt" };
+			SMemoryTracker::DumpToFile(std::string{ Filename.begin(), Filename.end() }.c_str());
+		}
+	}
+
+	void GameConsole::RenderMemoryStats()
+	{
+		static const int32_t LineHeight = 25;
+		auto& DebugText = FDebug::Text::GetInstance();
+		const Vector2i Start{ (int32_t)SScreen::GetResolution().x - 560, (int32_t)SScreen::GetResolution().y - 50 };
+
+		wchar_t String[250];
+		swprintf_s(String, L"%-16S %10S %10S %8S", "Memory", "Live MB", "Peak MB", "Count");
+		DebugText.AddText(std::wstring{ String }, Start, mTextMarkup);
+
+		uint64_t TotalLive = 0;
+		for (uint32_t i = 0; i < (uint32_t)EMemoryTag::Count; i++)
+		{
+			const SMemoryTracker::FTagStats Stats = SMemoryTracker::GetStats((EMemoryTag)i);
+			TotalLive += Stats.LiveBytes;
+
+			swprintf_s(String, L"%-16S %10.2f %10.2f %8llu", SMemoryTracker::GetTagName((EMemoryTag)i),
+				Stats.LiveBytes / (1024.0f * 1024.0f), Stats.PeakBytes / (1024.0f * 1024.0f), Stats.LiveCount);
+			DebugText.AddText(std::wstring{ String }, Start - Vector2i{ 0, (int32_t)(i + 1) * LineHeight }, mTextMarkup);
+		}
+
+		swprintf_s(String, L"%-16S %10.2f", "Total", TotalLive / (1024.0f * 1024.0f));
+		DebugText.AddText(std::wstring{ String }, Start - Vector2i{ 0, ((int32_t)EMemoryTag::Count + 1) * LineHeight }, mTextMarkup);
 	}
 
 	void GameConsole::SetPhysicsSystem(FPhysicsSystem* Physics)
@@ -144,8 +320,18 @@ namespace FDebug
 		mRenderSystem = RenderSystem;
 	}
 
+	void GameConsole::SetAudioSystem(FAudioSystem* AudioSystem)
+	{
+		mAudioSystem = AudioSystem;
+	}
+
 	void GameConsole::SetChunkManager(FChunkManager* ChunkManager)
 	{
 		mChunkManager = ChunkManager;
 	}
+
+	void GameConsole::SetMeshLoader(FMeshLoader* MeshLoader)
+	{
+		mMeshLoader = MeshLoader;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "FileIO\AsyncFileReader.h"
+
+#if defined(__linux__)
+	#include "Posix\IoUringFileReader.h"
+#endif
+
+#include <algorithm>
+
+std::unique_ptr<IAsyncFileReader> IAsyncFileReader::Create(const uint32_t QueueDepth)
+{
+#if defined(__linux__)
+	// Kernels without io_uring, or sandboxes that block it, fall back to the thread pool
+	std::unique_ptr<IAsyncFileReader> Reader = FIoUringFileReader::Create(QueueDepth);
+	if (Reader)
+		return Reader;
+#endif
+
+	return std::unique_ptr<IAsyncFileReader>{ new FThreadPoolFileReader(QueueDepth) };
+}
+
+FThreadPoolFileReader::FThreadPoolFileReader(const uint32_t QueueDepth, const uint32_t ThreadCount)
+	: mRequests()
+	, mResults()
+	, mWorkers()
+	, mQueueDepth(QueueDepth)
+	, mPendingCount(0)
+	, mMutex()
+	, mRequestAdded()
+	, mReadCompleted()
+	, mMustShutdown(false)
+{
+	for (uint32_t i = 0; i < ThreadCount; i++)
+	{
+		mWorkers.push_back(std::thread(&FThreadPoolFileReader::WorkerThreadLoop, this));
+	}
+}
+
+FThreadPoolFileReader::~FThreadPoolFileReader()
+{
+	{
+		std::lock_guard<std::mutex> Lock(mMutex);
+		mMustShutdown = true;
+	}
+
+	mRequestAdded.notify_all();
+	for (std::thread& Worker : mWorkers)
+	{
+		Worker.join();
+	}
+}
+
+uint32_t FThreadPoolFileReader::Submit(const FAsyncReadRequest* Requests, const uint32_t Count)
+{
+	uint32_t Accepted;
+	{
+		std::lock_guard<std::mutex> Lock(mMutex);
+		Accepted = std::min(Count, mQueueDepth - mPendingCount);
+
+		mRequests.insert(mRequests.end(), Requests, Requests + Accepted);
+		mPendingCount += Accepted;
+	}
+
+	mRequestAdded.notify_all();
+	return Accepted;
+}
+
+uint32_t FThreadPoolFileReader::Wait(FAsyncReadResult* ResultsOut, const uint32_t MaxResults, const uint32_t MinResults)
+{
+	std::unique_lock<std::mutex> Lock(mMutex);
+
+	const uint32_t WaitCount = std::min(MinResults, mPendingCount);
+	mReadCompleted.wait(Lock, [this, WaitCount]() { return mResults.size() >= WaitCount; });
+
+	const uint32_t Count = std::min(MaxResults, (uint32_t)mResults.size());
+	std::copy(mResults.begin(), mResults.begin() + Count, ResultsOut);
+	mResults.erase(mResults.begin(), mResults.begin() + Count);
+	mPendingCount -= Count;
+
+	return Count;
+}
+
+void FThreadPoolFileReader::WorkerThreadLoop()
+{
+	std::unique_lock<std::mutex> Lock(mMutex);
+
+	while (true)
+	{
+		mRequestAdded.wait(Lock, [this]() { return mMustShutdown || !mRequests.empty(); });
+
+		if (mRequests.empty())
+			break;
+
+		const FAsyncReadRequest Request = mRequests.front();
+		mRequests.pop_front();
+
+		Lock.unlock();
+		const bool Succeeded = Request.File->ReadAt(Request.Buffer, Request.Size, Request.Offset);
+		Lock.lock();
+
+		mResults.push_back(FAsyncReadResult{ Request.UserData, Succeeded ? (int64_t)Request.Size : -1 });
+		mReadCompleted.notify_all();
+	}
+}
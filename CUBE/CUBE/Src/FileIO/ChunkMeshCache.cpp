@@ -0,0 +1,261 @@
+#include "FileIO\ChunkMeshCache.h"
+#include "Misc\Assertions.h"
+#include "Memory\ScratchArena.h"
+#include <cstring>
+#include <wchar.h>
+
+// Bytes stored for each quad, its geometry, block type and corner occlusion
+static const uint32_t BYTES_PER_QUAD = sizeof(uint32_t) + sizeof(FBlockTypes::BlockID) + sizeof(uint8_t);
+
+FChunkMeshCache::FChunkMeshCache(const wchar_t* WorldName, const uint32_t MaxOpenFiles)
+	: mWorldName(WorldName)
+	, mSidecars()
+	, mUsageList()
+	, mMaxOpenFiles(MaxOpenFiles)
+	, mHits()
+	, mMisses()
+	, mStale()
+	, mStores()
+	, mBytes()
+{
+	mHits = 0;
+	mMisses = 0;
+	mStale = 0;
+	mStores = 0;
+	mBytes = 0;
+}
+
+FChunkMeshCache::~FChunkMeshCache()
+{
+	CloseAll();
+}
+
+bool FChunkMeshCache::Find(const Vector3i& ChunkPosition, const uint64_t BlockHash, TScratchArray<FChunk::MeshQuad>& QuadsOut)
+{
+	FSidecar* Sidecar = GetSidecar(FRegionFile::ChunkToRegionPosition(ChunkPosition));
+	if (!Sidecar)
+	{
+		mMisses++;
+		return false;
+	}
+
+	const Vector3i LocalPosition = FRegionFile::LocalRegionPosition(ChunkPosition);
+	const Entry& ChunkEntry = Sidecar->Table.ChunkEntry[GetTableIndex(LocalPosition)];
+
+	if (ChunkEntry.Offset == 0)
+	{
+		mMisses++;
+		return false;
+	}
+
+	if (ChunkEntry.BlockHash != BlockHash)
+	{
+		mStale++;
+		return false;
+	}
+
+	const uint32_t QuadCount = ChunkEntry.QuadCount;
+	if (QuadCount > 0)
+	{
+		// Make room for the quads before the file data, which is released when this scope ends
+		const uint32_t FirstQuad = QuadsOut.Size();
+		QuadsOut.Resize(FirstQuad + QuadCount);
+
+		FScratchScope Scratch;
+		uint8_t* Data = static_cast<uint8_t*>(Scratch.GetArena().Allocate(QuadCount * BYTES_PER_QUAD));
+
+		if (!Sidecar->File->ReadAt(Data, QuadCount * BYTES_PER_QUAD, ChunkEntry.Offset))
+		{
+			QuadsOut.Resize(FirstQuad);
+			mMisses++;
+			return false;
+		}
+
+		// Expand geometry, block types and occlusion into quads
+		FChunk::MeshQuad* Quads = QuadsOut.Data() + FirstQuad;
+		const uint8_t* BlockTypes = Data + QuadCount * sizeof(uint32_t);
+		const uint8_t* Occlusion = BlockTypes + QuadCount * sizeof(FBlockTypes::BlockID);
+
+		for (uint32_t i = 0; i < QuadCount; i++)
+		{
+			std::memcpy(&Quads[i].Geometry, Data + i * sizeof(uint32_t), sizeof(uint32_t));
+			Quads[i].BlockType = BlockTypes[i];
+			Quads[i].Occlusion = Occlusion[i];
+		}
+
+		mBytes += QuadCount * BYTES_PER_QUAD;
+	}
+
+	mHits++;
+	return true;
+}
+
+void FChunkMeshCache::Store(const Vector3i& ChunkPosition, const uint64_t BlockHash, const FChunk::MeshQuad* Quads, const uint32_t QuadCount)
+{
+	FSidecar* Sidecar = GetSidecar(FRegionFile::ChunkToRegionPosition(ChunkPosition));
+	if (!Sidecar)
+		return;
+
+	const Vector3i LocalPosition = FRegionFile::LocalRegionPosition(ChunkPosition);
+	Entry& ChunkEntry = Sidecar->Table.ChunkEntry[GetTableIndex(LocalPosition)];
+
+	uint32_t Offset = ChunkEntry.Offset;
+	if (QuadCount > 0)
+	{
+		FScratchScope Scratch;
+		const uint32_t DataSize = QuadCount * BYTES_PER_QUAD;
+		uint8_t* Data = static_cast<uint8_t*>(Scratch.GetArena().Allocate(DataSize));
+		uint8_t* BlockTypes = Data + QuadCount * sizeof(uint32_t);
+		uint8_t* Occlusion = BlockTypes + QuadCount * sizeof(FBlockTypes::BlockID);
+
+		for (uint32_t i = 0; i < QuadCount; i++)
+		{
+			std::memcpy(Data + i * sizeof(uint32_t), &Quads[i].Geometry, sizeof(uint32_t));
+			BlockTypes[i] = Quads[i].BlockType;
+			Occlusion[i] = Quads[i].Occlusion;
+		}
+
+		// Reuse the old space if the mesh still fits, otherwise append it.
+		// Space of meshes that moved is not reclaimed.
+		if (Offset == 0 || GetAllocatedSize(QuadCount) > GetAllocatedSize(ChunkEntry.QuadCount))
+		{
+			Offset = (uint32_t)Sidecar->FileSize;
+			Sidecar->FileSize += GetAllocatedSize(QuadCount);
+		}
+
+		if (!Sidecar->File->WriteAt(Data, DataSize, Offset))
+			return;
+	}
+	else if (Offset == 0)
+	{
+		// Meshes without quads have no data, point them at the end of the table
+		Offset = sizeof(Header);
+	}
+
+	ChunkEntry.BlockHash = BlockHash;
+	ChunkEntry.Offset = Offset;
+	ChunkEntry.QuadCount = QuadCount;
+	Sidecar->IsTableDirty = true;
+	mStores++;
+}
+
+void FChunkMeshCache::CloseAll()
+{
+	for (auto& Sidecar : mSidecars)
+	{
+		CloseSidecar(*Sidecar.second);
+	}
+
+	mSidecars.clear();
+	mUsageList.clear();
+}
+
+FChunkMeshCache::FStats FChunkMeshCache::GetStats() const
+{
+	FStats Stats;
+	Stats.Hits = mHits;
+	Stats.Misses = mMisses;
+	Stats.Stale = mStale;
+	Stats.Stores = mStores;
+	Stats.Bytes = mBytes;
+	return Stats;
+}
+
+FChunkMeshCache::FSidecar* FChunkMeshCache::GetSidecar(const Vector3i& RegionPosition)
+{
+	auto Found = mSidecars.find(RegionPosition);
+	if (Found != mSidecars.end())
+	{
+		// Move to the front of the usage list
+		FSidecar& Sidecar = *Found->second;
+		mUsageList.splice(mUsageList.begin(), mUsageList, Sidecar.UsageNode);
+		return &Sidecar;
+	}
+
+	// Close the least recently used sidecar to stay within the handle limit
+	if (mSidecars.size() >= mMaxOpenFiles && !mUsageList.empty())
+	{
+		const Vector3i Oldest = mUsageList.back();
+		mUsageList.pop_back();
+		CloseSidecar(*mSidecars[Oldest]);
+		mSidecars.erase(Oldest);
+	}
+
+	auto& FileSystem = IFileSystem::GetInstance();
+
+	static const uint32_t DirectoryBufferSize = 300;
+
+	// Sidecars are next to the region file
+	std::wstring Filepath{ L"./Worlds/" };
+	Filepath += mWorldName;
+
+	FileSystem.CreateFileDirectory(Filepath.c_str());
+
+	wchar_t FileName[DirectoryBufferSize];
+	int32_t CharCount = swprintf(FileName, DirectoryBufferSize, L"/x%dy%dz%d.vgm", RegionPosition.x, RegionPosition.y, RegionPosition.z);
+	FileName[CharCount] = L'\0';
+
+	Filepath += FileName;
+
+	std::unique_ptr<FSidecar> Sidecar{ new FSidecar };
+	Sidecar->IsTableDirty = false;
+
+	if (FileSystem.FileExists(Filepath.c_str()))
+	{
+		Sidecar->File = FileSystem.OpenReadWritable(Filepath.c_str(), true);
+
+		// Sidecars from other versions of the mesher are thrown away
+		if (Sidecar->File && (!Sidecar->File->ReadAt((uint8_t*)&Sidecar->Table, sizeof(Header), 0) ||
+			Sidecar->Table.Magic != Header::MAGIC || Sidecar->Table.Version != MESH_VERSION))
+		{
+			Sidecar->File.reset();
+			FileSystem.DeleteFilename(Filepath.c_str());
+		}
+	}
+
+	if (!Sidecar->File)
+	{
+		Sidecar->File = FileSystem.OpenReadWritable(Filepath.c_str(), true, true);
+		if (!Sidecar->File)
+			return nullptr;
+
+		std::memset(&Sidecar->Table, 0, sizeof(Header));
+		Sidecar->Table.Magic = Header::MAGIC;
+		Sidecar->Table.Version = MESH_VERSION;
+		Sidecar->File->WriteAt((const uint8_t*)&Sidecar->Table, sizeof(Header), 0);
+	}
+
+	// Meshes are read in the order chunks are loaded
+	Sidecar->File->Advise(EFileAdvice::Random);
+	Sidecar->FileSize = Sidecar->File->GetFileSize();
+
+	mUsageList.push_front(RegionPosition);
+	Sidecar->UsageNode = mUsageList.begin();
+
+	FSidecar* Result = Sidecar.get();
+	mSidecars[RegionPosition] = std::move(Sidecar);
+	return Result;
+}
+
+void FChunkMeshCache::CloseSidecar(FSidecar& Sidecar)
+{
+	if (Sidecar.File && Sidecar.IsTableDirty)
+	{
+		Sidecar.File->WriteAt((const uint8_t*)&Sidecar.Table, sizeof(Header), 0);
+		Sidecar.IsTableDirty = false;
+	}
+
+	Sidecar.File.reset();
+}
+
+uint32_t FChunkMeshCache::GetTableIndex(const Vector3i& LocalPosition)
+{
+	const Vector3i PositionToIndex{ (int32_t)FRegionFile::RegionData::REGION_SIZE, (int32_t)FRegionFile::RegionData::REGION_SIZE * FRegionFile::RegionData::REGION_SIZE, 1 };
+	return (uint32_t)Vector3i::Dot(LocalPosition, PositionToIndex);
+}
+
+uint32_t FChunkMeshCache::GetAllocatedSize(const uint32_t QuadCount)
+{
+	const uint32_t DataSize = QuadCount * BYTES_PER_QUAD;
+	return (DataSize + Header::ALLOCATION_SIZE - 1) / Header::ALLOCATION_SIZE * Header::ALLOCATION_SIZE;
+}
@@ -0,0 +1,170 @@
+#include "FileIO\ChunkPayloadCache.h"
+#include "FileIO\ChunkWriteQueue.h"
+#include "Memory\MemoryTracker.h"
+#include "Misc\Assertions.h"
+
+#include <cstring>
+
+FChunkPayloadCache::FChunkPayloadCache(FChunkWriteQueue& WriteQueue, const size_t ByteBudget)
+	: mWriteQueue(WriteQueue)
+	, mEntries()
+	, mUsageList()
+	, mByteBudget(ByteBudget)
+	, mHits()
+	, mMisses()
+	, mEvictions()
+	, mWriteBacks()
+	, mBytes()
+	, mEntryCount()
+{
+	mHits = 0;
+	mMisses = 0;
+	mEvictions = 0;
+	mWriteBacks = 0;
+	mBytes = 0;
+	mEntryCount = 0;
+}
+
+FChunkPayloadCache::~FChunkPayloadCache()
+{
+	Clear();
+}
+
+void FChunkPayloadCache::Insert(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec, const bool IsDirty, const FChunkSummary& Summary)
+{
+	// A newer payload replaces the cached one
+	EntryMap::iterator Existing = mEntries.find(ChunkPosition);
+	if (Existing != mEntries.end())
+	{
+		Remove(Existing);
+	}
+
+	// Payloads larger than the whole budget go straight to the write queue
+	if (DataSize > mByteBudget)
+	{
+		if (IsDirty)
+		{
+			mWriteQueue.Push(ChunkPosition, Data, DataSize, Codec, Summary);
+			mWriteBacks++;
+		}
+		return;
+	}
+
+	FEntry& Entry = mEntries[ChunkPosition];
+	Entry.Data.reset(new uint8_t[DataSize]);
+	std::memcpy(Entry.Data.get(), Data, DataSize);
+	Entry.DataSize = DataSize;
+	Entry.Codec = Codec;
+	Entry.IsDirty = IsDirty;
+	Entry.Summary = Summary;
+
+	mUsageList.push_front(ChunkPosition);
+	Entry.UsageNode = mUsageList.begin();
+
+	mBytes += DataSize;
+	mEntryCount++;
+	SMemoryTracker::OnAllocate(EMemoryTag::ChunkCache, DataSize);
+
+	EnforceBudget();
+}
+
+const uint8_t* FChunkPayloadCache::Take(const Vector3i& ChunkPosition, FStackAllocator& Scratch, uint32_t& SizeOut, uint8_t& CodecOut, bool& IsDirtyOut)
+{
+	EntryMap::iterator Found = mEntries.find(ChunkPosition);
+	if (Found == mEntries.end())
+	{
+		mMisses++;
+		return nullptr;
+	}
+
+	mHits++;
+
+	FEntry& Entry = Found->second;
+	uint8_t* Data = static_cast<uint8_t*>(Scratch.Allocate(Entry.DataSize));
+	std::memcpy(Data, Entry.Data.get(), Entry.DataSize);
+
+	SizeOut = Entry.DataSize;
+	CodecOut = Entry.Codec;
+	IsDirtyOut = Entry.IsDirty;
+
+	// The loaded chunk now owns the layout
+	Remove(Found);
+	return Data;
+}
+
+void FChunkPayloadCache::FlushDirty()
+{
+	for (auto& Entry : mEntries)
+	{
+		if (Entry.second.IsDirty)
+		{
+			WriteBack(Entry.first, Entry.second);
+		}
+	}
+}
+
+void FChunkPayloadCache::Clear()
+{
+	while (!mEntries.empty())
+	{
+		Remove(mEntries.begin());
+	}
+}
+
+void FChunkPayloadCache::SetByteBudget(const size_t ByteBudget)
+{
+	mByteBudget = ByteBudget;
+	EnforceBudget();
+}
+
+FChunkPayloadCache::FStats FChunkPayloadCache::GetStats() const
+{
+	FStats Stats;
+	Stats.Hits = mHits;
+	Stats.Misses = mMisses;
+	Stats.Evictions = mEvictions;
+	Stats.WriteBacks = mWriteBacks;
+	Stats.Bytes = mBytes;
+	Stats.Entries = mEntryCount;
+	return Stats;
+}
+
+void FChunkPayloadCache::Evict(EntryMap::iterator Entry)
+{
+	if (Entry->second.IsDirty)
+	{
+		WriteBack(Entry->first, Entry->second);
+	}
+
+	mEvictions++;
+	Remove(Entry);
+}
+
+void FChunkPayloadCache::Remove(EntryMap::iterator Entry)
+{
+	const uint32_t DataSize = Entry->second.DataSize;
+	mBytes -= DataSize;
+	mEntryCount--;
+	SMemoryTracker::OnFree(EMemoryTag::ChunkCache, DataSize);
+
+	mUsageList.erase(Entry->second.UsageNode);
+	mEntries.erase(Entry);
+}
+
+void FChunkPayloadCache::WriteBack(const Vector3i& ChunkPosition, FEntry& Entry)
+{
+	ASSERT(Entry.IsDirty);
+
+	mWriteQueue.Push(ChunkPosition, Entry.Data.get(), Entry.DataSize, Entry.Codec, Entry.Summary);
+
+	Entry.IsDirty = false;
+	mWriteBacks++;
+}
+
+void FChunkPayloadCache::EnforceBudget()
+{
+	while (mBytes > mByteBudget && !mUsageList.empty())
+	{
+		Evict(mEntries.find(mUsageList.back()));
+	}
+}
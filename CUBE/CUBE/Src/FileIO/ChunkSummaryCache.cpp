@@ -0,0 +1,196 @@
+#include "FileIO\ChunkSummaryCache.h"
+#include "ChunkSystems\Chunk.h"
+#include <algorithm>
+#include <cstring>
+#include <wchar.h>
+
+FChunkSummaryCache::FChunkSummaryCache(const wchar_t* WorldName, const uint32_t MaxTables)
+	: mWorldName(WorldName)
+	, mTables()
+	, mUsageList()
+	, mMaxTables(MaxTables)
+	, mMutex()
+	, mLookups()
+	, mUniform()
+	, mStores()
+{
+	mLookups = 0;
+	mUniform = 0;
+	mStores = 0;
+}
+
+FChunkSummaryCache::~FChunkSummaryCache()
+{
+	CloseAll();
+}
+
+FChunkSummary FChunkSummaryCache::Find(const Vector3i& ChunkPosition)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	const FTable& Table = GetTable(FRegionFile::ChunkToRegionPosition(ChunkPosition));
+	return Table.Table.ChunkEntry[GetTableIndex(FRegionFile::LocalRegionPosition(ChunkPosition))];
+}
+
+FChunkSummary FChunkSummaryCache::FindForLoad(const Vector3i& ChunkPosition)
+{
+	const FChunkSummary Summary = Find(ChunkPosition);
+
+	mLookups++;
+	if (Summary.Type == EChunkSummary::Air || Summary.Type == EChunkSummary::Solid)
+		mUniform++;
+
+	return Summary;
+}
+
+void FChunkSummaryCache::Store(const Vector3i& ChunkPosition, const FChunkSummary& Summary)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	FTable& Table = GetTable(FRegionFile::ChunkToRegionPosition(ChunkPosition));
+	const Vector3i LocalPosition = FRegionFile::LocalRegionPosition(ChunkPosition);
+
+	FChunkSummary& Entry = Table.Table.ChunkEntry[GetTableIndex(LocalPosition)];
+	if (std::memcmp(&Entry, &Summary, sizeof(FChunkSummary)) == 0)
+		return;
+
+	Entry = Summary;
+	Table.IsDirty = true;
+	mStores++;
+
+	// The column's height is the top of its highest chunk with blocks
+	uint32_t ColumnHeight = 0;
+	for (int32_t y = FRegionFile::RegionData::REGION_SIZE - 1; y >= 0 && ColumnHeight == 0; y--)
+	{
+		const FChunkSummary& Chunk = Table.Table.ChunkEntry[GetTableIndex(Vector3i{ LocalPosition.x, y, LocalPosition.z })];
+		if (Chunk.Height > 0)
+			ColumnHeight = y * FChunk::CHUNK_SIZE + Chunk.Height;
+	}
+
+	Table.Table.ColumnHeight[GetColumnIndex(LocalPosition)] = (uint16_t)ColumnHeight;
+}
+
+uint32_t FChunkSummaryCache::GetColumnHeight(const Vector3i& ChunkPosition)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	const FTable& Table = GetTable(FRegionFile::ChunkToRegionPosition(ChunkPosition));
+	return Table.Table.ColumnHeight[GetColumnIndex(FRegionFile::LocalRegionPosition(ChunkPosition))];
+}
+
+void FChunkSummaryCache::CloseAll()
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	for (auto& Table : mTables)
+	{
+		WriteTable(Table.first, *Table.second);
+	}
+
+	mTables.clear();
+	mUsageList.clear();
+}
+
+FChunkSummaryCache::FStats FChunkSummaryCache::GetStats() const
+{
+	FStats Stats;
+	Stats.Lookups = mLookups;
+	Stats.Uniform = mUniform;
+	Stats.Stores = mStores;
+
+	std::lock_guard<std::mutex> Lock(mMutex);
+	Stats.Tables = (uint32_t)mTables.size();
+	return Stats;
+}
+
+FChunkSummaryCache::FTable& FChunkSummaryCache::GetTable(const Vector3i& RegionPosition)
+{
+	auto Found = mTables.find(RegionPosition);
+	if (Found != mTables.end())
+	{
+		// Move to the front of the usage list
+		FTable& Table = *Found->second;
+		mUsageList.splice(mUsageList.begin(), mUsageList, Table.UsageNode);
+		return Table;
+	}
+
+	// Drop the least recently used table to stay within the limit
+	if (mTables.size() >= mMaxTables && !mUsageList.empty())
+	{
+		const Vector3i Oldest = mUsageList.back();
+		mUsageList.pop_back();
+		WriteTable(Oldest, *mTables[Oldest]);
+		mTables.erase(Oldest);
+	}
+
+	std::unique_ptr<FTable> Table{ new FTable };
+	Table->IsDirty = false;
+
+	// Regions without a sidecar, or with one from another version, start with every chunk unknown
+	auto& FileSystem = IFileSystem::GetInstance();
+	const std::wstring Filepath = GetSidecarPath(RegionPosition);
+
+	std::unique_ptr<IFileHandle> File;
+	if (FileSystem.FileExists(Filepath.c_str()))
+		File = FileSystem.OpenReadable(Filepath.c_str());
+
+	if (!File || !File->ReadAt((uint8_t*)&Table->Table, sizeof(Header), 0) ||
+		Table->Table.Magic != Header::MAGIC || Table->Table.Version != SUMMARY_VERSION)
+	{
+		std::memset(&Table->Table, 0, sizeof(Header));
+		Table->Table.Magic = Header::MAGIC;
+		Table->Table.Version = SUMMARY_VERSION;
+	}
+
+	mUsageList.push_front(RegionPosition);
+	Table->UsageNode = mUsageList.begin();
+
+	FTable& Result = *Table;
+	mTables[RegionPosition] = std::move(Table);
+	return Result;
+}
+
+void FChunkSummaryCache::WriteTable(const Vector3i& RegionPosition, FTable& Table)
+{
+	if (!Table.IsDirty)
+		return;
+
+	auto& FileSystem = IFileSystem::GetInstance();
+
+	std::wstring Directory{ L"./Worlds/" };
+	Directory += mWorldName;
+	FileSystem.CreateFileDirectory(Directory.c_str());
+
+	const std::wstring Filepath = GetSidecarPath(RegionPosition);
+	std::unique_ptr<IFileHandle> File = FileSystem.OpenWritable(Filepath.c_str(), false, true);
+
+	if (File && File->Write((const uint8_t*)&Table.Table, sizeof(Header)))
+		Table.IsDirty = false;
+}
+
+std::wstring FChunkSummaryCache::GetSidecarPath(const Vector3i& RegionPosition) const
+{
+	static const uint32_t DirectoryBufferSize = 300;
+
+	// Sidecars are next to the region file
+	std::wstring Filepath{ L"./Worlds/" };
+	Filepath += mWorldName;
+
+	wchar_t FileName[DirectoryBufferSize];
+	int32_t CharCount = swprintf(FileName, DirectoryBufferSize, L"/x%dy%dz%d.vgs", RegionPosition.x, RegionPosition.y, RegionPosition.z);
+	FileName[CharCount] = L'\0';
+
+	Filepath += FileName;
+	return Filepath;
+}
+
+uint32_t FChunkSummaryCache::GetTableIndex(const Vector3i& LocalPosition)
+{
+	const Vector3i PositionToIndex{ (int32_t)FRegionFile::RegionData::REGION_SIZE, (int32_t)FRegionFile::RegionData::REGION_SIZE * FRegionFile::RegionData::REGION_SIZE, 1 };
+	return (uint32_t)Vector3i::Dot(LocalPosition, PositionToIndex);
+}
+
+uint32_t FChunkSummaryCache::GetColumnIndex(const Vector3i& LocalPosition)
+{
+	return (uint32_t)(LocalPosition.x * FRegionFile::RegionData::REGION_SIZE + LocalPosition.z);
+}
@@ -0,0 +1,249 @@
+#include "FileIO\ChunkWriteQueue.h"
+#include "FileIO\WorldFileSystem.h"
+#include "Memory\MemoryTracker.h"
+#include "Misc\Assertions.h"
+#include "Clock.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+FChunkWriteQueue::FChunkWriteQueue(FWorldFileSystem& FileSystem, FChunkSummaryCache& SummaryCache, const size_t ByteBudget)
+	: mFileSystem(FileSystem)
+	, mSummaryCache(SummaryCache)
+	, mQueued()
+	, mWriting()
+	, mByteBudget(ByteBudget)
+	, mMutex()
+	, mWriteRequested()
+	, mWriteCompleted()
+	, mPersistenceThread()
+	, mMustShutdown(false)
+	, mDepth()
+	, mPeakDepth()
+	, mBytes()
+	, mWrites()
+	, mCoalesced()
+	, mStalls()
+	, mLatencyCycles()
+	, mMaxLatencyCycles()
+{
+	mDepth = 0;
+	mPeakDepth = 0;
+	mBytes = 0;
+	mWrites = 0;
+	mCoalesced = 0;
+	mStalls = 0;
+	mLatencyCycles = 0;
+	mMaxLatencyCycles = 0;
+
+	mPersistenceThread = std::thread(&FChunkWriteQueue::PersistenceThreadLoop, this);
+}
+
+FChunkWriteQueue::~FChunkWriteQueue()
+{
+	{
+		std::lock_guard<std::mutex> Lock(mMutex);
+		mMustShutdown = true;
+	}
+
+	// The thread writes what is left before it exits
+	mWriteRequested.notify_one();
+	mPersistenceThread.join();
+}
+
+void FChunkWriteQueue::Push(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec, const FChunkSummary& Summary)
+{
+	std::unique_ptr<uint8_t[]> Copy{ new uint8_t[DataSize] };
+	std::memcpy(Copy.get(), Data, DataSize);
+
+	std::unique_lock<std::mutex> Lock(mMutex);
+
+	// Wait for the persistence thread to make room, a layout larger than the budget is queued alone
+	if (mBytes + DataSize > mByteBudget && mBytes > 0)
+	{
+		mStalls++;
+		mWriteRequested.notify_one();
+		mWriteCompleted.wait(Lock, [this, DataSize]() { return mBytes + DataSize <= mByteBudget || mBytes == 0; });
+	}
+
+	EntryMap::iterator Existing = mQueued.find(ChunkPosition);
+	if (Existing != mQueued.end())
+	{
+		// Only the newest layout needs to be written
+		FEntry& Entry = Existing->second;
+		mBytes -= Entry.DataSize;
+		SMemoryTracker::OnFree(EMemoryTag::ChunkCache, Entry.DataSize);
+
+		Entry.Data = std::move(Copy);
+		Entry.DataSize = DataSize;
+		Entry.Codec = Codec;
+		Entry.Summary = Summary;
+		mCoalesced++;
+	}
+	else
+	{
+		FEntry& Entry = mQueued[ChunkPosition];
+		Entry.Data = std::move(Copy);
+		Entry.DataSize = DataSize;
+		Entry.Codec = Codec;
+		Entry.Summary = Summary;
+		Entry.QueueTime = FClock::ReadSystemTimer();
+
+		mDepth++;
+		mPeakDepth = std::max(mPeakDepth.load(), mDepth.load());
+	}
+
+	mBytes += DataSize;
+	SMemoryTracker::OnAllocate(EMemoryTag::ChunkCache, DataSize);
+
+	mWriteRequested.notify_one();
+}
+
+const uint8_t* FChunkWriteQueue::Find(const Vector3i& ChunkPosition, FStackAllocator& Scratch, uint32_t& SizeOut, uint8_t& CodecOut)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	// Layouts waiting for the next batch are newer than the ones being written
+	EntryMap::const_iterator Found = mQueued.find(ChunkPosition);
+	if (Found == mQueued.end())
+	{
+		Found = mWriting.find(ChunkPosition);
+		if (Found == mWriting.end())
+			return nullptr;
+	}
+
+	const FEntry& Entry = Found->second;
+	uint8_t* Data = static_cast<uint8_t*>(Scratch.Allocate(Entry.DataSize));
+	std::memcpy(Data, Entry.Data.get(), Entry.DataSize);
+
+	SizeOut = Entry.DataSize;
+	CodecOut = Entry.Codec;
+	return Data;
+}
+
+void FChunkWriteQueue::Flush()
+{
+	std::unique_lock<std::mutex> Lock(mMutex);
+
+	mWriteRequested.notify_one();
+	mWriteCompleted.wait(Lock, [this]() { return mQueued.empty() && mWriting.empty(); });
+}
+
+FChunkWriteQueue::FStats FChunkWriteQueue::GetStats() const
+{
+	FStats Stats;
+	Stats.Depth = mDepth;
+	Stats.PeakDepth = mPeakDepth;
+	Stats.Bytes = mBytes;
+	Stats.Writes = mWrites;
+	Stats.Coalesced = mCoalesced;
+	Stats.Stalls = mStalls;
+	Stats.AverageLatency = (Stats.Writes > 0) ? FClock::CyclesToSeconds(mLatencyCycles / Stats.Writes) : 0.0f;
+	Stats.MaxLatency = FClock::CyclesToSeconds(mMaxLatencyCycles);
+	return Stats;
+}
+
+void FChunkWriteQueue::WriteBatch()
+{
+	struct FWrite
+	{
+		Vector3i        RegionPosition;
+		uint32_t        SectorOffset;
+		const Vector3i* ChunkPosition;
+		const FEntry*   Entry;
+	};
+
+	std::vector<FWrite> Writes;
+	Writes.reserve(mWriting.size());
+
+	for (const auto& Queued : mWriting)
+	{
+		FWrite Write;
+		Write.RegionPosition = FRegionFile::ChunkToRegionPosition(Queued.first);
+		Write.SectorOffset = 0;
+		Write.ChunkPosition = &Queued.first;
+		Write.Entry = &Queued.second;
+		Writes.push_back(Write);
+	}
+
+	// Group the batch by region file
+	std::sort(Writes.begin(), Writes.end(), [](const FWrite& Lhs, const FWrite& Rhs)
+	{
+		if (Lhs.RegionPosition.x != Rhs.RegionPosition.x)
+			return Lhs.RegionPosition.x < Rhs.RegionPosition.x;
+		if (Lhs.RegionPosition.y != Rhs.RegionPosition.y)
+			return Lhs.RegionPosition.y < Rhs.RegionPosition.y;
+		return Lhs.RegionPosition.z < Rhs.RegionPosition.z;
+	});
+
+	for (auto RegionStart = Writes.begin(); RegionStart != Writes.end();)
+	{
+		const Vector3i RegionPosition = RegionStart->RegionPosition;
+		auto RegionEnd = std::find_if(RegionStart, Writes.end(), [&RegionPosition](const FWrite& Write)
+		{
+			return Write.RegionPosition != RegionPosition;
+		});
+
+		// Pin the region once for all of its chunks
+		mFileSystem.AddRegionFileReference(*RegionStart->ChunkPosition);
+
+		// Write in file order, chunks that are not in the file yet are appended last
+		for (auto Write = RegionStart; Write != RegionEnd; ++Write)
+		{
+			Write->SectorOffset = mFileSystem.GetChunkSectorOffset(*Write->ChunkPosition);
+		}
+
+		std::sort(RegionStart, RegionEnd, [](const FWrite& Lhs, const FWrite& Rhs)
+		{
+			return Lhs.SectorOffset < Rhs.SectorOffset;
+		});
+
+		for (auto Write = RegionStart; Write != RegionEnd; ++Write)
+		{
+			mFileSystem.WriteChunkData(*Write->ChunkPosition, Write->Entry->Data.get(), Write->Entry->DataSize, Write->Entry->Codec);
+			mSummaryCache.Store(*Write->ChunkPosition, Write->Entry->Summary);
+
+			const uint64_t Latency = FClock::ReadSystemTimer() - Write->Entry->QueueTime;
+			mLatencyCycles += Latency;
+			if (Latency > mMaxLatencyCycles)
+				mMaxLatencyCycles = Latency;
+			mWrites++;
+		}
+
+		mFileSystem.RemoveRegionFileReference(*RegionStart->ChunkPosition);
+		RegionStart = RegionEnd;
+	}
+}
+
+void FChunkWriteQueue::PersistenceThreadLoop()
+{
+	std::unique_lock<std::mutex> Lock(mMutex);
+
+	while (true)
+	{
+		mWriteRequested.wait(Lock, [this]() { return mMustShutdown || !mQueued.empty(); });
+
+		if (mQueued.empty())
+			break;
+
+		// Everything queued so far is written as one batch. The batch stays readable while it is written.
+		ASSERT(mWriting.empty());
+		mWriting.swap(mQueued);
+
+		Lock.unlock();
+		WriteBatch();
+		Lock.lock();
+
+		for (const auto& Written : mWriting)
+		{
+			mBytes -= Written.second.DataSize;
+			SMemoryTracker::OnFree(EMemoryTag::ChunkCache, Written.second.DataSize);
+		}
+
+		mDepth -= (uint32_t)mWriting.size();
+		mWriting.clear();
+
+		mWriteCompleted.notify_all();
+	}
+}
@@ -1,22 +1,34 @@
 #include "FileIO/RegionFile.h"
 #include "Misc\Assertions.h"
 #include <wchar.h>
+#include <cstring>
 
 static const uint8_t FilePadding[sizeof(FRegionFile::RegionData)];
 
 FRegionFile::FRegionFile()
 	: mRegionFile()
+	, mFilepath()
+	, mHasLookupTable(false)
+	, mIsLookupTableDirty(false)
+	, mWriteCount(0)
 {
 }
 
 FRegionFile::~FRegionFile()
 {
-	// Write lookup table data back to disk
-	if (mRegionFile)
+	Close();
+}
+
+void FRegionFile::Close()
+{
+	// Write lookup table data back to disk, it stays in memory for reopening
+	if (mRegionFile && mIsLookupTableDirty)
 	{
-		mRegionFile->SeekFromStart(0);
-		mRegionFile->Write((uint8_t*)&mRegionData, sizeof(RegionData));
+		mRegionFile->WriteAt((uint8_t*)&mRegionData, sizeof(RegionData), 0);
+		mIsLookupTableDirty = false;
 	}
+
+	mRegionFile.reset();
 }
 
 bool FRegionFile::Load(const wchar_t* WorldName, const Vector3i& RegionPosition)
@@ -36,27 +48,35 @@ bool FRegionFile::Load(const wchar_t* WorldName, const Vector3i& RegionPosition)
 	ProgramDirectory[CharCount] = L'\0';
 
 	Filepath += ProgramDirectory;
+	mFilepath = Filepath;
 
-	if (FileSystem.FileExists(Filepath.c_str()))
-	{
-		mRegionFile = FileSystem.OpenReadWritable(Filepath.c_str(), true);
-		ASSERT(mRegionFile);
-	}
-	else
+	if (!FileSystem.FileExists(Filepath.c_str()))
 	{
-		// If it doesn't exist, create it
-		mRegionFile = FileSystem.OpenReadWritable(Filepath.c_str(), true, true);
-		ASSERT(mRegionFile);
-		
-		// Add empty lookup table
-		mRegionFile->Write(FilePadding, sizeof(RegionData));
+		// The file is created on the first write, so regions that are only read leave no file behind
+		if (!mHasLookupTable)
+		{
+			std::memset(&mRegionData, 0, sizeof(RegionData));
+			mHasLookupTable = true;
+		}
+
+		return true;
 	}
 
-	mRegionFile->SeekFromStart(0);
-	return mRegionFile->Read((uint8_t*)&mRegionData, sizeof(RegionData));
+	mRegionFile = FileSystem.OpenReadWritable(Filepath.c_str(), true);
+	ASSERT(mRegionFile);
+
+	// Chunks are accessed in any order, reading ahead would only waste memory
+	mRegionFile->Advise(EFileAdvice::Random);
+
+	// The lookup table is kept from the last time this region was open
+	if (mHasLookupTable)
+		return true;
+
+	mHasLookupTable = mRegionFile->ReadAt((uint8_t*)&mRegionData, sizeof(RegionData), 0);
+	return mHasLookupTable;
 }
 
-void FRegionFile::GetChunkDataInfo(const Vector3i& ChunkPosition, uint32_t& SizeOut, uint32_t& SectorOffsetOut)
+void FRegionFile::GetChunkDataInfo(const Vector3i& ChunkPosition, uint32_t& SizeOut, uint32_t& SectorOffsetOut, uint8_t& CodecOut)
 {
 	uint32_t TableIndex = GetTableIndex(ChunkPosition);
 
@@ -68,21 +88,67 @@ void FRegionFile::GetChunkDataInfo(const Vector3i& ChunkPosition, uint32_t& Size
 	}
 
 	SectorOffsetOut = mRegionData.ChunkEntry[TableIndex].Offset;
-	mRegionFile->SeekFromStart(sizeof(RegionData) + SectorOffsetOut * RegionData::SECTOR_SIZE);
-	mRegionFile->Read((uint8_t*)&SizeOut, 4);
+
+	uint32_t Header = 0;
+	mRegionFile->ReadAt((uint8_t*)&Header, 4, GetSectorPosition(SectorOffsetOut));
+	SizeOut = Header & RegionData::CHUNK_SIZE_MASK;
+	CodecOut = (uint8_t)(Header >> RegionData::CHUNK_CODEC_SHIFT);
 }
 
 void FRegionFile::GetChunkData(const uint32_t SectorOffset, uint8_t* DataOut, const uint32_t DataSize)
 {
 	ASSERT(DataSize != 0);
 
-	// Add offset after region data block and offset for chunk data size (4 bytes)
-	mRegionFile->SeekFromStart((sizeof(RegionData) + SectorOffset * RegionData::SECTOR_SIZE) + 4);
-	mRegionFile->Read(DataOut, DataSize);
+	// Add offset for chunk data header (4 bytes)
+	mRegionFile->ReadAt(DataOut, DataSize, GetSectorPosition(SectorOffset) + 4);
 }
 
-void FRegionFile::WriteChunkData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize)
+bool FRegionFile::GetChunkSectors(const Vector3i& ChunkPosition, uint64_t& FileOffsetOut, uint32_t& ByteCountOut)
 {
+	const LookupEntry& ChunkEntry = mRegionData.ChunkEntry[GetTableIndex(ChunkPosition)];
+
+	if (ChunkEntry.NumOfSectors == 0)
+		return false;
+
+	FileOffsetOut = GetSectorPosition(ChunkEntry.Offset);
+	ByteCountOut = ChunkEntry.NumOfSectors * RegionData::SECTOR_SIZE;
+	return true;
+}
+
+const uint8_t* FRegionFile::ParseChunkSectors(const uint8_t* Sectors, const uint32_t ByteCount, uint32_t& SizeOut, uint8_t& CodecOut)
+{
+	if (ByteCount < 4)
+		return nullptr;
+
+	uint32_t Header;
+	std::memcpy(&Header, Sectors, 4);
+	SizeOut = Header & RegionData::CHUNK_SIZE_MASK;
+	CodecOut = (uint8_t)(Header >> RegionData::CHUNK_CODEC_SHIFT);
+
+	if (SizeOut == 0 || SizeOut > ByteCount - 4)
+		return nullptr;
+
+	// Data follows the header
+	return Sectors + 4;
+}
+
+void FRegionFile::WriteChunkData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec)
+{
+	ASSERT(DataSize <= RegionData::CHUNK_SIZE_MASK);
+
+	if (!mRegionFile)
+	{
+		// First write to a region without a file, start it with an empty lookup table
+		mRegionFile = IFileSystem::GetInstance().OpenReadWritable(mFilepath.c_str(), true, true);
+		ASSERT(mRegionFile);
+
+		mRegionFile->Write(FilePadding, sizeof(RegionData));
+		mRegionFile->Advise(EFileAdvice::Random);
+	}
+
+	// Writes can move the data of any chunk in the file
+	mWriteCount++;
+
 	uint32_t TableIndex = GetTableIndex(ChunkPosition);
 	LookupEntry& ChunkEntry = mRegionData.ChunkEntry[TableIndex];
 
@@ -92,24 +158,23 @@ void FRegionFile::WriteChunkData(const Vector3i& ChunkPosition, const uint8_t* D
 		// If we have enough space with the current amount of sectors.
 		if (ChunkEntry.NumOfSectors * RegionData::SECTOR_SIZE >= DataSize + 4)
 		{
-			// Add offset after region data block and offset for chunk data size (4 bytes)
-			mRegionFile->SeekFromStart((sizeof(RegionData) + ChunkEntry.Offset * RegionData::SECTOR_SIZE));
-			mRegionFile->Write((uint8_t*)&DataSize, 4);
-			mRegionFile->Write(Data, DataSize);
+			WriteChunkSector(ChunkEntry, Data, DataSize, Codec);
 		}
 		else
 		{
-			RelocateAndAddChunkData(ChunkEntry, Data, DataSize);
+			RelocateAndAddChunkData(ChunkEntry, Data, DataSize, Codec);
+			mIsLookupTableDirty = true;
 		}
 	}
 	else
 	{
 		// Chunk is not in file, add it
-		AddNewChunk(ChunkEntry, Data, DataSize);
+		AddNewChunk(ChunkEntry, Data, DataSize, Codec);
+		mIsLookupTableDirty = true;
 	}
 }
 
-void FRegionFile::AddNewChunk(LookupEntry& ChunkEntry, const uint8_t* Data, const uint32_t DataSize)
+void FRegionFile::AddNewChunk(LookupEntry& ChunkEntry, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec)
 {
 	// Determine how many sectors are currently in this region file.
 	uint32_t SectorCount = (mRegionFile->GetFileSize() - sizeof(RegionData)) / RegionData::SECTOR_SIZE;
@@ -118,28 +183,25 @@ void FRegionFile::AddNewChunk(LookupEntry& ChunkEntry, const uint8_t* Data, cons
 	ChunkEntry.Offset = SectorCount;
 	ChunkEntry.NumOfSectors = 1 + ((DataSize + 4) / RegionData::SECTOR_SIZE); // add 4 bytes for data size
 
-	mRegionFile->SeekFromStart((sizeof(RegionData) + ChunkEntry.Offset * RegionData::SECTOR_SIZE));
-	mRegionFile->Write((uint8_t*)&DataSize, 4); // Write size of data
-	mRegionFile->Write(Data, DataSize); // Write chunk data
+	WriteChunkSector(ChunkEntry, Data, DataSize, Codec);
 
 	// Add padding to the rest of the sector
-	mRegionFile->Write(FilePadding, (ChunkEntry.NumOfSectors * RegionData::SECTOR_SIZE) - DataSize - 4);
+	mRegionFile->WriteAt(FilePadding, (ChunkEntry.NumOfSectors * RegionData::SECTOR_SIZE) - DataSize - 4, GetSectorPosition(ChunkEntry.Offset) + 4 + DataSize);
 }
 
-void FRegionFile::RelocateAndAddChunkData(LookupEntry& RelocationEntry, const uint8_t* Data, const uint32_t DataSize)
+void FRegionFile::RelocateAndAddChunkData(LookupEntry& RelocationEntry, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec)
 {
 	// Copy all data after this sector, then write it starting at this sector
 	uint32_t RelocationDataStart = sizeof(RegionData) + ((RelocationEntry.Offset + RelocationEntry.NumOfSectors) * RegionData::SECTOR_SIZE);
 	uint32_t RelocationDataSize = mRegionFile->GetFileSize() - RelocationDataStart;
 
-	// Get data to shift left
-	std::unique_ptr<uint8_t> RelocationData{ new uint8_t[RelocationDataSize] };
-	mRegionFile->SeekFromStart(RelocationDataStart);
-	mRegionFile->Read(RelocationData.get(), RelocationDataSize);
+	// Get data to shift left. Positional I/O leaves the shared file pointer alone,
+	// asynchronous reads of other chunks may be using the handle meanwhile.
+	std::unique_ptr<uint8_t[]> RelocationData{ new uint8_t[RelocationDataSize] };
+	mRegionFile->ReadAt(RelocationData.get(), RelocationDataSize, RelocationDataStart);
 
-	// Seek to the point where this chunk sector started and shift data to this point
-	mRegionFile->SeekFromStart(RelocationDataStart - (RelocationEntry.NumOfSectors * RegionData::SECTOR_SIZE));
-	mRegionFile->Write(RelocationData.get(), RelocationDataSize);
+	// Shift data to the point where this chunk sector started
+	mRegionFile->WriteAt(RelocationData.get(), RelocationDataSize, RelocationDataStart - (RelocationEntry.NumOfSectors * RegionData::SECTOR_SIZE));
 
 	// Decrement all offsets in lookup table that were effected
 	for (auto& Entry : mRegionData.ChunkEntry)
@@ -158,10 +220,17 @@ void FRegionFile::RelocateAndAddChunkData(LookupEntry& RelocationEntry, const ui
 	RelocationEntry.Offset = SectorCount - RelocationEntry.NumOfSectors;
 	RelocationEntry.NumOfSectors = 1 + ((DataSize + 4) / RegionData::SECTOR_SIZE); // add 4 bytes for data size
 
-	// We are already at the end of the old data, so just write from here
-	mRegionFile->Write((uint8_t*)&DataSize, 4); // Write size of data
-	mRegionFile->Write(Data, DataSize); // Write chunk data
+	// Write directly after the shifted data
+	WriteChunkSector(RelocationEntry, Data, DataSize, Codec);
 
 	// Add padding to the rest of the sector
-	mRegionFile->Write(FilePadding, (RelocationEntry.NumOfSectors * RegionData::SECTOR_SIZE) - DataSize - 4);
+	mRegionFile->WriteAt(FilePadding, (RelocationEntry.NumOfSectors * RegionData::SECTOR_SIZE) - DataSize - 4, GetSectorPosition(RelocationEntry.Offset) + 4 + DataSize);
+}
+
+void FRegionFile::WriteChunkSector(const LookupEntry& ChunkEntry, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec)
+{
+	const uint64_t Position = GetSectorPosition(ChunkEntry.Offset);
+	const uint32_t Header = DataSize | ((uint32_t)Codec << RegionData::CHUNK_CODEC_SHIFT);
+	mRegionFile->WriteAt((uint8_t*)&Header, 4, Position); // Write size of data and codec
+	mRegionFile->WriteAt(Data, DataSize, Position + 4); // Write chunk data
 }
\ No newline at end of file
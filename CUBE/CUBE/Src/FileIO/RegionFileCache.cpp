@@ -0,0 +1,382 @@
+#include "FileIO\RegionFileCache.h"
+#include "Misc\Assertions.h"
+
+#include <algorithm>
+
+FRegionFileCache::FRegionFileCache(const wchar_t* WorldName, const uint32_t MaxOpenFiles)
+	: mWorldName(WorldName)
+	, mRecords()
+	, mOpenUsageList()
+	, mClosedUsageList()
+	, mOpenQueue()
+	, mMaxOpenFiles(MaxOpenFiles)
+	, mPendingOpens(0)
+	, mCancelCount(0)
+	, mMutex()
+	, mOpenRequested()
+	, mOpenCompleted()
+	, mOpenerThread()
+	, mMustShutdown(false)
+	, mHits()
+	, mOpens()
+	, mCloses()
+	, mMisses()
+	, mOpenFiles()
+	, mPinnedFiles()
+	, mTables()
+{
+	mHits = 0;
+	mOpens = 0;
+	mCloses = 0;
+	mMisses = 0;
+	mOpenFiles = 0;
+	mPinnedFiles = 0;
+	mTables = 0;
+
+	mOpenerThread = std::thread(&FRegionFileCache::OpenerThreadLoop, this);
+}
+
+FRegionFileCache::~FRegionFileCache()
+{
+	{
+		std::lock_guard<std::mutex> Lock(mMutex);
+		mMustShutdown = true;
+	}
+
+	mOpenRequested.notify_one();
+	mOpenerThread.join();
+
+	Clear();
+}
+
+void FRegionFileCache::Acquire(const Vector3i& RegionPosition)
+{
+	std::unique_lock<std::mutex> Lock(mMutex);
+	bool WasMissed = false;
+
+	while (true)
+	{
+		// The record may have been removed while waiting, so find it again each time
+		FRecord& Record = FindOrAddRecord(RegionPosition);
+
+		if (Record.State == ERegionFileState::Open)
+		{
+			Pin(Record);
+			(WasMissed ? mMisses : mHits)++;
+			return;
+		}
+
+		WasMissed = true;
+
+		if (Record.State == ERegionFileState::Closed)
+		{
+			RemoveFromUsageList(Record);
+			Record.State = ERegionFileState::Opening;
+			OpenRecord(Lock, RegionPosition, Record);
+		}
+		else if (Record.IsQueued)
+		{
+			// Don't wait for the opener thread to get to it
+			mOpenQueue.erase(std::find(mOpenQueue.begin(), mOpenQueue.end(), RegionPosition));
+			Record.IsQueued = false;
+			OpenRecord(Lock, RegionPosition, Record);
+		}
+		else
+		{
+			// Another thread is opening the file
+			mOpenCompleted.wait(Lock);
+		}
+	}
+}
+
+bool FRegionFileCache::TryAcquire(const Vector3i& RegionPosition)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+	FRecord& Record = FindOrAddRecord(RegionPosition);
+
+	if (Record.State == ERegionFileState::Open)
+	{
+		Pin(Record);
+		mHits++;
+		return true;
+	}
+
+	if (Record.State == ERegionFileState::Closed)
+	{
+		QueueOpen(RegionPosition, Record);
+		mMisses++;
+	}
+
+	return false;
+}
+
+void FRegionFileCache::CancelPendingOpens()
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+	mCancelCount++;
+
+	for (const Vector3i& RegionPosition : mOpenQueue)
+	{
+		FRecord& Record = *mRecords[RegionPosition];
+		Record.State = ERegionFileState::Closed;
+		Record.IsQueued = false;
+		AddToUsageList(RegionPosition, Record);
+	}
+	mOpenQueue.clear();
+
+	for (auto& Entry : mRecords)
+	{
+		FRecord& Record = *Entry.second;
+		if (Record.IsAwaitingAcquire)
+		{
+			Record.IsAwaitingAcquire = false;
+			AddToUsageList(Entry.first, Record);
+		}
+	}
+
+	EnforceLimits();
+}
+
+void FRegionFileCache::Release(const Vector3i& RegionPosition)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	RecordMap::iterator Found = mRecords.find(RegionPosition);
+	ASSERT(Found != mRecords.end() && Found->second->ReferenceCount > 0 && "Shouldn't be releasing a region that is not pinned.");
+
+	FRecord& Record = *Found->second;
+	Record.ReferenceCount--;
+
+	if (Record.ReferenceCount == 0)
+	{
+		mPinnedFiles--;
+		AddToUsageList(RegionPosition, Record);
+		EnforceLimits();
+	}
+}
+
+FRegionFile& FRegionFileCache::Get(const Vector3i& RegionPosition)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	RecordMap::iterator Found = mRecords.find(RegionPosition);
+	ASSERT(Found != mRecords.end() && Found->second->ReferenceCount > 0 && "Region must be pinned to be used.");
+
+	// Pinned records are never closed or removed, the file can be used without the lock
+	return Found->second->File;
+}
+
+void FRegionFileCache::CloseAll()
+{
+	std::unique_lock<std::mutex> Lock(mMutex);
+	CloseAllLocked(Lock);
+	EnforceLimits();
+}
+
+void FRegionFileCache::Clear()
+{
+	std::unique_lock<std::mutex> Lock(mMutex);
+	CloseAllLocked(Lock);
+
+	mClosedUsageList.clear();
+	mRecords.clear();
+	mTables = 0;
+}
+
+void FRegionFileCache::SetMaxOpenFiles(const uint32_t MaxOpenFiles)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+	mMaxOpenFiles = MaxOpenFiles;
+	EnforceLimits();
+}
+
+FRegionFileCache::FStats FRegionFileCache::GetStats() const
+{
+	FStats Stats;
+	Stats.Hits = mHits;
+	Stats.Opens = mOpens;
+	Stats.Closes = mCloses;
+	Stats.Misses = mMisses;
+	Stats.OpenFiles = mOpenFiles;
+	Stats.PinnedFiles = mPinnedFiles;
+	Stats.Tables = mTables;
+	return Stats;
+}
+
+FRegionFileCache::FRecord& FRegionFileCache::FindOrAddRecord(const Vector3i& RegionPosition)
+{
+	std::unique_ptr<FRecord>& Record = mRecords[RegionPosition];
+
+	if (!Record)
+	{
+		Record.reset(new FRecord);
+		Record->ReferenceCount = 0;
+		Record->State = ERegionFileState::Closed;
+		Record->IsQueued = false;
+		Record->IsAwaitingAcquire = false;
+		Record->IsInUsageList = false;
+		mTables++;
+	}
+
+	return *Record;
+}
+
+void FRegionFileCache::QueueOpen(const Vector3i& RegionPosition, FRecord& Record)
+{
+	ASSERT(Record.State == ERegionFileState::Closed);
+
+	RemoveFromUsageList(Record);
+	Record.State = ERegionFileState::Opening;
+	Record.IsQueued = true;
+	mOpenQueue.push_back(RegionPosition);
+
+	mOpenRequested.notify_one();
+}
+
+void FRegionFileCache::OpenRecord(std::unique_lock<std::mutex>& Lock, const Vector3i& RegionPosition, FRecord& Record)
+{
+	ASSERT(Record.State == ERegionFileState::Opening && !Record.IsQueued);
+
+	// Records in the opening state are not touched by other threads
+	mPendingOpens++;
+	Lock.unlock();
+
+	Record.File.Load(mWorldName.c_str(), RegionPosition);
+
+	Lock.lock();
+	mPendingOpens--;
+
+	Record.State = ERegionFileState::Open;
+	mOpenFiles++;
+	mOpens++;
+
+	mOpenCompleted.notify_all();
+}
+
+void FRegionFileCache::Pin(FRecord& Record)
+{
+	ASSERT(Record.State == ERegionFileState::Open);
+
+	if (Record.ReferenceCount == 0)
+	{
+		RemoveFromUsageList(Record);
+		Record.IsAwaitingAcquire = false;
+		mPinnedFiles++;
+	}
+
+	Record.ReferenceCount++;
+}
+
+void FRegionFileCache::AddToUsageList(const Vector3i& RegionPosition, FRecord& Record)
+{
+	ASSERT(!Record.IsInUsageList && Record.ReferenceCount == 0);
+
+	std::list<Vector3i>& UsageList = (Record.State == ERegionFileState::Open) ? mOpenUsageList : mClosedUsageList;
+	UsageList.push_front(RegionPosition);
+	Record.UsageNode = UsageList.begin();
+	Record.IsInUsageList = true;
+}
+
+void FRegionFileCache::RemoveFromUsageList(FRecord& Record)
+{
+	if (!Record.IsInUsageList)
+		return;
+
+	std::list<Vector3i>& UsageList = (Record.State == ERegionFileState::Open) ? mOpenUsageList : mClosedUsageList;
+	UsageList.erase(Record.UsageNode);
+	Record.IsInUsageList = false;
+}
+
+void FRegionFileCache::EnforceLimits()
+{
+	// Close least recently used files, pinned files may keep the cache above the limit
+	while (mOpenFiles > mMaxOpenFiles && !mOpenUsageList.empty())
+	{
+		const Vector3i RegionPosition = mOpenUsageList.back();
+		FRecord& Record = *mRecords[RegionPosition];
+
+		RemoveFromUsageList(Record);
+		Record.File.Close();
+		Record.State = ERegionFileState::Closed;
+		AddToUsageList(RegionPosition, Record);
+
+		mOpenFiles--;
+		mCloses++;
+	}
+
+	// Forget the lookup tables of regions that haven't been used in a while
+	while (mClosedUsageList.size() > DEFAULT_MAX_CLOSED_TABLES)
+	{
+		const Vector3i RegionPosition = mClosedUsageList.back();
+		mClosedUsageList.pop_back();
+		mRecords.erase(RegionPosition);
+		mTables--;
+	}
+}
+
+void FRegionFileCache::CloseAllLocked(std::unique_lock<std::mutex>& Lock)
+{
+	// Cancel opens that haven't started
+	for (const Vector3i& RegionPosition : mOpenQueue)
+	{
+		FRecord& Record = *mRecords[RegionPosition];
+		Record.State = ERegionFileState::Closed;
+		Record.IsQueued = false;
+		AddToUsageList(RegionPosition, Record);
+	}
+	mOpenQueue.clear();
+
+	// Wait for opens that already started
+	while (mPendingOpens > 0)
+	{
+		mOpenCompleted.wait(Lock);
+	}
+
+	for (auto& Entry : mRecords)
+	{
+		FRecord& Record = *Entry.second;
+		if (Record.State == ERegionFileState::Open)
+		{
+			RemoveFromUsageList(Record);
+			Record.File.Close();
+			Record.State = ERegionFileState::Closed;
+			Record.ReferenceCount = 0;
+			Record.IsAwaitingAcquire = false;
+			AddToUsageList(Entry.first, Record);
+		}
+	}
+
+	mOpenFiles = 0;
+	mPinnedFiles = 0;
+}
+
+void FRegionFileCache::OpenerThreadLoop()
+{
+	std::unique_lock<std::mutex> Lock(mMutex);
+
+	while (true)
+	{
+		mOpenRequested.wait(Lock, [this]() { return mMustShutdown || !mOpenQueue.empty(); });
+
+		if (mMustShutdown)
+			break;
+
+		const Vector3i RegionPosition = mOpenQueue.front();
+		mOpenQueue.pop_front();
+
+		FRecord& Record = *mRecords[RegionPosition];
+		Record.IsQueued = false;
+
+		const uint32_t CancelCount = mCancelCount;
+		OpenRecord(Lock, RegionPosition, Record);
+
+		// Kept out of the usage list until it is pinned, otherwise a cache full of pinned
+		// regions would close it right away and the region could never be acquired
+		if (CancelCount == mCancelCount)
+			Record.IsAwaitingAcquire = true;
+		else
+			AddToUsageList(RegionPosition, Record);
+
+		EnforceLimits();
+	}
+}
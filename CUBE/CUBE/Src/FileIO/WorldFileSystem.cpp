@@ -1,30 +1,89 @@
 #include "FileIO\WorldFileSystem.h"
+#include "Misc\Assertions.h"
+#include "Clock.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
 
 const wchar_t FWorldFileSystem::TEMP_DIRECTORY_NAME[] = L"Temp_World";
 const wchar_t FWorldFileSystem::WORLDS_DIRECTORY_NAME[] = L"./Worlds/";
 const wchar_t FWorldFileSystem::TEMP_DIRECTORY_PATH[] = L"./Worlds/Temp_World";
 
+// Temp directory indices used by world file systems, shared by every world in the process
+static std::mutex TempDirectoryMutex;
+static std::vector<bool> IsTempDirectoryUsed;
+
+static uint32_t AcquireTempDirectory()
+{
+	std::lock_guard<std::mutex> Lock(TempDirectoryMutex);
+
+	uint32_t Index = 0;
+	while (Index < IsTempDirectoryUsed.size() && IsTempDirectoryUsed[Index])
+	{
+		Index++;
+	}
+
+	if (Index == IsTempDirectoryUsed.size())
+		IsTempDirectoryUsed.push_back(true);
+	else
+		IsTempDirectoryUsed[Index] = true;
+
+	return Index;
+}
+
+static void ReleaseTempDirectory(const uint32_t Index)
+{
+	std::lock_guard<std::mutex> Lock(TempDirectoryMutex);
+	IsTempDirectoryUsed[Index] = false;
+}
+
+static std::wstring TempDirectoryName(const uint32_t Index)
+{
+	std::wostringstream Name;
+	Name << FWorldFileSystem::TEMP_DIRECTORY_NAME;
+	if (Index > 0)
+		Name << Index;
+
+	return Name.str();
+}
+
 FWorldFileSystem::FWorldFileSystem()
 	: mWorldName()
-	, mRegionFiles()
+	, mTempDirectoryIndex(AcquireTempDirectory())
+	, mTempDirectoryName(TempDirectoryName(mTempDirectoryIndex))
+	, mTempDirectoryPath(std::wstring{ WORLDS_DIRECTORY_NAME } + mTempDirectoryName)
+	, mRegionFiles(mTempDirectoryName.c_str())
 	, mWorldSize(0)
+	, mWorldSeed(0)
+	, mAsyncReader()
+	, mReadyReads()
+	, mReadScratch(nullptr)
+	, mReads()
+	, mReadBatches()
+	, mReadRetries()
+	, mReadCycles()
+	, mMaxReadCycles()
+	, mReadHistogram()
 {
-
+	mAsyncReader = IAsyncFileReader::Create(READ_QUEUE_DEPTH);
+	mReadyReads.reserve(READ_QUEUE_DEPTH);
+	ResetReadStats();
 }
 
 FWorldFileSystem::~FWorldFileSystem()
 {
 	IFileSystem& FileSystem = IFileSystem::GetInstance();
-	mRegionFiles.clear();
+	mRegionFiles.Clear();
 
 	// Delete the temp directory
-	std::wstring TempPath{ TEMP_DIRECTORY_PATH };
-	FileSystem.DeleteDirectory(TempPath.c_str());
+	FileSystem.DeleteDirectory(mTempDirectoryPath.c_str());
+	ReleaseTempDirectory(mTempDirectoryIndex);
 }
 
 bool FWorldFileSystem::SetWorld(const wchar_t* WorldName)
 {
-	mRegionFiles.clear();
+	// Cached lookup tables belong to the region files that are replaced
+	mRegionFiles.Clear();
 	mWorldName = WorldName;
 
 	IFileSystem& FileSystem = IFileSystem::GetInstance();
@@ -33,7 +92,7 @@ bool FWorldFileSystem::SetWorld(const wchar_t* WorldName)
 	std::wstring Filepath{ WORLDS_DIRECTORY_NAME };
 	Filepath += WorldName;
 
-	std::wstring TempPath{ TEMP_DIRECTORY_PATH };
+	std::wstring TempPath{ mTempDirectoryPath };
 
 	FileSystem.DeleteDirectory(TempPath.c_str());
 	FileSystem.CopyFileDirectory(Filepath.c_str(), TempPath.c_str());
@@ -46,6 +105,12 @@ bool FWorldFileSystem::SetWorld(const wchar_t* WorldName)
 	if (WorldInfoFile)
 	{
 		WorldInfoFile->Read((uint8_t*)&mWorldSize, 4);
+
+		// The seed follows the world size in worlds created for on demand generation
+		mWorldSeed = 0;
+		if (WorldInfoFile->GetFileSize() >= 8)
+			WorldInfoFile->Read((uint8_t*)&mWorldSeed, 4);
+
 		return true;
 	}
 	
@@ -53,11 +118,44 @@ bool FWorldFileSystem::SetWorld(const wchar_t* WorldName)
 	return false;
 }
 
+bool FWorldFileSystem::CreateWorld(const wchar_t* WorldName, const uint32_t WorldSize, const uint32_t Seed)
+{
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+
+	std::wstring Filepath{ WORLDS_DIRECTORY_NAME };
+	Filepath += WorldName;
+	Filepath += L"/WorldInfo.vgw";
+
+	if (FileSystem.FileExists(Filepath.c_str()))
+	{
+		std::wcerr << L"World " << WorldName << L" already exists" << std::endl;
+		return false;
+	}
+
+	std::wstring WorldPath{ WORLDS_DIRECTORY_NAME };
+	WorldPath += WorldName;
+	FileSystem.CreateFileDirectory(WorldPath.c_str());
+
+	// Region files are created as chunks are saved, only the world info is needed
+	auto WorldInfoFile = FileSystem.OpenWritable(Filepath.c_str(), false, true);
+	if (!WorldInfoFile)
+		return false;
+
+	WorldInfoFile->Write((const uint8_t*)&WorldSize, 4);
+	WorldInfoFile->Write((const uint8_t*)&Seed, 4);
+	return true;
+}
+
 uint32_t FWorldFileSystem::GetWorldSize() const
 {
 	return mWorldSize;
 }
 
+uint32_t FWorldFileSystem::GetWorldSeed() const
+{
+	return mWorldSeed;
+}
+
 std::wstring FWorldFileSystem::GetWorldName() const
 {
 	return mWorldName;
@@ -73,28 +171,25 @@ void FWorldFileSystem::SaveWorld()
 	FileSystem.DeleteDirectory(Filepath.c_str());
 
 	// Copy temp world into a new world directory
-	std::wstring TempPath{ WORLDS_DIRECTORY_NAME };
-	TempPath += TEMP_DIRECTORY_NAME;
-	FileSystem.CopyFileDirectory(TempPath.c_str(), Filepath.c_str());
+	FileSystem.CopyFileDirectory(mTempDirectoryPath.c_str(), Filepath.c_str());
 }
 
 void FWorldFileSystem::AddRegionFileReference(const Vector3i& ChunkPosition)
 {
 	// Get region position info
 	const Vector3i RegionID = FRegionFile::ChunkToRegionPosition(ChunkPosition);
+	mRegionFiles.Acquire(RegionID);
+}
 
-	// Increment if the file is loaded
-	if (mRegionFiles.find(RegionID) != mRegionFiles.end())
-	{
-		mRegionFiles[RegionID].ReferenceCount++;
-	}
-	else
-	{
-		// Add the file if not loaded
-		RegionFileRecord& Record = mRegionFiles[RegionID];
-		Record.ReferenceCount = 1;
-		Record.File.Load(TEMP_DIRECTORY_NAME, RegionID);
-	}
+bool FWorldFileSystem::TryAddRegionFileReference(const Vector3i& ChunkPosition)
+{
+	const Vector3i RegionID = FRegionFile::ChunkToRegionPosition(ChunkPosition);
+	return mRegionFiles.TryAcquire(RegionID);
+}
+
+void FWorldFileSystem::CancelRegionFileOpens()
+{
+	mRegionFiles.CancelPendingOpens();
 }
 
 void FWorldFileSystem::RemoveRegionFileReference(const Vector3i& ChunkPosition)
@@ -102,50 +197,265 @@ void FWorldFileSystem::RemoveRegionFileReference(const Vector3i& ChunkPosition)
 	// Get region position info
 	const Vector3i RegionID = FRegionFile::ChunkToRegionPosition(ChunkPosition);
 
-	ASSERT(mRegionFiles.find(RegionID) != mRegionFiles.end() && "Shouldn't be removing a record that is not there.");
+	// The file stays open until the cache needs the handle
+	mRegionFiles.Release(RegionID);
+}
 
-	// Decrement reference count and erase if 0
-	RegionFileRecord& Record = mRegionFiles[RegionID];
-	Record.ReferenceCount--;
+void FWorldFileSystem::ClearAllRegionFileReferences()
+{
+	mRegionFiles.CloseAll();
+}
 
-	if (Record.ReferenceCount <= 0)
-	{
-		mRegionFiles.erase(RegionID);
-	}
+void FWorldFileSystem::SetMaxOpenRegionFiles(const uint32_t MaxOpenFiles)
+{
+	mRegionFiles.SetMaxOpenFiles(MaxOpenFiles);
 }
 
-void FWorldFileSystem::ClearAllRegionFileReferences()
+FRegionFileCache::FStats FWorldFileSystem::GetRegionFileStats() const
 {
-	mRegionFiles.clear();
+	return mRegionFiles.GetStats();
 }
 
-void FWorldFileSystem::GetChunkData(const Vector3i& ChunkPosition, std::vector<uint8_t>& DataOut)
+const uint8_t* FWorldFileSystem::GetChunkData(const Vector3i& ChunkPosition, FStackAllocator& Scratch, uint32_t& SizeOut, uint8_t& CodecOut)
+{
+	const uint64_t StartTime = FClock::ReadSystemTimer();
+	const uint8_t* Data = ReadChunkData(ChunkPosition, Scratch, SizeOut, CodecOut);
+
+	if (Data)
+		RecordRead(StartTime);
+	return Data;
+}
+
+const uint8_t* FWorldFileSystem::ReadChunkData(const Vector3i& ChunkPosition, FStackAllocator& Scratch, uint32_t& SizeOut, uint8_t& CodecOut)
 {
 	const Vector3i RegionID = FRegionFile::ChunkToRegionPosition(ChunkPosition);
 	const Vector3i RegionPosition = FRegionFile::LocalRegionPosition(ChunkPosition);
 
-	ASSERT(mRegionFiles.find(RegionID) != mRegionFiles.end());
-
-	FRegionFile& File = mRegionFiles[RegionID].File;
+	FRegionFile& File = mRegionFiles.Get(RegionID);
+	std::lock_guard<std::mutex> Lock(File.GetDataMutex());
 
 	// Get size and offset
-	uint32_t DataSize, SectorOffset;
-	File.GetChunkDataInfo(RegionPosition, DataSize, SectorOffset);
+	uint32_t SectorOffset;
+	File.GetChunkDataInfo(RegionPosition, SizeOut, SectorOffset, CodecOut);
+
+	if (SizeOut == 0)
+		return nullptr;
 
 	// Fill data buffer
-	DataOut.resize(DataSize);
-	File.GetChunkData(SectorOffset, DataOut.data(), DataSize);
+	uint8_t* Data = static_cast<uint8_t*>(Scratch.Allocate(SizeOut));
+	File.GetChunkData(SectorOffset, Data, SizeOut);
+	return Data;
+}
+
+uint32_t FWorldFileSystem::GetChunkSectorOffset(const Vector3i& ChunkPosition)
+{
+	const Vector3i RegionID = FRegionFile::ChunkToRegionPosition(ChunkPosition);
+	const Vector3i RegionPosition = FRegionFile::LocalRegionPosition(ChunkPosition);
+
+	FRegionFile& File = mRegionFiles.Get(RegionID);
+	std::lock_guard<std::mutex> Lock(File.GetDataMutex());
+
+	uint32_t DataSize, SectorOffset;
+	uint8_t Codec;
+	File.GetChunkDataInfo(RegionPosition, DataSize, SectorOffset, Codec);
+	return (DataSize == 0) ? UINT32_MAX : SectorOffset;
+}
+
+uint32_t FWorldFileSystem::GetChunkReadSize(const Vector3i& ChunkPosition)
+{
+	FRegionFile& File = mRegionFiles.Get(FRegionFile::ChunkToRegionPosition(ChunkPosition));
+	std::lock_guard<std::mutex> Lock(File.GetDataMutex());
 
+	uint64_t FileOffset;
+	uint32_t SectorBytes;
+	return File.GetChunkSectors(FRegionFile::LocalRegionPosition(ChunkPosition), FileOffset, SectorBytes) ? SectorBytes : 0;
 }
 
-void FWorldFileSystem::WriteChunkData(const Vector3i& ChunkPosition, const std::vector<uint8_t>& Data)
+void FWorldFileSystem::WriteChunkData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec)
 {
 	const Vector3i RegionID = FRegionFile::ChunkToRegionPosition(ChunkPosition);
 	const Vector3i RegionPosition = FRegionFile::LocalRegionPosition(ChunkPosition);
 
-	ASSERT(mRegionFiles.find(RegionID) != mRegionFiles.end());
+	FRegionFile& File = mRegionFiles.Get(RegionID);
+	std::lock_guard<std::mutex> Lock(File.GetDataMutex());
+	File.WriteChunkData(RegionPosition, Data, DataSize, Codec);
+}
+
+void FWorldFileSystem::SubmitChunkReads(FChunkRead* Reads, const uint32_t Count, FStackAllocator& Scratch)
+{
+	ASSERT(!mReadScratch || mReadScratch == &Scratch);
+	mReadScratch = &Scratch;
+
+	FAsyncReadRequest Requests[READ_QUEUE_DEPTH];
+	FChunkRead* Submitted[READ_QUEUE_DEPTH];
+	uint32_t RequestCount = 0;
 
-	FRegionFile& File = mRegionFiles[RegionID].File;
-	File.WriteChunkData(RegionPosition, Data.data(), Data.size());
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		FChunkRead& Read = Reads[i];
+		Read.Data = nullptr;
+		Read.DataSize = 0;
+		Read.Codec = 0;
+		Read.Sectors = nullptr;
+		Read.SubmitTime = FClock::ReadSystemTimer();
+
+		FRegionFile& File = mRegionFiles.Get(FRegionFile::ChunkToRegionPosition(Read.ChunkPosition));
+		std::lock_guard<std::mutex> Lock(File.GetDataMutex());
+
+		// Header and data are read together, the lookup table says how many sectors they span
+		uint64_t FileOffset;
+		if (!File.GetChunkSectors(FRegionFile::LocalRegionPosition(Read.ChunkPosition), FileOffset, Read.SectorBytes))
+		{
+			// Chunks not in the world complete right away
+			Read.SectorBytes = 0;
+			mReadyReads.push_back(&Read);
+			continue;
+		}
+
+		// Reads beyond the queue depth are read synchronously when retrieved
+		if (RequestCount == READ_QUEUE_DEPTH)
+		{
+			mReadyReads.push_back(&Read);
+			continue;
+		}
+
+		Read.Sectors = static_cast<uint8_t*>(Scratch.Allocate(Read.SectorBytes));
+		Read.WriteCount = File.GetWriteCount();
+
+		FAsyncReadRequest& Request = Requests[RequestCount];
+		Request.File = File.GetFileHandle();
+		Request.Buffer = Read.Sectors;
+		Request.Size = Read.SectorBytes;
+		Request.Offset = FileOffset;
+		Request.UserData = &Read;
+		Submitted[RequestCount++] = &Read;
+	}
+
+	if (RequestCount == 0)
+		return;
+
+	mReadBatches++;
+
+	// Reads the reader has no room for are read synchronously when retrieved
+	const uint32_t Accepted = mAsyncReader->Submit(Requests, RequestCount);
+	for (uint32_t i = Accepted; i < RequestCount; i++)
+	{
+		mReadyReads.push_back(Submitted[i]);
+	}
+}
+
+uint32_t FWorldFileSystem::WaitForChunkReads(FChunkRead** ReadsOut, const uint32_t MaxReads)
+{
+	uint32_t Count = 0;
+
+	while (Count < MaxReads && !mReadyReads.empty())
+	{
+		FChunkRead& Read = *mReadyReads.back();
+		mReadyReads.pop_back();
+
+		// Reads that were not submitted still need their data
+		if (Read.SectorBytes > 0)
+		{
+			Read.Data = ReadChunkData(Read.ChunkPosition, *mReadScratch, Read.DataSize, Read.Codec);
+			RecordRead(Read.SubmitTime);
+		}
+
+		ReadsOut[Count++] = &Read;
+	}
 
-}
\ No newline at end of file
+	if (Count < MaxReads && mAsyncReader->GetPendingCount() > 0)
+	{
+		// Only block if there is nothing to hand back yet
+		FAsyncReadResult Results[READ_QUEUE_DEPTH];
+		const uint32_t MaxResults = std::min(MaxReads - Count, READ_QUEUE_DEPTH);
+		const uint32_t ResultCount = mAsyncReader->Wait(Results, MaxResults, (Count == 0) ? 1 : 0);
+
+		for (uint32_t i = 0; i < ResultCount; i++)
+		{
+			FChunkRead& Read = *static_cast<FChunkRead*>(Results[i].UserData);
+			CompleteChunkRead(Read, Results[i].BytesRead);
+			ReadsOut[Count++] = &Read;
+		}
+	}
+
+	if (mReadyReads.empty() && mAsyncReader->GetPendingCount() == 0)
+		mReadScratch = nullptr;
+
+	return Count;
+}
+
+void FWorldFileSystem::CompleteChunkRead(FChunkRead& Read, const int64_t BytesRead)
+{
+	FRegionFile& File = mRegionFiles.Get(FRegionFile::ChunkToRegionPosition(Read.ChunkPosition));
+
+	{
+		// Writes during the read may have moved the chunk or left a partly written copy
+		std::lock_guard<std::mutex> Lock(File.GetDataMutex());
+		if (BytesRead == (int64_t)Read.SectorBytes && File.GetWriteCount() == Read.WriteCount)
+			Read.Data = FRegionFile::ParseChunkSectors(Read.Sectors, Read.SectorBytes, Read.DataSize, Read.Codec);
+	}
+
+	if (!Read.Data)
+	{
+		mReadRetries++;
+		Read.Data = ReadChunkData(Read.ChunkPosition, *mReadScratch, Read.DataSize, Read.Codec);
+	}
+
+	RecordRead(Read.SubmitTime);
+}
+
+FWorldFileSystem::FReadStats FWorldFileSystem::GetReadStats() const
+{
+	FReadStats Stats;
+	Stats.Reads = mReads;
+	Stats.Batches = mReadBatches;
+	Stats.Retries = mReadRetries;
+	Stats.AverageLatency = (Stats.Reads > 0) ? FClock::CyclesToSeconds(mReadCycles / Stats.Reads) : 0.0f;
+	Stats.MaxLatency = FClock::CyclesToSeconds(mMaxReadCycles);
+	Stats.Backend = mAsyncReader->GetName();
+
+	// Find the bucket the 99th percentile falls in
+	Stats.P99Latency = 0.0f;
+	const uint64_t Target = Stats.Reads - Stats.Reads / 100;
+	uint64_t Total = 0;
+
+	for (uint32_t i = 0; i < LATENCY_BUCKETS && Stats.Reads > 0; i++)
+	{
+		Total += mReadHistogram[i];
+		if (Total >= Target)
+		{
+			Stats.P99Latency = std::min(std::ldexp(1.0f, i + 1) / 1000000.0f, Stats.MaxLatency);
+			break;
+		}
+	}
+
+	return Stats;
+}
+
+void FWorldFileSystem::ResetReadStats()
+{
+	mReads = 0;
+	mReadBatches = 0;
+	mReadRetries = 0;
+	mReadCycles = 0;
+	mMaxReadCycles = 0;
+
+	for (auto& Bucket : mReadHistogram)
+	{
+		Bucket = 0;
+	}
+}
+
+void FWorldFileSystem::RecordRead(const uint64_t StartTime)
+{
+	const uint64_t Latency = FClock::ReadSystemTimer() - StartTime;
+	mReadCycles += Latency;
+	if (Latency > mMaxReadCycles)
+		mMaxReadCycles = Latency;
+	mReads++;
+
+	// Bucket i holds latencies below 2^(i + 1) microseconds
+	const float Microseconds = FClock::CyclesToSeconds(Latency) * 1000000.0f;
+	const int32_t Bucket = std::max(std::ilogb(Microseconds + 1.0f), 0);
+	mReadHistogram[std::min((uint32_t)Bucket, LATENCY_BUCKETS - 1)]++;
+}
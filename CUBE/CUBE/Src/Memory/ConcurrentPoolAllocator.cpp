@@ -0,0 +1,59 @@
+#include "..\..\Include\Memory\ConcurrentPoolAllocator.h"
+
+namespace FConcurrentPool
+{
+	THREAD_LOCAL FThreadMagazines* ThreadMagazines = nullptr;
+
+	static std::mutex        ThreadListMutex;
+	static FThreadMagazines* ThreadList = nullptr;
+
+	static std::mutex PoolIDMutex;
+	static bool       IsPoolIDUsed[MAX_POOLS];
+	static uint32_t   PoolIDGenerations[MAX_POOLS];
+
+	uint32_t AcquirePoolID(uint32_t& GenerationOut)
+	{
+		std::lock_guard<std::mutex> Lock(PoolIDMutex);
+
+		uint32_t ID = 0;
+		while (ID < MAX_POOLS && IsPoolIDUsed[ID])
+		{
+			ID++;
+		}
+
+		ASSERT(ID < MAX_POOLS && "Too many concurrent pools, increase FConcurrentPool::MAX_POOLS.");
+		IsPoolIDUsed[ID] = true;
+
+		// Thread magazines start at generation 0, so they are never mistaken for a pool's
+		GenerationOut = ++PoolIDGenerations[ID];
+		return ID;
+	}
+
+	void ReleasePoolID(const uint32_t ID)
+	{
+		std::lock_guard<std::mutex> Lock(PoolIDMutex);
+		IsPoolIDUsed[ID] = false;
+	}
+
+	FThreadMagazines* RegisterThread()
+	{
+		// Value-initialized, so every magazine starts at generation 0
+		FThreadMagazines* Magazines = new FThreadMagazines();
+
+		std::lock_guard<std::mutex> Lock(ThreadListMutex);
+		Magazines->Next = ThreadList;
+		ThreadList = Magazines;
+
+		ThreadMagazines = Magazines;
+		return Magazines;
+	}
+
+	void VisitMagazines(const uint32_t ID, void(*Visit)(FMagazine& Magazine, void* UserData), void* UserData)
+	{
+		std::lock_guard<std::mutex> Lock(ThreadListMutex);
+		for (FThreadMagazines* Magazines = ThreadList; Magazines; Magazines = Magazines->Next)
+		{
+			Visit(Magazines->Magazines[ID], UserData);
+		}
+	}
+}
@@ -0,0 +1,217 @@
+#include "Memory\MemoryTracker.h"
+#include "BulletPhysics\LinearMath\btAlignedAllocator.h"
+#include "FMOD\fmod.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+	/**
+	* Statistics of a single tag. Each tag has its own cache line
+	* so threads reporting to different tags don't contend.
+	*/
+	WIN_ALIGN(64)
+	struct TagCounters
+	{
+		std::atomic<uint64_t> LiveBytes;
+		std::atomic<uint64_t> PeakBytes;
+		std::atomic<uint64_t> LiveCount;
+		std::atomic<uint64_t> TotalCount;
+	};
+
+	TagCounters Counters[(uint32_t)EMemoryTag::Count];
+
+	const char* TagNames[(uint32_t)EMemoryTag::Count] =
+	{
+		"Untagged",
+		"Chunk Blocks",
+		"Chunk Meshes",
+		"Chunk Collision",
+		"Chunk GPU",
+		"Chunk Cache",
+		"Scratch",
+		"Game Objects",
+		"Physics",
+		"Audio",
+		"Mesh Resources"
+	};
+}
+
+#if MEMORY_TRACKING_ENABLED
+namespace
+{
+	THREAD_LOCAL EMemoryTag CurrentTag = EMemoryTag::Untagged;
+
+	// Size header placed in front of third party allocations, keeps 16 byte alignment
+	static const size_t HEADER_SIZE = 16;
+
+	void* TrackedMalloc(const EMemoryTag Tag, const size_t Bytes)
+	{
+		uint8_t* Memory = static_cast<uint8_t*>(std::malloc(Bytes + HEADER_SIZE));
+		if (!Memory)
+			return nullptr;
+
+		*reinterpret_cast<size_t*>(Memory) = Bytes;
+		SMemoryTracker::OnAllocate(Tag, Bytes);
+		return Memory + HEADER_SIZE;
+	}
+
+	void TrackedFree(const EMemoryTag Tag, void* Data)
+	{
+		if (!Data)
+			return;
+
+		uint8_t* Memory = static_cast<uint8_t*>(Data) - HEADER_SIZE;
+		SMemoryTracker::OnFree(Tag, *reinterpret_cast<size_t*>(Memory));
+		std::free(Memory);
+	}
+
+	void* BulletAlloc(size_t Bytes)
+	{
+		return TrackedMalloc(EMemoryTag::Physics, Bytes);
+	}
+
+	void BulletFree(void* Data)
+	{
+		TrackedFree(EMemoryTag::Physics, Data);
+	}
+
+	void* F_CALLBACK FMODAlloc(unsigned int Bytes, FMOD_MEMORY_TYPE, const char*)
+	{
+		return TrackedMalloc(EMemoryTag::Audio, Bytes);
+	}
+
+	void* F_CALLBACK FMODRealloc(void* Data, unsigned int Bytes, FMOD_MEMORY_TYPE, const char*)
+	{
+		if (!Data)
+			return TrackedMalloc(EMemoryTag::Audio, Bytes);
+
+		uint8_t* Memory = static_cast<uint8_t*>(Data) - HEADER_SIZE;
+		const size_t OldBytes = *reinterpret_cast<size_t*>(Memory);
+
+		Memory = static_cast<uint8_t*>(std::realloc(Memory, Bytes + HEADER_SIZE));
+		if (!Memory)
+			return nullptr;
+
+		*reinterpret_cast<size_t*>(Memory) = Bytes;
+		SMemoryTracker::OnResize(EMemoryTag::Audio, OldBytes, Bytes);
+		return Memory + HEADER_SIZE;
+	}
+
+	void F_CALLBACK FMODFree(void* Data, FMOD_MEMORY_TYPE, const char*)
+	{
+		TrackedFree(EMemoryTag::Audio, Data);
+	}
+}
+
+void SMemoryTracker::OnAllocate(const EMemoryTag Tag, const size_t Bytes)
+{
+	TagCounters& Counter = Counters[(uint32_t)Tag];
+	Counter.LiveCount.fetch_add(1, std::memory_order_relaxed);
+	Counter.TotalCount.fetch_add(1, std::memory_order_relaxed);
+
+	const uint64_t Live = Counter.LiveBytes.fetch_add(Bytes, std::memory_order_relaxed) + Bytes;
+	uint64_t Peak = Counter.PeakBytes.load(std::memory_order_relaxed);
+	while (Live > Peak && !Counter.PeakBytes.compare_exchange_weak(Peak, Live, std::memory_order_relaxed)){}
+}
+
+void SMemoryTracker::OnFree(const EMemoryTag Tag, const size_t Bytes)
+{
+	TagCounters& Counter = Counters[(uint32_t)Tag];
+	Counter.LiveCount.fetch_sub(1, std::memory_order_relaxed);
+	Counter.LiveBytes.fetch_sub(Bytes, std::memory_order_relaxed);
+}
+
+void SMemoryTracker::OnResize(const EMemoryTag Tag, const size_t OldBytes, const size_t NewBytes)
+{
+	if (OldBytes == NewBytes)
+		return;
+
+	if (OldBytes == 0)
+	{
+		OnAllocate(Tag, NewBytes);
+	}
+	else if (NewBytes == 0)
+	{
+		OnFree(Tag, OldBytes);
+	}
+	else if (NewBytes > OldBytes)
+	{
+		// The allocation count is unchanged, only the byte counts grow
+		TagCounters& Counter = Counters[(uint32_t)Tag];
+		const uint64_t Live = Counter.LiveBytes.fetch_add(NewBytes - OldBytes, std::memory_order_relaxed) + (NewBytes - OldBytes);
+		uint64_t Peak = Counter.PeakBytes.load(std::memory_order_relaxed);
+		while (Live > Peak && !Counter.PeakBytes.compare_exchange_weak(Peak, Live, std::memory_order_relaxed)){}
+	}
+	else
+	{
+		Counters[(uint32_t)Tag].LiveBytes.fetch_sub(OldBytes - NewBytes, std::memory_order_relaxed);
+	}
+}
+
+EMemoryTag SMemoryTracker::GetCurrentTag()
+{
+	return CurrentTag;
+}
+
+void SMemoryTracker::SetCurrentTag(const EMemoryTag Tag)
+{
+	CurrentTag = Tag;
+}
+#endif
+
+SMemoryTracker::FTagStats SMemoryTracker::GetStats(const EMemoryTag Tag)
+{
+	const TagCounters& Counter = Counters[(uint32_t)Tag];
+
+	FTagStats Stats;
+	Stats.LiveBytes = Counter.LiveBytes.load(std::memory_order_relaxed);
+	Stats.PeakBytes = Counter.PeakBytes.load(std::memory_order_relaxed);
+	Stats.LiveCount = Counter.LiveCount.load(std::memory_order_relaxed);
+	Stats.TotalCount = Counter.TotalCount.load(std::memory_order_relaxed);
+	return Stats;
+}
+
+const char* SMemoryTracker::GetTagName(const EMemoryTag Tag)
+{
+	return TagNames[(uint32_t)Tag];
+}
+
+bool SMemoryTracker::DumpToFile(const char* Filename)
+{
+	FILE* File = fopen(Filename, "w");
+	if (!File)
+	{
+		printf("Unable to open %s for writing memory stats.\n", Filename);
+		return false;
+	}
+
+	uint64_t TotalLive = 0;
+	fprintf(File, "%-16s %14s %14s %12s %12s\n", "Tag", "Live (bytes)", "Peak (bytes)", "Live Count", "Total Count");
+	for (uint32_t i = 0; i < (uint32_t)EMemoryTag::Count; i++)
+	{
+		const FTagStats Stats = GetStats((EMemoryTag)i);
+		fprintf(File, "%-16s %14llu %14llu %12llu %12llu\n", TagNames[i],
+			(unsigned long long)Stats.LiveBytes, (unsigned long long)Stats.PeakBytes,
+			(unsigned long long)Stats.LiveCount, (unsigned long long)Stats.TotalCount);
+		TotalLive += Stats.LiveBytes;
+	}
+
+	fprintf(File, "%-16s %14llu\n", "Total", (unsigned long long)TotalLive);
+	fclose(File);
+	return true;
+}
+
+void SMemoryTracker::InstallThirdPartyHooks()
+{
+#if MEMORY_TRACKING_ENABLED
+	btAlignedAllocSetCustom(&BulletAlloc, &BulletFree);
+
+	FMOD_RESULT Result = FMOD::Memory_Initialize(nullptr, 0, &FMODAlloc, &FMODRealloc, &FMODFree);
+	if (Result != FMOD_OK)
+	{
+		printf("FMOD error! (%d) Unable to install memory callbacks.\n", Result);
+	}
+#endif
+}
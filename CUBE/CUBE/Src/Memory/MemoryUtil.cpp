@@ -1,6 +1,13 @@
 #include "../Include/Memory/MemoryUtil.h"
 #include "../Include/Misc/Assertions.h"
 
+#ifdef _WIN32
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
 namespace FMemory
 {
 	void* AllocateUnaligned(uint32_t Bytes)
@@ -56,4 +63,76 @@ namespace FMemory
 
 		FreeUnaligned(reinterpret_cast<void*>(CompleteAddress));
 	}
+
+#ifdef _WIN32
+	uint32_t GetPageSize()
+	{
+		static uint32_t PageSize = 0;
+		if (PageSize == 0)
+		{
+			SYSTEM_INFO Info;
+			GetSystemInfo(&Info);
+			PageSize = Info.dwPageSize;
+		}
+
+		return PageSize;
+	}
+
+	void* ReserveVirtual(const size_t Bytes)
+	{
+		return VirtualAlloc(nullptr, Bytes, MEM_RESERVE, PAGE_NOACCESS);
+	}
+
+	bool CommitVirtual(void* Address, const size_t Bytes)
+	{
+		return VirtualAlloc(Address, Bytes, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+	}
+
+	void DecommitVirtual(void* Address, const size_t Bytes)
+	{
+		VirtualFree(Address, Bytes, MEM_DECOMMIT);
+	}
+
+	void ReleaseVirtual(void* Address, const size_t Bytes)
+	{
+		Bytes; // Windows releases the complete reservation
+		VirtualFree(Address, 0, MEM_RELEASE);
+	}
+#else
+	uint32_t GetPageSize()
+	{
+		static uint32_t PageSize = 0;
+		if (PageSize == 0)
+		{
+			PageSize = static_cast<uint32_t>(sysconf(_SC_PAGESIZE));
+		}
+
+		return PageSize;
+	}
+
+	void* ReserveVirtual(const size_t Bytes)
+	{
+		// Reserve inaccessible pages that don't count against the commit limit
+		void* Address = mmap(nullptr, Bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		return (Address == MAP_FAILED) ? nullptr : Address;
+	}
+
+	bool CommitVirtual(void* Address, const size_t Bytes)
+	{
+		// Pages are backed lazily by the kernel once they are touched
+		return mprotect(Address, Bytes, PROT_READ | PROT_WRITE) == 0;
+	}
+
+	void DecommitVirtual(void* Address, const size_t Bytes)
+	{
+		// Drop the physical pages, then make the range inaccessible again
+		madvise(Address, Bytes, MADV_DONTNEED);
+		mprotect(Address, Bytes, PROT_NONE);
+	}
+
+	void ReleaseVirtual(void* Address, const size_t Bytes)
+	{
+		munmap(Address, Bytes);
+	}
+#endif
 }
\ No newline at end of file
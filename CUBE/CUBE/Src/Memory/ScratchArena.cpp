@@ -0,0 +1,66 @@
+#include "..\..\Include\Memory\ScratchArena.h"
+#include "Common.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	// Owns every arena ever created. Arenas are only destroyed at program exit.
+	std::vector<std::unique_ptr<FStackAllocator>> AllArenas;
+
+	// Arenas released by threads that are done with them
+	std::vector<FStackAllocator*> FreeArenas;
+
+	std::mutex ArenaMutex;
+
+	THREAD_LOCAL FStackAllocator* ThreadArena = nullptr;
+}
+
+std::atomic<uint32_t> SScratchArena::mPeakUsage(0);
+
+FStackAllocator& SScratchArena::Get()
+{
+	if (!ThreadArena)
+	{
+		std::lock_guard<std::mutex> Lock(ArenaMutex);
+		if (!FreeArenas.empty())
+		{
+			ThreadArena = FreeArenas.back();
+			FreeArenas.pop_back();
+		}
+		else
+		{
+			FMemoryTagScope MemoryTag(EMemoryTag::Scratch);
+			AllArenas.emplace_back(new FStackAllocator{ ARENA_SIZE });
+			ThreadArena = AllArenas.back().get();
+		}
+	}
+
+	return *ThreadArena;
+}
+
+void SScratchArena::ReleaseThreadArena()
+{
+	if (ThreadArena)
+	{
+		ASSERT(ThreadArena->GetMarker() == 0 && "Scratch memory is still in use.");
+
+		std::lock_guard<std::mutex> Lock(ArenaMutex);
+		FreeArenas.push_back(ThreadArena);
+		ThreadArena = nullptr;
+	}
+}
+
+uint32_t SScratchArena::GetPeakUsage()
+{
+	return mPeakUsage.load(std::memory_order_relaxed);
+}
+
+void SScratchArena::UpdatePeakUsage(const FStackAllocator& Arena)
+{
+	const uint32_t Peak = Arena.GetPeakMarker();
+	uint32_t Current = mPeakUsage.load(std::memory_order_relaxed);
+	while (Peak > Current && !mPeakUsage.compare_exchange_weak(Current, Peak, std::memory_order_relaxed)){}
+}
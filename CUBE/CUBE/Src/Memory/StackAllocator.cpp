@@ -3,15 +3,19 @@
 
 FStackAllocator::FStackAllocator(const uint32_t SizeBytes)
 	: mCurrentMarker(0)
+	, mPeakMarker(0)
 	, mCapacity(SizeBytes)
+	, mTag(SMemoryTracker::GetCurrentTag())
 {
 	ASSERT(SizeBytes > 0);
 	mData = new uint8_t[SizeBytes];
+	SMemoryTracker::OnAllocate(mTag, SizeBytes);
 }
 
 FStackAllocator::~FStackAllocator()
 {
 	delete[] mData;
+	SMemoryTracker::OnFree(mTag, mCapacity);
 }
 
 void* FStackAllocator::Allocate(const uint32_t Bytes)
@@ -21,6 +25,9 @@ void* FStackAllocator::Allocate(const uint32_t Bytes)
 	void* Data = &mData[mCurrentMarker];
 	mCurrentMarker += Bytes;
 
+	if (mCurrentMarker > mPeakMarker)
+		mPeakMarker = mCurrentMarker;
+
 	return Data;
 }
 
@@ -36,6 +43,21 @@ FStackAllocator::UMarker FStackAllocator::GetMarker() const
 	return mCurrentMarker;
 }
 
+FStackAllocator::UMarker FStackAllocator::GetPeakMarker() const
+{
+	return mPeakMarker;
+}
+
+void FStackAllocator::ResetPeakMarker()
+{
+	mPeakMarker = mCurrentMarker;
+}
+
+uint32_t FStackAllocator::GetCapacity() const
+{
+	return mCapacity;
+}
+
 void FStackAllocator::Clear()
 {
 	mCurrentMarker = 0;
@@ -5,6 +5,10 @@
 #include "Debugging\DebugDraw.h"
 #include "SFML\Window\Keyboard.hpp"
 
+// Bullet's profiler (BT_PROFILE) keeps process-wide state, so the worlds of
+// roots running on different threads are never stepped or drawn at the same time
+static std::mutex BulletProfilerMutex;
+
 FPhysicsSystem::FPhysicsSystem(Atlas::FWorld& World)
 	: ISystem(World)
 	, mRigidBodyMutex()
@@ -18,7 +22,8 @@ FPhysicsSystem::FPhysicsSystem(Atlas::FWorld& World)
 	, mDynamicsWorld(&mCollisionDispatcher, &mBroadPhase, &mConstraintSolver, &mCollisionConfig)
 {
 	mDynamicsWorld.setGravity(btVector3{ 0, -10, 0 });
-	mDynamicsWorld.setDebugDrawer(FDebug::Draw::GetInstancePtr());
+	// Headless roots have no debug drawer
+	mDynamicsWorld.setDebugDrawer(FDebug::Draw::TryGetInstancePtr());
 
 	AddSubSystem<FRigidBodySystem>(*this);
 	AddSubSystem<FColliderSystem>(*this);
@@ -76,11 +81,13 @@ void FPhysicsSystem::Update()
 
 	ColliderLock.unlock();
 	
+	std::lock_guard<std::mutex> BulletLock(BulletProfilerMutex);
 	mDynamicsWorld.stepSimulation(STime::GetDeltaTime());
 }
 
 void FPhysicsSystem::RenderCollisionObjects()
 {
+	std::lock_guard<std::mutex> BulletLock(BulletProfilerMutex);
 	mDynamicsWorld.debugDrawWorld();
 }
 
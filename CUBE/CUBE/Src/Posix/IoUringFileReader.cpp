@@ -0,0 +1,300 @@
+// Only compiled on Linux, other platforms read on a thread pool
+#if defined(__linux__)
+
+#include "..\Include\Posix\IoUringFileReader.h"
+#include "..\Include\Posix\PosixFile.h"
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+	int SetupRing(const uint32_t Entries, io_uring_params& Params)
+	{
+		return (int)syscall(__NR_io_uring_setup, Entries, &Params);
+	}
+
+	int EnterRing(const int RingFile, const uint32_t ToSubmit, const uint32_t MinCompletions, const uint32_t Flags)
+	{
+		return (int)syscall(__NR_io_uring_enter, RingFile, ToSubmit, MinCompletions, Flags, nullptr, 0);
+	}
+
+	void* MapRing(const int RingFile, const size_t Size, const off_t Offset)
+	{
+		void* Ring = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingFile, Offset);
+		return (Ring == MAP_FAILED) ? nullptr : Ring;
+	}
+
+	// The kernel reads and writes the ring indices concurrently
+	uint32_t LoadAcquire(const uint32_t* Index)
+	{
+		return __atomic_load_n(Index, __ATOMIC_ACQUIRE);
+	}
+
+	void StoreRelease(uint32_t* Index, const uint32_t Value)
+	{
+		__atomic_store_n(Index, Value, __ATOMIC_RELEASE);
+	}
+}
+
+std::unique_ptr<IAsyncFileReader> FIoUringFileReader::Create(const uint32_t QueueDepth)
+{
+	std::unique_ptr<FIoUringFileReader> Reader{ new FIoUringFileReader };
+	if (!Reader->MapRings(QueueDepth))
+		return nullptr;
+
+	return Reader;
+}
+
+FIoUringFileReader::FIoUringFileReader()
+	: mRingFile(-1)
+	, mSubmitRing(nullptr)
+	, mSubmitRingSize(0)
+	, mSubmitHead(nullptr)
+	, mSubmitTail(nullptr)
+	, mSubmitMask(0)
+	, mSubmitArray(nullptr)
+	, mSubmitEntries(nullptr)
+	, mSubmitEntriesSize(0)
+	, mUnsubmitted(0)
+	, mCompleteRing(nullptr)
+	, mCompleteRingSize(0)
+	, mCompleteHead(nullptr)
+	, mCompleteTail(nullptr)
+	, mCompleteMask(0)
+	, mCompletions(nullptr)
+	, mSlots()
+	, mFreeSlots()
+	, mReaped()
+{
+}
+
+FIoUringFileReader::~FIoUringFileReader()
+{
+	// Buffers and iovecs of reads in flight must outlive the reads
+	if (mRingFile >= 0 && GetPendingCount() > 0)
+	{
+		std::vector<FAsyncReadResult> Discarded(mSlots.size());
+		while (GetPendingCount() > 0 && Wait(Discarded.data(), (uint32_t)Discarded.size(), 1) > 0);
+	}
+
+	if (mSubmitEntries)
+		munmap(mSubmitEntries, mSubmitEntriesSize);
+	if (mCompleteRing && mCompleteRing != mSubmitRing)
+		munmap(mCompleteRing, mCompleteRingSize);
+	if (mSubmitRing)
+		munmap(mSubmitRing, mSubmitRingSize);
+	if (mRingFile >= 0)
+		close(mRingFile);
+}
+
+bool FIoUringFileReader::MapRings(const uint32_t QueueDepth)
+{
+	io_uring_params Params;
+	std::memset(&Params, 0, sizeof(Params));
+
+	// Fails with ENOSYS on kernels without io_uring and EPERM where it is disabled
+	mRingFile = SetupRing(QueueDepth, Params);
+	if (mRingFile < 0)
+		return false;
+
+	mSubmitRingSize = Params.sq_off.array + Params.sq_entries * sizeof(uint32_t);
+	mCompleteRingSize = Params.cq_off.cqes + Params.cq_entries * sizeof(io_uring_cqe);
+
+	// Newer kernels map both rings with a single call
+	const bool IsSingleMapping = (Params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (IsSingleMapping)
+	{
+		mSubmitRingSize = (mSubmitRingSize > mCompleteRingSize) ? mSubmitRingSize : mCompleteRingSize;
+		mCompleteRingSize = mSubmitRingSize;
+	}
+
+	mSubmitRing = MapRing(mRingFile, mSubmitRingSize, IORING_OFF_SQ_RING);
+	if (!mSubmitRing)
+		return false;
+
+	mCompleteRing = IsSingleMapping ? mSubmitRing : MapRing(mRingFile, mCompleteRingSize, IORING_OFF_CQ_RING);
+	if (!mCompleteRing)
+		return false;
+
+	mSubmitEntriesSize = Params.sq_entries * sizeof(io_uring_sqe);
+	mSubmitEntries = MapRing(mRingFile, mSubmitEntriesSize, IORING_OFF_SQES);
+	if (!mSubmitEntries)
+		return false;
+
+	uint8_t* SubmitRing = static_cast<uint8_t*>(mSubmitRing);
+	mSubmitHead = reinterpret_cast<uint32_t*>(SubmitRing + Params.sq_off.head);
+	mSubmitTail = reinterpret_cast<uint32_t*>(SubmitRing + Params.sq_off.tail);
+	mSubmitMask = *reinterpret_cast<uint32_t*>(SubmitRing + Params.sq_off.ring_mask);
+	mSubmitArray = reinterpret_cast<uint32_t*>(SubmitRing + Params.sq_off.array);
+
+	uint8_t* CompleteRing = static_cast<uint8_t*>(mCompleteRing);
+	mCompleteHead = reinterpret_cast<uint32_t*>(CompleteRing + Params.cq_off.head);
+	mCompleteTail = reinterpret_cast<uint32_t*>(CompleteRing + Params.cq_off.tail);
+	mCompleteMask = *reinterpret_cast<uint32_t*>(CompleteRing + Params.cq_off.ring_mask);
+	mCompletions = CompleteRing + Params.cq_off.cqes;
+
+	// The kernel rounds the depth up to a power of two, the completion ring is twice as large
+	// so it can never overflow with at most sq_entries reads in flight
+	mSlots.resize(Params.sq_entries);
+	mFreeSlots.reserve(Params.sq_entries);
+	for (uint32_t i = Params.sq_entries; i > 0; i--)
+	{
+		mFreeSlots.push_back(i - 1);
+	}
+
+	return true;
+}
+
+uint32_t FIoUringFileReader::Submit(const FAsyncReadRequest* Requests, const uint32_t Count)
+{
+	io_uring_sqe* Entries = static_cast<io_uring_sqe*>(mSubmitEntries);
+
+	// Only this thread writes the tail
+	uint32_t Tail = *mSubmitTail;
+	uint32_t Accepted = 0;
+
+	while (Accepted < Count && !mFreeSlots.empty())
+	{
+		const FAsyncReadRequest& Request = Requests[Accepted];
+
+		const uint32_t SlotIndex = mFreeSlots.back();
+		mFreeSlots.pop_back();
+
+		FSlot& Slot = mSlots[SlotIndex];
+		Slot.Vector.iov_base = Request.Buffer;
+		Slot.Vector.iov_len = Request.Size;
+		Slot.UserData = Request.UserData;
+
+		const uint32_t EntryIndex = Tail & mSubmitMask;
+		io_uring_sqe& Entry = Entries[EntryIndex];
+		std::memset(&Entry, 0, sizeof(Entry));
+		Entry.opcode = IORING_OP_READV;
+		Entry.fd = static_cast<FPosixHandle*>(Request.File)->GetFileDescriptor();
+		Entry.off = Request.Offset;
+		Entry.addr = (uint64_t)(uintptr_t)&Slot.Vector;
+		Entry.len = 1;
+		Entry.user_data = SlotIndex;
+
+		mSubmitArray[EntryIndex] = EntryIndex;
+		Tail++;
+		Accepted++;
+	}
+
+	// Entries must be visible to the kernel before the tail moves
+	StoreRelease(mSubmitTail, Tail);
+	mUnsubmitted += Accepted;
+
+	Enter(0);
+	return Accepted;
+}
+
+uint32_t FIoUringFileReader::Wait(FAsyncReadResult* ResultsOut, const uint32_t MaxResults, const uint32_t MinResults)
+{
+	const uint32_t WaitCount = (MinResults < GetPendingCount()) ? MinResults : GetPendingCount();
+	uint32_t Count = 0;
+
+	while (true)
+	{
+		while (!mReaped.empty() && Count < MaxResults)
+		{
+			ResultsOut[Count++] = mReaped.back();
+			mReaped.pop_back();
+		}
+
+		Count += ReapCompletions(ResultsOut + Count, MaxResults - Count);
+
+		if (Count >= WaitCount || Count >= MaxResults)
+			break;
+
+		// Callers free the buffers once the reads are retrieved, so reads are never left in flight
+		if (!Enter(WaitCount - Count))
+			ReapAll();
+	}
+
+	return Count;
+}
+
+uint32_t FIoUringFileReader::ReapCompletions(FAsyncReadResult* ResultsOut, const uint32_t MaxResults)
+{
+	const io_uring_cqe* Completions = static_cast<const io_uring_cqe*>(mCompletions);
+
+	// Only this thread writes the head
+	uint32_t Head = *mCompleteHead;
+	const uint32_t Tail = LoadAcquire(mCompleteTail);
+	uint32_t Count = 0;
+
+	while (Head != Tail && Count < MaxResults)
+	{
+		const io_uring_cqe& Completion = Completions[Head & mCompleteMask];
+		const uint32_t SlotIndex = (uint32_t)Completion.user_data;
+
+		ResultsOut[Count].UserData = mSlots[SlotIndex].UserData;
+		ResultsOut[Count].BytesRead = Completion.res;
+		mFreeSlots.push_back(SlotIndex);
+
+		Head++;
+		Count++;
+	}
+
+	// The kernel may reuse the entries once the head moves
+	StoreRelease(mCompleteHead, Head);
+	return Count;
+}
+
+void FIoUringFileReader::ReapAll()
+{
+	const io_uring_sqe* Entries = static_cast<const io_uring_sqe*>(mSubmitEntries);
+
+	// The kernel only takes entries while this thread is in io_uring_enter, so entries
+	// it has not taken yet can be withdrawn by moving the tail back
+	const uint32_t Head = LoadAcquire(mSubmitHead);
+	const uint32_t Tail = *mSubmitTail;
+	for (uint32_t Index = Head; Index != Tail; Index++)
+	{
+		const uint32_t SlotIndex = (uint32_t)Entries[mSubmitArray[Index & mSubmitMask]].user_data;
+		mReaped.push_back(FAsyncReadResult{ mSlots[SlotIndex].UserData, -ECANCELED });
+		mFreeSlots.push_back(SlotIndex);
+	}
+
+	StoreRelease(mSubmitTail, Head);
+	mUnsubmitted = 0;
+
+	// Reads the kernel took complete without us, their buffers are written until then
+	while (GetInFlightCount() > 0)
+	{
+		const size_t Start = mReaped.size();
+		mReaped.resize(Start + GetInFlightCount());
+		const uint32_t Reaped = ReapCompletions(&mReaped[Start], GetInFlightCount());
+		mReaped.resize(Start + Reaped);
+
+		if (GetInFlightCount() > 0 && EnterRing(mRingFile, 0, 1, IORING_ENTER_GETEVENTS) < 0)
+			std::this_thread::yield();
+	}
+}
+
+bool FIoUringFileReader::Enter(const uint32_t MinCompletions)
+{
+	while (true)
+	{
+		const uint32_t Flags = (MinCompletions > 0) ? IORING_ENTER_GETEVENTS : 0;
+		const int Result = EnterRing(mRingFile, mUnsubmitted, MinCompletions, Flags);
+
+		if (Result >= 0)
+		{
+			// Entries the kernel could not take yet are passed again on the next call
+			mUnsubmitted -= (uint32_t)Result;
+			return true;
+		}
+
+		if (errno != EINTR)
+			return false;
+	}
+}
+
+#endif
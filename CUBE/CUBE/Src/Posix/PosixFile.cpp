@@ -0,0 +1,519 @@
+// Only compiled on POSIX platforms, the Windows build uses WindowsFile.cpp
+#if !defined(_WIN32)
+
+#include "..\Include\Posix\PosixFile.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <vector>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <ftw.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace
+{
+	void PrintError()
+	{
+		std::wcerr << strerror(errno) << std::endl;
+	}
+
+	void PrintError(const wchar_t* File)
+	{
+		std::wcerr << strerror(errno) << L" on file: " << File << std::endl;
+	}
+
+	std::string ToNarrowPath(const wchar_t* Path)
+	{
+		const size_t Length = wcstombs(nullptr, Path, 0);
+		if (Length == (size_t)-1)
+			return std::string{};
+
+		std::string Narrow(Length, '\0');
+		wcstombs(&Narrow[0], Path, Length);
+		return Narrow;
+	}
+
+	bool ToWidePath(const char* Path, wchar_t* DataOut, const uint32_t BufferLength)
+	{
+		const size_t Length = mbstowcs(DataOut, Path, BufferLength);
+		return Length != (size_t)-1 && Length < BufferLength;
+	}
+
+	int RemoveEntry(const char* Path, const struct stat*, int, struct FTW*)
+	{
+		return remove(Path);
+	}
+}
+
+FPosixHandle::FPosixHandle(int FileDescriptor)
+	: mFileDescriptor(FileDescriptor)
+{
+}
+
+bool FPosixHandle::Read(uint8_t* DataOut, uint32_t NumBytesToRead)
+{
+	while (NumBytesToRead > 0)
+	{
+		const ssize_t BytesRead = read(mFileDescriptor, DataOut, NumBytesToRead);
+		if (BytesRead < 0 && errno == EINTR)
+			continue;
+
+		if (BytesRead <= 0)
+		{
+			PrintError();
+			return false;
+		}
+
+		DataOut += BytesRead;
+		NumBytesToRead -= (uint32_t)BytesRead;
+	}
+
+	return true;
+}
+
+bool FPosixHandle::Write(const uint8_t* Data, const uint32_t NumBytesToWrite)
+{
+	uint32_t BytesLeft = NumBytesToWrite;
+	while (BytesLeft > 0)
+	{
+		const ssize_t BytesWritten = write(mFileDescriptor, Data, BytesLeft);
+		if (BytesWritten < 0 && errno == EINTR)
+			continue;
+
+		if (BytesWritten <= 0)
+		{
+			PrintError();
+			return false;
+		}
+
+		Data += BytesWritten;
+		BytesLeft -= (uint32_t)BytesWritten;
+	}
+
+	return true;
+}
+
+bool FPosixHandle::Seek(const uint64_t Distance)
+{
+	return FileSeek(Distance, SEEK_CUR);
+}
+
+bool FPosixHandle::SeekFromEnd(const uint64_t Distance)
+{
+	return FileSeek(Distance, SEEK_END);
+}
+
+bool FPosixHandle::SeekFromStart(const uint64_t Distance)
+{
+	return FileSeek(Distance, SEEK_SET);
+}
+
+bool FPosixHandle::FileSeek(const uint64_t Distance, const int Whence)
+{
+	if (lseek(mFileDescriptor, (off_t)Distance, Whence) == (off_t)-1)
+	{
+		PrintError();
+		return false;
+	}
+
+	return true;
+}
+
+uint32_t FPosixHandle::GetFileSize() const
+{
+	struct stat FileInfo;
+	if (fstat(mFileDescriptor, &FileInfo) != 0)
+		return 0;
+
+	return (uint32_t)FileInfo.st_size;
+}
+
+bool FPosixHandle::ReadAt(uint8_t* DataOut, const uint32_t NumBytesToRead, const uint64_t Offset)
+{
+	uint32_t BytesLeft = NumBytesToRead;
+	uint64_t Position = Offset;
+	while (BytesLeft > 0)
+	{
+		const ssize_t BytesRead = pread(mFileDescriptor, DataOut, BytesLeft, (off_t)Position);
+		if (BytesRead < 0 && errno == EINTR)
+			continue;
+
+		if (BytesRead <= 0)
+		{
+			PrintError();
+			return false;
+		}
+
+		DataOut += BytesRead;
+		Position += BytesRead;
+		BytesLeft -= (uint32_t)BytesRead;
+	}
+
+	return true;
+}
+
+bool FPosixHandle::WriteAt(const uint8_t* Data, const uint32_t NumBytesToWrite, const uint64_t Offset)
+{
+	uint32_t BytesLeft = NumBytesToWrite;
+	uint64_t Position = Offset;
+	while (BytesLeft > 0)
+	{
+		const ssize_t BytesWritten = pwrite(mFileDescriptor, Data, BytesLeft, (off_t)Position);
+		if (BytesWritten < 0 && errno == EINTR)
+			continue;
+
+		if (BytesWritten <= 0)
+		{
+			PrintError();
+			return false;
+		}
+
+		Data += BytesWritten;
+		Position += BytesWritten;
+		BytesLeft -= (uint32_t)BytesWritten;
+	}
+
+	return true;
+}
+
+bool FPosixHandle::Reserve(const uint64_t Size)
+{
+#if defined(__linux__)
+	// Keep the reported size so appends still land at the end of the data
+	if (fallocate(mFileDescriptor, FALLOC_FL_KEEP_SIZE, 0, (off_t)Size) == 0)
+		return true;
+
+	// Not supported by the file system, nothing to reserve
+	if (errno == EOPNOTSUPP)
+		return true;
+
+	PrintError();
+	return false;
+#else
+	return true;
+#endif
+}
+
+void FPosixHandle::Advise(const EFileAdvice::Type Advice, const uint64_t Offset, const uint64_t Length)
+{
+#if defined(POSIX_FADV_NORMAL)
+	static const int Advices[] =
+	{
+		POSIX_FADV_NORMAL,
+		POSIX_FADV_SEQUENTIAL,
+		POSIX_FADV_RANDOM,
+		POSIX_FADV_WILLNEED,
+		POSIX_FADV_DONTNEED
+	};
+
+	posix_fadvise(mFileDescriptor, (off_t)Offset, (off_t)Length, Advices[Advice]);
+#endif
+}
+
+FPosixHandle::~FPosixHandle()
+{
+	if (mFileDescriptor >= 0)
+		close(mFileDescriptor);
+	mFileDescriptor = -1;
+}
+
+FPosixMappedFile::FPosixMappedFile(const uint8_t* Data, const uint64_t Size)
+	: IMappedFile(Data, Size)
+{
+}
+
+FPosixMappedFile::~FPosixMappedFile()
+{
+	munmap(const_cast<uint8_t*>(mData), (size_t)mSize);
+}
+
+FPosixFileSystem::FPosixFileSystem()
+	: IFileSystem()
+{
+	SetProgramDirectory();
+}
+
+std::unique_ptr<IFileHandle> FPosixFileSystem::OpenFile(const wchar_t* Filename, const int Flags)
+{
+	const std::string Path = ToNarrowPath(Filename);
+
+	int FileDescriptor;
+	do
+	{
+		FileDescriptor = open(Path.c_str(), Flags | O_CLOEXEC, 0644);
+	} while (FileDescriptor < 0 && errno == EINTR);
+
+	if (FileDescriptor >= 0)
+	{
+		return std::unique_ptr<IFileHandle>{ new FPosixHandle{ FileDescriptor } };
+	}
+
+	PrintError(Filename);
+	return nullptr;
+}
+
+std::unique_ptr<IFileHandle> FPosixFileSystem::OpenWritable(const wchar_t* Filename, const bool /*AllowShareRead*/, const bool CreateNew)
+{
+	// Files are always shared on POSIX platforms
+	return OpenFile(Filename, O_WRONLY | (CreateNew ? O_CREAT | O_TRUNC : 0));
+}
+
+std::unique_ptr<IFileHandle> FPosixFileSystem::OpenReadable(const wchar_t* Filename)
+{
+	return OpenFile(Filename, O_RDONLY);
+}
+
+std::unique_ptr<IMappedFile> FPosixFileSystem::MapReadable(const wchar_t* Filename)
+{
+	std::unique_ptr<IFileHandle> File = OpenFile(Filename, O_RDONLY);
+	if (!File)
+		return nullptr;
+
+	// Empty files can't be mapped
+	struct stat FileInfo;
+	const int FileDescriptor = static_cast<FPosixHandle*>(File.get())->GetFileDescriptor();
+	if (fstat(FileDescriptor, &FileInfo) != 0 || FileInfo.st_size == 0)
+		return nullptr;
+
+	// The mapping keeps the file open after the descriptor is closed
+	void* Data = mmap(nullptr, (size_t)FileInfo.st_size, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+	if (Data == MAP_FAILED)
+	{
+		PrintError(Filename);
+		return nullptr;
+	}
+
+	madvise(Data, (size_t)FileInfo.st_size, MADV_SEQUENTIAL);
+	return std::unique_ptr<IMappedFile>{ new FPosixMappedFile{ static_cast<const uint8_t*>(Data), (uint64_t)FileInfo.st_size } };
+}
+
+std::unique_ptr<IFileHandle> FPosixFileSystem::OpenReadWritable(const wchar_t* Filename, const bool /*AllowShareRead*/, const bool CreateNew)
+{
+	// Files are always shared on POSIX platforms
+	return OpenFile(Filename, O_RDWR | (CreateNew ? O_CREAT | O_TRUNC : 0));
+}
+
+bool FPosixFileSystem::DeleteFilename(const wchar_t* Filename)
+{
+	if (unlink(ToNarrowPath(Filename).c_str()) == 0)
+		return true;
+
+	PrintError(Filename);
+	return false;
+}
+
+bool FPosixFileSystem::CurrentDirectory(wchar_t* DataOut, const uint32_t BufferLength)
+{
+	std::vector<char> Directory(PATH_MAX);
+	if (getcwd(Directory.data(), Directory.size()) && ToWidePath(Directory.data(), DataOut, BufferLength))
+		return true;
+
+	PrintError();
+	return false;
+}
+
+bool FPosixFileSystem::DeleteDirectory(const wchar_t* DirectoryName)
+{
+	// Remove children before their directories, don't follow links
+	if (nftw(ToNarrowPath(DirectoryName).c_str(), &RemoveEntry, 16, FTW_DEPTH | FTW_PHYS) == 0)
+		return true;
+
+	std::wcerr << "Delete directory operation failded on " << DirectoryName << " with code: " << errno << std::endl;
+	return false;
+}
+
+bool FPosixFileSystem::RenameDirectory(const wchar_t* CurrentName, const wchar_t* NewName)
+{
+	if (rename(ToNarrowPath(CurrentName).c_str(), ToNarrowPath(NewName).c_str()) == 0)
+		return true;
+
+	PrintError(CurrentName);
+	return false;
+}
+
+bool FPosixFileSystem::CreateFileDirectory(const wchar_t* DirectoryName)
+{
+	if (mkdir(ToNarrowPath(DirectoryName).c_str(), 0755) == 0)
+	{
+		return true;
+	}
+	else
+	{
+		if (errno == ENOENT)
+			std::wcerr << L"Directory path not found when creating directory." << std::endl;
+	}
+
+	return false;
+}
+
+bool FPosixFileSystem::GetProgramDirectory(wchar_t* DataOut, const uint32_t BufferLength)
+{
+	std::memcpy(DataOut, ProgramDirectory, std::min(BufferLength, ProgramDirectorySize) * sizeof(wchar_t));
+	return BufferLength < ProgramDirectorySize;
+}
+
+bool FPosixFileSystem::SetDirectory(const wchar_t* DirectoryName)
+{
+	if (chdir(ToNarrowPath(DirectoryName).c_str()) == 0)
+	{
+		return true;
+	}
+
+	PrintError(DirectoryName);
+	return false;
+}
+
+bool FPosixFileSystem::FileExists(const wchar_t* Filename)
+{
+	struct stat FileInfo;
+	return stat(ToNarrowPath(Filename).c_str(), &FileInfo) == 0;
+}
+
+bool FPosixFileSystem::GetWriteTime(const wchar_t* Filename, uint64_t& TimeOut)
+{
+	struct stat FileInfo;
+	if (stat(ToNarrowPath(Filename).c_str(), &FileInfo) != 0)
+		return false;
+
+#if defined(__APPLE__)
+	TimeOut = (uint64_t)FileInfo.st_mtimespec.tv_sec * 1000000000 + (uint64_t)FileInfo.st_mtimespec.tv_nsec;
+#else
+	TimeOut = (uint64_t)FileInfo.st_mtim.tv_sec * 1000000000 + (uint64_t)FileInfo.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+bool FPosixFileSystem::SetToProgramDirectory()
+{
+	return SetDirectory(ProgramDirectory);
+}
+
+void FPosixFileSystem::SetProgramDirectory()
+{
+	std::vector<char> Executable(PATH_MAX);
+	ssize_t Length = -1;
+
+#if defined(__linux__)
+	Length = readlink("/proc/self/exe", Executable.data(), Executable.size() - 1);
+#endif
+
+	if (Length <= 0)
+	{
+		// Fall back to the working directory the program was started from
+		if (!getcwd(Executable.data(), Executable.size()))
+		{
+			PrintError();
+			return;
+		}
+	}
+	else
+	{
+		// Remove the file name
+		Executable[Length] = '\0';
+		char* LastSeparator = strrchr(Executable.data(), '/');
+		if (LastSeparator)
+			*LastSeparator = '\0';
+	}
+
+	if (ToWidePath(Executable.data(), ProgramDirectory, PROGRAM_DIRECTORY_CAP))
+		ProgramDirectorySize = (uint32_t)wcslen(ProgramDirectory) + 1;
+}
+
+bool FPosixFileSystem::CopyFileDirectory(const wchar_t* From, const wchar_t* To)
+{
+	if (CopyDirectory(ToNarrowPath(From), ToNarrowPath(To)))
+		return true;
+
+	PrintError(From);
+	return false;
+}
+
+bool FPosixFileSystem::CopyDirectory(const std::string& From, const std::string& To)
+{
+	DIR* Directory = opendir(From.c_str());
+	if (!Directory)
+		return false;
+
+	struct stat DirectoryInfo;
+	if (stat(From.c_str(), &DirectoryInfo) != 0 || (mkdir(To.c_str(), DirectoryInfo.st_mode & 0777) != 0 && errno != EEXIST))
+	{
+		closedir(Directory);
+		return false;
+	}
+
+	bool Succeeded = true;
+	while (dirent* Entry = readdir(Directory))
+	{
+		if (strcmp(Entry->d_name, ".") == 0 || strcmp(Entry->d_name, "..") == 0)
+			continue;
+
+		const std::string FromPath = From + '/' + Entry->d_name;
+		const std::string ToPath = To + '/' + Entry->d_name;
+
+		struct stat EntryInfo;
+		if (lstat(FromPath.c_str(), &EntryInfo) != 0)
+		{
+			Succeeded = false;
+			break;
+		}
+
+		if (S_ISDIR(EntryInfo.st_mode))
+			Succeeded = CopyDirectory(FromPath, ToPath);
+		else if (S_ISREG(EntryInfo.st_mode))
+			Succeeded = CopySingleFile(FromPath, ToPath);
+
+		if (!Succeeded)
+			break;
+	}
+
+	closedir(Directory);
+	return Succeeded;
+}
+
+bool FPosixFileSystem::CopySingleFile(const std::string& From, const std::string& To)
+{
+	const int Source = open(From.c_str(), O_RDONLY | O_CLOEXEC);
+	if (Source < 0)
+		return false;
+
+	struct stat SourceInfo;
+	const int Destination = (fstat(Source, &SourceInfo) == 0) ? open(To.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, SourceInfo.st_mode & 0777) : -1;
+	if (Destination < 0)
+	{
+		close(Source);
+		return false;
+	}
+
+	FPosixHandle SourceHandle{ Source };
+	FPosixHandle DestinationHandle{ Destination };
+	SourceHandle.Advise(EFileAdvice::Sequential);
+	DestinationHandle.Reserve((uint64_t)SourceInfo.st_size);
+
+	// Region files are a few MB at most, copy in large blocks
+	static const uint32_t COPY_BLOCK_SIZE = 256 * 1024;
+	std::vector<uint8_t> Buffer(COPY_BLOCK_SIZE);
+
+	uint64_t BytesLeft = (uint64_t)SourceInfo.st_size;
+	while (BytesLeft > 0)
+	{
+		const uint32_t BlockSize = (uint32_t)std::min<uint64_t>(BytesLeft, COPY_BLOCK_SIZE);
+		if (!SourceHandle.Read(Buffer.data(), BlockSize) || !DestinationHandle.Write(Buffer.data(), BlockSize))
+			return false;
+
+		BytesLeft -= BlockSize;
+	}
+
+	// Copied data won't be read again soon
+	SourceHandle.Advise(EFileAdvice::DontNeed);
+	return true;
+}
+
+#endif
@@ -3,7 +3,7 @@
 #include "Rendering\Screen.h"
 #include "Math\FMath.h"
 
-FCamera* FCamera::Main = nullptr;
+THREAD_LOCAL FCamera* FCamera::Main = nullptr;
 
 FCamera::FCamera()
 	: mProjection()
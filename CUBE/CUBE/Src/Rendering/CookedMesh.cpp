@@ -0,0 +1,456 @@
+#include "Rendering\CookedMesh.h"
+#include "FileIO\GenericFile.h"
+#include "Common.h"
+#include "tinyobjloader\tiny_obj_loader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+namespace
+{
+	const uint32_t INVALID_INDEX = ~0u;
+
+	// Vertex score parameters from Forsyth's paper
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	float VertexScore(const int32_t CachePosition, const uint32_t RemainingTriangles)
+	{
+		// Vertices without triangles left must never be picked
+		if (RemainingTriangles == 0)
+			return -1.0f;
+
+		float Score = 0.0f;
+		if (CachePosition >= 0)
+		{
+			// The vertices of the last triangle get a fixed score so the next triangle doesn't share its edge needlessly
+			if (CachePosition < 3)
+				Score = LAST_TRIANGLE_SCORE;
+			else
+				Score = std::pow(1.0f - (CachePosition - 3) / float(SCookedMesh::VERTEX_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+		}
+
+		// Vertices with few triangles left are finished first
+		return Score + VALENCE_BOOST_SCALE * std::pow((float)RemainingTriangles, -VALENCE_BOOST_POWER);
+	}
+
+	float Clamp(const float Value, const float Min, const float Max)
+	{
+		return std::min(std::max(Value, Min), Max);
+	}
+
+	float SignNotZero(const float Value)
+	{
+		return (Value >= 0.0f) ? 1.0f : -1.0f;
+	}
+
+	void EncodeNormal(const Vector3f& Normal, int8_t* Out)
+	{
+		// Project onto the octahedron and fold the lower half over the upper half
+		const float L1Norm = std::abs(Normal.x) + std::abs(Normal.y) + std::abs(Normal.z);
+		float X = (L1Norm > 0.0f) ? Normal.x / L1Norm : 0.0f;
+		float Y = (L1Norm > 0.0f) ? Normal.y / L1Norm : 0.0f;
+		if (Normal.z < 0.0f)
+		{
+			const float FoldedX = (1.0f - std::abs(Y)) * SignNotZero(X);
+			Y = (1.0f - std::abs(X)) * SignNotZero(Y);
+			X = FoldedX;
+		}
+
+		Out[0] = (int8_t)std::floor(Clamp(X, -1.0f, 1.0f) * 127.0f + 0.5f);
+		Out[1] = (int8_t)std::floor(Clamp(Y, -1.0f, 1.0f) * 127.0f + 0.5f);
+	}
+
+	Vector3f DecodeNormal(const int8_t* Encoded)
+	{
+		const float X = std::max(Encoded[0] / 127.0f, -1.0f);
+		const float Y = std::max(Encoded[1] / 127.0f, -1.0f);
+		const float Z = 1.0f - std::abs(X) - std::abs(Y);
+
+		Vector3f Normal{ X, Y, Z };
+		if (Z < 0.0f)
+		{
+			Normal.x = (1.0f - std::abs(Y)) * SignNotZero(X);
+			Normal.y = (1.0f - std::abs(X)) * SignNotZero(Y);
+		}
+
+		return Normal.Normalize();
+	}
+
+	uint16_t QuantizePosition(const float Value, const float Min, const float Extent)
+	{
+		if (Extent <= 0.0f)
+			return 0;
+
+		return (uint16_t)std::floor(Clamp((Value - Min) / Extent, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	}
+
+	uint8_t QuantizeColor(const float Value)
+	{
+		return (uint8_t)std::floor(Clamp(Value, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+}
+
+bool SCookedMesh::Cook(const char* ObjFilepath, const wchar_t* CookedFilepath)
+{
+	std::vector<tinyobj::shape_t> Shapes;
+	std::vector<tinyobj::material_t> Materials;
+	std::string Error = tinyobj::LoadObj(Shapes, Materials, ObjFilepath);
+
+	if (!Error.empty())
+	{
+		std::cerr << Error << std::endl;
+		return false;
+	}
+
+	std::vector<MeshVertex> Vertices;
+	std::vector<uint32_t> Indices;
+
+	for (uint32_t s = 0; s < Shapes.size(); s++)
+	{
+		tinyobj::mesh_t& Mesh = Shapes[s].mesh;
+
+		const uint32_t FirstVertex = Vertices.size();
+		const uint32_t FirstIndex = Indices.size();
+		const bool HasNormals = Mesh.normals.size() == Mesh.positions.size();
+
+		for (uint32_t i = 0; i < Mesh.positions.size(); i += 3)
+		{
+			const Vector4f P{ Mesh.positions[i + 0], Mesh.positions[i + 1], Mesh.positions[i + 2], 1 };
+			const Vector3f N = HasNormals ? Vector3f{ Mesh.normals[i + 0], Mesh.normals[i + 1], Mesh.normals[i + 2] } : Vector3f{};
+
+			Vertices.push_back(MeshVertex{ P, N, Vector3f{ 1.0f, 1.0f, 1.0f } });
+		}
+
+		for (uint32_t i = 0; i < Mesh.indices.size(); i++)
+		{
+			if (Mesh.indices[i] >= Vertices.size() - FirstVertex)
+			{
+				std::cerr << ObjFilepath << ": index out of range" << std::endl;
+				return false;
+			}
+
+			Indices.push_back(Mesh.indices[i] + FirstVertex);
+		}
+
+		// Shapes without normals get area weighted face normals
+		if (!HasNormals)
+		{
+			for (uint32_t i = FirstIndex; i + 2 < Indices.size(); i += 3)
+			{
+				MeshVertex& V1 = Vertices[Indices[i + 0]];
+				MeshVertex& V2 = Vertices[Indices[i + 1]];
+				MeshVertex& V3 = Vertices[Indices[i + 2]];
+				const Vector3f FaceNormal = Vector3f::Cross(Vector3f{ V2.Position - V1.Position }, Vector3f{ V3.Position - V1.Position });
+
+				V1.Normal += FaceNormal;
+				V2.Normal += FaceNormal;
+				V3.Normal += FaceNormal;
+			}
+
+			for (uint32_t i = FirstVertex; i < Vertices.size(); i++)
+			{
+				if (Vertices[i].Normal.LengthSquared() > 0.0f)
+					Vertices[i].Normal.Normalize();
+			}
+		}
+
+		// Material IDs are per face, a vertex shared by faces of different materials keeps the last one
+		for (uint32_t i = 0; i < Mesh.material_ids.size() && FirstIndex + i * 3 + 2 < Indices.size(); i++)
+		{
+			const int32_t MatID = Mesh.material_ids[i];
+			if (MatID < 0 || (uint32_t)MatID >= Materials.size())
+				continue;
+
+			const Vector3f Color{ Materials[MatID].diffuse[0], Materials[MatID].diffuse[1], Materials[MatID].diffuse[2] };
+			FOR(j, 3)
+				Vertices[Indices[FirstIndex + i * 3 + j]].Color = Color;
+		}
+	}
+
+	if (Vertices.empty() || Indices.empty())
+	{
+		std::cerr << ObjFilepath << ": model has no triangles" << std::endl;
+		return false;
+	}
+
+	OptimizeVertexCache(Indices, Vertices.size());
+
+	// Order vertices by first use so vertex fetches walk the buffer forwards, unused vertices are dropped
+	std::vector<uint32_t> Remap(Vertices.size(), INVALID_INDEX);
+	std::vector<MeshVertex> OrderedVertices;
+	OrderedVertices.reserve(Vertices.size());
+	for (uint32_t& Index : Indices)
+	{
+		if (Remap[Index] == INVALID_INDEX)
+		{
+			Remap[Index] = OrderedVertices.size();
+			OrderedVertices.push_back(Vertices[Index]);
+		}
+
+		Index = Remap[Index];
+	}
+
+	// Bounds
+	FMeshBounds Bounds;
+	Bounds.Min = Vector3f{ OrderedVertices[0].Position };
+	Bounds.Max = Bounds.Min;
+	for (const MeshVertex& Vertex : OrderedVertices)
+	{
+		Bounds.Min = Vector3f{ std::min(Bounds.Min.x, Vertex.Position.x), std::min(Bounds.Min.y, Vertex.Position.y), std::min(Bounds.Min.z, Vertex.Position.z) };
+		Bounds.Max = Vector3f{ std::max(Bounds.Max.x, Vertex.Position.x), std::max(Bounds.Max.y, Vertex.Position.y), std::max(Bounds.Max.z, Vertex.Position.z) };
+	}
+
+	const Vector3f Center = (Bounds.Min + Bounds.Max) * 0.5f;
+	const Vector3f Extent = Bounds.Max - Bounds.Min;
+	float RadiusSquared = 0.0f;
+	for (const MeshVertex& Vertex : OrderedVertices)
+		RadiusSquared = std::max(RadiusSquared, (Vector3f{ Vertex.Position } - Center).LengthSquared());
+	Bounds.Radius = std::sqrt(RadiusSquared);
+
+	// Layout the file
+	FCookedMeshHeader Header;
+	std::memset(&Header, 0, sizeof(Header));
+	Header.Magic = FCookedMeshHeader::MAGIC;
+	Header.Version = FCookedMeshHeader::VERSION;
+	Header.VertexCount = OrderedVertices.size();
+	Header.IndexCount = Indices.size();
+	Header.IndexSize = (Header.VertexCount <= 0x10000) ? sizeof(uint16_t) : sizeof(uint32_t);
+	Header.VertexOffset = sizeof(FCookedMeshHeader);
+	Header.IndexOffset = (Header.VertexOffset + Header.VertexCount * sizeof(FCookedVertex) + 3) & ~3u;
+	FOR(i, 3)
+	{
+		Header.BoundsMin[i] = Bounds.Min[i];
+		Header.BoundsMax[i] = Bounds.Max[i];
+	}
+	Header.BoundsRadius = Bounds.Radius;
+
+	std::vector<uint8_t> File(Header.IndexOffset + Header.IndexCount * Header.IndexSize, 0);
+	std::memcpy(File.data(), &Header, sizeof(Header));
+
+	FCookedVertex* CookedVertices = reinterpret_cast<FCookedVertex*>(File.data() + Header.VertexOffset);
+	for (uint32_t i = 0; i < OrderedVertices.size(); i++)
+	{
+		const MeshVertex& Vertex = OrderedVertices[i];
+		FCookedVertex& Cooked = CookedVertices[i];
+
+		FOR(j, 3)
+			Cooked.Position[j] = QuantizePosition(Vertex.Position[j], Bounds.Min[j], Extent[j]);
+		EncodeNormal(Vertex.Normal, Cooked.Normal);
+		FOR(j, 3)
+			Cooked.Color[j] = QuantizeColor(Vertex.Color[j]);
+		Cooked.Color[3] = 255;
+	}
+
+	uint8_t* CookedIndices = File.data() + Header.IndexOffset;
+	for (uint32_t i = 0; i < Indices.size(); i++)
+	{
+		if (Header.IndexSize == sizeof(uint16_t))
+			reinterpret_cast<uint16_t*>(CookedIndices)[i] = (uint16_t)Indices[i];
+		else
+			reinterpret_cast<uint32_t*>(CookedIndices)[i] = Indices[i];
+	}
+
+	std::unique_ptr<IFileHandle> Output = IFileSystem::GetInstance().OpenWritable(CookedFilepath, false, true);
+	return Output && Output->Write(File.data(), File.size());
+}
+
+bool SCookedMesh::CookIfStale(const char* ObjFilepath, const wchar_t* CookedFilepath)
+{
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	const std::string ObjPath{ ObjFilepath };
+
+	uint64_t CookedTime;
+	if (!FileSystem.GetWriteTime(CookedFilepath, CookedTime))
+		return Cook(ObjFilepath, CookedFilepath);
+
+	// Without the model the existing cooked mesh is kept
+	uint64_t ObjTime;
+	if (FileSystem.GetWriteTime(std::wstring{ ObjPath.begin(), ObjPath.end() }.c_str(), ObjTime) && ObjTime > CookedTime)
+		return Cook(ObjFilepath, CookedFilepath);
+
+	return true;
+}
+
+bool SCookedMesh::Decode(const uint8_t* Data, const uint64_t Size, std::vector<MeshVertex>& VerticesOut, std::vector<uint32_t>& IndicesOut, FMeshBounds& BoundsOut)
+{
+	if (Size < sizeof(FCookedMeshHeader))
+		return false;
+
+	FCookedMeshHeader Header;
+	std::memcpy(&Header, Data, sizeof(Header));
+
+	if (Header.Magic != FCookedMeshHeader::MAGIC || Header.Version != FCookedMeshHeader::VERSION)
+		return false;
+
+	if (Header.IndexSize != sizeof(uint16_t) && Header.IndexSize != sizeof(uint32_t))
+		return false;
+
+	// Sections must be aligned and lie within the file
+	if (Header.VertexOffset % 4 != 0 || Header.IndexOffset % 4 != 0 ||
+		(uint64_t)Header.VertexOffset + (uint64_t)Header.VertexCount * sizeof(FCookedVertex) > Size ||
+		(uint64_t)Header.IndexOffset + (uint64_t)Header.IndexCount * Header.IndexSize > Size)
+		return false;
+
+	FOR(i, 3)
+	{
+		BoundsOut.Min[i] = Header.BoundsMin[i];
+		BoundsOut.Max[i] = Header.BoundsMax[i];
+	}
+	BoundsOut.Radius = Header.BoundsRadius;
+
+	const Vector3f Scale = (BoundsOut.Max - BoundsOut.Min) / 65535.0f;
+	const FCookedVertex* CookedVertices = reinterpret_cast<const FCookedVertex*>(Data + Header.VertexOffset);
+
+	VerticesOut.resize(Header.VertexCount);
+	for (uint32_t i = 0; i < Header.VertexCount; i++)
+	{
+		const FCookedVertex& Cooked = CookedVertices[i];
+		MeshVertex& Vertex = VerticesOut[i];
+
+		Vertex.Position = Vector4f{ BoundsOut.Min.x + Cooked.Position[0] * Scale.x, BoundsOut.Min.y + Cooked.Position[1] * Scale.y, BoundsOut.Min.z + Cooked.Position[2] * Scale.z, 1.0f };
+		Vertex.Normal = DecodeNormal(Cooked.Normal);
+		Vertex.Color = Vector3f{ Cooked.Color[0] / 255.0f, Cooked.Color[1] / 255.0f, Cooked.Color[2] / 255.0f };
+	}
+
+	IndicesOut.resize(Header.IndexCount);
+	const uint8_t* CookedIndices = Data + Header.IndexOffset;
+	for (uint32_t i = 0; i < Header.IndexCount; i++)
+	{
+		const uint32_t Index = (Header.IndexSize == sizeof(uint16_t)) ? reinterpret_cast<const uint16_t*>(CookedIndices)[i] : reinterpret_cast<const uint32_t*>(CookedIndices)[i];
+		if (Index >= Header.VertexCount)
+			return false;
+
+		IndicesOut[i] = Index;
+	}
+
+	return true;
+}
+
+void SCookedMesh::OptimizeVertexCache(std::vector<uint32_t>& Indices, const uint32_t VertexCount)
+{
+	const uint32_t TriangleCount = Indices.size() / 3;
+
+	// Triangles of each vertex, the triangles not yet emitted are kept at the front of each list
+	std::vector<uint32_t> TriangleStart(VertexCount + 1, 0);
+	for (uint32_t i = 0; i < TriangleCount * 3; i++)
+		TriangleStart[Indices[i] + 1]++;
+	for (uint32_t i = 0; i < VertexCount; i++)
+		TriangleStart[i + 1] += TriangleStart[i];
+
+	std::vector<uint32_t> VertexTriangles(TriangleCount * 3);
+	std::vector<uint32_t> RemainingTriangles(VertexCount, 0);
+	for (uint32_t i = 0; i < TriangleCount * 3; i++)
+	{
+		const uint32_t Vertex = Indices[i];
+		VertexTriangles[TriangleStart[Vertex] + RemainingTriangles[Vertex]++] = i / 3;
+	}
+
+	std::vector<int32_t> CachePosition(VertexCount, -1);
+	std::vector<float> VertexScores(VertexCount);
+	for (uint32_t i = 0; i < VertexCount; i++)
+		VertexScores[i] = VertexScore(-1, RemainingTriangles[i]);
+
+	std::vector<float> TriangleScores(TriangleCount);
+	for (uint32_t i = 0; i < TriangleCount; i++)
+		TriangleScores[i] = VertexScores[Indices[i * 3]] + VertexScores[Indices[i * 3 + 1]] + VertexScores[Indices[i * 3 + 2]];
+
+	std::vector<bool> Emitted(TriangleCount, false);
+	std::vector<uint32_t> Cache;
+	std::vector<uint32_t> NewCache;
+	Cache.reserve(VERTEX_CACHE_SIZE + 3);
+	NewCache.reserve(VERTEX_CACHE_SIZE + 3);
+
+	std::vector<uint32_t> Optimized;
+	Optimized.reserve(TriangleCount * 3);
+
+	uint32_t BestTriangle = INVALID_INDEX;
+	uint32_t ScanStart = 0;
+
+	while (Optimized.size() < TriangleCount * 3)
+	{
+		// Nothing in the cache has triangles left, pick the best triangle of the whole mesh
+		if (BestTriangle == INVALID_INDEX)
+		{
+			float BestScore = -1.0f;
+			while (Emitted[ScanStart])
+				ScanStart++;
+
+			for (uint32_t i = ScanStart; i < TriangleCount; i++)
+			{
+				if (!Emitted[i] && TriangleScores[i] > BestScore)
+				{
+					BestScore = TriangleScores[i];
+					BestTriangle = i;
+				}
+			}
+		}
+
+		Emitted[BestTriangle] = true;
+		NewCache.clear();
+
+		FOR(i, 3)
+		{
+			const uint32_t Vertex = Indices[BestTriangle * 3 + i];
+			Optimized.push_back(Vertex);
+			NewCache.push_back(Vertex);
+
+			// Move the emitted triangle out of the remaining triangles of the vertex
+			uint32_t* Triangles = &VertexTriangles[TriangleStart[Vertex]];
+			const uint32_t Last = --RemainingTriangles[Vertex];
+			for (uint32_t j = 0; j <= Last; j++)
+			{
+				if (Triangles[j] == BestTriangle)
+				{
+					std::swap(Triangles[j], Triangles[Last]);
+					break;
+				}
+			}
+		}
+
+		for (const uint32_t Vertex : Cache)
+		{
+			if (Vertex != NewCache[0] && Vertex != NewCache[1] && Vertex != NewCache[2])
+				NewCache.push_back(Vertex);
+		}
+
+		// Vertices pushed out of the cache lose their cache score
+		for (uint32_t i = 0; i < NewCache.size(); i++)
+		{
+			const uint32_t Vertex = NewCache[i];
+			CachePosition[Vertex] = (i < VERTEX_CACHE_SIZE) ? (int32_t)i : -1;
+			VertexScores[Vertex] = VertexScore(CachePosition[Vertex], RemainingTriangles[Vertex]);
+		}
+
+		// Rescore the triangles of every vertex that changed and pick the best one
+		BestTriangle = INVALID_INDEX;
+		float BestScore = -1.0f;
+		for (const uint32_t Vertex : NewCache)
+		{
+			const uint32_t* Triangles = &VertexTriangles[TriangleStart[Vertex]];
+			for (uint32_t j = 0; j < RemainingTriangles[Vertex]; j++)
+			{
+				const uint32_t Triangle = Triangles[j];
+				const float Score = VertexScores[Indices[Triangle * 3]] + VertexScores[Indices[Triangle * 3 + 1]] + VertexScores[Indices[Triangle * 3 + 2]];
+				TriangleScores[Triangle] = Score;
+
+				if (Score > BestScore)
+				{
+					BestScore = Score;
+					BestTriangle = Triangle;
+				}
+			}
+		}
+
+		if (NewCache.size() > VERTEX_CACHE_SIZE)
+			NewCache.resize(VERTEX_CACHE_SIZE);
+		Cache.swap(NewCache);
+	}
+
+	Indices.swap(Optimized);
+}
@@ -5,7 +5,7 @@ FEdgeDetection::FEdgeDetection()
 	: mShader()
 {
 	FShader Frag{ L"Shaders/EdgeDetection.frag.glsl", GL_FRAGMENT_SHADER };
-	mShader.AttachShader(SShaderHolder::Get("FullScreenQuad.vert"));
+	mShader.AttachShader(SShaderHolder::Get(STRING_ID("FullScreenQuad.vert")));
 	mShader.AttachShader(Frag);
 	mShader.LinkProgram();
 }
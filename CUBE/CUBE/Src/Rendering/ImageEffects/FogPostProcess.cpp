@@ -21,7 +21,7 @@ FFogPostProcess::FFogPostProcess()
 	, mFogParamBlock(GLUniformBindings::FogParamBlock, FogBlockOffsets::Size)
 {
 	FShader FragShader{ L"Shaders/FogPass.frag.glsl", GL_FRAGMENT_SHADER };
-	mShaderProgram.AttachShader(SShaderHolder::Get("FullScreenQuad.vert"));
+	mShaderProgram.AttachShader(SShaderHolder::Get(STRING_ID("FullScreenQuad.vert")));
 	mShaderProgram.AttachShader(FragShader);
 	mShaderProgram.LinkProgram();
 }
@@ -13,6 +13,8 @@ FSSAOPostProcess::FSSAOPostProcess()
 	, mSSAO()
 	, mNoiseTex(0)
 	, mSampleTex(0)
+	, mBlur()
+	, mUseSSAO(true)
 {
 	mSSAOBuffer.FBO = 0;
 	mSSAOBuffer.mSSAOTex = 0;
@@ -20,12 +22,12 @@ FSSAOPostProcess::FSSAOPostProcess()
 	FRenderSystem::OnResolutionChange.AddListener<FSSAOPostProcess, &FSSAOPostProcess::ResizeRenderTarget>(this);
 
 	FShader SSAOFrag{ L"Shaders/SSAOPass.frag.glsl", GL_FRAGMENT_SHADER };
-	mSSAO.AttachShader(SShaderHolder::Get("FullScreenQuad.vert"));
+	mSSAO.AttachShader(SShaderHolder::Get(STRING_ID("FullScreenQuad.vert")));
 	mSSAO.AttachShader(SSAOFrag);
 	mSSAO.LinkProgram();
 	
 	FShader BlurFrag{ L"Shaders/BlurPass.frag.glsl", GL_FRAGMENT_SHADER };
-	mBlur.AttachShader(SShaderHolder::Get("FullScreenQuad.vert"));
+	mBlur.AttachShader(SShaderHolder::Get(STRING_ID("FullScreenQuad.vert")));
 	mBlur.AttachShader(BlurFrag);
 	mBlur.LinkProgram();
 
@@ -104,14 +106,18 @@ void FSSAOPostProcess::GenerateSampleTexture(const uint32_t KernalSize)
 
 void FSSAOPostProcess::OnPostLightingPass()
 {
-	GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, mSSAOBuffer.FBO));
-
-	glDisable(GL_BLEND);
 	glDisable(GL_DEPTH_TEST);
-	mSSAO.Use();
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-	GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	if (mUseSSAO)
+	{
+		GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, mSSAOBuffer.FBO));
+
+		glDisable(GL_BLEND);
+		mSSAO.Use();
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+		GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	}
 
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_ONE, GL_ONE);
@@ -148,6 +154,12 @@ void FSSAOPostProcess::SetGlobalAmbient(const Vector3f& Ambient)
 	mBlur.SetVector("uAmbient", 1, &Ambient);
 }
 
+void FSSAOPostProcess::SetScreenSpaceOcclusion(const bool Enabled)
+{
+	mUseSSAO = Enabled;
+	mBlur.SetUniform("uUseSSAO", (int32_t)Enabled);
+}
+
 void FSSAOPostProcess::ResizeRenderTarget(const Vector2ui Size)
 {
 	if (mSSAOBuffer.FBO != 0)
@@ -25,7 +25,7 @@ FDirectionalLightSystem::FDirectionalLightSystem(Atlas::FWorld& World, FRenderSy
 
 	FShader FragShader{ L"Shaders/DeferredDirectionalLighting.frag", GL_FRAGMENT_SHADER };
 
-	mLightShader.AttachShader(SShaderHolder::Get("FullScreenQuad.vert"));
+	mLightShader.AttachShader(SShaderHolder::Get(STRING_ID("FullScreenQuad.vert")));
 	mLightShader.AttachShader(FragShader);
 	mLightShader.LinkProgram();
 }
@@ -70,7 +70,7 @@ FPointLightSystem::FPointLightSystem(Atlas::FWorld& World, FRenderSystem& Render
 
 	FShader FragShader{ L"Shaders/DeferredPointLighting.frag", GL_FRAGMENT_SHADER };
 
-	mLightShader.AttachShader(SShaderHolder::Get("FullScreenQuad.vert"));
+	mLightShader.AttachShader(SShaderHolder::Get(STRING_ID("FullScreenQuad.vert")));
 	mLightShader.AttachShader(FragShader);
 	mLightShader.LinkProgram();
 }
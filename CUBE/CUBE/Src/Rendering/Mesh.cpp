@@ -5,14 +5,17 @@
 #include "SFML\Window\Context.hpp"
 #include "Components\MeshRenderer.h"
 #include "tinyobjloader\tiny_obj_loader.h"
+#include "Memory\MemoryTracker.h"
 #include <fstream>
 
 BMesh::BMesh(const GLuint DrawMode, const uint32_t DefaultBufferSize )
 	: mVertexData(DefaultBufferSize)
 	, mIndices()
 	, mVertexArray()
+	, mBufferBytes(0)
 	, mUsageMode(DrawMode)
 	, mIndexCount(0)
+	, mAllocatedIndexCount(0)
 	, mIsActive(false)
 {
 	glGenVertexArrays(1, &mVertexArray);
@@ -22,8 +25,10 @@ BMesh::BMesh(const GLuint DrawMode, const uint32_t DefaultBufferSize )
 BMesh::BMesh(const BMesh& Other)
 	: mVertexData(Other.mVertexData)
 	, mIndices(Other.mIndices)
+	, mBufferBytes(0)
 	, mUsageMode(Other.mUsageMode)
 	, mIndexCount(Other.mIndexCount)
+	, mAllocatedIndexCount(0)
 	, mIsActive(Other.mIsActive)
 {
 	glGenVertexArrays(1, &mVertexArray);
@@ -34,8 +39,10 @@ BMesh::BMesh(BMesh&& Other) _NOEXCEPT
 	: mVertexData(std::move(Other.mVertexData))
 	, mIndices(std::move(Other.mIndices))
 	, mVertexArray(Other.mVertexArray)
+	, mBufferBytes(Other.mBufferBytes)
 	, mUsageMode(Other.mUsageMode)
 	, mIndexCount(Other.mIndexCount)
+	, mAllocatedIndexCount(Other.mAllocatedIndexCount)
 	, mIsActive(Other.mIsActive)
 {
 	// Copy buffers
@@ -47,6 +54,7 @@ BMesh::BMesh(BMesh&& Other) _NOEXCEPT
 	Other.mBuffers[0] = Other.mBuffers[1] = 0;
 
 	// Set invalid data
+	Other.mBufferBytes = 0;
 	Other.mIndexCount = 0;
 	Other.mUsageMode = 0;
 	Other.mIsActive = false;
@@ -56,6 +64,7 @@ BMesh::~BMesh()
 {
 	glDeleteVertexArrays(1, &mVertexArray);
 	glDeleteBuffers(2, mBuffers);
+	SMemoryTracker::OnResize(EMemoryTag::MeshResources, mBufferBytes, 0);
 }
 
 BMesh& BMesh::operator=(const BMesh& Other)
@@ -75,13 +84,16 @@ BMesh& BMesh::operator=(BMesh&& Other) _NOEXCEPT
 	// Delete buffers held
 	glDeleteVertexArrays(1, &mVertexArray);
 	glDeleteBuffers(2, mBuffers);
+	SMemoryTracker::OnResize(EMemoryTag::MeshResources, mBufferBytes, 0);
 
 	// Steal data
 	mVertexData = std::move(Other.mVertexData);
 	mIndices = std::move(Other.mIndices);
 	mVertexArray = Other.mVertexArray;
+	mBufferBytes = Other.mBufferBytes;
 	mUsageMode = Other.mUsageMode;
 	mIndexCount = Other.mIndexCount;
+	mAllocatedIndexCount = Other.mAllocatedIndexCount;
 	mIsActive = Other.mIsActive;
 
 	// Copy buffers
@@ -93,6 +105,7 @@ BMesh& BMesh::operator=(BMesh&& Other) _NOEXCEPT
 	Other.mBuffers[0] = Other.mBuffers[1] = 0;
 	
 	// Set invalid data
+	Other.mBufferBytes = 0;
 	Other.mIndexCount = 0;
 	Other.mUsageMode = 0;
 	Other.mIsActive = false;
@@ -122,6 +135,8 @@ void BMesh::DeactivateB()
 	GLUtils::BufferBinder<GL_ELEMENT_ARRAY_BUFFER> IndexBinding(mBuffers[Index]);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, nullptr, mUsageMode);
 
+	SMemoryTracker::OnResize(EMemoryTag::MeshResources, mBufferBytes, 0);
+	mBufferBytes = 0;
 	mIndexCount = 0;
 }
 
@@ -150,6 +165,10 @@ void BMesh::ActivateB()
 
 	// Save index count separately incase local data is cleared.
 	mIndexCount = mIndices.size();
+
+	const size_t BufferBytes = mVertexData.size() + mIndices.size() * sizeof(uint32_t);
+	SMemoryTracker::OnResize(EMemoryTag::MeshResources, mBufferBytes, BufferBytes);
+	mBufferBytes = BufferBytes;
 }
 
 uint32_t BMesh::AddVertexB(const uint8_t* Vertex, const uint32_t VertexSize)
@@ -200,6 +219,56 @@ void BMesh::MapAndActivateB(const void* VertexData, const uint32_t VertexSize, c
 	glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
 
 	mIndexCount = IndexSize;
+
+	const size_t BufferBytes = VertexSize + IndexSize * sizeof(uint32_t);
+	SMemoryTracker::OnResize(EMemoryTag::MeshResources, mBufferBytes, BufferBytes);
+	mBufferBytes = BufferBytes;
+}
+
+void BMesh::AllocateB(const uint32_t VertexSize, const uint32_t IndexCount)
+{
+	mIsActive = false;
+
+	GLUtils::ArrayBinder VAOBinding(mVertexArray);
+
+	// Allocate the vertex buffer
+	glBindBuffer(GL_ARRAY_BUFFER, mBuffers[Vertex]);
+	glBufferData(GL_ARRAY_BUFFER, VertexSize, nullptr, mUsageMode);
+
+	EnableAttributes();
+
+	// Allocate the index buffer
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mBuffers[Index]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * IndexCount, nullptr, mUsageMode);
+
+	mIndexCount = 0;
+	mAllocatedIndexCount = IndexCount;
+
+	const size_t BufferBytes = VertexSize + IndexCount * sizeof(uint32_t);
+	SMemoryTracker::OnResize(EMemoryTag::MeshResources, mBufferBytes, BufferBytes);
+	mBufferBytes = BufferBytes;
+}
+
+void BMesh::UploadVerticesB(const void* VertexData, const uint32_t Offset, const uint32_t Size)
+{
+	GLUtils::BufferBinder<GL_ARRAY_BUFFER> VertexBinding(mBuffers[Vertex]);
+	glBufferSubData(GL_ARRAY_BUFFER, Offset, Size, VertexData);
+}
+
+void BMesh::UploadIndicesB(const uint32_t* IndexData, const uint32_t First, const uint32_t Count)
+{
+	ASSERT(First + Count <= mAllocatedIndexCount);
+
+	// The index buffer binding is part of the VAO
+	GLUtils::ArrayBinder VAOBinding(mVertexArray);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mBuffers[Index]);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, First * sizeof(uint32_t), Count * sizeof(uint32_t), IndexData);
+}
+
+void BMesh::FinishUploadB()
+{
+	mIndexCount = mAllocatedIndexCount;
+	mIsActive = true;
 }
 
 template <>
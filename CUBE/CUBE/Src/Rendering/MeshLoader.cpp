@@ -0,0 +1,188 @@
+#include "Rendering\MeshLoader.h"
+#include "Rendering\CookedMesh.h"
+#include "FileIO\GenericFile.h"
+#include "Debugging\ConsoleOutput.h"
+#include "Clock.h"
+
+#include <algorithm>
+
+const float FMeshLoader::DEFAULT_UPLOAD_BUDGET = 0.002f;
+
+FMeshLoader::FMeshLoader()
+	: mRequests()
+	, mDecoded()
+	, mUploading()
+	, mMutex()
+	, mLoadRequested()
+	, mLoadThread()
+	, mMustShutdown(false)
+	, mPending(0)
+	, mLoaded(0)
+	, mFailed(0)
+	, mUploadedBytes(0)
+	, mLatencyCycles(0)
+	, mMaxLatencyCycles(0)
+	, mFirstRequestTime(0)
+	, mColdStartCycles(0)
+{
+	mLoadThread = std::thread(&FMeshLoader::LoadThreadLoop, this);
+}
+
+FMeshLoader::~FMeshLoader()
+{
+	{
+		std::lock_guard<std::mutex> Lock(mMutex);
+		mMustShutdown = true;
+	}
+
+	mLoadRequested.notify_one();
+	mLoadThread.join();
+}
+
+void FMeshLoader::Load(const char* Name, const wchar_t* Filepath)
+{
+	// The mesh exists right away so renderers can link to it
+	SMeshHolder::Load(Name);
+
+	FRequest Request;
+	Request.Name = Name;
+	Request.Filepath = Filepath;
+	Request.RequestTime = FClock::ReadSystemTimer();
+
+	if (mFirstRequestTime == 0)
+		mFirstRequestTime = Request.RequestTime;
+	mPending++;
+
+	{
+		std::lock_guard<std::mutex> Lock(mMutex);
+		mRequests.push_back(std::move(Request));
+	}
+
+	mLoadRequested.notify_one();
+}
+
+void FMeshLoader::Update(const float TimeBudget)
+{
+	if (mPending == 0)
+		return;
+
+	const uint64_t Deadline = FClock::ReadSystemTimer() + FClock::SecondsToCycles(TimeBudget);
+
+	do
+	{
+		if (!mUploading)
+		{
+			std::lock_guard<std::mutex> Lock(mMutex);
+			if (mDecoded.empty())
+				break;
+
+			mUploading = std::move(mDecoded.front());
+			mDecoded.pop_front();
+		}
+
+		FDecodedMesh& Mesh = *mUploading;
+		if (Mesh.Failed)
+		{
+			FDebug::PrintF("MeshLoader: %s failed to load from %ls", Mesh.Request.Name.c_str(), Mesh.Request.Filepath.c_str());
+			mFailed++;
+		}
+		else if (UploadSlice(Mesh))
+		{
+			const uint64_t Latency = FClock::ReadSystemTimer() - Mesh.Request.RequestTime;
+			mLatencyCycles += Latency;
+			mMaxLatencyCycles = std::max(mMaxLatencyCycles, Latency);
+			mLoaded++;
+
+			FDebug::PrintF("MeshLoader: %s loaded in %.2f ms (%u vertices, %u indices)", Mesh.Request.Name.c_str(),
+				FClock::CyclesToSeconds(Latency) * 1000.0f, (uint32_t)Mesh.Vertices.size(), (uint32_t)Mesh.Indices.size());
+		}
+		else
+		{
+			continue;
+		}
+
+		mUploading.reset();
+		mPending--;
+	} while (FClock::ReadSystemTimer() < Deadline);
+
+	if (mPending == 0 && mColdStartCycles == 0)
+		mColdStartCycles = FClock::ReadSystemTimer() - mFirstRequestTime;
+}
+
+FMeshLoader::FStats FMeshLoader::GetStats() const
+{
+	FStats Stats;
+	Stats.Pending = mPending;
+	Stats.Loaded = mLoaded;
+	Stats.Failed = mFailed;
+	Stats.UploadedBytes = mUploadedBytes;
+	Stats.AverageLatency = (mLoaded > 0) ? FClock::CyclesToSeconds(mLatencyCycles / mLoaded) : 0.0f;
+	Stats.MaxLatency = FClock::CyclesToSeconds(mMaxLatencyCycles);
+	Stats.ColdStartTime = FClock::CyclesToSeconds(mColdStartCycles);
+	return Stats;
+}
+
+bool FMeshLoader::UploadSlice(FDecodedMesh& Mesh)
+{
+	FObjectMesh& ObjectMesh = SMeshHolder::Get(Mesh.Request.Name.c_str());
+
+	// The first slice allocates the buffers
+	if (Mesh.UploadedVertices == 0 && Mesh.UploadedIndices == 0)
+	{
+		ObjectMesh.Mesh.Allocate(Mesh.Vertices.size(), Mesh.Indices.size());
+		ObjectMesh.Bounds = Mesh.Bounds;
+	}
+
+	// Vertices first, then indices
+	if (Mesh.UploadedVertices < Mesh.Vertices.size())
+	{
+		const uint32_t SliceVertices = std::max(UPLOAD_SLICE_BYTES / (uint32_t)sizeof(MeshVertex), 1u);
+		const uint32_t Count = std::min(SliceVertices, (uint32_t)Mesh.Vertices.size() - Mesh.UploadedVertices);
+
+		ObjectMesh.Mesh.UploadVertices(Mesh.Vertices.data() + Mesh.UploadedVertices, Mesh.UploadedVertices, Count);
+		Mesh.UploadedVertices += Count;
+		mUploadedBytes += Count * sizeof(MeshVertex);
+	}
+	else
+	{
+		const uint32_t SliceIndices = UPLOAD_SLICE_BYTES / sizeof(uint32_t);
+		const uint32_t Count = std::min(SliceIndices, (uint32_t)Mesh.Indices.size() - Mesh.UploadedIndices);
+
+		ObjectMesh.Mesh.UploadIndices(Mesh.Indices.data() + Mesh.UploadedIndices, Mesh.UploadedIndices, Count);
+		Mesh.UploadedIndices += Count;
+		mUploadedBytes += Count * sizeof(uint32_t);
+	}
+
+	if (Mesh.UploadedVertices < Mesh.Vertices.size() || Mesh.UploadedIndices < Mesh.Indices.size())
+		return false;
+
+	ObjectMesh.Mesh.FinishUpload();
+	return true;
+}
+
+void FMeshLoader::LoadThreadLoop()
+{
+	std::unique_lock<std::mutex> Lock(mMutex);
+
+	while (true)
+	{
+		mLoadRequested.wait(Lock, [this]() { return mMustShutdown || !mRequests.empty(); });
+		if (mMustShutdown)
+			return;
+
+		std::unique_ptr<FDecodedMesh> Mesh{ new FDecodedMesh };
+		Mesh->Request = std::move(mRequests.front());
+		mRequests.pop_front();
+		Lock.unlock();
+
+		// The pages of the file are read as they are decoded
+		std::unique_ptr<IMappedFile> File = IFileSystem::GetInstance().MapReadable(Mesh->Request.Filepath.c_str());
+		Mesh->Failed = !File || !SCookedMesh::Decode(File->GetData(), File->GetSize(), Mesh->Vertices, Mesh->Indices, Mesh->Bounds);
+		Mesh->UploadedVertices = 0;
+		Mesh->UploadedIndices = 0;
+		File.reset();
+
+		Lock.lock();
+		mDecoded.push_back(std::move(Mesh));
+	}
+}
@@ -62,16 +62,22 @@ FRenderSystem::FRenderSystem(Atlas::FWorld& World, sf::Window& GameWindow, FChun
 	, mChunkManager(ChunkManager)
 	, mDeferredRender()
 	, mChunkRender()
+	, mOverdrawRender()
 	, mGBuffer()
 	, mPostProcesses()
 	, mTransformBlock(GLUniformBindings::TransformBlock, TransformBuffer::Size)
 	, mResolutionBlock(GLUniformBindings::ResolutionBlock, ResolutionBlock::Size)
 	, mProjectionInfoBlock(GLUniformBindings::ProjectionInfoBlock, ProjectionInfoBlock::Size)
 	, mBlockInfoBuffer(0)
+	, mFragmentQueries()
+	, mQueryFrame(0)
+	, mGBufferFragments(0)
+	, mShowOverdraw(false)
 {
 	mGBuffer.FBO = 0;
 	mGBuffer.DepthTex = 0;
 	mGBuffer.ColorTex[0] = 0;
+	glGenQueries(FRAGMENT_QUERY_COUNT, mFragmentQueries);
 
 	SetResolution(Vector2ui{ GameWindow.getSize().x, GameWindow.getSize().y });
 	glEnable(GL_CULL_FACE);
@@ -100,6 +106,11 @@ void FRenderSystem::LoadShaders()
 	mChunkRender.AttachShader(DeferredChunkVert);
 	mChunkRender.AttachShader(DeferredFrag);
 	mChunkRender.LinkProgram();
+
+	FShader OverdrawFrag{ L"Shaders/Overdraw.frag", GL_FRAGMENT_SHADER };
+	mOverdrawRender.AttachShader(DeferredChunkVert);
+	mOverdrawRender.AttachShader(OverdrawFrag);
+	mOverdrawRender.LinkProgram();
 }
 
 void FRenderSystem::LoadSubSystems()
@@ -110,6 +121,7 @@ void FRenderSystem::LoadSubSystems()
 
 FRenderSystem::~FRenderSystem()
 {
+	glDeleteQueries(FRAGMENT_QUERY_COUNT, mFragmentQueries);
 	glDeleteBuffers(1, &mBlockInfoBuffer);
 	glDeleteFramebuffers(1, &mGBuffer.FBO);
 	glDeleteTextures(2, mGBuffer.ColorTex);
@@ -160,18 +172,25 @@ void FRenderSystem::Update()
 	
 	ConstructGBuffer();
 
-	for (auto& Record : mPostProcesses)
+	if (mShowOverdraw)
 	{
-		if (Record.IsActive)
-			Record.Process->OnPreLightingPass();
+		OverdrawPass();
 	}
+	else
+	{
+		for (auto& Record : mPostProcesses)
+		{
+			if (Record.IsActive)
+				Record.Process->OnPreLightingPass();
+		}
 
-	LightingPass();
+		LightingPass();
 
-	for (auto& Record : mPostProcesses)
-	{
-		if (Record.IsActive)
-			Record.Process->OnPostLightingPass();
+		for (auto& Record : mPostProcesses)
+		{
+			if (Record.IsActive)
+				Record.Process->OnPostLightingPass();
+		}
 	}
 
 	// Render overlayed facilities
@@ -208,6 +227,10 @@ void FRenderSystem::RenderGeometry()
 		auto& Transform = GameObject->Transform;
 		auto& Mesh = GameObject->GetComponent<Atlas::EComponent::MeshRenderer>();
 
+		// Meshes still being loaded in the background are skipped
+		if (!Mesh.Mesh->Mesh.IsActive())
+			continue;
+
 		SetModelTransform(Transform);
 		Mesh.Mesh->Mesh.Render();
 	}
@@ -289,9 +312,16 @@ void FRenderSystem::ConstructGBuffer()
 	glDisable(GL_BLEND);
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LEQUAL);
+
+	// Count the fragments that are shaded into the GBuffer
+	ReadFragmentQuery();
+	glBeginQuery(GL_SAMPLES_PASSED, mFragmentQueries[mQueryFrame % FRAGMENT_QUERY_COUNT]);
 	
 	RenderGeometry();
 
+	glEndQuery(GL_SAMPLES_PASSED);
+	mQueryFrame++;
+
 	// Close the G-Buffer
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	glViewport(0, 0, Resolution.x, Resolution.y);
@@ -318,6 +348,40 @@ void FRenderSystem::LightingPass()
 		SubSystem->Update();
 }
 
+void FRenderSystem::OverdrawPass()
+{
+	// Chunks are drawn again to the back buffer in the same order as in the GBuffer
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	glBlendEquation(GL_FUNC_ADD);
+
+	mOverdrawRender.Use();
+	mChunkManager.Render(*this);
+
+	glDisable(GL_DEPTH_TEST);
+}
+
+void FRenderSystem::ReadFragmentQuery()
+{
+	// Each query is only used once every few frames
+	if (mQueryFrame < FRAGMENT_QUERY_COUNT)
+		return;
+
+	const GLuint Query = mFragmentQueries[mQueryFrame % FRAGMENT_QUERY_COUNT];
+	GLuint IsAvailable = GL_FALSE;
+	glGetQueryObjectuiv(Query, GL_QUERY_RESULT_AVAILABLE, &IsAvailable);
+
+	// Keep the last count rather than waiting on the GPU
+	if (IsAvailable)
+	{
+		GLuint64 Fragments = 0;
+		glGetQueryObjectui64v(Query, GL_QUERY_RESULT, &Fragments);
+		mGBufferFragments = Fragments;
+	}
+}
+
 //FBox FRenderSystem::GetViewBounds() const
 //{
 //	return mViewAABB;
@@ -1,28 +1,27 @@
 #include "STime.h"
 
-FClock STime::mGameClock;
-uint64_t STime::mFrameStart = 0;
-uint64_t STime::mFrameEnd = 0;
-float STime::mDeltaTime = 1.0f / 30.0f;
-float STime::mFixedUpdate = 0;
+STime::FTimeState STime::mDefaultState;
+THREAD_LOCAL STime::FTimeState* STime::mThreadState = nullptr;
 
 void STime::StartGameTimer()
 {
-	mFrameStart = FClock::ReadSystemTimer();
+	GetState().FrameStart = FClock::ReadSystemTimer();
 }
 
 void STime::UpdateGameTimer()
 {
+	FTimeState& State = GetState();
+
 	// Manage frame timers
-	mFrameEnd = FClock::ReadSystemTimer();
-	uint64_t FrameTime = mFrameEnd - mFrameStart;
+	State.FrameEnd = FClock::ReadSystemTimer();
+	uint64_t FrameTime = State.FrameEnd - State.FrameStart;
 
 	// Update the game clock with this frame's time and
 	// compute the frame delta time by taking the game timer's time
 	// before and after this update (GameTimer may be time scaled)
-	const uint64_t PreUpdateTimer = mGameClock.GetCycles();
-	mGameClock.Update(FClock::CyclesToSeconds(FrameTime));
-	const uint64_t PostUpdateTimer = mGameClock.GetCycles();
+	const uint64_t PreUpdateTimer = State.GameClock.GetCycles();
+	State.GameClock.Update(FClock::CyclesToSeconds(FrameTime));
+	const uint64_t PostUpdateTimer = State.GameClock.GetCycles();
 
 	float DeltaTime = FClock::CyclesToSeconds(PostUpdateTimer - PreUpdateTimer);
 
@@ -33,6 +32,18 @@ void STime::UpdateGameTimer()
 	}
 
 	// Set delta time for this frame
-	mDeltaTime = DeltaTime;
-	mFrameStart = mFrameEnd;
+	State.DeltaTime = DeltaTime;
+	State.FrameStart = State.FrameEnd;
+}
+
+void STime::StepGameTimer(const float TickTime)
+{
+	FTimeState& State = GetState();
+
+	const uint64_t PreUpdateTimer = State.GameClock.GetCycles();
+	State.GameClock.Update(TickTime);
+	const uint64_t PostUpdateTimer = State.GameClock.GetCycles();
+
+	State.DeltaTime = FClock::CyclesToSeconds(PostUpdateTimer - PreUpdateTimer);
+	State.FrameStart = FClock::ReadSystemTimer();
 }
\ No newline at end of file
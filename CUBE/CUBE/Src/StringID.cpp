@@ -3,23 +3,32 @@
 #include "Misc/Assertions.h"
 #include "Misc/StringUtil.h"
 #include <unordered_map>
+#include <sstream>
+#include <mutex>
 
+#ifndef NDEBUG
+// Names of all IDs, shared by every world in the process
 static std::unordered_map<uint32_t, std::string> NameMap;
+static std::mutex NameMapMutex;
+#endif
 
 FStringID::FStringID(const char* Name)
 {
 	mID = FString::HashCRC32(Name);
-	
-	if (NameMap.find(mID) == NameMap.end())
+
+#ifndef NDEBUG
+	std::lock_guard<std::mutex> Lock(NameMapMutex);
+	auto Found = NameMap.find(mID);
+	if (Found == NameMap.end())
 	{
 		// Name is a new entry into the namemap
 		NameMap[mID] = Name;
 	}
-	
-	if (NameMap[mID] != Name)
+	else if (Found->second != Name)
 	{
 		FDebug::PrintF("StringID: %s maps to an already used index and must be changed.", Name);
 	}
+#endif
 }
 
 FStringID::FStringID(const std::string& Name)
@@ -29,6 +38,13 @@ FStringID::FStringID(const std::string& Name)
 
 const std::string FStringID::GetName() const
 {
+#ifndef NDEBUG
+	std::lock_guard<std::mutex> Lock(NameMapMutex);
 	ASSERT(NameMap.find(mID) != NameMap.end() && "Trying to retrieve a key that is not in NameMap");
 	return NameMap[mID];
-}
\ No newline at end of file
+#else
+	std::ostringstream Name;
+	Name << "0x" << std::hex << std::uppercase << mID;
+	return Name.str();
+#endif
+}
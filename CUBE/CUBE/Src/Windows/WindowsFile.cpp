@@ -96,12 +96,83 @@ uint32_t FWindowsHandle::GetFileSize() const
 	return ::GetFileSize(mFileHandle, nullptr);
 }
 
+bool FWindowsHandle::ReadAt(uint8_t* DataOut, const uint32_t NumBytesToRead, const uint64_t Offset)
+{
+	// Reads with an offset don't depend on the file pointer, so handles can be shared between threads
+	OVERLAPPED Overlapped = {};
+	Overlapped.Offset = (DWORD)(Offset & 0xFFFFFFFF);
+	Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+
+	DWORD BytesRead = 0;
+	if (ReadFile(mFileHandle, DataOut, NumBytesToRead, &BytesRead, &Overlapped))
+	{
+		if (NumBytesToRead == BytesRead)
+			return true;
+	}
+
+	PrintError();
+	return false;
+}
+
+bool FWindowsHandle::WriteAt(const uint8_t* Data, const uint32_t NumBytesToWrite, const uint64_t Offset)
+{
+	OVERLAPPED Overlapped = {};
+	Overlapped.Offset = (DWORD)(Offset & 0xFFFFFFFF);
+	Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+
+	DWORD BytesWritten = 0;
+	if (WriteFile(mFileHandle, Data, NumBytesToWrite, &BytesWritten, &Overlapped))
+	{
+		if (BytesWritten == NumBytesToWrite)
+			return true;
+	}
+
+	PrintError();
+	return false;
+}
+
+bool FWindowsHandle::Reserve(const uint64_t Size)
+{
+	// Allocation sizes smaller than the file truncate it
+	LARGE_INTEGER CurrentSize;
+	if (GetFileSizeEx(mFileHandle, &CurrentSize) && (uint64_t)CurrentSize.QuadPart >= Size)
+		return true;
+
+	FILE_ALLOCATION_INFO AllocationInfo;
+	AllocationInfo.AllocationSize.QuadPart = Size;
+
+	if (SetFileInformationByHandle(mFileHandle, FileAllocationInfo, &AllocationInfo, sizeof(AllocationInfo)))
+		return true;
+
+	PrintError();
+	return false;
+}
+
+void FWindowsHandle::Advise(const EFileAdvice::Type Advice, const uint64_t Offset, const uint64_t Length)
+{
+	// Windows only takes access hints when a file is opened
+}
+
 FWindowsHandle::~FWindowsHandle()
 {
 	CloseHandle(mFileHandle);
 	mFileHandle = nullptr;
 };
 
+FWindowsMappedFile::FWindowsMappedFile(HANDLE FileHandle, HANDLE MappingHandle, const uint8_t* View, const uint64_t Size)
+	: IMappedFile(View, Size)
+	, mFileHandle(FileHandle)
+	, mMappingHandle(MappingHandle)
+{
+}
+
+FWindowsMappedFile::~FWindowsMappedFile()
+{
+	UnmapViewOfFile(mData);
+	CloseHandle(mMappingHandle);
+	CloseHandle(mFileHandle);
+}
+
 FWindowsFileSystem::FWindowsFileSystem()
 	: IFileSystem()
 {
@@ -158,6 +229,37 @@ std::unique_ptr<IFileHandle> FWindowsFileSystem::OpenReadWritable(const wchar_t*
 	return nullptr;
 }
 
+std::unique_ptr<IMappedFile> FWindowsFileSystem::MapReadable(const wchar_t* Filename)
+{
+	HANDLE FileHandle = CreateFile(Filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (FileHandle == INVALID_HANDLE_VALUE)
+	{
+		PrintError(Filename);
+		return nullptr;
+	}
+
+	// Empty files can't be mapped
+	LARGE_INTEGER Size;
+	if (!GetFileSizeEx(FileHandle, &Size) || Size.QuadPart == 0)
+	{
+		CloseHandle(FileHandle);
+		return nullptr;
+	}
+
+	HANDLE MappingHandle = CreateFileMapping(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* View = MappingHandle ? MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!View)
+	{
+		PrintError(Filename);
+		if (MappingHandle)
+			CloseHandle(MappingHandle);
+		CloseHandle(FileHandle);
+		return nullptr;
+	}
+
+	return std::unique_ptr<IMappedFile>{ new FWindowsMappedFile{ FileHandle, MappingHandle, static_cast<const uint8_t*>(View), (uint64_t)Size.QuadPart } };
+}
+
 bool FWindowsFileSystem::DeleteFilename(const wchar_t* Filename)
 {
 	if (DeleteFile(Filename))
@@ -265,6 +367,16 @@ bool FWindowsFileSystem::FileExists(const wchar_t* Filename)
 	return !(INVALID_FILE_ATTRIBUTES == GetFileAttributes(Filename) && GetLastError() == ERROR_FILE_NOT_FOUND);
 }
 
+bool FWindowsFileSystem::GetWriteTime(const wchar_t* Filename, uint64_t& TimeOut)
+{
+	WIN32_FILE_ATTRIBUTE_DATA FileInfo;
+	if (!GetFileAttributesEx(Filename, GetFileExInfoStandard, &FileInfo))
+		return false;
+
+	TimeOut = ((uint64_t)FileInfo.ftLastWriteTime.dwHighDateTime << 32) | FileInfo.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
 bool FWindowsFileSystem::SetToProgramDirectory()
 {
 	if (SetCurrentDirectory(ProgramDirectory) != 0)
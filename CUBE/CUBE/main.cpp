@@ -20,11 +20,14 @@
 #include "Atlas\ComponentTypes.h"
 #include "Components\SoundListener.h"
 #include "Components\SoundEmitter.h"
+#include "Rendering\CookedMesh.h"
+#include "Rendering\MeshLoader.h"
 
 #include "FileIO\RegionFile.h"
 
 #include "LibNoise\noise.h"
 #include "ChunkSystems\WorldGenerator.h"
+#include "ChunkSystems\ChunkGenerator.h"
 #include "Math\Vector2.h"
 #include "Utils\Event.h"
 #include "ChunkSystems\BlockTypes.h"
@@ -34,9 +37,17 @@ using namespace Atlas;
 
 int main()
 {
+	// Generates chunks missing from region files, must outlive the chunk manager
+	FChunkGenerator ChunkGenerator;
+	ChunkGenerator.SetMinHeight(160);
+	ChunkGenerator.SetMaxHeight(300);
+	ChunkGenerator.AddTerrainLevel(0, 4);    // DarkBrick
+	ChunkGenerator.AddTerrainLevel(180, 1);  // Grass
+
 	const Vector2ui Resolution{ 1920, 1080 };
 	FCubeRoot Root{ L"CUBE", Resolution, sf::Style::Default };
 	Root.GetChunkManager().SetViewDistance(14);
+	Root.GetChunkManager().SetChunkGenerator(&ChunkGenerator);
 
 	SMouseAxis::SetDefaultMousePosition(Resolution / 2);
 	SMouseAxis::SetMouseVisible(false);
@@ -77,7 +88,7 @@ int main()
 
 	std::unique_ptr<FSSAOPostProcess> SSAO{ new FSSAOPostProcess{} };
 	SSAO->SetGlobalAmbient(Vector3f{ .3f, .3f, .3f });
-	SSAO->SetKernalSize(16);
+	SSAO->SetKernalSize(8);
 	SSAO->SetNoiseSize(4);
 	SSAO->SetPower(1.25f);
 	SSAO->SetRadius(1.25f);
@@ -115,13 +126,13 @@ int main()
 	DirectionalLight.Transform.SetRotation(FQuaternion{ -130, -20, 0 });
 
 
-	SMeshHolder::Load("Box");
-	auto& BoxMesh = SMeshHolder::Get("Box");
-	BoxMesh.Mesh.LoadModel("Box.obj");
+	// Models are cooked when their .obj is newer than the cooked mesh, the cooked meshes load in the background
+	SCookedMesh::CookIfStale("Box.obj", L"Box.vcm");
+	SCookedMesh::CookIfStale("Sword.obj", L"Sword.vcm");
 
-	SMeshHolder::Load("Sword");
-	auto& SwordMesh = SMeshHolder::Get("Sword");
-	SwordMesh.Mesh.LoadModel("Sword.obj");
+	auto& MeshLoader = Root.GetMeshLoader();
+	MeshLoader.Load("Box", L"Box.vcm");
+	MeshLoader.Load("Sword", L"Sword.vcm");
 
 	//auto& PointLight = GameObjectManager.CreateGameObject();
 	//PointLight.Transform.SetPosition(Vector3f{ 260.0f, 245.0f, 260.0f });
@@ -205,10 +216,1004 @@ int main()
 //	//Generator.AddTerrainLevel(220, Dirt);
 //	//Generator.AddTerrainLevel(250, Snow);
 //
-//	Generator.Build(finalTerrain, L"NewWorld");
+//	// Rebuild the world with an increasing number of threads, the last build is kept.
+//	const uint32_t MaxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+//	for (uint32_t Threads = 1; Threads <= MaxThreads; Threads *= 2)
+//	{
+//		Generator.SetThreadCount(Threads);
+//		Generator.Build(finalTerrain, L"NewWorld");
+//
+//		const FWorldGenerator::FBuildStats Stats = Generator.GetLastBuildStats();
+//		wprintf(L"%2u threads  %5u regions  %8.2f s  %8.2f regions/s\n", Stats.ThreadCount, Stats.RegionCount,
+//			Stats.Seconds, Stats.RegionCount / Stats.Seconds);
+//	}
+//
+//	delete FileSys;
+//
+//	return 0;
+//}
+//
+
+//////////////////////////////////////
+// Chunk Pool Memory /////////////////
+//////////////////////////////////////
+//
+//// Roughly the size of a chunk's block data
+//struct FPoolBenchElement
+//{
+//	uint8_t Blocks[16384];
+//};
+//
+//template <typename PoolType>
+//void RunPoolBenchmark(PoolType& Pool, const wchar_t* Name)
+//{
+//	std::vector<FPoolBenchElement*> Live;
+//	std::mt19937 Random{ 42 };
+//	uint64_t AllocateCycles = 0, MaxAllocateCycles = 0, Allocations = 0;
+//	float CommittedMB[3];
+//
+//	auto Allocate = [&]()
+//	{
+//		const uint64_t StartTime = FClock::ReadSystemTimer();
+//		FPoolBenchElement* Element = Pool.Allocate();
+//		const uint64_t Cycles = FClock::ReadSystemTimer() - StartTime;
+//		AllocateCycles += Cycles;
+//		MaxAllocateCycles = std::max(MaxAllocateCycles, Cycles);
+//		Allocations++;
+//
+//		// Filled like a loaded chunk, so the memory is resident
+//		std::memset(Element->Blocks, 1, sizeof(Element->Blocks));
+//		Live.push_back(Element);
+//	};
+//
+//	auto Free = [&](const size_t Index)
+//	{
+//		Pool.Free(Live[Index]);
+//		Live[Index] = Live.back();
+//		Live.pop_back();
+//	};
+//
+//	// Loads a view distance worth of chunks, streams them around a moving camera, then drops to a short view distance
+//	while (Live.size() < 2048)
+//		Allocate();
+//	CommittedMB[0] = SMemoryTracker::GetStats(EMemoryTag::ChunkBlocks).LiveBytes / (1024.0f * 1024.0f);
+//
+//	for (uint32_t i = 0; i < 200000; i++)
+//	{
+//		Free(Random() % Live.size());
+//		Allocate();
+//	}
+//	CommittedMB[1] = SMemoryTracker::GetStats(EMemoryTag::ChunkBlocks).LiveBytes / (1024.0f * 1024.0f);
+//
+//	while (Live.size() > 256)
+//		Free(Random() % Live.size());
+//	CommittedMB[2] = SMemoryTracker::GetStats(EMemoryTag::ChunkBlocks).LiveBytes / (1024.0f * 1024.0f);
+//
+//	while (!Live.empty())
+//		Free(Live.size() - 1);
+//
+//	wprintf(L"%-8ls loaded %7.1f MB  streamed %7.1f MB  shrunk %7.1f MB  allocate %6.1f ns avg  %8.1f ns max\n", Name,
+//		CommittedMB[0], CommittedMB[1], CommittedMB[2], FClock::CyclesToSeconds(AllocateCycles) * 1e9f / Allocations,
+//		FClock::CyclesToSeconds(MaxAllocateCycles) * 1e9f);
+//}
+//
+//int main()
+//{
+//	// The fixed pool commits its whole capacity up front, like the chunk pools used to
+//	{
+//		FPoolAllocatorType<FPoolBenchElement, 4096> Pool{ 16, EMemoryTag::ChunkBlocks };
+//		RunPoolBenchmark(Pool, L"fixed");
+//	}
+//
+//	{
+//		FVirtualPoolAllocatorType<FPoolBenchElement, 16> Pool{ 16, 4096, EMemoryTag::ChunkBlocks };
+//		RunPoolBenchmark(Pool, L"virtual");
+//	}
+//
+//	return 0;
+//}
+//
+
+//////////////////////////////////////
+// Concurrent Pool Scaling ///////////
+//////////////////////////////////////
+//
+//struct FStressElement
+//{
+//	uint32_t Owner;
+//	uint32_t Pattern[63];
+//};
+//
+//typedef FConcurrentPoolAllocatorType<FStressElement, 64> FStressPool;
+//
+//// A mutex around the virtual pool, how the chunk pools would be shared without thread caches
+//struct FLockedStressPool
+//{
+//	FVirtualPoolAllocatorType<FStressElement, 64> Pool{ 16, 4096 };
+//	std::mutex Mutex;
+//
+//	FStressElement* Allocate() { std::lock_guard<std::mutex> Lock(Mutex); return Pool.Allocate(); }
+//	void Free(FStressElement* Data) { std::lock_guard<std::mutex> Lock(Mutex); Pool.Free(Data); }
+//	void FlushThreadCache() {}
+//	void Trim() {}
+//};
+//
+//// Allocates and fills elements, hands half of them to the next thread to free, like chunks
+//// created on the loader and destroyed on the main thread
+//template <typename PoolType>
+//void StressThread(PoolType* Pool, const uint32_t Index, const uint32_t Operations, std::vector<std::atomic<FStressElement*>>* Handoff,
+//	const uint32_t ThreadCount, std::atomic<uint32_t>* Errors)
+//{
+//	std::vector<FStressElement*> Live;
+//	std::mt19937 Random{ Index };
+//
+//	for (uint32_t i = 0; i < Operations; i++)
+//	{
+//		if (Live.size() < 64 && (Live.empty() || Random() % 2))
+//		{
+//			FStressElement* Element = Pool->Allocate();
+//			Element->Owner = Index;
+//			std::fill(std::begin(Element->Pattern), std::end(Element->Pattern), Index * 7919u + i);
+//			Live.push_back(Element);
+//			continue;
+//		}
+//
+//		FStressElement* Element = Live.back();
+//		Live.pop_back();
+//
+//		// An element handed out twice has been overwritten by another thread
+//		if (Element->Owner != Index || std::count(std::begin(Element->Pattern), std::end(Element->Pattern), Element->Pattern[0]) != 63)
+//			Errors->fetch_add(1);
+//
+//		// Frees the element the previous thread left and leaves this one for the next thread, so frees cross threads
+//		const uint32_t Next = (Index + 1) % ThreadCount;
+//		if (FStressElement* Foreign = (*Handoff)[Index].exchange(nullptr))
+//		{
+//			if (Foreign->Owner != Index || Foreign->Pattern[0] != 0)
+//				Errors->fetch_add(1);
+//			Pool->Free(Foreign);
+//		}
+//
+//		Element->Owner = Next;
+//		std::fill(std::begin(Element->Pattern), std::end(Element->Pattern), 0u);
+//		if (FStressElement* Untaken = (*Handoff)[Next].exchange(Element))
+//		{
+//			if (Untaken->Owner != Next || Untaken->Pattern[0] != 0)
+//				Errors->fetch_add(1);
+//			Pool->Free(Untaken);
+//		}
+//	}
+//
+//	for (FStressElement* Element : Live)
+//		Pool->Free(Element);
+//	Pool->FlushThreadCache();
+//}
+//
+//template <typename PoolType>
+//float RunStress(PoolType& Pool, const uint32_t ThreadCount, const uint32_t Operations, std::atomic<uint32_t>& Errors, const bool TrimConcurrently)
+//{
+//	std::vector<std::atomic<FStressElement*>> Handoff(ThreadCount);
+//	for (auto& Slot : Handoff)
+//		Slot = nullptr;
+//
+//	std::atomic<bool> IsRunning{ true };
+//	std::thread Trimmer;
+//	if (TrimConcurrently)
+//	{
+//		Trimmer = std::thread{ [&Pool, &IsRunning]()
+//		{
+//			while (IsRunning)
+//				Pool.Trim();
+//		} };
+//	}
+//
+//	const uint64_t StartTime = FClock::ReadSystemTimer();
+//	std::vector<std::thread> Threads;
+//	for (uint32_t i = 0; i < ThreadCount; i++)
+//		Threads.emplace_back(StressThread<PoolType>, &Pool, i, Operations, &Handoff, ThreadCount, &Errors);
+//	for (std::thread& Thread : Threads)
+//		Thread.join();
+//	const float Seconds = FClock::CyclesToSeconds(FClock::ReadSystemTimer() - StartTime);
+//
+//	IsRunning = false;
+//	if (Trimmer.joinable())
+//		Trimmer.join();
+//
+//	// Elements still waiting in the handoff slots
+//	for (auto& Slot : Handoff)
+//	{
+//		if (FStressElement* Element = Slot.load())
+//			Pool.Free(Element);
+//	}
+//	Pool.FlushThreadCache();
+//
+//	return Seconds;
+//}
+//
+//int main()
+//{
+//	const uint32_t Operations = 2000000;
+//	const uint32_t MaxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+//	std::atomic<uint32_t> Errors{ 0 };
+//
+//	for (uint32_t Threads = 1; Threads <= MaxThreads; Threads *= 2)
+//	{
+//		FLockedStressPool LockedPool;
+//		const float LockedSeconds = RunStress(LockedPool, Threads, Operations, Errors, false);
+//
+//		FStressPool Pool{ 16, 4096 };
+//		const float Seconds = RunStress(Pool, Threads, Operations, Errors, false);
+//
+//		// Trimming while threads allocate must never fault or hand out an element twice
+//		FStressPool TrimmedPool{ 16, 4096 };
+//		const float TrimmedSeconds = RunStress(TrimmedPool, Threads, Operations, Errors, true);
+//
+//		wprintf(L"%2u threads  locked %7.2f Mops/s  concurrent %7.2f Mops/s  with trim %7.2f Mops/s  errors %u\n", Threads,
+//			Threads * Operations / LockedSeconds / 1e6f, Threads * Operations / Seconds / 1e6f,
+//			Threads * Operations / TrimmedSeconds / 1e6f, Errors.load());
+//	}
+//
+//	return Errors.load() == 0 ? 0 : 1;
+//}
+//
+
+//////////////////////////////////////
+// Chunk Codec Conversion ////////////
+//////////////////////////////////////
+//
+//int main()
+//{
+//	IFileSystem* FileSys = new FFileSystem;
+//
+//	// Rewrites the bundled world with each codec, ending with the codec it should be stored with.
+//	const EChunkCodec::Type Codecs[] = { EChunkCodec::RLE, EChunkCodec::Palette, EChunkCodec::LZ };
+//	for (const EChunkCodec::Type Codec : Codecs)
+//	{
+//		SChunkCodecs::FReencodeReport Report;
+//		if (!SChunkCodecs::ReencodeWorld(L"ShortPrettyWorld", Codec, &Report) || Report.ChunkCount == 0)
+//			break;
+//
+//		wprintf(L"%-8s %6u chunks  %8.2f MB stored  ratio %6.2f  decode %8.1f MB/s  load %6.1f us/chunk\n",
+//			SChunkCodecs::Get(Codec)->GetName(), Report.ChunkCount,
+//			Report.EncodedBytes / (1024.0f * 1024.0f),
+//			(float)Report.RawBytes / (float)Report.EncodedBytes,
+//			(Report.RawBytes / (1024.0f * 1024.0f)) / Report.DecodeSeconds,
+//			(Report.LoadSeconds / Report.ChunkCount) * 1000000.0f);
+//	}
 //
 //	delete FileSys;
 //
 //	return 0;
 //}
 //
+
+//////////////////////////////////////
+// Camera Sweep //////////////////////
+//////////////////////////////////////
+//
+//// Waits until no chunk has been loaded for a while, the area around the viewpoints is then resident
+//void WaitForChunkLoads(FChunkManager& ChunkManager)
+//{
+//	uint64_t Loads = ChunkManager.GetResidencyStats().Loads;
+//	for (uint32_t IdlePolls = 0; IdlePolls < 20; IdlePolls++)
+//	{
+//		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+//		const uint64_t CurrentLoads = ChunkManager.GetResidencyStats().Loads;
+//		if (CurrentLoads != Loads)
+//			IdlePolls = 0;
+//		Loads = CurrentLoads;
+//	}
+//}
+//
+//int main()
+//{
+//	IFileSystem* FileSys = new FFileSystem;
+//
+//	FChunkManager* ChunkManager = new FChunkManager;
+//	ChunkManager->SetRenderingEnabled(false);
+//	ChunkManager->SetViewDistance(6);
+//	ChunkManager->LoadWorld(L"NewWorld");
+//
+//	const float Center = ChunkManager->GetWorldSize() * FChunk::CHUNK_SIZE / 2.0f;
+//	ChunkManager->SetViewpointPosition(FChunkManager::MAIN_VIEWPOINT, Vector3f{ Center, Center, Center });
+//	WaitForChunkLoads(*ChunkManager);
+//
+//	// Moves the camera back and forth over chunk boundaries, the first pass reads the chunks that come
+//	// into view from file and later passes should find them in the payload cache
+//	for (uint32_t Pass = 0; Pass < 5; Pass++)
+//	{
+//		const FChunkManager::FResidencyStats StartResidency = ChunkManager->GetResidencyStats();
+//		const FChunkPayloadCache::FStats StartCache = ChunkManager->GetPayloadCacheStats();
+//		const uint64_t StartReads = ChunkManager->GetChunkReadStats().Reads;
+//		const uint64_t StartTime = FClock::ReadSystemTimer();
+//
+//		for (const float Offset : { 2.0f, 0.0f, -2.0f, 0.0f })
+//		{
+//			ChunkManager->SetViewpointPosition(FChunkManager::MAIN_VIEWPOINT, Vector3f{ Center + Offset * FChunk::CHUNK_SIZE, Center, Center });
+//			WaitForChunkLoads(*ChunkManager);
+//		}
+//
+//		const float Seconds = FClock::CyclesToSeconds(FClock::ReadSystemTimer() - StartTime);
+//		const FChunkPayloadCache::FStats Cache = ChunkManager->GetPayloadCacheStats();
+//		const uint64_t Hits = Cache.Hits - StartCache.Hits;
+//		const uint64_t Lookups = Hits + Cache.Misses - StartCache.Misses;
+//		wprintf(L"pass %u  %6llu loads  %6llu file reads  hit rate %5.1f%%  %6.2f MB cached  %7.2f s\n", Pass,
+//			ChunkManager->GetResidencyStats().Loads - StartResidency.Loads, ChunkManager->GetChunkReadStats().Reads - StartReads,
+//			Lookups ? 100.0f * Hits / Lookups : 0.0f, Cache.Bytes / (1024.0f * 1024.0f), Seconds);
+//	}
+//
+//	delete ChunkManager;
+//	delete FileSys;
+//
+//	return 0;
+//}
+//
+
+//////////////////////////////////////
+// Chunk Codec Fuzzing ///////////////
+//////////////////////////////////////
+//
+//// Terrain-like chunks are solid below a wavy surface, random chunks have runs of random length
+//void FillTestChunk(std::mt19937& Random, const bool IsTerrain, FBlock* BlocksOut)
+//{
+//	const int32_t Size = FChunk::CHUNK_SIZE;
+//	const int32_t Surface = Random() % Size;
+//	for (int32_t i = 0; i < FChunk::BLOCKS_PER_CHUNK;)
+//	{
+//		if (IsTerrain)
+//		{
+//			const int32_t y = i / (Size * Size), x = (i / Size) % Size, z = i % Size;
+//			BlocksOut[i++] = (y < Surface + (x + z) % 5) ? FBlock{ (FBlockTypes::BlockID)(1 + y / 12) } : FBlock{};
+//			continue;
+//		}
+//
+//		const FBlock Block{ (FBlockTypes::BlockID)(Random() % 4) };
+//		for (int32_t Run = 1 + Random() % 40; Run > 0 && i < FChunk::BLOCKS_PER_CHUNK; Run--)
+//			BlocksOut[i++] = Block;
+//	}
+//}
+//
+//int main()
+//{
+//	// Run under AddressSanitizer, decoders must never read past the data or write past the blocks
+//	std::mt19937 Random{ 1234 };
+//	uint32_t Failures = 0;
+//
+//	const uint32_t GuardSize = 64;
+//	std::vector<FBlock> Blocks(FChunk::BLOCKS_PER_CHUNK);
+//	std::vector<FBlock> Decoded(FChunk::BLOCKS_PER_CHUNK + GuardSize);
+//	std::vector<uint8_t> Encoded(FChunk::MAX_ENCODED_SIZE);
+//
+//	for (uint8_t CodecID = 0; CodecID < EChunkCodec::Count; CodecID++)
+//	{
+//		const IChunkCodec* Codec = SChunkCodecs::Get(CodecID);
+//		uint32_t Accepted = 0, Rejected = 0;
+//		uint64_t EncodeCycles = 0, DecodeCycles = 0, EncodedBytes = 0;
+//
+//		for (uint32_t Chunk = 0; Chunk < 20000; Chunk++)
+//		{
+//			FillTestChunk(Random, Chunk % 2 == 0, Blocks.data());
+//
+//			// Round trip
+//			uint64_t StartTime = FClock::ReadSystemTimer();
+//			const uint32_t Size = Codec->Encode(Blocks.data(), Encoded.data());
+//			EncodeCycles += FClock::ReadSystemTimer() - StartTime;
+//			EncodedBytes += Size;
+//
+//			StartTime = FClock::ReadSystemTimer();
+//			const bool IsDecoded = Codec->Decode(Encoded.data(), Size, Decoded.data());
+//			DecodeCycles += FClock::ReadSystemTimer() - StartTime;
+//
+//			if (Size > FChunk::MAX_ENCODED_SIZE || !IsDecoded || !std::equal(Blocks.begin(), Blocks.end(), Decoded.begin()))
+//				Failures++;
+//
+//			// Corrupted copies: flipped bytes, truncated and extended data, and pure noise
+//			for (uint32_t Mutation = 0; Mutation < 10; Mutation++)
+//			{
+//				std::vector<uint8_t> Corrupt(Encoded.begin(), Encoded.begin() + Size);
+//				switch (Mutation % 4)
+//				{
+//				case 0: for (uint32_t i = 1 + Random() % 4; i > 0 && !Corrupt.empty(); i--) Corrupt[Random() % Corrupt.size()] ^= (uint8_t)(1 + Random() % 255); break;
+//				case 1: Corrupt.resize(Random() % (Corrupt.size() + 1)); break;
+//				case 2: Corrupt.resize(Corrupt.size() + 1 + Random() % 64, (uint8_t)Random()); break;
+//				case 3: Corrupt.resize(Random() % FChunk::MAX_ENCODED_SIZE); for (uint8_t& Byte : Corrupt) Byte = (uint8_t)Random(); break;
+//				}
+//
+//				std::fill(Decoded.begin() + FChunk::BLOCKS_PER_CHUNK, Decoded.end(), FBlock{ 0xAB });
+//				(Codec->Decode(Corrupt.data(), (uint32_t)Corrupt.size(), Decoded.data()) ? Accepted : Rejected)++;
+//
+//				if (std::count(Decoded.begin() + FChunk::BLOCKS_PER_CHUNK, Decoded.end(), FBlock{ 0xAB }) != GuardSize)
+//					Failures++;
+//			}
+//		}
+//
+//		const float RawMB = 20000.0f * FChunk::BLOCKS_PER_CHUNK * sizeof(FBlock) / (1024.0f * 1024.0f);
+//		wprintf(L"%-8ls ratio %6.2f  encode %8.1f MB/s  decode %8.1f MB/s  corrupt accepted %6u  rejected %6u\n", Codec->GetName(),
+//			RawMB * 1024.0f * 1024.0f / EncodedBytes, RawMB / FClock::CyclesToSeconds(EncodeCycles),
+//			RawMB / FClock::CyclesToSeconds(DecodeCycles), Accepted, Rejected);
+//	}
+//
+//	wprintf(L"%u failures\n", Failures);
+//	return Failures == 0 ? 0 : 1;
+//}
+//
+
+//////////////////////////////////////
+// Mesh Cache Load Time //////////////
+//////////////////////////////////////
+//
+//int main()
+//{
+//	IFileSystem* FileSys = new FFileSystem;
+//
+//	FChunkManager* ChunkManager = new FChunkManager;
+//	ChunkManager->SetRenderingEnabled(false);
+//	ChunkManager->SetViewDistance(14);
+//
+//	// Loaded once first, so region files are in the page cache for every measured load
+//	ChunkManager->SetMeshCacheEnabled(false);
+//	ChunkManager->LoadWorld(L"NewWorld");
+//	while (ChunkManager->GetWorldVisibleTime() <= 0.0f)
+//		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+//
+//	// Removes the sidecars saved with the world, so the first cached load starts cold
+//	const int32_t RegionCount = (ChunkManager->GetWorldSize() + FRegionFile::RegionData::REGION_SIZE - 1) / FRegionFile::RegionData::REGION_SIZE;
+//	for (int32_t i = 0; i < RegionCount * RegionCount * RegionCount; i++)
+//	{
+//		wchar_t Path[300];
+//		swprintf(Path, 300, L"./Worlds/NewWorld/x%dy%dz%d.vgm", i % RegionCount, (i / RegionCount) % RegionCount, i / (RegionCount * RegionCount));
+//		FileSys->DeleteFilename(Path);
+//	}
+//
+//	// Without the cache, then with an empty cache, then with the sidecars the cold load saved
+//	const wchar_t* Runs[] = { L"uncached", L"cold", L"warm" };
+//	for (uint32_t Run = 0; Run < 3; Run++)
+//	{
+//		ChunkManager->SetMeshCacheEnabled(Run > 0);
+//		const FChunkMeshCache::FStats StartStats = ChunkManager->GetMeshCacheStats();
+//
+//		ChunkManager->LoadWorld(L"NewWorld");
+//		while (ChunkManager->GetWorldVisibleTime() <= 0.0f)
+//			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+//
+//		const FChunkMeshCache::FStats Stats = ChunkManager->GetMeshCacheStats();
+//		wprintf(L"%-8ls visible in %6.2f s  %6llu hits  %6llu misses  %6llu stale  %8.2f MB read\n", Runs[Run],
+//			ChunkManager->GetWorldVisibleTime(), Stats.Hits - StartStats.Hits, Stats.Misses - StartStats.Misses,
+//			Stats.Stale - StartStats.Stale, (Stats.Bytes - StartStats.Bytes) / (1024.0f * 1024.0f));
+//
+//		if (Run == 1)
+//			ChunkManager->SaveWorld();
+//	}
+//
+//	delete ChunkManager;
+//	delete FileSys;
+//
+//	return 0;
+//}
+//
+
+//////////////////////////////////////
+// Cold Cache Chunk Reads ////////////
+//////////////////////////////////////
+//
+//int main()
+//{
+//	IFileSystem* FileSys = new FFileSystem;
+//	FWorldFileSystem* World = new FWorldFileSystem;
+//	World->SetWorld(L"NewWorld");
+//
+//	const int32_t WorldSize = (int32_t)World->GetWorldSize();
+//	const int32_t ChunkCount = WorldSize * WorldSize * WorldSize;
+//	const int32_t RegionCount = (WorldSize + FRegionFile::RegionData::REGION_SIZE - 1) / FRegionFile::RegionData::REGION_SIZE;
+//	FStackAllocator Scratch{ SScratchArena::ARENA_SIZE };
+//
+//	// Reads every chunk of the world one at a time, then in batches like the chunk loader
+//	for (const bool Async : { false, true })
+//	{
+//		// Drop the region files from the page cache so every read goes to disk
+//		for (int32_t i = 0; i < RegionCount * RegionCount * RegionCount; i++)
+//		{
+//			wchar_t Path[300];
+//			swprintf(Path, 300, L"%ls/x%dy%dz%d.vgr", FWorldFileSystem::TEMP_DIRECTORY_PATH,
+//				i % RegionCount, (i / RegionCount) % RegionCount, i / (RegionCount * RegionCount));
+//
+//			auto Region = FileSys->OpenReadable(Path);
+//			if (Region)
+//				Region->Advise(EFileAdvice::DontNeed);
+//		}
+//
+//		World->ResetReadStats();
+//		const uint64_t StartTime = FClock::ReadSystemTimer();
+//
+//		FWorldFileSystem::FChunkRead Reads[32];
+//		uint32_t ReadCount = 0;
+//
+//		for (int32_t i = 0; i < ChunkCount; i++)
+//		{
+//			const Vector3i ChunkPosition{ i % WorldSize, (i / WorldSize) % WorldSize, i / (WorldSize * WorldSize) };
+//			World->AddRegionFileReference(ChunkPosition);
+//			Reads[ReadCount++].ChunkPosition = ChunkPosition;
+//
+//			if (ReadCount < 32 && i + 1 < ChunkCount)
+//				continue;
+//
+//			if (Async)
+//			{
+//				FWorldFileSystem::FChunkRead* Completed[32];
+//				World->SubmitChunkReads(Reads, ReadCount, Scratch);
+//				while (World->WaitForChunkReads(Completed, 32) > 0);
+//			}
+//			else
+//			{
+//				for (uint32_t j = 0; j < ReadCount; j++)
+//					World->GetChunkData(Reads[j].ChunkPosition, Scratch, Reads[j].DataSize, Reads[j].Codec);
+//			}
+//
+//			for (uint32_t j = 0; j < ReadCount; j++)
+//				World->RemoveRegionFileReference(Reads[j].ChunkPosition);
+//
+//			Scratch.Clear();
+//			ReadCount = 0;
+//		}
+//
+//		const float Seconds = FClock::CyclesToSeconds(FClock::ReadSystemTimer() - StartTime);
+//		const FWorldFileSystem::FReadStats Stats = World->GetReadStats();
+//		wprintf(L"%-12ls %8llu chunks  %9.0f chunks/s  latency %7.3f ms  p99 %7.3f ms  max %7.3f ms  retries %llu\n",
+//			Async ? Stats.Backend : L"synchronous", Stats.Reads, Stats.Reads / Seconds, Stats.AverageLatency * 1000.0f,
+//			Stats.P99Latency * 1000.0f, Stats.MaxLatency * 1000.0f, Stats.Retries);
+//	}
+//
+//	delete World;
+//	delete FileSys;
+//
+//	return 0;
+//}
+//
+
+//////////////////////////////////////
+// Streaming Viewpoints //////////////
+//////////////////////////////////////
+//
+//int main()
+//{
+//	IFileSystem* FileSys = new FFileSystem;
+//
+//	FChunkManager* ChunkManager = new FChunkManager;
+//	ChunkManager->SetRenderingEnabled(false);
+//
+//	// Streams the world around 1, 4 and 16 viewpoints spread over the world, with slots for every viewpoint's area
+//	for (const uint32_t ViewpointCount : { 1u, 4u, 16u })
+//	{
+//		ChunkManager->SetViewDistance(4);
+//		ChunkManager->LoadWorld(L"NewWorld");
+//
+//		const float WorldSize = (float)(ChunkManager->GetWorldSize() * FChunk::CHUNK_SIZE);
+//		const uint32_t Grid = (uint32_t)std::ceil(std::sqrt((float)ViewpointCount));
+//		for (uint32_t i = 0; i < ViewpointCount; i++)
+//		{
+//			const Vector3f Position{ (i % Grid + 0.5f) * WorldSize / Grid, WorldSize / 2.0f, (i / Grid + 0.5f) * WorldSize / Grid };
+//			if (i == FChunkManager::MAIN_VIEWPOINT)
+//				ChunkManager->SetViewpointPosition(i, Position);
+//			else
+//				ChunkManager->AddViewpoint(Position, 4);
+//		}
+//
+//		ChunkManager->SetResidentChunkLimit(ViewpointCount * 9 * 5 * 9);
+//		while (ChunkManager->GetWorldVisibleTime() <= 0.0f)
+//			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+//
+//		const FChunkManager::FResidencyStats Stats = ChunkManager->GetResidencyStats();
+//		wprintf(L"%2u viewpoints  %6u requested  %6u desired  %6u resident  %6llu loads  %6llu evictions  %7.2f s\n", Stats.Viewpoints,
+//			Stats.Requested, Stats.Desired, Stats.Resident, Stats.Loads, Stats.Evictions, ChunkManager->GetWorldVisibleTime());
+//
+//		for (uint32_t i = 1; i < ViewpointCount; i++)
+//			ChunkManager->RemoveViewpoint(i);
+//	}
+//
+//	delete ChunkManager;
+//	delete FileSys;
+//
+//	return 0;
+//}
+//
+
+//////////////////////////////////////
+// Audio Voices //////////////////////
+//////////////////////////////////////
+//
+//int main()
+//{
+//	IFileSystem* FileSys = new FFileSystem;
+//
+//	// The null output mixes without a sound device, at the rate the audio system is updated
+//	FWorld World;
+//	FGameObjectManager& Objects = World.GetObjectManager();
+//	Objects.RegisterComponentType<EComponent::SoundEmitter>();
+//	Objects.RegisterComponentType<EComponent::SoundListener>();
+//	FAudioSystem& Audio = World.GetSystemManager().AddSystem<FAudioSystem>(EAudioOutput::Null);
+//
+//	FGameObject& Listener = Objects.CreateGameObject();
+//	Listener.AddComponent<EComponent::SoundListener>();
+//
+//	// Emitters on a grid around the listener all play the same looping sound, some of them moving
+//	const uint32_t EmitterCount = 2048;
+//	std::vector<FGameObject*> Emitters;
+//	for (uint32_t i = 0; i < EmitterCount; i++)
+//	{
+//		FGameObject& Object = Objects.CreateGameObject();
+//		Object.Transform.SetLocalPosition(Vector3f{ (float)(i % 64) - 32.0f, 0.0f, (float)(i / 64) - 16.0f } * 4.0f);
+//
+//		FSoundEmitter& Emitter = Object.AddComponent<EComponent::SoundEmitter>();
+//		Emitter.Filename = "Sounds/Emitter.wav";
+//		Emitter.Looping = true;
+//		Emitter.ActivateSound = true;
+//		Emitters.push_back(&Object);
+//	}
+//
+//	World.Start();
+//	STime::StartGameTimer();
+//
+//	for (const uint32_t MaxVoices : { 16u, 32u, 64u })
+//	{
+//		Audio.SetMaxVoices(MaxVoices);
+//
+//		const uint32_t FrameCount = 600;
+//		const uint64_t StartTime = FClock::ReadSystemTimer();
+//		for (uint32_t Frame = 0; Frame < FrameCount; Frame++)
+//		{
+//			for (uint32_t i = 0; i < EmitterCount; i += 8)
+//				Emitters[i]->Transform.SetLocalPosition(Emitters[i]->Transform.GetWorldPosition() + Vector3f::Right * 0.1f);
+//
+//			Audio.Update();
+//			STime::UpdateGameTimer();
+//		}
+//
+//		const float FrameTime = FClock::CyclesToSeconds(FClock::ReadSystemTimer() - StartTime) / FrameCount;
+//		const FAudioSystem::FStats Stats = Audio.GetStats();
+//		wprintf(L"%2u voices  %.3f ms per update  %u real  %u virtual  %llu virtualized  %llu 3D updates  %u sounds  hits %llu / %llu\n", MaxVoices,
+//			FrameTime * 1000.0f, Stats.RealVoices, Stats.VirtualVoices, Stats.Virtualizations, Stats.AttributeUpdates, Stats.Cache.Resident,
+//			Stats.Cache.Hits, Stats.Cache.Requests);
+//	}
+//
+//	delete FileSys;
+//
+//	return 0;
+//}
+//
+
+//////////////////////////////////////
+// Resource Lookups //////////////////
+//////////////////////////////////////
+//
+//struct FLookupResource
+//{
+//	uint32_t Value;
+//};
+//
+//int main()
+//{
+//	// A holder with as many resources as the shaders and meshes of a large scene
+//	const uint32_t ResourceCount = 256;
+//	std::vector<std::string> Names;
+//	std::map<uint32_t, uint32_t> Tree;
+//	for (uint32_t i = 0; i < ResourceCount; i++)
+//	{
+//		Names.push_back("Resource" + std::to_string(i));
+//		TResourceHolder<FLookupResource>::Load(Names.back().c_str());
+//		TResourceHolder<FLookupResource>::Get(Names.back().c_str()).Value = i;
+//		Tree[FString::HashCRC32(Names.back().c_str())] = i;
+//	}
+//
+//	// Hashing the name and searching a tree like the holder used to, hashing the name and searching
+//	// the flat table, and searching the flat table with an ID computed at compile time
+//	const uint32_t LookupCount = 10000000;
+//	uint64_t Sum = 0;
+//
+//	uint64_t StartTime = FClock::ReadSystemTimer();
+//	for (uint32_t i = 0; i < LookupCount; i++)
+//		Sum += Tree.find(FString::HashCRC32(Names[i % ResourceCount].c_str()))->second;
+//	const float TreeTime = FClock::CyclesToSeconds(FClock::ReadSystemTimer() - StartTime);
+//
+//	StartTime = FClock::ReadSystemTimer();
+//	for (uint32_t i = 0; i < LookupCount; i++)
+//		Sum += TResourceHolder<FLookupResource>::Get(Names[i % ResourceCount].c_str()).Value;
+//	const float NameTime = FClock::CyclesToSeconds(FClock::ReadSystemTimer() - StartTime);
+//
+//	StartTime = FClock::ReadSystemTimer();
+//	for (uint32_t i = 0; i < LookupCount; i++)
+//		Sum += TResourceHolder<FLookupResource>::Get(STRING_ID("Resource42")).Value;
+//	const float IDTime = FClock::CyclesToSeconds(FClock::ReadSystemTimer() - StartTime);
+//
+//	wprintf(L"Tree + hash %.1f ns  flat + hash %.1f ns  flat + STRING_ID %.1f ns  (%llu)\n", TreeTime * 1e9f / LookupCount,
+//		NameTime * 1e9f / LookupCount, IDTime * 1e9f / LookupCount, Sum);
+//
+//	return 0;
+//}
+//
+
+//////////////////////////////////////
+// Cook Meshes ///////////////////////
+//////////////////////////////////////
+//
+//int main(int argc, char* argv[])
+//{
+//	// Cooks every model given on the command line next to it, Model.obj becomes Model.vcm
+//	IFileSystem* FileSys = new FFileSystem;
+//
+//	int Result = 0;
+//	for (int i = 1; i < argc; i++)
+//	{
+//		std::string ObjFilepath{ argv[i] };
+//		std::wstring CookedFilepath{ ObjFilepath.begin(), ObjFilepath.end() - 4 };
+//		CookedFilepath += L".vcm";
+//
+//		const uint64_t StartTime = FClock::ReadSystemTimer();
+//		const bool Cooked = SCookedMesh::Cook(ObjFilepath.c_str(), CookedFilepath.c_str());
+//		wprintf(L"%hs -> %ls: %ls (%.1f ms)\n", ObjFilepath.c_str(), CookedFilepath.c_str(), Cooked ? L"cooked" : L"FAILED",
+//			FClock::CyclesToSeconds(FClock::ReadSystemTimer() - StartTime) * 1000.0f);
+//		Result |= Cooked ? 0 : 1;
+//	}
+//
+//	delete FileSys;
+//
+//	return Result;
+//}
+//
+
+//////////////////////////////////////
+// Mesh Loading //////////////////////
+//////////////////////////////////////
+//
+//int main()
+//{
+//	IFileSystem* FileSys = new FFileSystem;
+//	sf::Context Context;
+//	glewInit();
+//
+//	const char* Models[] = { "Box", "Sword" };
+//	for (const char* Model : Models)
+//	{
+//		const std::string Name{ Model };
+//		const std::wstring CookedFilepath = std::wstring{ Name.begin(), Name.end() } + L".vcm";
+//		SCookedMesh::Cook((Name + ".obj").c_str(), CookedFilepath.c_str());
+//	}
+//
+//	// Parsing the .obj text on the main thread like the game used to
+//	uint64_t StartTime = FClock::ReadSystemTimer();
+//	for (const char* Model : Models)
+//	{
+//		const uint64_t ModelStartTime = FClock::ReadSystemTimer();
+//		const std::string Name = std::string{ Model } + "Obj";
+//		SMeshHolder::Load(Name.c_str());
+//		SMeshHolder::Get(Name.c_str()).Mesh.LoadModel((std::string{ Model } + ".obj").c_str());
+//		wprintf(L"LoadModel %hs: %.2f ms\n", Model, FClock::CyclesToSeconds(FClock::ReadSystemTimer() - ModelStartTime) * 1000.0f);
+//	}
+//	const float ObjTime = FClock::CyclesToSeconds(FClock::ReadSystemTimer() - StartTime);
+//
+//	// Cooked meshes, uploaded within a 2 ms budget per 16 ms frame. The loader prints the latency of every mesh
+//	FMeshLoader Loader;
+//	StartTime = FClock::ReadSystemTimer();
+//	uint32_t Frames = 0;
+//	for (const char* Model : Models)
+//	{
+//		const std::string Name{ Model };
+//		Loader.Load(Model, (std::wstring{ Name.begin(), Name.end() } + L".vcm").c_str());
+//	}
+//	while (!Loader.IsIdle())
+//	{
+//		Loader.Update(0.002f);
+//		std::this_thread::sleep_for(std::chrono::milliseconds(14));
+//		Frames++;
+//	}
+//	glFinish();
+//	const float CookedTime = FClock::CyclesToSeconds(FClock::ReadSystemTimer() - StartTime);
+//
+//	const FMeshLoader::FStats Stats = Loader.GetStats();
+//	wprintf(L"Cold start: obj %.2f ms  cooked %.2f ms over %u frames (loader %.2f ms)\n", ObjTime * 1000.0f, CookedTime * 1000.0f, Frames,
+//		Stats.ColdStartTime * 1000.0f);
+//	wprintf(L"Per mesh latency: average %.2f ms  max %.2f ms  %.1f KB uploaded  %llu failed\n", Stats.AverageLatency * 1000.0f,
+//		Stats.MaxLatency * 1000.0f, Stats.UploadedBytes / 1024.0f, Stats.Failed);
+//
+//	delete FileSys;
+//
+//	return 0;
+//}
+//
+
+//////////////////////////////////////
+// Headless Server ///////////////////
+//////////////////////////////////////
+//
+//// Moves players around the world and has them edit blocks, stops the root after a number of ticks
+//struct FServerPlayers
+//{
+//	FCubeRoot*      Root;
+//	uint32_t        Players[16];
+//	uint32_t        PlayerCount;
+//	uint64_t        TickLimit;
+//
+//	void OnTick(uint64_t Tick)
+//	{
+//		FChunkManager& ChunkManager = Root->GetChunkManager();
+//		const float WorldSize = (float)(ChunkManager.GetWorldSize() * FChunk::CHUNK_SIZE);
+//
+//		for (uint32_t i = 0; i < PlayerCount; i++)
+//		{
+//			// Each player walks a circle of its own
+//			const float Angle = Tick * 0.002f + i;
+//			const Vector3f Position{ (i % 4 + 0.5f) * WorldSize / 4.0f + std::cos(Angle) * 48.0f, 200.0f, (i / 4 + 0.5f) * WorldSize / 4.0f + std::sin(Angle) * 48.0f };
+//			ChunkManager.SetViewpointPosition(Players[i], Position);
+//
+//			if (Tick % 30 == i)
+//				ChunkManager.SetBlock(Vector3i{ (int32_t)Position.x, (int32_t)Position.y, (int32_t)Position.z }, 4);
+//		}
+//
+//		if (Tick >= TickLimit)
+//			Root->Stop();
+//	}
+//};
+//
+//int main()
+//{
+//	const uint32_t TickRate = 30;
+//	FCubeRoot Root{ TickRate };
+//
+//	FChunkManager& ChunkManager = Root.GetChunkManager();
+//	ChunkManager.SetViewDistance(6);
+//	ChunkManager.LoadWorld(L"NewWorld");
+//
+//	// The main viewpoint is the first player
+//	FServerPlayers Players;
+//	Players.Root = &Root;
+//	Players.PlayerCount = 16;
+//	Players.TickLimit = 60 * TickRate;
+//	for (uint32_t i = 0; i < Players.PlayerCount; i++)
+//		Players.Players[i] = (i == FChunkManager::MAIN_VIEWPOINT) ? i : ChunkManager.AddViewpoint(Vector3f{}, 6);
+//	ChunkManager.SetResidentChunkLimit(Players.PlayerCount * 13 * 7 * 13);
+//
+//	Root.mOnTick.AddListener<FServerPlayers, &FServerPlayers::OnTick>(&Players);
+//	Root.Start();
+//
+//	const FCubeRoot::FTickStats Stats = Root.GetTickStats();
+//	const FChunkManager::FResidencyStats Residency = ChunkManager.GetResidencyStats();
+//	const uint32_t Cores = std::max(std::thread::hardware_concurrency(), 1u);
+//	wprintf(L"%u players  %.2f ms/tick (max %.2f ms)  %llu overruns  %u resident chunks  %.0f chunks/core  %.1f players/core at %u Hz\n",
+//		Players.PlayerCount, Stats.AverageTick * 1000.0f, Stats.MaxTick * 1000.0f, Stats.Overruns, Residency.Resident,
+//		(float)Residency.Resident / Cores, Players.PlayerCount * (1.0f / TickRate) / std::max(Stats.AverageTick, 0.0001f) / Cores, TickRate);
+//
+//	return 0;
+//}
+//
+
+//////////////////////////////////////
+// Concurrent Worlds /////////////////
+//////////////////////////////////////
+//
+//// Every world edits its own position with its own block type, no world may see the edit of another
+//static const uint32_t MAX_WORLDS = 8;
+//static const FBlockTypes::BlockID FIRST_EDIT_BLOCK = 10;
+//
+//Vector3i GetEditPosition(const float Center, const uint32_t Index)
+//{
+//	return Vector3i{ (int32_t)Center + 2 * (int32_t)Index, 200, (int32_t)Center };
+//}
+//
+//// Edits a block once the world is visible, stops the root after a number of ticks
+//struct FWorldInstance
+//{
+//	FCubeRoot*           Root;
+//	uint64_t             TickLimit;
+//	Vector3i             EditPosition;
+//	FBlockTypes::BlockID EditBlock;
+//	bool                 IsEdited;
+//
+//	void OnTick(uint64_t Tick)
+//	{
+//		FChunkManager& ChunkManager = Root->GetChunkManager();
+//		if (!IsEdited && ChunkManager.GetWorldVisibleTime() > 0.0f)
+//		{
+//			ChunkManager.SetBlock(EditPosition, EditBlock);
+//			IsEdited = true;
+//		}
+//
+//		if (Tick >= TickLimit)
+//			Root->Stop();
+//	}
+//};
+//
+//struct FWorldResult
+//{
+//	FCubeRoot::FTickStats Stats;
+//	uint32_t              Resident;
+//	float                 VisibleTime;
+//	bool                  HasOwnEdit;
+//	uint32_t              ForeignEdits;  // Edits of other worlds found in this world
+//};
+//
+//void RunWorld(const uint32_t Index, FWorldResult* ResultOut)
+//{
+//	// Each world has its own generator, it must outlive the root
+//	FChunkGenerator ChunkGenerator;
+//	ChunkGenerator.SetMinHeight(160);
+//	ChunkGenerator.SetMaxHeight(300);
+//	ChunkGenerator.AddTerrainLevel(0, 4);
+//	ChunkGenerator.AddTerrainLevel(180, 1);
+//
+//	FCubeRoot Root{ 30 };
+//	FChunkManager& ChunkManager = Root.GetChunkManager();
+//	ChunkManager.SetChunkGenerator(&ChunkGenerator);
+//	ChunkManager.SetViewDistance(4);
+//
+//	// Worlds of earlier runs were removed, so every world starts from generated terrain
+//	const std::wstring WorldName = L"Instance" + std::to_wstring(Index);
+//	const bool IsCreated = ChunkManager.CreateWorld(WorldName.c_str(), 16, 1000 + Index);
+//	ASSERT(IsCreated);
+//
+//	const float Center = ChunkManager.GetWorldSize() * FChunk::CHUNK_SIZE / 2.0f;
+//	ChunkManager.SetViewpointPosition(FChunkManager::MAIN_VIEWPOINT, Vector3f{ Center, 200.0f, Center });
+//
+//	FWorldInstance Instance{ &Root, 240, GetEditPosition(Center, Index), (FBlockTypes::BlockID)(FIRST_EDIT_BLOCK + Index), false };
+//	Root.mOnTick.AddListener<FWorldInstance, &FWorldInstance::OnTick>(&Instance);
+//	Root.Start();
+//
+//	ResultOut->Stats = Root.GetTickStats();
+//	ResultOut->Resident = ChunkManager.GetResidencyStats().Resident;
+//	ResultOut->VisibleTime = ChunkManager.GetWorldVisibleTime();
+//	ResultOut->HasOwnEdit = Instance.IsEdited && ChunkManager.GetBlock(Instance.EditPosition) == Instance.EditBlock;
+//
+//	// Generated terrain never uses the edit block types, so any of them at another world's position leaked
+//	ResultOut->ForeignEdits = 0;
+//	for (uint32_t Other = 0; Other < MAX_WORLDS; Other++)
+//	{
+//		if (Other != Index && ChunkManager.GetBlock(GetEditPosition(Center, Other)) == FIRST_EDIT_BLOCK + Other)
+//			ResultOut->ForeignEdits++;
+//	}
+//}
+//
+//int main()
+//{
+//	// Block types are shared by all worlds and must be added before they start
+//	FBlockTypes::AddBlock(1, Vector4f{ 0.11f, 0.35f, 0.15f });
+//	FBlockTypes::AddBlock(2, Vector4f{ 0.47f, 0.28f, 0.0f });
+//	FBlockTypes::AddBlock(3, Vector4f{ 1.0f, 0.98f, 0.98f });
+//	FBlockTypes::AddBlock(4, Vector4f{ 0.2f, 0.2f, 0.2f });
+//	for (uint32_t i = 0; i < MAX_WORLDS; i++)
+//		FBlockTypes::AddBlock((FBlockTypes::BlockID)(FIRST_EDIT_BLOCK + i), Vector4f{ i / (float)MAX_WORLDS, 0.0f, 1.0f });
+//
+//	// Runs 1, 2, 4 and 8 worlds at once, each on its own thread, twice to reuse the pools of destroyed worlds
+//	uint32_t SharedCount = 0;
+//	for (const uint32_t WorldCount : { 1u, 2u, 4u, 8u, 8u })
+//	{
+//		// Edits saved by an earlier run must not count for this one
+//		for (uint32_t i = 0; i < WorldCount; i++)
+//		{
+//			const std::wstring WorldPath = std::wstring{ FWorldFileSystem::WORLDS_DIRECTORY_NAME } + L"Instance" + std::to_wstring(i);
+//			IFileSystem::GetInstance().DeleteDirectory(WorldPath.c_str());
+//		}
+//
+//		std::vector<FWorldResult> Results(WorldCount);
+//		std::vector<std::thread> Threads;
+//		for (uint32_t i = 0; i < WorldCount; i++)
+//			Threads.emplace_back(RunWorld, i, &Results[i]);
+//
+//		for (std::thread& Thread : Threads)
+//			Thread.join();
+//
+//		for (uint32_t i = 0; i < WorldCount; i++)
+//		{
+//			const FWorldResult& Result = Results[i];
+//			const bool IsIsolated = Result.HasOwnEdit && Result.ForeignEdits == 0;
+//			wprintf(L"%u worlds  world %u  %.2f ms/tick (max %.2f ms)  %llu overruns  %u resident  visible in %.2f s  %ls (%u foreign edits)\n", WorldCount, i,
+//				Result.Stats.AverageTick * 1000.0f, Result.Stats.MaxTick * 1000.0f, Result.Stats.Overruns, Result.Resident, Result.VisibleTime,
+//				IsIsolated ? L"isolated" : L"SHARED STATE", Result.ForeignEdits);
+//
+//			if (!IsIsolated)
+//				SharedCount++;
+//		}
+//	}
+//
+//	// A world that lost its own edit or saw the edit of another world shares state with it
+//	ASSERT(SharedCount == 0);
+//	return (SharedCount == 0) ? 0 : 1;
+//}
+//